@@ -22,6 +22,7 @@
 #include <boost/mpi/collectives.hpp>
 
 #include "communication.hpp"
+#include "threads.hpp"
 
 using namespace std;
 using boost::mpi::communicator;
@@ -36,6 +37,8 @@ RuntimeErrorCollector(const communicator &comm) : m_comm(comm)
 void RuntimeErrorCollector::
 warning(const string &msg,
         const char* function, const char* file, const int line) {
+  /* may be called from the threaded force and integrator loops */
+  ES_OMP_PRAGMA(omp critical(runtime_error_collector))
   m_errors.emplace_back(RuntimeError::ErrorLevel::WARNING,
 			m_comm.rank(),
 			msg,
@@ -59,6 +62,7 @@ warning(const ostringstream &mstr,
 void RuntimeErrorCollector::
 error(const string &msg,
       const char* function, const char* file, const int line) {
+  ES_OMP_PRAGMA(omp critical(runtime_error_collector))
   m_errors.emplace_back(RuntimeError::ErrorLevel::ERROR,
 			m_comm.rank(),
 			msg,
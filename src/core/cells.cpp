@@ -27,6 +27,11 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <vector>
 #include "utils.hpp"
 #include "cells.hpp"
 #include "grid.hpp"
@@ -41,6 +46,8 @@
 #include "lees_edwards_domain_decomposition.hpp"
 #include "nsquare.hpp"
 #include "layered.hpp"
+#include "phase_timers.hpp"
+#include "constraint.hpp"
 
 /* Variables */
 
@@ -60,6 +67,11 @@ double max_range = 0.0;
 
 int rebuild_verletlist = 0;
 
+int sort_interval = 0;
+
+/** number of particle resorts since the last spatial sort. */
+static int resorts_since_sort = 0;
+
 /************************************************************/
 /** \name Privat Functions */
 /************************************************************/
@@ -182,6 +194,9 @@ void cells_re_init(int new_cs)
   CELL_TRACE(fprintf(stderr, "%d: cells_re_init: convert type (%d->%d)\n", this_node, cell_structure.type, new_cs));
 
   invalidate_ghosts();
+#ifdef CONSTRAINTS
+  constraints_cells_invalidate();
+#endif
 
   /* 
      CELL_TRACE({
@@ -282,6 +297,67 @@ int cells_get_n_particles()
 
 /*************************************************/
 
+std::vector<int> cells_neighbor_nodes()
+{
+  std::vector<int> nodes;
+
+  if (cell_structure.type == CELL_STRUCTURE_DOMDEC) {
+    int pos[3];
+    // the node grid is periodic, so map_array_node wraps the positions
+    for (int i=-1;i<=1;i++)
+      for (int j=-1;j<=1;j++)
+        for (int k=-1;k<=1;k++) {
+          pos[0] = node_pos[0] + i;
+          pos[1] = node_pos[1] + j;
+          pos[2] = node_pos[2] + k;
+          int node = map_array_node(pos);
+          if (node != this_node)
+            nodes.push_back(node);
+        }
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+  }
+  else {
+    for (int node=0;node<n_nodes;node++)
+      if (node != this_node)
+        nodes.push_back(node);
+  }
+  return nodes;
+}
+
+void cells_neighbor_exchange(const void *send, int n_bytes, std::vector<char> &recv)
+{
+  std::vector<int> nodes = cells_neighbor_nodes();
+  int n = nodes.size();
+  if (n == 0)
+    return;
+
+  std::vector<int> n_recv(n);
+  std::vector<MPI_Request> req(2*n);
+
+  for (int i=0;i<n;i++) {
+    MPI_Irecv(&n_recv[i], 1, MPI_INT, nodes[i], SOME_TAG, comm_cart, &req[2*i]);
+    MPI_Isend(&n_bytes, 1, MPI_INT, nodes[i], SOME_TAG, comm_cart, &req[2*i + 1]);
+  }
+  MPI_Waitall(2*n, req.data(), MPI_STATUSES_IGNORE);
+
+  int offset = recv.size(), total = 0;
+  for (int i=0;i<n;i++)
+    total += n_recv[i];
+  recv.resize(offset + total);
+
+  for (int i=0;i<n;i++) {
+    MPI_Irecv(recv.data() + offset, n_recv[i], MPI_BYTE,
+              nodes[i], SOME_TAG, comm_cart, &req[2*i]);
+    MPI_Isend(const_cast<void *>(send), n_bytes, MPI_BYTE,
+              nodes[i], SOME_TAG, comm_cart, &req[2*i + 1]);
+    offset += n_recv[i];
+  }
+  MPI_Waitall(2*n, req.data(), MPI_STATUSES_IGNORE);
+}
+
+/*************************************************/
+
 void print_local_particle_positions()
 {
   Cell *cell;
@@ -349,6 +425,11 @@ void cells_resort_particles(int global_flag)
     break;
   }
 
+  if (sort_interval > 0 && ++resorts_since_sort >= sort_interval) {
+    cells_spatial_sort_particles();
+    resorts_since_sort = 0;
+  }
+
 #ifdef ADDITIONAL_CHECKS
   /* at the end of the day, everything should be consistent again */
   check_particle_consistency();
@@ -409,6 +490,70 @@ void local_sort_particles()
 
 /*************************************************/
 
+/** Spread the lower 21 bits of i such that there are two zero bits
+    between each of them. */
+static uint64_t morton_spread(uint64_t i)
+{
+  i &= 0x1fffff;
+  i = (i | i << 32) & 0x1f00000000ffffULL;
+  i = (i | i << 16) & 0x1f0000ff0000ffULL;
+  i = (i | i << 8)  & 0x100f00f00f00f00fULL;
+  i = (i | i << 4)  & 0x10c30c30c30c30c3ULL;
+  i = (i | i << 2)  & 0x1249249249249249ULL;
+  return i;
+}
+
+/** Position of a particle along the Morton curve through the box,
+    with 2^21 points per box length. */
+static uint64_t morton_key(const Particle *p)
+{
+  uint64_t key = 0;
+  for (int d = 0; d < 3; d++) {
+    double x = p->r.p[d]*box_l_i[d];
+    x -= floor(x);
+    uint64_t q = std::min<uint64_t>((uint64_t)(x*2097152.0), 2097151);
+    key |= morton_spread(q) << d;
+  }
+  return key;
+}
+
+void cells_spatial_sort_particles()
+{
+  CELL_TRACE(fprintf(stderr, "%d: entering cells_spatial_sort_particles\n", this_node));
+
+  static std::vector<std::pair<uint64_t, int> > keys;
+  static Particle *buffer = NULL;
+  static int buffer_max = 0;
+
+  for (int c = 0; c < local_cells.n; c++) {
+    Cell *cell  = local_cells.cell[c];
+    Particle *p = cell->part;
+    int np      = cell->n;
+
+    if (np < 2)
+      continue;
+
+    keys.resize(np);
+    for (int i = 0; i < np; i++)
+      keys[i] = std::make_pair(morton_key(&p[i]), i);
+    std::sort(keys.begin(), keys.end());
+
+    if (np > buffer_max) {
+      buffer_max = np;
+      buffer = (Particle *) Utils::realloc(buffer, buffer_max*sizeof(Particle));
+    }
+    /* the particles are moved as a whole, including the pointers to
+       their bond and exclusion lists */
+    memcpy(buffer, p, np*sizeof(Particle));
+    for (int i = 0; i < np; i++)
+      memcpy(&p[i], &buffer[keys[i].second], sizeof(Particle));
+
+    update_local_particles(cell);
+  }
+}
+
+/*************************************************/
+
 void cells_on_geometry_change(int flags)
 {
   if (max_cut > 0.0) {
@@ -420,6 +565,11 @@ void cells_on_geometry_change(int flags)
 
   CELL_TRACE(fprintf(stderr,"%d: on_geometry_change with max range %f\n", this_node, max_range));
 
+#ifdef CONSTRAINTS
+  /* the constraints in range of the cells have to be redetermined */
+  constraints_cells_invalidate();
+#endif
+
   switch (cell_structure.type) {
   case CELL_STRUCTURE_DOMDEC:
     dd_on_geometry_change(flags);
@@ -465,6 +615,7 @@ void cells_update_ghosts()
     resort_particles = 1;
 
   if (resort_particles) {
+    phase_timer_begin(PHASE_RESORT);
 #ifdef LEES_EDWARDS
     /* Communication step:  number of ghosts and ghost information */
     cells_resort_particles(CELL_GLOBAL_EXCHANGE);
@@ -472,12 +623,24 @@ void cells_update_ghosts()
     /* Communication step:  number of ghosts and ghost information */
     cells_resort_particles(CELL_NEIGHBOR_EXCHANGE);
 #endif
+    phase_timer_end(PHASE_RESORT);
   }
   else
     /* Communication step: ghost information */
     ghost_communicator(&cell_structure.update_ghost_pos_comm);
 }
 
+void cells_start_update_ghosts()
+{
+  if (cell_structure.type == CELL_STRUCTURE_DOMDEC && dd.use_vList &&
+      dd.n_colors > 0 && !resort_particles && !rebuild_verletlist)
+    ghost_communicator_begin(&cell_structure.update_ghost_pos_comm);
+  else
+    cells_update_ghosts();
+}
+
+/*************************************************/
+
 /*************************************************/
 
 void print_ghost_positions()
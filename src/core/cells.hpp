@@ -61,6 +61,7 @@
    </ul>
 */
 
+#include <vector>
 #include "particle_data.hpp"
 #include "ghosts.hpp"
 #include "verlet.hpp"
@@ -195,6 +196,11 @@ extern double max_range;
     rebuilt. */
 extern int rebuild_verletlist;
 
+/** Number of particle resorts, i.e. Verlet list rebuilds, between two
+    calls of \ref cells_spatial_sort_particles, or 0 to never sort the
+    particles in space. */
+extern int sort_interval;
+
 /*@}*/
 
 /************************************************************/
@@ -260,10 +266,27 @@ void cells_on_geometry_change(int flags);
     also a resorting of the particles takes place. */
 void cells_update_ghosts();
 
+/** Like \ref cells_update_ghosts, but if no resorting is necessary and
+    the Verlet lists are valid, the ghost positions of the domain
+    decomposition are only sent off (\ref ghost_communicator_begin).
+    Then the forces within the inner cells can be calculated while the
+    data is in flight, see \ref calculate_verlet_ia. */
+void cells_start_update_ghosts();
+
 /** Calculate and return the total number of particles on this
     node. */
 int cells_get_n_particles();
 
+/** The ranks of the nodes that can have a particle that is a ghost
+    on this node, without this node. For the domain decomposition,
+    these are the neighbors in the node grid, for the other cell
+    systems all nodes. */
+std::vector<int> cells_neighbor_nodes();
+
+/** Send n_bytes from send to all \ref cells_neighbor_nodes and append
+    the data they send to recv. Has to be called on all nodes. */
+void cells_neighbor_exchange(const void *send, int n_bytes, std::vector<char> &recv);
+
 /** Debug function to print particle positions. */
 void print_local_particle_positions();
 
@@ -279,6 +302,15 @@ void check_resort_particles();
 /* Do a strict particle sorting, including order in the cells. */
 void local_sort_particles();
 
+/** Sort the particles within each local cell along a Morton curve
+    through the box, so that particles that are close in space are
+    also close in memory, and update \ref local_particles. The order
+    of the cells is not changed, since the neighbor cell lists and the
+    ghost communicators refer to the cells by their index. Called by
+    \ref cells_resort_particles every \ref sort_interval resorts,
+    before the ghosts are exchanged. */
+void cells_spatial_sort_particles();
+
 /*@}*/
 
 #endif
@@ -0,0 +1,1060 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file checkpoint.cpp
+ *
+ *  Implementation of \ref checkpoint.hpp "checkpoint.hpp".
+ *
+ *  Layout of a checkpoint file, the offsets of the sections are
+ *  stored in the header:
+ *  - the \ref CheckpointHeader,
+ *  - the particle prefixes, n_nodes + 1 int64 values: the index of
+ *    the first particle of each node and the total number,
+ *  - the global section, see \ref checkpoint_write,
+ *  - the states of the random number generators, the lengths of the
+ *    states of all nodes as n_nodes int64 values, followed by the
+ *    states,
+ *  - the particle records, see \ref pack_particle,
+ *  - the lengths of the bond and exclusion lists, two ints per
+ *    particle,
+ *  - the bond lists of all particles, followed by the exclusion
+ *    lists,
+ *  - the LB populations of the global lattice, x running fastest.
+ *
+ *  All particle data is in the same order, so that each node can
+ *  locate its data from the prefixes.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "config.hpp"
+#include "checkpoint.hpp"
+#include "communication.hpp"
+#include "global.hpp"
+#include "cells.hpp"
+#include "particle_data.hpp"
+#include "interaction_data.hpp"
+#include "integrate.hpp"
+#include "initialize.hpp"
+#include "thermostat.hpp"
+#include "random.hpp"
+#include "lattice.hpp"
+#include "lb.hpp"
+#include "reaction.hpp"
+#include "statistics_correlation.hpp"
+#include "errorhandling.hpp"
+#include "utils.hpp"
+
+#include <mpi.h>
+
+/** Identification of a checkpoint file. */
+#define CHECKPOINT_MAGIC "ESCHKPT"
+/** Version of the file layout. */
+#define CHECKPOINT_VERSION 1
+
+/** The raw structs in a checkpoint, whose sizes have to match. */
+enum CheckpointStruct {
+  CHECKPOINT_PROPERTIES = 0,
+  CHECKPOINT_POSITION,
+  CHECKPOINT_MOMENTUM,
+  CHECKPOINT_FORCE,
+  CHECKPOINT_LOCAL,
+  CHECKPOINT_SWIMMING,
+  CHECKPOINT_IA,
+  CHECKPOINT_BONDED_IA,
+  CHECKPOINT_N_STRUCTS
+};
+
+/** Header of a checkpoint file. */
+typedef struct {
+  char magic[8];
+  int version;
+  /** sizes of the raw structs, see \ref CheckpointStruct */
+  int struct_sizes[CHECKPOINT_N_STRUCTS];
+  /** number of nodes that wrote the checkpoint */
+  int n_nodes;
+  /** total number of particles */
+  int n_part;
+  int max_seen_particle;
+  /** global LB lattice, or 0 if there was no LB fluid */
+  int lb_grid[3];
+  /** number of populations per LB site, or 0 */
+  int lb_n_pop;
+  /** seed and step counters of the counter-based noise */
+  uint32_t noise_seed;
+  uint64_t thermo_noise_step;
+  uint64_t lb_noise_step;
+  uint64_t reaction_noise_step;
+  /** offsets of the sections */
+  int64_t prefix_offset, global_offset, rng_offset, part_offset;
+  int64_t count_offset, bond_offset, excl_offset, lb_offset;
+  /** size of the global section */
+  int64_t global_size;
+  /** total lengths of the bond and exclusion lists */
+  int64_t n_bonds, n_excl;
+} CheckpointHeader;
+
+/** Size of a particle record, see \ref pack_particle. */
+static const int record_size =
+    sizeof(ParticleProperties) + sizeof(ParticlePosition) +
+    sizeof(ParticleMomentum) + sizeof(ParticleForce) + sizeof(ParticleLocal)
+#ifdef ENGINE
+    + sizeof(ParticleParametersSwimming)
+#endif
+    ;
+
+/** The global parameters in a checkpoint, in the order in which they
+    are restored. The node grid, the number of threads and the derived
+    and read-only parameters depend on the run and are not stored. */
+static const int checkpoint_fields[] = {
+    FIELD_BOXL,           FIELD_PERIODIC,
+    FIELD_SKIN,           FIELD_TIMESTEP,
+    FIELD_SIMTIME,        FIELD_SMALLERTIMESTEP,
+    FIELD_MIN_GLOBAL_CUT, FIELD_MAXNUMCELLS,
+    FIELD_MINNUMCELLS,    FIELD_INTEG_SWITCH,
+    FIELD_NPTISO_G0,      FIELD_NPTISO_GV,
+    FIELD_NPTISO_PEXT,    FIELD_NPTISO_PDIFF,
+    FIELD_NPTISO_PISTON,  FIELD_THERMO_SWITCH,
+    FIELD_TEMPERATURE,    FIELD_LANGEVIN_GAMMA,
+    FIELD_DPD_GAMMA,      FIELD_DPD_RCUT,
+    FIELD_DPD_TGAMMA,     FIELD_DPD_TRCUT,
+    FIELD_DPD_TWF,        FIELD_DPD_WF,
+    FIELD_DPD_IGNORE_FIXED_PARTICLES,
+    FIELD_LEES_EDWARDS_OFFSET,
+    FIELD_GHMC_NMD,       FIELD_GHMC_PHI,
+    FIELD_GHMC_RES,       FIELD_GHMC_FLIP,
+    FIELD_GHMC_SCALE,     FIELD_NONBONDED_BATCH,
+    FIELD_BALANCE_INTERVAL, FIELD_SKIN_TUNE_INTERVAL,
+    FIELD_RESPA_STEPS,    FIELD_SORT_INTERVAL};
+
+/** The global section, packed by \ref checkpoint_write on the master
+    node for \ref checkpoint_common_write. */
+static std::vector<char> global_section;
+
+/** A bond type read from a checkpoint, with its tables. */
+struct StagedBond {
+  /** the plain fields, the pointers in it are not valid */
+  Bonded_ia_parameters b;
+  std::string filename;
+  std::vector<double> tables[3];
+};
+
+/** The content of the global section of a checkpoint. It is read
+    completely before any of it is applied to the simulation. */
+struct GlobalSection {
+  /** index and data of the global parameters */
+  std::vector<std::pair<int, std::vector<char>>> fields;
+  int n_types = 0;
+  std::vector<double> tab_forces, tab_energies;
+  /** the nonbonded parameters of the type pairs (i <= j) */
+  std::vector<IA_parameters> ia;
+  std::vector<StagedBond> bonds;
+  /** index and state of the matching correlations */
+  std::vector<std::pair<unsigned int, std::vector<char>>> correlations;
+};
+
+/************************************************************
+ * byte buffers
+ ************************************************************/
+
+/** Append raw data to a buffer. */
+static void put_raw(std::vector<char> &buf, const void *data, size_t size) {
+  const char *c = static_cast<const char *>(data);
+  buf.insert(buf.end(), c, c + size);
+}
+
+template <typename T> static void put(std::vector<char> &buf, const T &v) {
+  put_raw(buf, &v, sizeof(T));
+}
+
+static void put_string(std::vector<char> &buf, const char *s) {
+  int len = s ? strlen(s) : 0;
+  put(buf, len);
+  put_raw(buf, s, len);
+}
+
+/** Sequential reader of a buffer. Reading past the end yields zeros
+    and clears \ref ok. */
+class BufferReader {
+public:
+  explicit BufferReader(const std::vector<char> &buf)
+      : ok(true), m_buf(buf), m_pos(0) {}
+
+  void get_raw(void *data, size_t size) {
+    if (m_pos + size > m_buf.size()) {
+      ok = false;
+      memset(data, 0, size);
+      return;
+    }
+    memcpy(data, &m_buf[m_pos], size);
+    m_pos += size;
+  }
+
+  template <typename T> T get() {
+    T v;
+    get_raw(&v, sizeof(T));
+    return v;
+  }
+
+  std::string get_string() {
+    int len = get<int>();
+    if (!has(len, 1))
+      return std::string();
+    std::string s(&m_buf[m_pos], len);
+    m_pos += len;
+    return s;
+  }
+
+  void skip(size_t size) {
+    if (m_pos + size > m_buf.size())
+      ok = false;
+    else
+      m_pos += size;
+  }
+
+  /** Whether \a n elements of size \a size are left. Clears \ref ok
+      if not, so that sizes read from the buffer can be checked before
+      memory is allocated for them. */
+  bool has(int64_t n, size_t size) {
+    if (n < 0 || (uint64_t)n > (m_buf.size() - m_pos) / size)
+      ok = false;
+    return ok;
+  }
+
+  /** Read \a n doubles into a vector. */
+  void get_doubles(std::vector<double> &v, int64_t n) {
+    v.clear();
+    if (!has(n, sizeof(double)))
+      return;
+    v.resize(n);
+    get_raw(v.data(), n * sizeof(double));
+  }
+
+  bool ok;
+
+private:
+  const std::vector<char> &m_buf;
+  size_t m_pos;
+};
+
+/************************************************************
+ * header
+ ************************************************************/
+
+/** Fill a header with the properties of the running simulation. */
+static void init_header(CheckpointHeader *head) {
+  memset(head, 0, sizeof(CheckpointHeader));
+  strncpy(head->magic, CHECKPOINT_MAGIC, sizeof(head->magic));
+  head->version = CHECKPOINT_VERSION;
+
+  head->struct_sizes[CHECKPOINT_PROPERTIES] = sizeof(ParticleProperties);
+  head->struct_sizes[CHECKPOINT_POSITION] = sizeof(ParticlePosition);
+  head->struct_sizes[CHECKPOINT_MOMENTUM] = sizeof(ParticleMomentum);
+  head->struct_sizes[CHECKPOINT_FORCE] = sizeof(ParticleForce);
+  head->struct_sizes[CHECKPOINT_LOCAL] = sizeof(ParticleLocal);
+#ifdef ENGINE
+  head->struct_sizes[CHECKPOINT_SWIMMING] = sizeof(ParticleParametersSwimming);
+#endif
+  head->struct_sizes[CHECKPOINT_IA] = sizeof(IA_parameters);
+  head->struct_sizes[CHECKPOINT_BONDED_IA] = sizeof(Bonded_ia_parameters);
+
+  head->n_nodes = n_nodes;
+  head->n_part = n_part;
+  head->max_seen_particle = max_seen_particle;
+
+#ifdef LB
+  if (lattice_switch & LATTICE_LB) {
+    for (int d = 0; d < 3; d++)
+      head->lb_grid[d] = lblattice.global_grid[d];
+    head->lb_n_pop = 19 * LB_COMPONENTS;
+  }
+  head->lb_noise_step = lb_noise_step;
+#endif
+  head->noise_seed = Random::noise_seed;
+  head->thermo_noise_step = thermo_noise_step;
+#ifdef CATALYTIC_REACTIONS
+  head->reaction_noise_step = reaction_noise_step;
+#endif
+}
+
+/** Check that a checkpoint can be read into the running simulation.
+    Issues a runtime error if not. */
+static bool check_header(const CheckpointHeader &head, const char *filename) {
+  CheckpointHeader ref;
+  init_header(&ref);
+
+  if (memcmp(head.magic, ref.magic, sizeof(ref.magic)) != 0 ||
+      head.version != ref.version) {
+    runtimeErrorMsg() << "\"" << filename << "\" is not a checkpoint";
+    return false;
+  }
+  if (memcmp(head.struct_sizes, ref.struct_sizes, sizeof(ref.struct_sizes)) !=
+      0) {
+    runtimeErrorMsg() << "checkpoint \"" << filename
+                      << "\" was written with different features";
+    return false;
+  }
+#ifndef EXCLUSIONS
+  if (head.n_excl > 0) {
+    runtimeErrorMsg() << "checkpoint \"" << filename
+                      << "\" contains exclusions, but EXCLUSIONS is not compiled in";
+    return false;
+  }
+#endif
+  if (head.lb_n_pop > 0 &&
+      (head.lb_n_pop != ref.lb_n_pop ||
+       memcmp(head.lb_grid, ref.lb_grid, sizeof(ref.lb_grid)) != 0)) {
+    runtimeErrorMsg() << "checkpoint \"" << filename
+                      << "\" contains an LB fluid, which has to be set up "
+                         "with the same lattice before reading it";
+    return false;
+  }
+  return true;
+}
+
+/************************************************************
+ * global section
+ ************************************************************/
+
+/** Size of the data of a global parameter. */
+static int field_size(int index) {
+  switch (fields[index].type) {
+  case TYPE_INT:
+    return fields[index].dimension * sizeof(int);
+  case TYPE_DOUBLE:
+    return fields[index].dimension * sizeof(double);
+  default:
+    return sizeof(int);
+  }
+}
+
+static void pack_fields(std::vector<char> &buf) {
+  int n = sizeof(checkpoint_fields) / sizeof(int);
+  put(buf, n);
+  for (int i = 0; i < n; i++) {
+    int index = checkpoint_fields[i], size = field_size(index);
+    put(buf, index);
+    put(buf, size);
+    put_raw(buf, fields[index].data, size);
+  }
+}
+
+static bool parse_fields(BufferReader &r, GlobalSection &g) {
+  int n = r.get<int>();
+  for (int i = 0; i < n && r.ok; i++) {
+    int index = r.get<int>(), size = r.get<int>();
+    if (!r.ok || index < 0 || index > FIELD_SORT_INTERVAL ||
+        size != field_size(index))
+      return false;
+    g.fields.push_back(std::make_pair(index, std::vector<char>(size)));
+    r.get_raw(g.fields.back().second.data(), size);
+  }
+  return r.ok;
+}
+
+static void apply_fields(const GlobalSection &g) {
+  for (auto const &field : g.fields) {
+    const int index = field.first;
+    if (index == FIELD_TIMESTEP) {
+      /* also rescales the velocities, which are overwritten anyways */
+      double ts;
+      memcpy(&ts, field.second.data(), sizeof(double));
+      mpi_set_time_step(ts);
+      continue;
+    }
+    memcpy(fields[index].data, field.second.data(), field.second.size());
+    if (index == FIELD_SKIN)
+      skin_set = true;
+    mpi_bcast_parameter(index);
+  }
+}
+
+static void pack_interactions(std::vector<char> &buf) {
+  put(buf, n_particle_types);
+#ifdef TABULATED
+  put(buf, tabulated_forces.max);
+  put_raw(buf, tabulated_forces.e, tabulated_forces.max * sizeof(double));
+  put_raw(buf, tabulated_energies.e, tabulated_forces.max * sizeof(double));
+#endif
+  for (int i = 0; i < n_particle_types; i++)
+    for (int j = i; j < n_particle_types; j++)
+      put(buf, *get_ia_param(i, j));
+
+  put(buf, n_bonded_ia);
+  for (int i = 0; i < n_bonded_ia; i++) {
+    const Bonded_ia_parameters &b = bonded_ia_params[i];
+    put(buf, b);
+#ifdef TABULATED
+    if (b.type == BONDED_IA_TABULATED) {
+      put_string(buf, b.p.tab.filename);
+      put_raw(buf, b.p.tab.f, b.p.tab.npoints * sizeof(double));
+      put_raw(buf, b.p.tab.e, b.p.tab.npoints * sizeof(double));
+    }
+#endif
+#ifdef OVERLAPPED
+    if (b.type == BONDED_IA_OVERLAPPED) {
+      put_string(buf, b.p.overlap.filename);
+      put_raw(buf, b.p.overlap.para_a, b.p.overlap.noverlaps * sizeof(double));
+      put_raw(buf, b.p.overlap.para_b, b.p.overlap.noverlaps * sizeof(double));
+      put_raw(buf, b.p.overlap.para_c, b.p.overlap.noverlaps * sizeof(double));
+    }
+#endif
+  }
+}
+
+static bool parse_interactions(BufferReader &r, GlobalSection &g) {
+  g.n_types = r.get<int>();
+  if (!r.ok || g.n_types < 0)
+    return false;
+#ifdef TABULATED
+  int tab_size = r.get<int>();
+  r.get_doubles(g.tab_forces, tab_size);
+  r.get_doubles(g.tab_energies, tab_size);
+#endif
+  const int64_t n_ia = (int64_t)g.n_types * (g.n_types + 1) / 2;
+  if (!r.has(n_ia, sizeof(IA_parameters)))
+    return false;
+  g.ia.resize(n_ia);
+  for (auto &ia : g.ia)
+    r.get_raw(&ia, sizeof(IA_parameters));
+
+  int n_bonds = r.get<int>();
+  if (!r.has(n_bonds, sizeof(Bonded_ia_parameters)))
+    return false;
+  g.bonds.resize(n_bonds);
+  for (auto &bond : g.bonds) {
+    /* only the plain fields are used, the tables follow the struct */
+    r.get_raw(&bond.b, sizeof(Bonded_ia_parameters));
+#ifdef TABULATED
+    if (bond.b.type == BONDED_IA_TABULATED) {
+      bond.filename = r.get_string();
+      r.get_doubles(bond.tables[0], bond.b.p.tab.npoints);
+      r.get_doubles(bond.tables[1], bond.b.p.tab.npoints);
+    }
+#endif
+#ifdef OVERLAPPED
+    if (bond.b.type == BONDED_IA_OVERLAPPED) {
+      bond.filename = r.get_string();
+      for (int k = 0; k < 3; k++)
+        r.get_doubles(bond.tables[k], bond.b.p.overlap.noverlaps);
+    }
+#endif
+    if (!r.ok)
+      return false;
+  }
+  return true;
+}
+
+/** Release the tables of an existing bond type before it is
+    overwritten. */
+static void free_bond_tables(int i) {
+  if (i >= n_bonded_ia)
+    return;
+  Bonded_ia_parameters *b = &bonded_ia_params[i];
+#ifdef TABULATED
+  if (b->type == BONDED_IA_TABULATED) {
+    free(b->p.tab.filename);
+    if (b->p.tab.npoints > 0) {
+      free(b->p.tab.f);
+      free(b->p.tab.e);
+    }
+  }
+#endif
+#ifdef OVERLAPPED
+  if (b->type == BONDED_IA_OVERLAPPED) {
+    free(b->p.overlap.filename);
+    if (b->p.overlap.noverlaps > 0) {
+      free(b->p.overlap.para_a);
+      free(b->p.overlap.para_b);
+      free(b->p.overlap.para_c);
+    }
+  }
+#endif
+  b->type = BONDED_IA_NONE;
+}
+
+/** Newly allocated copy of a table. */
+static double *copy_table(const std::vector<double> &v) {
+  double *t = (double *)Utils::malloc(v.size() * sizeof(double));
+  if (!v.empty())
+    memcpy(t, v.data(), v.size() * sizeof(double));
+  return t;
+}
+
+static char *copy_string(const std::string &str) {
+  char *c = (char *)Utils::malloc(str.size() + 1);
+  strcpy(c, str.c_str());
+  return c;
+}
+
+static void apply_interactions(const GlobalSection &g) {
+  mpi_bcast_n_particle_types(g.n_types);
+#ifdef TABULATED
+  const int tab_size = g.tab_forces.size();
+  realloc_doublelist(&tabulated_forces, tab_size);
+  realloc_doublelist(&tabulated_energies, tab_size);
+  tabulated_forces.n = tabulated_energies.n = tab_size;
+  if (tab_size > 0) {
+    memcpy(tabulated_forces.e, g.tab_forces.data(), tab_size * sizeof(double));
+    memcpy(tabulated_energies.e, g.tab_energies.data(),
+           tab_size * sizeof(double));
+  }
+#endif
+  int k = 0;
+  for (int i = 0; i < g.n_types; i++)
+    for (int j = i; j < g.n_types; j++) {
+      *get_ia_param(i, j) = g.ia[k++];
+      mpi_bcast_ia_params(i, j);
+    }
+
+  for (int i = 0; i < (int)g.bonds.size(); i++) {
+    const StagedBond &bond = g.bonds[i];
+    free_bond_tables(i);
+    make_bond_type_exist(i);
+    Bonded_ia_parameters *b = &bonded_ia_params[i];
+    *b = bond.b;
+#ifdef TABULATED
+    if (b->type == BONDED_IA_TABULATED) {
+      b->p.tab.filename = copy_string(bond.filename);
+      b->p.tab.f = copy_table(bond.tables[0]);
+      b->p.tab.e = copy_table(bond.tables[1]);
+    }
+#endif
+#ifdef OVERLAPPED
+    if (b->type == BONDED_IA_OVERLAPPED) {
+      b->p.overlap.filename = copy_string(bond.filename);
+      b->p.overlap.para_a = copy_table(bond.tables[0]);
+      b->p.overlap.para_b = copy_table(bond.tables[1]);
+      b->p.overlap.para_c = copy_table(bond.tables[2]);
+    }
+#endif
+    mpi_bcast_ia_params(i, -1);
+  }
+}
+
+/** Number of dimensions of a correlation in a checkpoint. */
+#define CORRELATION_N_DIMS 8
+
+static void correlation_dims(const double_correlation *c,
+                             unsigned int dims[CORRELATION_N_DIMS]) {
+  dims[0] = c->finalized;
+  dims[1] = c->autocorrelation;
+  dims[2] = c->dim_A;
+  dims[3] = c->dim_B;
+  dims[4] = c->dim_corr;
+  dims[5] = c->tau_lin;
+  dims[6] = c->hierarchy_depth;
+  dims[7] = c->n_result;
+}
+
+/** The state of a correlation, in the same order as in \ref
+    double_correlation_write_data_to_file. */
+static std::vector<std::pair<void *, size_t>>
+correlation_state(double_correlation *c) {
+  std::vector<std::pair<void *, size_t>> s;
+  const size_t n_buffer = c->hierarchy_depth * (c->tau_lin + 1);
+  s.push_back(std::make_pair(c->A_data, n_buffer * c->dim_A * sizeof(double)));
+  if (!c->autocorrelation)
+    s.push_back(
+        std::make_pair(c->B_data, n_buffer * c->dim_B * sizeof(double)));
+  s.push_back(std::make_pair(c->result_data,
+                             c->n_result * c->dim_corr * sizeof(double)));
+  s.push_back(std::make_pair(c->n_sweeps, c->n_result * sizeof(unsigned int)));
+  s.push_back(
+      std::make_pair(c->n_vals, c->hierarchy_depth * sizeof(unsigned int)));
+  s.push_back(
+      std::make_pair(c->newest, c->hierarchy_depth * sizeof(unsigned int)));
+  s.push_back(std::make_pair(c->A_accumulated_average,
+                             c->dim_A * sizeof(double)));
+  s.push_back(std::make_pair(c->A_accumulated_variance,
+                             c->dim_A * sizeof(double)));
+  if (!c->autocorrelation) {
+    s.push_back(std::make_pair(c->B_accumulated_average,
+                               c->dim_B * sizeof(double)));
+    s.push_back(std::make_pair(c->B_accumulated_variance,
+                               c->dim_B * sizeof(double)));
+  }
+  s.push_back(std::make_pair(&c->n_data, sizeof(unsigned int)));
+  s.push_back(std::make_pair(&c->t, sizeof(unsigned int)));
+  s.push_back(std::make_pair(&c->last_update, sizeof(double)));
+  return s;
+}
+
+static void pack_correlations(std::vector<char> &buf) {
+  put(buf, n_correlations);
+  for (unsigned int i = 0; i < n_correlations; i++) {
+    unsigned int dims[CORRELATION_N_DIMS];
+    correlation_dims(&correlations[i], dims);
+    put_raw(buf, dims, sizeof(dims));
+
+    std::vector<std::pair<void *, size_t>> state;
+    if (!correlations[i].finalized)
+      state = correlation_state(&correlations[i]);
+    int64_t size = 0;
+    for (auto const &s : state)
+      size += s.second;
+    put(buf, size);
+    for (auto const &s : state)
+      put_raw(buf, s.first, s.second);
+  }
+}
+
+/** Collect the states of the correlations that match the ones in the
+    checkpoint, the others are skipped with a warning. */
+static bool parse_correlations(BufferReader &r, GlobalSection &g) {
+  unsigned int n = r.get<unsigned int>();
+  for (unsigned int i = 0; i < n && r.ok; i++) {
+    unsigned int dims[CORRELATION_N_DIMS], ref[CORRELATION_N_DIMS];
+    r.get_raw(dims, sizeof(dims));
+    int64_t size = r.get<int64_t>();
+    if (i < n_correlations)
+      correlation_dims(&correlations[i], ref);
+    if (!r.has(size, 1))
+      return false;
+
+    if (i >= n_correlations || memcmp(dims, ref, sizeof(dims)) != 0 ||
+        dims[0]) {
+      if (!dims[0])
+        runtimeWarning("checkpoint: correlation " + std::to_string(i) +
+                       " does not match and was not restored\n");
+      r.skip(size);
+      continue;
+    }
+    int64_t expected = 0;
+    for (auto const &s : correlation_state(&correlations[i]))
+      expected += s.second;
+    if (size != expected)
+      return false;
+    g.correlations.push_back(std::make_pair(i, std::vector<char>(size)));
+    r.get_raw(g.correlations.back().second.data(), size);
+  }
+  return r.ok;
+}
+
+static void apply_correlations(const GlobalSection &g) {
+  for (auto const &c : g.correlations) {
+    const char *data = c.second.data();
+    for (auto const &s : correlation_state(&correlations[c.first])) {
+      memcpy(s.first, data, s.second);
+      data += s.second;
+    }
+  }
+}
+
+/************************************************************
+ * particles and LB fluid
+ ************************************************************/
+
+/** Copy the data of a particle except for the bond and exclusion
+    lists into a record of size \ref record_size. */
+static void pack_particle(char *rec, const Particle *p) {
+  memcpy(rec, &p->p, sizeof(ParticleProperties));
+  rec += sizeof(ParticleProperties);
+  memcpy(rec, &p->r, sizeof(ParticlePosition));
+  rec += sizeof(ParticlePosition);
+  memcpy(rec, &p->m, sizeof(ParticleMomentum));
+  rec += sizeof(ParticleMomentum);
+  memcpy(rec, &p->f, sizeof(ParticleForce));
+  rec += sizeof(ParticleForce);
+  memcpy(rec, &p->l, sizeof(ParticleLocal));
+#ifdef ENGINE
+  rec += sizeof(ParticleLocal);
+  memcpy(rec, &p->swim, sizeof(ParticleParametersSwimming));
+#endif
+}
+
+/** Inverse of \ref pack_particle. */
+static void unpack_particle(Particle *p, const char *rec) {
+  memcpy(&p->p, rec, sizeof(ParticleProperties));
+  rec += sizeof(ParticleProperties);
+  memcpy(&p->r, rec, sizeof(ParticlePosition));
+  rec += sizeof(ParticlePosition);
+  memcpy(&p->m, rec, sizeof(ParticleMomentum));
+  rec += sizeof(ParticleMomentum);
+  memcpy(&p->f, rec, sizeof(ParticleForce));
+  rec += sizeof(ParticleForce);
+  memcpy(&p->l, rec, sizeof(ParticleLocal));
+#ifdef ENGINE
+  rec += sizeof(ParticleLocal);
+  memcpy(&p->swim, rec, sizeof(ParticleParametersSwimming));
+#endif
+}
+
+/** Abort if an MPI-IO call failed. */
+static void check_mpi_io(int ret, const char *action, const std::string &fn) {
+  if (ret == MPI_SUCCESS)
+    return;
+  char buf[MPI_MAX_ERROR_STRING];
+  int len;
+  MPI_Error_string(ret, buf, &len);
+  buf[len] = '\0';
+  fprintf(stderr, "%d: Checkpoint Error: Could not %s \"%s\": %s\n",
+          this_node, action, fn.c_str(), buf);
+  errexit();
+}
+
+#ifdef LB
+/** Write or read the populations of the local LB sites. The local
+    lattice is a subarray of the global lattice in the file, so the
+    fluid can be read on a different node grid. */
+static void lb_io(MPI_File f, MPI_Offset offset, int n_pop, bool write,
+                  const std::string &fn) {
+  int sizes[3], subsizes[3], starts[3];
+  /* C order, so that x runs fastest */
+  for (int d = 0; d < 3; d++) {
+    sizes[2 - d] = lblattice.global_grid[d];
+    subsizes[2 - d] = lblattice.grid[d];
+    starts[2 - d] = lblattice.local_index_offset[d];
+  }
+  MPI_Datatype site, view;
+  MPI_Type_contiguous(n_pop, MPI_DOUBLE, &site);
+  MPI_Type_commit(&site);
+  MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C, site,
+                           &view);
+  MPI_Type_commit(&view);
+
+  const int n_sites = lblattice.grid[0] * lblattice.grid[1] * lblattice.grid[2];
+  std::vector<double> pop(n_sites * n_pop);
+  int ret = MPI_File_set_view(f, offset, site, view,
+                              const_cast<char *>("native"), MPI_INFO_NULL);
+  if (write) {
+    double *p = pop.data();
+    for (int z = 1; z <= lblattice.grid[2]; z++)
+      for (int y = 1; y <= lblattice.grid[1]; y++)
+        for (int x = 1; x <= lblattice.grid[0]; x++, p += n_pop)
+          lb_get_populations(get_linear_index(x, y, z, lblattice.halo_grid),
+                             p);
+    ret |= MPI_File_write_all(f, pop.data(), n_sites, site, MPI_STATUS_IGNORE);
+  } else {
+    ret |= MPI_File_read_all(f, pop.data(), n_sites, site, MPI_STATUS_IGNORE);
+    double *p = pop.data();
+    for (int z = 1; z <= lblattice.grid[2]; z++)
+      for (int y = 1; y <= lblattice.grid[1]; y++)
+        for (int x = 1; x <= lblattice.grid[0]; x++, p += n_pop)
+          lb_set_populations(get_linear_index(x, y, z, lblattice.halo_grid),
+                             p);
+    lbpar.resend_halo = 1;
+  }
+  check_mpi_io(ret, write ? "write the LB fluid to" : "read the LB fluid from",
+               fn);
+
+  MPI_Type_free(&view);
+  MPI_Type_free(&site);
+}
+#endif
+
+/************************************************************
+ * public functions
+ ************************************************************/
+
+int checkpoint_write(const char *filename) {
+  global_section.clear();
+  pack_fields(global_section);
+  pack_interactions(global_section);
+  pack_correlations(global_section);
+
+  mpi_checkpoint(filename, 1);
+
+  global_section.clear();
+  global_section.shrink_to_fit();
+  return ES_OK;
+}
+
+void checkpoint_common_write(const char *filename) {
+  const std::string fn(filename), tmp = fn + ".tmp";
+
+  /* pack the local particles */
+  std::vector<char> records;
+  std::vector<int> counts, bonds, excl;
+  for (int c = 0; c < local_cells.n; c++) {
+    Cell *cell = local_cells.cell[c];
+    for (int i = 0; i < cell->n; i++) {
+      const Particle *p = &cell->part[i];
+      records.resize(records.size() + record_size);
+      pack_particle(&records[records.size() - record_size], p);
+      counts.push_back(p->bl.n);
+      bonds.insert(bonds.end(), p->bl.e, p->bl.e + p->bl.n);
+#ifdef EXCLUSIONS
+      counts.push_back(p->el.n);
+      excl.insert(excl.end(), p->el.e, p->el.e + p->el.n);
+#else
+      counts.push_back(0);
+#endif
+    }
+  }
+  const std::string rng = Random::get_state();
+
+  /* particles, bonds, exclusions, RNG state */
+  int64_t local[4] = {(int64_t)counts.size() / 2, (int64_t)bonds.size(),
+                      (int64_t)excl.size(), (int64_t)rng.size()};
+  int64_t pref[4] = {0, 0, 0, 0}, total[4];
+  MPI_Exscan(local, pref, 4, MPI_INT64_T, MPI_SUM, comm_cart);
+  if (this_node == 0)
+    pref[0] = pref[1] = pref[2] = pref[3] = 0;
+  MPI_Allreduce(local, total, 4, MPI_INT64_T, MPI_SUM, comm_cart);
+
+  CheckpointHeader head;
+  init_header(&head);
+  head.n_part = total[0];
+  head.n_bonds = total[1];
+  head.n_excl = total[2];
+  head.global_size = global_section.size();
+  MPI_Bcast(&head.global_size, 1, MPI_INT64_T, 0, comm_cart);
+
+  head.prefix_offset = sizeof(CheckpointHeader);
+  head.global_offset = head.prefix_offset + (n_nodes + 1) * sizeof(int64_t);
+  head.rng_offset = head.global_offset + head.global_size;
+  head.part_offset = head.rng_offset + n_nodes * sizeof(int64_t) + total[3];
+  head.count_offset = head.part_offset + total[0] * record_size;
+  head.bond_offset = head.count_offset + 2 * total[0] * sizeof(int);
+  head.excl_offset = head.bond_offset + total[1] * sizeof(int);
+  head.lb_offset = head.excl_offset + total[2] * sizeof(int);
+  const int64_t file_size =
+      head.lb_offset + (int64_t)head.lb_grid[0] * head.lb_grid[1] *
+                           head.lb_grid[2] * head.lb_n_pop * sizeof(double);
+
+  MPI_File f;
+  int ret = MPI_File_open(comm_cart, const_cast<char *>(tmp.c_str()),
+                          MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &f);
+  check_mpi_io(ret, "open", tmp);
+  /* truncates a leftover of an interrupted write */
+  ret = MPI_File_set_size(f, file_size);
+
+  if (this_node == 0) {
+    ret |= MPI_File_write_at(f, 0, &head, sizeof(head), MPI_BYTE,
+                             MPI_STATUS_IGNORE);
+    ret |= MPI_File_write_at(f, head.global_offset, global_section.data(),
+                             global_section.size(), MPI_BYTE,
+                             MPI_STATUS_IGNORE);
+    ret |= MPI_File_write_at(f, head.prefix_offset + n_nodes * sizeof(int64_t),
+                             &total[0], 1, MPI_INT64_T, MPI_STATUS_IGNORE);
+  }
+  ret |= MPI_File_write_at(f, head.prefix_offset + this_node * sizeof(int64_t),
+                           &pref[0], 1, MPI_INT64_T, MPI_STATUS_IGNORE);
+  ret |= MPI_File_write_at(f, head.rng_offset + this_node * sizeof(int64_t),
+                           &local[3], 1, MPI_INT64_T, MPI_STATUS_IGNORE);
+  ret |= MPI_File_write_at(f,
+                           head.rng_offset + n_nodes * sizeof(int64_t) + pref[3],
+                           const_cast<char *>(rng.data()), rng.size(), MPI_CHAR,
+                           MPI_STATUS_IGNORE);
+
+  MPI_Datatype record;
+  MPI_Type_contiguous(record_size, MPI_BYTE, &record);
+  MPI_Type_commit(&record);
+  ret |= MPI_File_write_at_all(f, head.part_offset + pref[0] * record_size,
+                               records.data(), local[0], record,
+                               MPI_STATUS_IGNORE);
+  MPI_Type_free(&record);
+  ret |= MPI_File_write_at_all(f, head.count_offset + 2 * pref[0] * sizeof(int),
+                               counts.data(), counts.size(), MPI_INT,
+                               MPI_STATUS_IGNORE);
+  ret |= MPI_File_write_at_all(f, head.bond_offset + pref[1] * sizeof(int),
+                               bonds.data(), bonds.size(), MPI_INT,
+                               MPI_STATUS_IGNORE);
+  ret |= MPI_File_write_at_all(f, head.excl_offset + pref[2] * sizeof(int),
+                               excl.data(), excl.size(), MPI_INT,
+                               MPI_STATUS_IGNORE);
+  check_mpi_io(ret, "write", tmp);
+
+#ifdef LB
+  /* changes the file view, so this comes last */
+  if (head.lb_n_pop > 0)
+    lb_io(f, head.lb_offset, head.lb_n_pop, true, tmp);
+#endif
+
+  MPI_File_close(&f);
+
+  if (this_node == 0 && rename(tmp.c_str(), fn.c_str()) != 0) {
+    fprintf(stderr, "Checkpoint Error: Could not rename \"%s\" to \"%s\".\n",
+            tmp.c_str(), fn.c_str());
+    errexit();
+  }
+}
+
+int checkpoint_read(const char *filename) {
+  CheckpointHeader head;
+  std::vector<char> global;
+
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    runtimeErrorMsg() << "could not open checkpoint \"" << filename << "\"";
+    return ES_ERROR;
+  }
+  bool ok = fread(&head, sizeof(head), 1, fp) == 1;
+  if (ok && head.global_size >= 0) {
+    global.resize(head.global_size);
+    ok = fseek(fp, head.global_offset, SEEK_SET) == 0 &&
+         fread(global.data(), 1, global.size(), fp) == global.size();
+  }
+  fclose(fp);
+  if (!ok) {
+    runtimeErrorMsg() << "could not read checkpoint \"" << filename << "\"";
+    return ES_ERROR;
+  }
+  if (!check_header(head, filename))
+    return ES_ERROR;
+
+  /* nothing is changed before the whole global section was read */
+  GlobalSection g;
+  BufferReader r(global);
+  if (!parse_fields(r, g) || !parse_interactions(r, g) ||
+      !parse_correlations(r, g)) {
+    runtimeErrorMsg() << "checkpoint \"" << filename << "\" is corrupt";
+    return ES_ERROR;
+  }
+
+  /* the particles go first, so that changing the box does not move
+     them around */
+  remove_all_particles();
+  apply_fields(g);
+  apply_interactions(g);
+  apply_correlations(g);
+
+  mpi_checkpoint(filename, 0);
+  build_particle_node();
+  return ES_OK;
+}
+
+void checkpoint_common_read(const char *filename) {
+  const std::string fn(filename);
+  MPI_File f;
+  int ret = MPI_File_open(comm_cart, const_cast<char *>(fn.c_str()),
+                          MPI_MODE_RDONLY, MPI_INFO_NULL, &f);
+  check_mpi_io(ret, "open", fn);
+
+  CheckpointHeader head;
+  if (this_node == 0)
+    ret = MPI_File_read_at(f, 0, &head, sizeof(head), MPI_BYTE,
+                           MPI_STATUS_IGNORE);
+  MPI_Bcast(&head, sizeof(head), MPI_BYTE, 0, comm_cart);
+
+  /* on the same number of nodes, each node reads its own particles,
+     otherwise an equal share */
+  int64_t first, n_local;
+  if (head.n_nodes == n_nodes) {
+    int64_t range[2];
+    ret |= MPI_File_read_at(f, head.prefix_offset + this_node * sizeof(int64_t),
+                            range, 2, MPI_INT64_T, MPI_STATUS_IGNORE);
+    first = range[0];
+    n_local = range[1] - range[0];
+  } else {
+    first = (int64_t)head.n_part * this_node / n_nodes;
+    n_local = (int64_t)head.n_part * (this_node + 1) / n_nodes - first;
+  }
+
+  std::vector<char> records(n_local * record_size);
+  std::vector<int> counts(2 * n_local);
+  MPI_Datatype record;
+  MPI_Type_contiguous(record_size, MPI_BYTE, &record);
+  MPI_Type_commit(&record);
+  ret |= MPI_File_read_at_all(f, head.part_offset + first * record_size,
+                              records.data(), n_local, record,
+                              MPI_STATUS_IGNORE);
+  MPI_Type_free(&record);
+  ret |= MPI_File_read_at_all(f, head.count_offset + 2 * first * sizeof(int),
+                              counts.data(), counts.size(), MPI_INT,
+                              MPI_STATUS_IGNORE);
+
+  int64_t local[2] = {0, 0}, pref[2] = {0, 0};
+  for (int64_t i = 0; i < n_local; i++) {
+    local[0] += counts[2 * i];
+    local[1] += counts[2 * i + 1];
+  }
+  MPI_Exscan(local, pref, 2, MPI_INT64_T, MPI_SUM, comm_cart);
+  if (this_node == 0)
+    pref[0] = pref[1] = 0;
+
+  std::vector<int> bonds(local[0]), excl(local[1]);
+  ret |= MPI_File_read_at_all(f, head.bond_offset + pref[0] * sizeof(int),
+                              bonds.data(), bonds.size(), MPI_INT,
+                              MPI_STATUS_IGNORE);
+  ret |= MPI_File_read_at_all(f, head.excl_offset + pref[1] * sizeof(int),
+                              excl.data(), excl.size(), MPI_INT,
+                              MPI_STATUS_IGNORE);
+
+  /* the generators can only be assigned to the same nodes */
+  if (head.n_nodes == n_nodes) {
+    std::vector<int64_t> lens(n_nodes);
+    ret |= MPI_File_read_at(f, head.rng_offset, lens.data(), n_nodes,
+                            MPI_INT64_T, MPI_STATUS_IGNORE);
+    int64_t offset = head.rng_offset + n_nodes * sizeof(int64_t);
+    for (int i = 0; i < this_node; i++)
+      offset += lens[i];
+    std::vector<char> state(lens[this_node]);
+    ret |= MPI_File_read_at(f, offset, state.data(), state.size(), MPI_CHAR,
+                            MPI_STATUS_IGNORE);
+    Random::set_state(std::string(state.begin(), state.end()));
+  }
+  check_mpi_io(ret, "read", fn);
+
+#ifdef LB
+  if (head.lb_n_pop > 0)
+    lb_io(f, head.lb_offset, head.lb_n_pop, false, fn);
+  lb_noise_step = head.lb_noise_step;
+#endif
+  Random::noise_seed = head.noise_seed;
+  thermo_noise_step = head.thermo_noise_step;
+#ifdef CATALYTIC_REACTIONS
+  reaction_noise_step = head.reaction_noise_step;
+#endif
+
+  MPI_File_close(&f);
+
+  /* the master has removed all particles before */
+  n_part = head.n_part;
+  max_seen_particle = head.max_seen_particle;
+  realloc_local_particles(max_seen_particle);
+  for (int i = 0; i <= max_seen_particle; i++)
+    local_particles[i] = NULL;
+
+  /* put the particles into the first cell, the resort below sends
+     them to their nodes and cells */
+  Cell *cell = local_cells.cell[0];
+  realloc_particlelist(cell, cell->n + n_local);
+  const int *b = bonds.data();
+#ifdef EXCLUSIONS
+  const int *e = excl.data();
+#endif
+  for (int64_t i = 0; i < n_local; i++) {
+    Particle *p = &cell->part[cell->n++];
+    init_particle(p);
+    unpack_particle(p, &records[i * record_size]);
+
+    const int n_b = counts[2 * i];
+    realloc_intlist(&p->bl, n_b);
+    p->bl.n = n_b;
+    memcpy(p->bl.e, b, n_b * sizeof(int));
+    b += n_b;
+#ifdef EXCLUSIONS
+    const int n_e = counts[2 * i + 1];
+    realloc_intlist(&p->el, n_e);
+    p->el.n = n_e;
+    memcpy(p->el.e, e, n_e * sizeof(int));
+    e += n_e;
+#endif
+  }
+  update_local_particles(cell);
+
+  cells_resort_particles(CELL_GLOBAL_EXCHANGE);
+  rebuild_verletlist = 1;
+  on_particle_change();
+}
@@ -0,0 +1,79 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+/** \file checkpoint.hpp
+ *
+ *  Parallel binary checkpoints of the simulation state.
+ *
+ *  A checkpoint is a single file that all nodes write and read
+ *  collectively with MPI-IO. It contains
+ *  - the global parameters that are set via setmd, the bonded and
+ *    non-bonded short range interaction parameters and the state of
+ *    the correlations, written by the master node,
+ *  - the state of the random number generators of all nodes and
+ *    the counters of the thermal noise,
+ *  - the complete data of all particles, including bond and
+ *    exclusion lists,
+ *  - the populations of the lattice Boltzmann fluid (CPU).
+ *
+ *  The particles are stored in the order of the nodes, and the fluid
+ *  in the order of the global lattice, so that a checkpoint can be
+ *  read on a different number of nodes. In that case, each node reads
+ *  an equal share of the particles, which are then sent to their
+ *  nodes, and the random number generators of the nodes are not
+ *  restored.
+ *
+ *  The data is written in the native binary format, the particle and
+ *  interaction parameters as the raw structs. A checkpoint can
+ *  therefore only be read by a binary with the same features on the
+ *  same architecture, which is checked via the sizes of the structs.
+ *
+ *  Objects that are created by commands, i.e. the LB fluid, the
+ *  electrostatics and magnetostatics methods, constraints,
+ *  observables and correlations, are not part of the checkpoint. They
+ *  have to be set up again before reading it, and then their state is
+ *  taken from the checkpoint.
+ *
+ *  The file is written under a temporary name first, which replaces
+ *  the old checkpoint only after it is complete.
+ */
+
+/** Write a checkpoint. Must be called on the master node only.
+ *
+ *  \param filename name of the checkpoint file.
+ *  \return ES_OK or ES_ERROR.
+ */
+int checkpoint_write(const char *filename);
+
+/** Read a checkpoint. Must be called on the master node only.
+ *
+ *  \param filename name of the checkpoint file.
+ *  \return ES_OK or ES_ERROR, in which case a runtime error was
+ *  issued.
+ */
+int checkpoint_read(const char *filename);
+
+/** Collective part of \ref checkpoint_write, called on all nodes. */
+void checkpoint_common_write(const char *filename);
+
+/** Collective part of \ref checkpoint_read, called on all nodes. */
+void checkpoint_common_read(const char *filename);
+
+#endif
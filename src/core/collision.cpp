@@ -17,12 +17,16 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>. 
 */
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
 #include "collision.hpp"
 #include "cells.hpp"
 #include "communication.hpp"
 #include "errorhandling.hpp"
 #include "grid.hpp"
 #include "domain_decomposition.hpp"
+#include "initialize.hpp"
 
 
 using namespace std;
@@ -41,16 +45,15 @@ typedef struct {
   int pp1; // 1st particle id
   int pp2; // 2nd particle id
   double point_of_collision[3]; 
+  // ids of the virtual sites created for pp1 and pp2, or -1
+  int vs1;
+  int vs2;
 } collision_struct;
 
-// During force calculation, colliding particles are recorded in thequeue
+// During force calculation, colliding particles are recorded in the queue
 // The queue is processed after force calculation, when it is save to add
 // particles
-static collision_struct *collision_queue = 0;
-static collision_struct *gathered_queue = 0;
-
-// Number of collisions recoreded in the queue
-static int number_of_collisions, total_collisions;
+static std::vector<collision_struct> collision_queue;
 
 /// Parameters for collision detection
 Collision_parameters collision_params = { 0, };
@@ -71,11 +74,6 @@ int collision_detection_set_params(int mode, double d, int bond_centers, int bon
     return 1;
 #endif
 
-  // For vs based methods, Binding so far only works on a single cpu
-  if ((mode & COLLISION_MODE_VS) ||(mode & COLLISION_MODE_GLUE_TO_SURF))
-    if (n_nodes != 1)
-      return 2;
-
   // Check if bonded ia exist
   if ((mode & COLLISION_MODE_BOND) &&
       (bond_centers >= n_bonded_ia))
@@ -140,15 +138,15 @@ int collision_detection_set_params(int mode, double d, int bond_centers, int bon
   return 0;
 }
 
-//* Allocate memory for the collision queue /
+//* Reset the collision queue /
 void prepare_collision_queue()
 {
  TRACE(printf("%d: Prepare_collision_queue()\n",this_node));
-  number_of_collisions=0;
+  collision_queue.clear();
 }
 
 
-bool bond_exists(Particle* p, Particle* partner, int bond_type)
+bool bond_exists(Particle* p, int partner, int bond_type)
 {
   // First check the bonds of p1
   if (p->bl.e) {
@@ -157,7 +155,7 @@ bool bond_exists(Particle* p, Particle* partner, int bond_type)
       int size = bonded_ia_params[p->bl.e[i]].num;
       
       if (p->bl.e[i] == bond_type &&
-          p->bl.e[i + 1] == partner->p.identity) {
+          p->bl.e[i + 1] == partner) {
         // There's a bond, already. Nothing to do for these particles
         return true;
       }
@@ -170,16 +168,12 @@ bool bond_exists(Particle* p, Particle* partner, int bond_type)
 
 void queue_collision(int part1,int part2, double* point_of_collision) {
 
-    //Get memory for the new entry in the collision queue
-    number_of_collisions++;
-    if (number_of_collisions==1)
-      collision_queue = (collision_struct *) malloc(number_of_collisions*sizeof(collision_struct));
-    else
-      collision_queue = (collision_struct *) realloc (collision_queue,number_of_collisions*sizeof(collision_struct));
-    // Save the collision      
-    collision_queue[number_of_collisions-1].pp1 = part1;
-    collision_queue[number_of_collisions-1].pp2 = part2;
-    memcpy(collision_queue[number_of_collisions-1].point_of_collision,point_of_collision, 3*sizeof(double));
+    collision_struct c;
+    c.pp1 = part1;
+    c.pp2 = part2;
+    memcpy(c.point_of_collision,point_of_collision, 3*sizeof(double));
+    c.vs1 = c.vs2 = -1;
+    collision_queue.push_back(c);
     
     TRACE(printf("%d: Added to queue: Particles %d and %d at %lf %lf %lf\n",this_node,part1,part2,point_of_collision[0],point_of_collision[1],point_of_collision[2]));
 }
@@ -191,8 +185,7 @@ void detect_collision(Particle* p1, Particle* p2)
 {
   // The check, whether collision detection is actually turned on is performed in forces.hpp
 
-  int part1, part2, size;
-  int counts[n_nodes];
+  int part1, part2;
   //TRACE(printf("%d: consider particles %d and %d\n", this_node, p1->p.identity, p2->p.identity));
 
   double vec21[3];
@@ -234,11 +227,13 @@ void detect_collision(Particle* p1, Particle* p2)
   if (p1==p2)
     return;
 
-  // Check, if there's already a bond between the particles
-  if (bond_exists(p1,p2, collision_params.bond_centers))
+  // Check, if there's already a bond between the particles. The bond
+  // list of a ghost can be outdated, so the node of the particle that
+  // gets the bond checks again.
+  if (bond_exists(p1,p2->p.identity, collision_params.bond_centers))
     return;
   
-  if (bond_exists(p2,p1, collision_params.bond_centers))
+  if (bond_exists(p2,p1->p.identity, collision_params.bond_centers))
     return;
 
 
@@ -296,7 +291,13 @@ void detect_collision(Particle* p1, Particle* p2)
        new_position[i] = p1->r.p[i] - vec21[i] * c;
     }
 
-
+    // The order of the particles only matters for the glue to surface
+    // mode, otherwise the smaller id comes first
+    if (!(collision_params.mode & COLLISION_MODE_GLUE_TO_SURF) && part1 > part2) {
+      int tmp=part1;
+      part1=part2;
+      part2=tmp;
+    }
 
     queue_collision(part1,part2,new_position);
   }
@@ -403,18 +404,18 @@ void coldet_do_three_particle_bond(Particle* p, Particle* p1, Particle* p2)
 
 // If activated, throws an exception for each collision which can be
 // parsed by the script interface
-void handle_exception_throwing_for_single_collision(int i)
+void handle_exception_throwing_for_single_collision(const collision_struct &c)
 {
     if (collision_params.mode & (COLLISION_MODE_EXCEPTION)) {
 
       int id1, id2;
-      if (collision_queue[i].pp1 > collision_queue[i].pp2) {
-	id1 = collision_queue[i].pp2;
-	id2 = collision_queue[i].pp1;
+      if (c.pp1 > c.pp2) {
+	id1 = c.pp2;
+	id2 = c.pp1;
       }
       else {
-	id1 = collision_queue[i].pp1;
-	id2 = collision_queue[i].pp2;
+	id1 = c.pp1;
+	id2 = c.pp2;
       }
       ostringstream msg;
       msg << "collision between particles " << id1 << " and " <<id2;
@@ -423,339 +424,370 @@ void handle_exception_throwing_for_single_collision(int i)
 }
 
 #ifdef VIRTUAL_SITES_RELATIVE
-void place_vs_and_relate_to_particle(double* pos, int relate_to)
+// Create the virtual site vs at pos on the node of the real particle
+// relate_to, and relate it to that particle
+void place_vs_and_relate_to_particle(int vs, double* pos, int relate_to)
 {
- 
-	  place_particle(max_seen_particle+1,pos);
-	  vs_relate_to(max_seen_particle,relate_to);
-	  
-	  (local_particles[max_seen_particle])->p.isVirtual=1;
-	  #ifdef ROTATION_PER_PARTICLE
-	    (local_particles[relate_to])->p.rotation=14;
-	  #endif
-	  (local_particles[max_seen_particle])->p.type=collision_params.vs_particle_type;
+  double d[3], vs_pos[3];
+  Particle *p = local_particles[relate_to];
+
+  // Place the site next to the real particle rather than at a periodic
+  // image of the point of collision, so that it starts out on this node
+  get_mi_vector(d, pos, p->r.p);
+  for (int i=0;i<3;i++)
+    vs_pos[i] = p->r.p[i] + d[i];
+  local_place_particle(vs, vs_pos, 1);
+
+  // Placing the site can move the particles in memory
+  Particle *site = local_particles[vs];
+  p = local_particles[relate_to];
+  local_vs_relate_to(site, p);
+  site->p.isVirtual=1;
+  site->p.type=collision_params.vs_particle_type;
+#ifdef ROTATION_PER_PARTICLE
+  p->p.rotation=14;
+#endif
 }
 
 
-void bind_at_poc_create_bond_between_vs(int i)
+void bind_at_poc_create_bond_between_vs(const collision_struct &c, int vs)
 {
    int bondG[3];
 
    switch (bonded_ia_params[collision_params.bond_vs].num) {
    case 1: {
-     // Create bond between the virtual particles
-     bondG[0] = collision_params.bond_vs;
-     bondG[1] = max_seen_particle-1;
-     local_change_bond(max_seen_particle, bondG, 0);
+     // Create bond between the virtual particles, on the second one
+     if (vs == c.vs2) {
+       bondG[0] = collision_params.bond_vs;
+       bondG[1] = c.vs1;
+       local_change_bond(c.vs2, bondG, 0);
+     }
      break;
    }
    case 2: {
-     // Create 1st bond between the virtual particles
+     // Create the bond on both virtual particles
      bondG[0] = collision_params.bond_vs;
-     bondG[1] = collision_queue[i].pp1;
-     bondG[2] = collision_queue[i].pp2;
-     local_change_bond(max_seen_particle,   bondG, 0);
-     local_change_bond(max_seen_particle-1, bondG, 0);
+     bondG[1] = c.pp1;
+     bondG[2] = c.pp2;
+     local_change_bond(vs, bondG, 0);
      break;
    }
   }
 }
 
-void glue_to_surface_bind_vs_to_pp1(int i)
+void glue_to_surface_bind_vs_to_pp1(const collision_struct &c)
 {
 	 int bondG[3];
          // Create bond between the virtual particles
          bondG[0] = collision_params.bond_vs;
-         bondG[1] = max_seen_particle;
-         local_change_bond(collision_queue[i].pp1, bondG, 0);
-	 local_particles[collision_queue[i].pp1]->p.type=collision_params.part_type_after_glueing;
+         bondG[1] = c.vs2;
+         local_change_bond(c.pp1, bondG, 0);
+	 local_particles[c.pp1]->p.type=collision_params.part_type_after_glueing;
 }
 
 #endif
 
-void gather_collision_queue(int* counts)
+static bool collision_less(const collision_struct &a, const collision_struct &b)
 {
-    int displacements[n_nodes];                   // offsets into collisions
-  
-    // Initialize number of collisions gathered from all processors
-    for (int a=0;a<n_nodes;a++)
-        counts[a]=0;
-    
-    // Total number of collisions
-    MPI_Allreduce(&number_of_collisions, &total_collisions, 1, MPI_INT, MPI_SUM, comm_cart);
-    
-    if (total_collisions==0)
-      return;
-
-    // Gather number of collisions
-    MPI_Allgather(&number_of_collisions, 1, MPI_INT, counts, 1, MPI_INT, comm_cart);
-
-    // initialize displacement information for all nodes
-    displacements[0]=0;
-  
-    // Find where to place collision information for each processor
-    int byte_counts[n_nodes];
-    for (int k=1; k<n_nodes; k++)
-        displacements[k]=displacements[k-1]+(counts[k-1])*sizeof(collision_struct);
-    
-    for (int k=0; k<n_nodes; k++)
-       byte_counts[k]=counts[k]*sizeof(collision_struct);
-    
-    TRACE(printf("counts [%d] = %d and number of collisions = %d and diplacements = %d and total collisions = %d\n", this_node, counts[this_node], number_of_collisions, displacements[this_node], total_collisions));
-    
-    // Allocate mem for the new collision info
-    gathered_queue = (collision_struct *) malloc(total_collisions * sizeof(collision_struct));
-
-    // Gather collision informtion from all nodes and send it to all nodes
-    MPI_Allgatherv(collision_queue, byte_counts[this_node], MPI_BYTE, gathered_queue, byte_counts, displacements, MPI_BYTE, comm_cart);
-
-    return;
+  return (a.pp1 < b.pp1) || (a.pp1 == b.pp1 && a.pp2 < b.pp2);
 }
 
-
-// this looks in all local particles for a particle close to those in a 
-// 2-particle collision. If it finds them, it performs three particle binding
-void three_particle_binding_full_search()
+static bool collision_same(const collision_struct &a, const collision_struct &b)
 {
-  Cell *cell;
-  Particle *p, *p1, *p2;
-  // first iterate over cells, get one of the cells and find how many particles in this cell
-  for (int c=0; c<local_cells.n; c++) {
-      cell=local_cells.cell[c];
-      // iterate over particles in the cell
-      for (int a=0; a<cell->n; a++) {
-          p=&cell->part[a];
-          // for all p:
-          for (int ij=0; ij<total_collisions; ij++) {
-              p1=local_particles[gathered_queue[ij].pp1];
-              p2=local_particles[gathered_queue[ij].pp2];
-  
-  		   // Check, whether p is equal to one of the particles in the
-  		   // collision. If so, skip
-  		   if ((p->p.identity ==p1->p.identity) || ( p->p.identity == p2->p.identity)) {
-  		     continue;
-  		   }
-  
-             // The following checks, 
-  		 // if the particle p is closer that the cutoff from p1 and/or p2.
-  		 // If yes, three particle bonds are created on all particles
-  		 // which have two other particles within the cutoff distance,
-  		 // unless such a bond already exists
-  		 
-  		 // We need all cyclical permutations, here 
-  		 // (bond is placed on 1st particle, order of bond partners
-  		 // does not matter, so we don't neet non-cyclic permutations):
-             coldet_do_three_particle_bond(p,p1,p2);
-             coldet_do_three_particle_bond(p1,p,p2);
-             coldet_do_three_particle_bond(p2,p,p1);
-  
-         }
-     }
- }
+  return a.pp1 == b.pp1 && a.pp2 == b.pp2;
 }
 
+// Whether a particle is a real particle on this node
+static bool is_local(int part)
+{
+  return part >= 0 && part <= max_seen_particle && local_particles[part] &&
+    !local_particles[part]->l.ghost;
+}
 
-// Goes through the collision queue and for each pair in it
-// looks for a third particle by using the domain decomposition
-// cell system. If found, it performs three particle binding
-void three_particle_binding_domain_decomposition()
+// Send the collisions in send to the neighboring nodes, and append the
+// ones they send to recv
+static void exchange_collisions(const std::vector<collision_struct> &send,
+                                std::vector<collision_struct> &recv)
 {
-  // We have domain decomposition
-    
-  // Indices of the cells in which the colliding particles reside
-  int cellIdx[2][3];
-    
-  // Iterate over collision queue
+  std::vector<char> buf;
+  cells_neighbor_exchange(send.data(), send.size()*sizeof(collision_struct), buf);
 
-  for (int id=0;id<total_collisions;id++) {
+  const collision_struct *c = reinterpret_cast<const collision_struct *>(buf.data());
+  recv.insert(recv.end(), c, c + buf.size()/sizeof(collision_struct));
+}
 
-      // Get first cell Idx
-      if ((local_particles[gathered_queue[id].pp1] != NULL) && (local_particles[gathered_queue[id].pp2] != NULL)) {
+// Append the collisions in send of all nodes to recv
+static void gather_collisions(const std::vector<collision_struct> &send,
+                              std::vector<collision_struct> &recv)
+{
+  int n_bytes = send.size()*sizeof(collision_struct), n_all = 0;
+  std::vector<int> counts(n_nodes), displs(n_nodes);
+  MPI_Allgather(&n_bytes, 1, MPI_INT, counts.data(), 1, MPI_INT, comm_cart);
+  for (int node=0;node<n_nodes;node++) {
+    displs[node] = n_all;
+    n_all += counts[node];
+  }
+  std::vector<char> buf(n_all);
+  MPI_Allgatherv(const_cast<collision_struct *>(send.data()), n_bytes, MPI_BYTE,
+                 buf.data(), counts.data(), displs.data(), MPI_BYTE, comm_cart);
 
-        Particle* p1=local_particles[gathered_queue[id].pp1];
-        Particle* p2=local_particles[gathered_queue[id].pp2];
-        dd_position_to_cell_indices(p1->r.p,cellIdx[0]);
-        dd_position_to_cell_indices(p2->r.p,cellIdx[1]);
+  const collision_struct *c = reinterpret_cast<const collision_struct *>(buf.data());
+  recv.insert(recv.end(), c, c + n_all/sizeof(collision_struct));
+}
 
-        // Iterate over the cells + their neighbors
-        // if p1 and p2 are in the same cell, we don't need to consider it 2x
-        int lim=1;
+// Whether the neighboring nodes see all third particles of a three
+// particle binding. The center of a triplet can be up to twice the
+// collision distance away from the particle that owns the collision,
+// so the neighbors only know about the collision, the other particles
+// and the cells around them if the cells are at least twice the
+// collision distance large.
+static bool three_particle_binding_is_local()
+{
+  if (n_nodes == 1 || cell_structure.type != CELL_STRUCTURE_DOMDEC)
+    return true;
+
+  // the cell sizes differ between the nodes with a non-uniform node grid
+  double min_cell_size = dmin(dmin(dd.cell_size[0], dd.cell_size[1]), dd.cell_size[2]);
+  double global_min_cell_size;
+  MPI_Allreduce(&min_cell_size, &global_min_cell_size, 1, MPI_DOUBLE, MPI_MIN, comm_cart);
+  return global_min_cell_size >= 2*collision_params.distance;
+}
 
-        if ((cellIdx[0][0]==cellIdx[1][0]) && (cellIdx[0][1]==cellIdx[1][1]) && (cellIdx[0][2]==cellIdx[1][2]))
-          lim=0; // Only consider the 1st cell
+// Collect the cells that may contain particles within the collision
+// distance of pos. For the domain decomposition, these are the cells
+// around the cell of pos, including the ghost cells, otherwise all cells.
+static void cells_around(double pos[3], std::vector<Cell *> &around)
+{
+  if (cell_structure.type != CELL_STRUCTURE_DOMDEC) {
+    for (int c=0;c<n_cells;c++)
+      around.push_back(&cells[c]);
+    return;
+  }
 
-        for (int j=0;j<=lim;j++) {
+  int idx[3], lo[3], hi[3];
+  for (int d=0;d<3;d++) {
+    idx[d] = (int)floor((pos[d] - my_left[d])*dd.inv_cell_size[d]) + 1;
+    lo[d] = std::max(idx[d] - 1, 0);
+    hi[d] = std::min(idx[d] + 1, dd.ghost_cell_grid[d] - 1);
+  }
+  for (int p=lo[0]; p<=hi[0]; p++)
+    for (int q=lo[1]; q<=hi[1]; q++)
+      for (int r=lo[2]; r<=hi[2]; r++)
+        around.push_back(&cells[get_linear_index(p,q,r,dd.ghost_cell_grid)]);
+}
 
-            // Iterate the cell with indices cellIdx[j][] and all its neighbors.
-            // code taken from dd_init_cell_interactions()
-            for(int p=cellIdx[j][0]-1; p<=cellIdx[j][0]+1; p++)	
-               for(int q=cellIdx[j][1]-1; q<=cellIdx[j][1]+1; q++)
-	                for(int r=cellIdx[j][2]-1; r<=cellIdx[j][2]+1; r++) {   
-	                   int ind2 = get_linear_index(p,q,r,dd.ghost_cell_grid);
-	                   Cell* cell=cells+ind2;
- 
-	                   // Iterate over particles in this cell
-                     for(int a=0; a<cell->n; a++) {
-                        Particle* P=&cell->part[a];
-                        // for all p:
-  	                      // Check, whether p is equal to one of the particles in the
-  	                      // collision. If so, skip
-  	                      if ((P->p.identity ==p1->p.identity) || (P->p.identity == p2->p.identity)) {
-                          //TRACE(printf("same particle\n"));
-  		                continue;
-  	                      }
-
-                        // The following checks, 
-                        // if the particle p is closer that the cutoff from p1 and/or p2.
-                        // If yes, three particle bonds are created on all particles
-  	                      // which have two other particles within the cutoff distance,
-                        // unless such a bond already exists
-
-  	                      // We need all cyclical permutations, here 
-                        // (bond is placed on 1st particle, order of bond partners
-  	                      // does not matter, so we don't need non-cyclic permutations):
-
-                        if (P->l.ghost) {
-                          //TRACE(printf("%d: center particle is ghost: %d\n", this_node, P->p.identity));
-                          continue;
-                        }
-                        //TRACE(printf("%d: LOOP: %d Handling collision of particles FIRST CONFIGURATION %d %d %d\n", this_node, id, p1->p.identity, P->p.identity, p2->p.identity));
-                        coldet_do_three_particle_bond(P,p1,p2);
-
-                        if (p1->l.ghost) {
-                          //TRACE(printf("%d: center particle is ghost: %d\n", this_node, p1->p.identity));
-                          continue;
-                        }
-
-                        coldet_do_three_particle_bond(p1,P,p2);
-
-                        if (p2->l.ghost) {
-                          //TRACE(printf("%d: center particle is ghost: %d\n", this_node, p2->p.identity));
-                          continue;
-                        }
-
-  	                      coldet_do_three_particle_bond(p2,P,p1);
-
-                     } // loop over particles in this cell
-
-	                } // Loop over cell
-
-        } // Loop over particles if they are in different cells
-    
-      } // If local particles exist
+// Look for third particles close to the pairs of the given collisions,
+// and perform three particle binding for those real on this node. The
+// bonds are created in the order of the particle ids, so that the
+// bond lists do not depend on the distribution of the particles.
+void three_particle_binding(const std::vector<collision_struct> &collisions)
+{
+  // center and partners of the candidate triplets
+  std::vector<int> triplets;
+  std::vector<Cell *> around;
+  double vec[3];
+  const double d2 = SQR(collision_params.distance);
+
+  for (size_t i=0;i<collisions.size();i++) {
+    Particle* p1=local_particles[collisions[i].pp1];
+    Particle* p2=local_particles[collisions[i].pp2];
+    if (!p1 || !p2)
+      continue;
+
+    around.clear();
+    cells_around(p1->r.p, around);
+    cells_around(p2->r.p, around);
+    std::sort(around.begin(), around.end());
+    around.erase(std::unique(around.begin(), around.end()), around.end());
+
+    for (size_t c=0;c<around.size();c++) {
+      Cell *cell = around[c];
+      for (int a=0;a<cell->n;a++) {
+        Particle* P=&cell->part[a];
+        // Check, whether P is equal to one of the particles in the
+        // collision. If so, skip
+        if ((P->p.identity == p1->p.identity) || (P->p.identity == p2->p.identity))
+          continue;
+
+        // The bond is placed on the 1st particle, and the order of
+        // the bond partners does not matter, so we need all cyclic
+        // permutations. Each center is handled on its own node.
+        get_mi_vector(vec, P->r.p, p1->r.p);
+        bool near1 = sqrlen(vec) <= d2;
+        get_mi_vector(vec, P->r.p, p2->r.p);
+        bool near2 = sqrlen(vec) <= d2;
+        int id = P->p.identity;
+        if (near1 && near2 && !P->l.ghost) {
+          int t[3] = {id, p1->p.identity, p2->p.identity};
+          triplets.insert(triplets.end(), t, t + 3);
+        }
+        if (near1 && !p1->l.ghost) {
+          int t[3] = {p1->p.identity, id, p2->p.identity};
+          triplets.insert(triplets.end(), t, t + 3);
+        }
+        if (near2 && !p2->l.ghost) {
+          int t[3] = {p2->p.identity, id, p1->p.identity};
+          triplets.insert(triplets.end(), t, t + 3);
+        }
+      }
+    }
+  }
 
-  } // Loop over total collisions
+  // sort the triplets lexicographically
+  int n = triplets.size()/3;
+  std::vector<int> order(n);
+  for (int i=0;i<n;i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [&triplets](int a, int b) {
+      return std::lexicographical_compare(&triplets[3*a], &triplets[3*a + 3],
+                                          &triplets[3*b], &triplets[3*b + 3]);
+    });
+
+  // coldet_do_three_particle_bond skips existing bonds, so duplicates
+  // do no harm
+  for (int i=0;i<n;i++) {
+    const int *t = &triplets[3*order[i]];
+    coldet_do_three_particle_bond(local_particles[t[0]], local_particles[t[1]],
+                                  local_particles[t[2]]);
+  }
 }
 
 
-// Handle the collisions stored in the queue
+// Handle the collisions stored in the queue. Every node only handles
+// the particles it owns. The collisions are exchanged with the
+// neighboring nodes in two rounds: first, the collisions are sent to
+// the node of the particle that gets the bond between the centers,
+// which is the one with the smaller id, and that node decides whether
+// the collision is new. Then, the new collisions are sent to the nodes
+// of the other particles involved. Only the three particle binding
+// with cells smaller than twice the collision distance needs the
+// collisions of all nodes.
 void handle_collisions ()
 {
 
-  TRACE(printf("%d: handle_collisions: number of collisions in queue %d\n",this_node,number_of_collisions));  
+  TRACE(printf("%d: handle_collisions: number of collisions in queue %d\n",this_node,(int)collision_queue.size()));  
+
+  int n_local = collision_queue.size(), n_total;
+  MPI_Allreduce(&n_local, &n_total, 1, MPI_INT, MPI_SUM, comm_cart);
+  if (n_total == 0)
+    return;
+
+  // Send the collisions to the owners of the bonds between the centers
+  std::vector<collision_struct> candidates(collision_queue);
+  exchange_collisions(collision_queue, candidates);
+  std::sort(candidates.begin(), candidates.end(), collision_less);
+  candidates.erase(std::unique(candidates.begin(), candidates.end(), collision_same),
+                   candidates.end());
+
+  std::vector<collision_struct> accepted;
+  for (size_t i=0;i<candidates.size();i++) {
+    const collision_struct &c = candidates[i];
+    int primary = std::min(c.pp1, c.pp2);
+    int secondary = std::max(c.pp1, c.pp2);
+    if (!is_local(primary))
+      continue;
+    if ((collision_params.mode & COLLISION_MODE_BOND) &&
+        bond_exists(local_particles[primary], secondary, collision_params.bond_centers))
+      continue;
+    accepted.push_back(c);
+  }
+
+  for (size_t i=0;i<accepted.size();i++)
+    handle_exception_throwing_for_single_collision(accepted[i]);
 
-  if (collision_params.mode & COLLISION_MODE_EXCEPTION)
-    for (int i=0;i<number_of_collisions;i++) {
-      handle_exception_throwing_for_single_collision(i);
-    }  
-    
-    
   if (collision_params.mode & COLLISION_MODE_BOND) 
   {
-    for (int i=0;i<number_of_collisions;i++) {
-      // put the bond to the physical particle; at least one partner always is
-      int primary =collision_queue[i].pp1;
-      int secondary = collision_queue[i].pp2;
-      if (local_particles[collision_queue[i].pp1]->l.ghost) {
-        primary = collision_queue[i].pp2;
-        secondary = collision_queue[i].pp1;
-        TRACE(printf("%d: particle-%d is ghost", this_node, collision_queue[i].pp1));
-      }
+    for (size_t i=0;i<accepted.size();i++) {
+      // put the bond on the particle with the smaller id
       int bondG[2];
       bondG[0]=collision_params.bond_centers;
-      bondG[1]=secondary;
-      local_change_bond(primary, bondG, 0);
-      TRACE(printf("%d: Adding bond %d->%d\n",this_node, primary,secondary));
+      bondG[1]=std::max(accepted[i].pp1, accepted[i].pp2);
+      local_change_bond(std::min(accepted[i].pp1, accepted[i].pp2), bondG, 0);
+      TRACE(printf("%d: Adding bond %d->%d\n",this_node, std::min(accepted[i].pp1, accepted[i].pp2), bondG[1]));
     }
   }
 
-#ifdef VIRTUAL_SITES_RELATIVE
-  // If one of the collision modes is active which places virtual sites, we go over the queue to handle them
-  if ((collision_params.mode & COLLISION_MODE_VS) || (collision_params.mode & COLLISION_MODE_GLUE_TO_SURF)) {
-    for (int i=0;i<number_of_collisions;i++) {
-	// Create virtual site(s) 
-	
-	// If we are in the two vs mode
-	// Virtual site related to first particle in the collision
-	if (collision_params.mode & COLLISION_MODE_VS)
-	{
-	 place_vs_and_relate_to_particle(collision_queue[i].point_of_collision,collision_queue[i].pp1);
-	}
-	// The virtual site related to p2 is needed independently on which of the vs-related modes is active
-        place_vs_and_relate_to_particle(collision_queue[i].point_of_collision,collision_queue[i].pp2);
-  
-	// If we are in the two vs mode, we need a bond between the virtual sites
-	if (collision_params.mode & COLLISION_MODE_VS)
-	{
-          bind_at_poc_create_bond_between_vs(i);
-        }
-	
-	// If we are in the "glue to surface mode", we need a bond between p1 and the vs
-	if (collision_params.mode & COLLISION_MODE_GLUE_TO_SURF)
-	{
-           glue_to_surface_bind_vs_to_pp1(i);
-        }
-      } // Loop over all collisions in the queue
-    } // are we in one of the vs_based methods
-#endif //defined VIRTUAL_SITES_RELATIVE
-  
+  if (!(collision_params.mode & (COLLISION_MODE_VS | COLLISION_MODE_GLUE_TO_SURF |
+                                 COLLISION_MODE_BIND_THREE_PARTICLES)))
+    return;
 
-  // three-particle-binding part
+#ifdef VIRTUAL_SITES_RELATIVE
+  // Assign the ids of the virtual sites. The sites of a node follow
+  // the ones of the nodes with smaller rank, and on each node, the
+  // accepted collisions are sorted by the ids of their particles.
+  int n_new = 0, base = max_seen_particle + 1;
+  if (collision_params.mode & (COLLISION_MODE_VS | COLLISION_MODE_GLUE_TO_SURF)) {
+    int per_collision = (collision_params.mode & COLLISION_MODE_VS) ? 2 : 1;
+    int n_mine = per_collision*accepted.size(), offset = 0;
+    MPI_Exscan(&n_mine, &offset, 1, MPI_INT, MPI_SUM, comm_cart);
+    if (this_node == 0)
+      offset = 0;
+    MPI_Allreduce(&n_mine, &n_new, 1, MPI_INT, MPI_SUM, comm_cart);
+
+    for (size_t i=0;i<accepted.size();i++) {
+      int first = base + offset + per_collision*i;
+      if (collision_params.mode & COLLISION_MODE_VS) {
+        accepted[i].vs1 = first;
+        accepted[i].vs2 = first + 1;
+      }
+      else
+        accepted[i].vs2 = first;
+    }
+  }
+#endif
 
+  // Tell the nodes of the other particles about the new collisions
+  std::vector<collision_struct> collisions(accepted);
+  exchange_collisions(accepted, collisions);
+  std::sort(collisions.begin(), collisions.end(), collision_less);
 
+  // three-particle-binding part. If the neighbors do not see all
+  // third particles, every node considers the collisions of all nodes.
   if (collision_params.mode & (COLLISION_MODE_BIND_THREE_PARTICLES)) {
-  int counts[n_nodes];
-  gather_collision_queue(counts);
+    if (three_particle_binding_is_local())
+      three_particle_binding(collisions);
+    else {
+      std::vector<collision_struct> all;
+      gather_collisions(accepted, all);
+      std::sort(all.begin(), all.end(), collision_less);
+      three_particle_binding(all);
+    }
+  }
 
-    if (counts[this_node]>0) {
+#ifdef VIRTUAL_SITES_RELATIVE
+  // If one of the collision modes is active which places virtual sites,
+  // each node creates the sites of its particles
+  if (n_new > 0) {
+    added_particles(n_new, base + n_new - 1);
+
+    for (size_t i=0;i<collisions.size();i++) {
+      collision_struct &c = collisions[i];
+
+      // If we are in the two vs mode
+      // Virtual site related to first particle in the collision
+      if ((collision_params.mode & COLLISION_MODE_VS) && is_local(c.pp1)) {
+        place_vs_and_relate_to_particle(c.vs1, c.point_of_collision, c.pp1);
+        bind_at_poc_create_bond_between_vs(c, c.vs1);
+      }
 
-      // If we don't have domain decomposition, we need to do a full sweep over all
-      // particles in the system. (slow)
-      if (cell_structure.type!=CELL_STRUCTURE_DOMDEC) {
-        three_particle_binding_full_search();
-    } // if cell structure != domain decomposition
-    else
-    {
-      three_particle_binding_domain_decomposition();
-    } // If we have doamin decomposition
-
-   } // if number of collisions of this node > 0
-       
-       if (total_collisions>0)
-         free(gathered_queue);
-       total_collisions = 0;
- } // if TPB
-
-  // If a collision method is active which places particles, resorting might be needed
-  TRACE(printf("%d: Resort particles is %d\n",this_node,resort_particles));
-  if (collision_params.mode & (COLLISION_MODE_VS | COLLISION_MODE_GLUE_TO_SURF))
-  {
-    // NOTE!! this has to be changed to total_collisions, once parallelization
-    // is implemented
+      // The virtual site related to p2 is needed independently on which of the vs-related modes is active
+      if (is_local(c.pp2)) {
+        place_vs_and_relate_to_particle(c.vs2, c.point_of_collision, c.pp2);
+        if (collision_params.mode & COLLISION_MODE_VS)
+          bind_at_poc_create_bond_between_vs(c, c.vs2);
+      }
 
-    if (number_of_collisions >0)
-    {
-      announce_resort_particles();
+      // If we are in the "glue to surface mode", we need a bond between p1 and the vs
+      if ((collision_params.mode & COLLISION_MODE_GLUE_TO_SURF) && is_local(c.pp1))
+        glue_to_surface_bind_vs_to_pp1(c);
     }
-  }
-  
-  // Reset the collision queue
-  if (number_of_collisions>0)
-    free(collision_queue);
-  
-  number_of_collisions = 0;
-
 
+    // the particles have to be resorted, and the master's map of the
+    // particles to the nodes is outdated
+    on_particle_change();
+    particle_invalidate_part_node();
+  }
+#endif
 }
 
 #endif
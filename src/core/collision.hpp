@@ -88,7 +88,9 @@ void detect_collision(Particle* p1, Particle* p2);
 
 void prepare_collision_queue();
 
-/// Handle the collisions recorded in the queue
+/** Handle the collisions recorded in the queue. Called on all nodes,
+    each of which creates the bonds and virtual sites of its own
+    particles after exchanging the collisions with its neighbors. */
 void handle_collisions();
 
 /** set the parameters for the collision detection
@@ -39,6 +39,7 @@
 #include "actor/EwaldGPU.hpp"
 #include "buckingham.hpp"
 #include "cells.hpp"
+#include "checkpoint.hpp"
 #include "cuda_interface.hpp"
 #include "elc.hpp"
 #include "energy.hpp"
@@ -68,6 +69,7 @@
 #include "overlap.hpp"
 #include "p3m.hpp"
 #include "particle_data.hpp"
+#include "phase_timers.hpp"
 #include "pressure.hpp"
 #include "reaction.hpp"
 #include "rotation.hpp"
@@ -79,6 +81,7 @@
 #include "statistics_observable.hpp"
 #include "tab.hpp"
 #include "topology.hpp"
+#include "trajectory.hpp"
 #include "virtual_sites.hpp"
 
 using namespace std;
@@ -172,12 +175,19 @@ static int terminated = 0;
   CB(mpi_external_potential_tabulated_read_potential_file_slave)               \
   CB(mpi_external_potential_sum_energies_slave)                                \
   CB(mpi_observable_lb_radial_velocity_profile_slave)                          \
+  CB(mpi_observable_parallel_slave)                                            \
   CB(mpi_check_runtime_errors_slave)                                           \
   CB(mpi_minimize_energy_slave)                                                \
   CB(mpi_gather_cuda_devices_slave)                                            \
   CB(mpi_thermalize_cpu_slave)                                                 \
+  CB(mpi_gather_phase_timers_slave)                                            \
   CB(mpi_scafacos_set_parameters_slave)                                        \
-  CB(mpi_mpiio_slave)
+  CB(mpi_mpiio_slave)                                                          \
+  CB(mpi_checkpoint_slave)                                                     \
+  CB(mpi_trajectory_slave)                                                     \
+  CB(mpi_set_particles_data_slave)                                             \
+  CB(mpi_get_particles_data_slave)                                             \
+  CB(mpi_bcast_constraint_sdf_slave)
 
 // create the forward declarations
 #define CB(name) void name(int node, int param);
@@ -257,7 +267,14 @@ void mpi_init(int *argc, char ***argv) {
   }
 #endif
 
+#ifdef _OPENMP
+  /* the ghost communication is driven by the master thread from
+     within the threaded force loop */
+  int provided;
+  MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+#else
   MPI_Init(argc, argv);
+#endif
 
   MPI_Comm_size(MPI_COMM_WORLD, &n_nodes);
 
@@ -507,6 +524,103 @@ void mpi_place_new_particle_slave(int pnode, int part) {
   on_particle_change();
 }
 
+/****************** REQ_SET_PARTICLES_DATA/REQ_GET_PARTICLES_DATA ************/
+
+/** MPI datatype of a \ref ParticleBulkData record. */
+static MPI_Datatype particle_bulk_data_type() {
+  static MPI_Datatype type = MPI_DATATYPE_NULL;
+  if (type == MPI_DATATYPE_NULL) {
+    MPI_Type_contiguous(sizeof(ParticleBulkData), MPI_BYTE, &type);
+    MPI_Type_commit(&type);
+  }
+  return type;
+}
+
+static void mpi_set_particles_data_common(ParticleBulkData *data, int *counts,
+                                          int fields, int n_new, int max_id) {
+  MPI_Datatype type = particle_bulk_data_type();
+  std::vector<int> header, displs;
+  int local_header[3];
+
+  /* number of particles of the node, and the new particles overall */
+  if (this_node == 0) {
+    header.resize(3 * n_nodes);
+    displs.resize(n_nodes);
+    for (int i = 0; i < n_nodes; i++) {
+      header[3 * i] = counts[i];
+      header[3 * i + 1] = n_new;
+      header[3 * i + 2] = max_id;
+      displs[i] = (i == 0) ? 0 : displs[i - 1] + counts[i - 1];
+    }
+  }
+  MPI_Scatter(header.data(), 3, MPI_INT, local_header, 3, MPI_INT, 0,
+              comm_cart);
+
+  std::vector<ParticleBulkData> local;
+  if (this_node == 0) {
+    MPI_Scatterv(data, counts, displs.data(), type, MPI_IN_PLACE, 0, type, 0,
+                 comm_cart);
+  } else {
+    local.resize(local_header[0]);
+    MPI_Scatterv(NULL, NULL, NULL, type, local.data(), local_header[0], type,
+                 0, comm_cart);
+    data = local.data();
+  }
+
+  added_particles(local_header[1], local_header[2]);
+  local_set_particles_data(data, local_header[0], fields);
+
+  on_particle_change();
+}
+
+void mpi_set_particles_data(ParticleBulkData *data, int *counts, int fields,
+                            int n_new, int max_id) {
+  mpi_call(mpi_set_particles_data_slave, -1, fields);
+  mpi_set_particles_data_common(data, counts, fields, n_new, max_id);
+}
+
+void mpi_set_particles_data_slave(int pnode, int fields) {
+  mpi_set_particles_data_common(NULL, NULL, fields, 0, 0);
+}
+
+static void mpi_get_particles_data_common(const int *ids,
+                                          ParticleBulkData *data,
+                                          int *counts) {
+  MPI_Datatype type = particle_bulk_data_type();
+  std::vector<int> displs;
+  int n;
+
+  if (this_node == 0) {
+    displs.resize(n_nodes);
+    for (int i = 0; i < n_nodes; i++)
+      displs[i] = (i == 0) ? 0 : displs[i - 1] + counts[i - 1];
+  }
+  MPI_Scatter(counts, 1, MPI_INT, &n, 1, MPI_INT, 0, comm_cart);
+
+  /* only the identities are sent, the records come back */
+  std::vector<int> local_ids(n);
+  MPI_Scatterv(const_cast<int *>(ids), counts, displs.data(), MPI_INT,
+               local_ids.data(), n, MPI_INT, 0, comm_cart);
+
+  std::vector<ParticleBulkData> local(n);
+  for (int i = 0; i < n; i++)
+    local[i].identity = local_ids[i];
+  local_get_particles_data(local.data(), n);
+
+  MPI_Gatherv(local.data(), n, type, data, counts, displs.data(), type, 0,
+              comm_cart);
+}
+
+void mpi_get_particles_data(const int *ids, ParticleBulkData *data,
+                            int *counts) {
+  mpi_call(mpi_get_particles_data_slave, -1, 0);
+  mpi_get_particles_data_common(ids, data, counts);
+}
+
+void mpi_get_particles_data_slave(int pnode, int dummy) {
+  mpi_get_particles_data_common(NULL, NULL, NULL);
+}
+
 /****************** REQ_SET_V ************/
 void mpi_send_v(int pnode, int part, double v[3]) {
   mpi_call(mpi_send_v_slave, pnode, part);
@@ -1146,6 +1260,13 @@ void mpi_observable_lb_radial_velocity_profile_slave(int pnode, int part) {
 #endif
 }
 
+void mpi_observable_parallel() {
+  mpi_call(mpi_observable_parallel_slave, -1, 0);
+}
+void mpi_observable_parallel_slave(int pnode, int part) {
+  mpi_observable_parallel_slave_implementation();
+}
+
 /********************* REQ_SET_BOND ********/
 
 int mpi_send_bond(int pnode, int part, int *bond, int _delete) {
@@ -2231,6 +2352,26 @@ void mpi_bcast_constraint_slave(int node, int parm) {
 #endif
 }
 
+/*************** REQ_BCAST_CONSTRAINT_SDF ************/
+void mpi_bcast_constraint_sdf(int n) {
+#ifdef CONSTRAINTS
+  mpi_call(mpi_bcast_constraint_sdf_slave, 0, n);
+  mpi_bcast_constraint_sdf_slave(0, n);
+#endif
+}
+
+void mpi_bcast_constraint_sdf_slave(int node, int n) {
+#ifdef CONSTRAINTS
+  double params[2] = {constraints[n].sdf_spacing, constraints[n].sdf_tolerance};
+
+  MPI_Bcast(params, 2, MPI_DOUBLE, 0, comm_cart);
+  constraints[n].sdf_spacing = params[0];
+  constraints[n].sdf_tolerance = params[1];
+
+  on_constraint_change();
+#endif
+}
+
 /*************** REQ_BCAST_LBBOUNDARY ************/
 void mpi_bcast_lbboundary(int del_num) {
 #if defined(LB_BOUNDARIES) || defined(LB_BOUNDARIES_GPU)
@@ -3024,6 +3165,16 @@ void mpi_thermalize_cpu(int temp) {
 
 void mpi_thermalize_cpu_slave(int node, int temp) { set_cpu_temp(temp); }
 
+/*********************** PHASE TIMERS **********************/
+void mpi_gather_phase_timers(double *stats) {
+  mpi_call(mpi_gather_phase_timers_slave, -1, 0);
+  phase_timers_gather(stats);
+}
+
+void mpi_gather_phase_timers_slave(int node, int param) {
+  phase_timers_gather(NULL);
+}
+
 /*********************** MAIN LOOP for slaves ****************/
 
 void mpi_loop() { mpiCallbacks().loop(); }
@@ -3144,3 +3295,35 @@ void mpi_mpiio_slave(int dummy, int flen) {
     mpi_mpiio_common_read(filename, fields);
   delete[] filename;
 }
+
+/*************** REQ_CHECKPOINT ************/
+void mpi_checkpoint(const char *filename, int write) {
+  int flen = strlen(filename) + 1;
+  mpi_call(mpi_checkpoint_slave, -1, flen);
+  MPI_Bcast((void *)filename, flen, MPI_CHAR, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&write, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (write)
+    checkpoint_common_write(filename);
+  else
+    checkpoint_common_read(filename);
+}
+
+void mpi_checkpoint_slave(int dummy, int flen) {
+  char *filename = new char[flen];
+  int write;
+  MPI_Bcast((void *)filename, flen, MPI_CHAR, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&write, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (write)
+    checkpoint_common_write(filename);
+  else
+    checkpoint_common_read(filename);
+  delete[] filename;
+}
+
+/*************** REQ_TRAJECTORY ************/
+void mpi_trajectory(int action) {
+  mpi_call(mpi_trajectory_slave, -1, action);
+  trajectory_common(action);
+}
+
+void mpi_trajectory_slave(int dummy, int action) { trajectory_common(action); }
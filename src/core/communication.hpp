@@ -161,6 +161,27 @@ void mpi_place_particle(int node, int id, double pos[3]);
 */
 void mpi_place_new_particle(int node, int id, double pos[3]);
 
+/** Issue REQ_SET_PARTICLES_DATA: send the properties of many particles
+    to their nodes with a single scatter, see \ref set_particles_data.
+    Also calls \ref on_particle_change.
+    \param data   the particles, sorted by node.
+    \param counts number of particles per node.
+    \param fields which properties to set, see \ref PARTICLES_DATA_POS.
+    \param n_new  number of particles that are created.
+    \param max_id largest identity of the particles.
+*/
+void mpi_set_particles_data(ParticleBulkData *data, int *counts, int fields,
+                            int n_new, int max_id);
+
+/** Issue REQ_GET_PARTICLES_DATA: get the properties of many particles
+    with one scatter and one gather, see \ref get_particles_data.
+    \param ids    the identities, sorted by node.
+    \param data   where to store the particles, in the order of ids.
+    \param counts number of particles per node.
+*/
+void mpi_get_particles_data(const int *ids, ParticleBulkData *data,
+                            int *counts);
+
 /** Issue REQ_SET_V: send particle velocity.
     Also calls \ref on_particle_change.
     \param part the particle.
@@ -523,6 +544,13 @@ void mpi_set_particle_gamma_rot(int pnode, int part, double gamma_rot);
 /** Issue REQ_BCAST_COULOMB: send new coulomb parameters. */
 void mpi_bcast_constraint(int del_num);
 
+/** Issue REQ_BCAST_CONSTRAINT_SDF: send the distance field parameters
+    \ref Constraint::sdf_spacing and \ref Constraint::sdf_tolerance of
+    a constraint, which are set on the master node.
+    \param n the constraint.
+*/
+void mpi_bcast_constraint_sdf(int n);
+
 #if defined(LB_BOUNDARIES) || defined(LB_BOUNDARIES_GPU)
 /** Issue REQ_LB_BOUNDARY: set up walls for lb fluid */
 void mpi_bcast_lbboundary(int del_num);
@@ -640,6 +668,9 @@ void mpi_system_CMS();
 void mpi_system_CMS_velocity();
 void mpi_galilei_transform();
 void mpi_observable_lb_radial_velocity_profile();
+/** Issue REQ_OBSERVABLE_PARALLEL: evaluate an observable on the local
+    particles of all nodes, see \ref observable_calc_parallel. */
+void mpi_observable_parallel();
 
 /** Issue REQ_CATALYTIC_REACTIONS: notify the system of changes to the reaction
  * parameters
@@ -660,6 +691,10 @@ std::vector<EspressoGpuDevice> mpi_gather_cuda_devices();
 /** CPU Thermostat */
 void mpi_thermalize_cpu(int temp);
 
+/** Collect the times of the phase timers from all nodes, see \ref
+    phase_timers_gather. */
+void mpi_gather_phase_timers(double *stats);
+
 /** MPI-IO output function.
  *  \param filename Filename prefix for the created files. Must be
  * null-terminated.
@@ -668,6 +703,19 @@ void mpi_thermalize_cpu(int temp);
  */
 void mpi_mpiio(const char *filename, unsigned fields, int write);
 
+/** Write or read a checkpoint, see \ref checkpoint.hpp.
+ *  \param filename name of the checkpoint file. Must be
+ * null-terminated.
+ *  \param write 1 to write, 0 to read
+ */
+void mpi_checkpoint(const char *filename, int write);
+
+/** Open, write to or close the trajectory, see \ref trajectory.hpp.
+ *  \param action one of TRAJECTORY_OPEN, TRAJECTORY_WRITE or
+ *  TRAJECTORY_CLOSE
+ */
+void mpi_trajectory(int action);
+
 /*@}*/
 
 /** \name Event codes for \ref mpi_bcast_event
@@ -23,7 +23,11 @@
 */
 
 #include <algorithm>
+#include <vector>
 #include "constraint.hpp"
+#include "constraint_sdf.hpp"
+#include "cells.hpp"
+#include "domain_decomposition.hpp"
 #include "energy_inline.hpp"
 #include "forces_inline.hpp"
 #include "tunable_slip.hpp"
@@ -49,6 +53,97 @@ Constraint *generate_constraint()
   return &constraints[n_constraints-1];
 }
 
+/** The constraints in range of the cells of the domain decomposition,
+    including the ghost cells. The constraints of cell i are
+    cell_constraints[cell_constraints_start[i]] up to
+    cell_constraints[cell_constraints_start[i+1]], in ascending order. */
+static std::vector<int> cell_constraints_start, cell_constraints;
+static int cell_constraints_valid = 0;
+
+double constraint_range(const Constraint *con)
+{
+  int t, type = con->part_rep.p.type;
+  double range = 0.0;
+
+  if (type < 0 || type >= n_particle_types)
+    return range;
+
+  for (t = 0; t < n_particle_types; t++) {
+    IA_parameters *ia = get_ia_param(t, type);
+    if (checkIfInteraction(ia))
+      range = std::max(range, ia->max_cut);
+  }
+  return range;
+}
+
+void constraints_cells_invalidate()
+{
+  cell_constraints_valid = 0;
+}
+
+/** Build the lists of the constraints in range of each cell. The
+    distance to a constraint changes at most as fast as the position,
+    so a constraint is out of range of a cell if its distance to the
+    center of the cell exceeds the range by more than half the cell
+    diagonal. Constraints without a shape are always in range. */
+static void update_cell_constraints()
+{
+  int n, i, j, k;
+  double half_diag, pos[3], dist, vec[3];
+
+  if (cell_constraints_valid || cell_structure.type != CELL_STRUCTURE_DOMDEC)
+    return;
+
+  half_diag = 0.5*sqrt(SQR(dd.cell_size[0]) + SQR(dd.cell_size[1]) + SQR(dd.cell_size[2]));
+
+  std::vector<double> range(n_constraints);
+  for (n = 0; n < n_constraints; n++)
+    range[n] = constraint_range(&constraints[n]);
+
+  cell_constraints_start.assign(1, 0);
+  cell_constraints.clear();
+  for (k = 0; k < dd.ghost_cell_grid[2]; k++)
+    for (j = 0; j < dd.ghost_cell_grid[1]; j++)
+      for (i = 0; i < dd.ghost_cell_grid[0]; i++) {
+        /* same order as get_linear_index */
+        pos[0] = my_left[0] + (i - 0.5)*dd.cell_size[0];
+        pos[1] = my_left[1] + (j - 0.5)*dd.cell_size[1];
+        pos[2] = my_left[2] + (k - 0.5)*dd.cell_size[2];
+        for (n = 0; n < n_constraints; n++) {
+          if (calculate_constraint_dist(&constraints[n], pos, &dist, vec) &&
+              dist - half_diag > range[n])
+            continue;
+          cell_constraints.push_back(n);
+        }
+        cell_constraints_start.push_back(cell_constraints.size());
+      }
+
+  cell_constraints_valid = 1;
+}
+
+/** Find the constraints in range of a folded position.
+    @param pos  the folded position.
+    @param near where to store the list of constraints, or NULL if all
+                constraints have to be considered.
+    @return the number of constraints in the list. */
+static int near_constraints(double pos[3], const int **near)
+{
+  int d, idx[3], c;
+
+  *near = NULL;
+  if (!cell_constraints_valid || cell_structure.type != CELL_STRUCTURE_DOMDEC)
+    return n_constraints;
+
+  for (d = 0; d < 3; d++) {
+    idx[d] = (int)floor((pos[d] - my_left[d])*dd.inv_cell_size[d]) + 1;
+    if (idx[d] < 0 || idx[d] >= dd.ghost_cell_grid[d])
+      return n_constraints;
+  }
+  c = get_linear_index(idx[0], idx[1], idx[2], dd.ghost_cell_grid);
+  *near = &cell_constraints[cell_constraints_start[c]];
+  return cell_constraints_start[c + 1] - cell_constraints_start[c];
+}
+
 void init_constraint_forces()
 {
   int n, i;
@@ -56,6 +151,52 @@ void init_constraint_forces()
   for (n = 0; n < n_constraints; n++)
     for (i = 0; i < 3; i++)
       constraints[n].part_rep.f.f[i] = 0;
+
+  constraints_sdf_update();
+  update_cell_constraints();
+}
+
+int calculate_constraint_dist(Constraint *con, double ppos[3], double *dist, double *vec)
+{
+  Particle *c_p = &con->part_rep;
+
+  switch(con->type) {
+  case CONSTRAINT_WAL:
+    calculate_wall_dist(NULL, ppos, c_p, &con->c.wal, dist, vec);
+    return 1;
+  case CONSTRAINT_SPH:
+    calculate_sphere_dist(NULL, ppos, c_p, &con->c.sph, dist, vec);
+    return 1;
+  case CONSTRAINT_CYL:
+    calculate_cylinder_dist(NULL, ppos, c_p, &con->c.cyl, dist, vec);
+    return 1;
+  case CONSTRAINT_RHOMBOID:
+    calculate_rhomboid_dist(NULL, ppos, c_p, &con->c.rhomboid, dist, vec);
+    return 1;
+  case CONSTRAINT_MAZE:
+    calculate_maze_dist(NULL, ppos, c_p, &con->c.maze, dist, vec);
+    return 1;
+  case CONSTRAINT_PORE:
+    calculate_pore_dist(NULL, ppos, c_p, &con->c.pore, dist, vec);
+    return 1;
+  case CONSTRAINT_SLITPORE:
+    calculate_slitpore_dist(NULL, ppos, c_p, &con->c.slitpore, dist, vec);
+    return 1;
+  case CONSTRAINT_STOMATOCYTE:
+    calculate_stomatocyte_dist(NULL, ppos, c_p, &con->c.stomatocyte, dist, vec);
+    return 1;
+  case CONSTRAINT_HOLLOW_CONE:
+    calculate_hollow_cone_dist(NULL, ppos, c_p, &con->c.hollow_cone, dist, vec);
+    return 1;
+  case CONSTRAINT_VOXEL:
+    calculate_voxel_dist(NULL, ppos, c_p, &con->c.voxel, dist, vec);
+    return 1;
+  case CONSTRAINT_PLANE:
+    calculate_plane_dist(NULL, ppos, c_p, &con->c.plane, dist, vec);
+    return 1;
+  default:
+    return 0;
+  }
 }
 
 
@@ -2362,7 +2503,7 @@ void add_constraints_forces(Particle *p1)
 {
   if (n_constraints==0)
    return;
-  int n, j;
+  int n, j, k;
   double dist, vec[3], force[3], torque1[3], torque2[3];
 
   IA_parameters *ia_params;
@@ -2374,7 +2515,10 @@ void add_constraints_forces(Particle *p1)
   memmove(img, p1->l.i, 3*sizeof(int));
   fold_position(folded_pos, img);
 
-  for(n=0;n<n_constraints;n++) {
+  const int *near;
+  int n_near = near_constraints(folded_pos, &near);
+  for(k=0;k<n_near;k++) {
+    n = near ? near[k] : k;
     ia_params=get_ia_param(p1->p.type, (&constraints[n].part_rep)->p.type);
     dist=0.;
     for (j = 0; j < 3; j++) {
@@ -2384,10 +2528,15 @@ void add_constraints_forces(Particle *p1)
 #endif
     }
 
+    /* cached distance, or skip the constraint if it is out of range */
+    int sdf = constraint_sdf_dist(n, folded_pos, &dist, vec);
+    if (sdf == SDF_FAR)
+      continue;
+
     switch(constraints[n].type) {
     case CONSTRAINT_WAL: 
       if(checkIfInteraction(ia_params)) {
-	calculate_wall_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.wal, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_wall_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.wal, &dist, vec); 
 	if ( dist > 0 ) {
 	  calc_non_bonded_pair_force(p1, &constraints[n].part_rep,
 				     ia_params,vec,dist,dist*dist, force,
@@ -2417,7 +2566,7 @@ void add_constraints_forces(Particle *p1)
 
     case CONSTRAINT_SPH:
       if(checkIfInteraction(ia_params)) {
-	calculate_sphere_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.sph, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_sphere_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.sph, &dist, vec); 
 	if ( dist > 0 ) {
 	  calc_non_bonded_pair_force(p1, &constraints[n].part_rep,
 				     ia_params,vec,dist,dist*dist, force,
@@ -2442,7 +2591,7 @@ void add_constraints_forces(Particle *p1)
     
     case CONSTRAINT_CYL: 
       if(checkIfInteraction(ia_params)) {
-	calculate_cylinder_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.cyl, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_cylinder_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.cyl, &dist, vec); 
 	if ( dist > 0 ) {
 	  calc_non_bonded_pair_force(p1, &constraints[n].part_rep,
 				     ia_params,vec,dist,dist*dist, force,
@@ -2467,7 +2616,7 @@ void add_constraints_forces(Particle *p1)
     
     case CONSTRAINT_RHOMBOID: 
       if(checkIfInteraction(ia_params)) {
-	calculate_rhomboid_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.rhomboid, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_rhomboid_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.rhomboid, &dist, vec); 
 	if ( dist > 0 ) {
 	  calc_non_bonded_pair_force(p1, &constraints[n].part_rep,
 				     ia_params,vec,dist,dist*dist, force,
@@ -2492,7 +2641,7 @@ void add_constraints_forces(Particle *p1)
 	
     case CONSTRAINT_MAZE: 
       if(checkIfInteraction(ia_params)) {
-	calculate_maze_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.maze, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_maze_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.maze, &dist, vec); 
 	if ( dist > 0 ) {
 	  calc_non_bonded_pair_force(p1, &constraints[n].part_rep,
 				     ia_params,vec,dist,dist*dist, force,
@@ -2513,7 +2662,7 @@ void add_constraints_forces(Particle *p1)
 
     case CONSTRAINT_PORE: 
       if(checkIfInteraction(ia_params)) {
-	calculate_pore_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.pore, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_pore_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.pore, &dist, vec); 
 	if ( dist >= 0 ) {
 	  calc_non_bonded_pair_force(p1, &constraints[n].part_rep,
 				     ia_params,vec,dist,dist*dist, force,
@@ -2530,7 +2679,7 @@ void add_constraints_forces(Particle *p1)
       break;
     case CONSTRAINT_SLITPORE: 
       if(checkIfInteraction(ia_params)) {
-	calculate_slitpore_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.slitpore, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_slitpore_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.slitpore, &dist, vec); 
 	if ( dist >= 0 ) {
 	  calc_non_bonded_pair_force(p1, &constraints[n].part_rep,
 				     ia_params,vec,dist,dist*dist, force,
@@ -2549,7 +2698,7 @@ void add_constraints_forces(Particle *p1)
       if( checkIfInteraction(ia_params) ) 
       {
 
-        calculate_stomatocyte_dist( p1, folded_pos, &constraints[n].part_rep, 
+        if (sdf == SDF_EXACT) calculate_stomatocyte_dist( p1, folded_pos, &constraints[n].part_rep, 
                                     &constraints[n].c.stomatocyte, &dist, vec );
 
 	      if ( dist > 0 ) 
@@ -2586,7 +2735,7 @@ void add_constraints_forces(Particle *p1)
       if( checkIfInteraction(ia_params) ) 
       {
 
-        calculate_hollow_cone_dist( p1, folded_pos, &constraints[n].part_rep, 
+        if (sdf == SDF_EXACT) calculate_hollow_cone_dist( p1, folded_pos, &constraints[n].part_rep, 
                                     &constraints[n].c.hollow_cone, &dist, vec );
 
 	      if ( dist > 0 ) 
@@ -2621,7 +2770,7 @@ void add_constraints_forces(Particle *p1)
     
     case CONSTRAINT_VOXEL:
       if(checkIfInteraction(ia_params)) {
-	calculate_voxel_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.voxel, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_voxel_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.voxel, &dist, vec); 
 	if ( dist > 0 ) {
 	  calc_non_bonded_pair_force(p1, &constraints[n].part_rep,
 				     ia_params,vec,dist,dist*dist, force,
@@ -2650,7 +2799,7 @@ void add_constraints_forces(Particle *p1)
     
     case CONSTRAINT_PLANE:
      if(checkIfInteraction(ia_params)) {
-	calculate_plane_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.plane, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_plane_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.plane, &dist, vec); 
 	if (dist > 0) {
 	    calc_non_bonded_pair_force(p1, &constraints[n].part_rep,
 				       ia_params,vec,dist,dist*dist, force,
@@ -2685,7 +2834,7 @@ void add_constraints_forces(Particle *p1)
 
 double add_constraints_energy(Particle *p1)
 {
-  int n, type;
+  int n, k, type;
   double dist, vec[3];
   double nonbonded_en, coulomb_en, magnetic_en;
   IA_parameters *ia_params;
@@ -2696,17 +2845,26 @@ double add_constraints_energy(Particle *p1)
   memmove(folded_pos, p1->r.p, 3*sizeof(double));
   memmove(img, p1->l.i, 3*sizeof(int));
   fold_position(folded_pos, img);
-  for(n=0;n<n_constraints;n++) { 
+
+  const int *near;
+  int n_near = near_constraints(folded_pos, &near);
+  for(k=0;k<n_near;k++) {
+    n = near ? near[k] : k;
     ia_params = get_ia_param(p1->p.type, (&constraints[n].part_rep)->p.type);
     nonbonded_en = 0.;
     coulomb_en   = 0.;
     magnetic_en = 0.;
 
     dist=0.;
+    /* cached distance, or skip the constraint if it is out of range */
+    int sdf = constraint_sdf_dist(n, folded_pos, &dist, vec);
+    if (sdf == SDF_FAR)
+      continue;
+
     switch(constraints[n].type) {
     case CONSTRAINT_WAL: 
       if(checkIfInteraction(ia_params)) {
-	calculate_wall_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.wal, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_wall_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.wal, &dist, vec); 
 	if ( dist > 0 ) {
 	  nonbonded_en = calc_non_bonded_pair_energy(p1, &constraints[n].part_rep,
 						     ia_params, vec, dist, dist*dist);
@@ -2725,7 +2883,7 @@ double add_constraints_energy(Particle *p1)
 	
     case CONSTRAINT_SPH: 
       if(checkIfInteraction(ia_params)) {
-	calculate_sphere_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.sph, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_sphere_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.sph, &dist, vec); 
 	if ( dist > 0 ) {
 	  nonbonded_en = calc_non_bonded_pair_energy(p1, &constraints[n].part_rep,
 						     ia_params, vec, dist, dist*dist);
@@ -2744,7 +2902,7 @@ double add_constraints_energy(Particle *p1)
 	
     case CONSTRAINT_CYL: 
       if(checkIfInteraction(ia_params)) {
-	calculate_cylinder_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.cyl, &dist , vec); 
+	if (sdf == SDF_EXACT) calculate_cylinder_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.cyl, &dist , vec); 
 	if ( dist > 0 ) {
 	  nonbonded_en = calc_non_bonded_pair_energy(p1, &constraints[n].part_rep,
 						     ia_params, vec, dist, dist*dist);
@@ -2764,7 +2922,7 @@ double add_constraints_energy(Particle *p1)
 	
     case CONSTRAINT_RHOMBOID: 
       if(checkIfInteraction(ia_params)) {
-	calculate_rhomboid_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.rhomboid, &dist , vec); 
+	if (sdf == SDF_EXACT) calculate_rhomboid_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.rhomboid, &dist , vec); 
 	if ( dist > 0 ) {
 	  nonbonded_en = calc_non_bonded_pair_energy(p1, &constraints[n].part_rep,
 						     ia_params, vec, dist, dist*dist);
@@ -2784,7 +2942,7 @@ double add_constraints_energy(Particle *p1)
 
     case CONSTRAINT_MAZE: 
       if(checkIfInteraction(ia_params)) {
-	calculate_maze_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.maze, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_maze_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.maze, &dist, vec); 
 	if ( dist > 0 ) {
 	  nonbonded_en = calc_non_bonded_pair_energy(p1, &constraints[n].part_rep,
 						     ia_params, vec, dist, dist*dist);
@@ -2803,7 +2961,7 @@ double add_constraints_energy(Particle *p1)
 
     case CONSTRAINT_PORE: 
       if(checkIfInteraction(ia_params)) {
-	calculate_pore_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.pore, &dist , vec); 
+	if (sdf == SDF_EXACT) calculate_pore_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.pore, &dist , vec); 
 	if ( dist > 0 ) {
 	  nonbonded_en = calc_non_bonded_pair_energy(p1, &constraints[n].part_rep,
 						     ia_params, vec, dist, dist*dist);
@@ -2818,7 +2976,7 @@ double add_constraints_energy(Particle *p1)
     case CONSTRAINT_STOMATOCYTE: 
       if( checkIfInteraction(ia_params) ) 
       {
-	      calculate_stomatocyte_dist( p1, folded_pos, &constraints[n].part_rep,
+	      if (sdf == SDF_EXACT) calculate_stomatocyte_dist( p1, folded_pos, &constraints[n].part_rep,
                                     &constraints[n].c.stomatocyte, &dist, vec ); 
 
 	      if ( dist > 0 )
@@ -2848,7 +3006,7 @@ double add_constraints_energy(Particle *p1)
     case CONSTRAINT_HOLLOW_CONE: 
       if( checkIfInteraction(ia_params) ) 
       {
-	      calculate_hollow_cone_dist( p1, folded_pos, &constraints[n].part_rep,
+	      if (sdf == SDF_EXACT) calculate_hollow_cone_dist( p1, folded_pos, &constraints[n].part_rep,
                                     &constraints[n].c.hollow_cone, &dist, vec ); 
 
 	      if ( dist > 0 )
@@ -2898,7 +3056,7 @@ double add_constraints_energy(Particle *p1)
       break;
   case CONSTRAINT_VOXEL: 
       if(checkIfInteraction(ia_params)) {
-	calculate_voxel_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.voxel, &dist, vec); 
+	if (sdf == SDF_EXACT) calculate_voxel_dist(p1, folded_pos, &constraints[n].part_rep, &constraints[n].c.voxel, &dist, vec); 
 	if ( dist > 0 ) {
 	  nonbonded_en = calc_non_bonded_pair_energy(p1, &constraints[n].part_rep,
 						     ia_params, vec, dist, dist*dist);
@@ -118,6 +118,20 @@ void add_constraints_forces(Particle *p1);
 double add_constraints_energy(Particle *p1);
 
 void init_constraint_forces();
+
+/** Calculate the distance of a position to a shaped constraint.
+    @return 1, or 0 if the constraint has no shape.
+*/
+int calculate_constraint_dist(Constraint *con, double ppos[3],
+                              double *dist, double *vec);
+
+/** Largest cutoff of a constraint with any particle type. */
+double constraint_range(const Constraint *con);
+
+/** Drop the lists of the constraints in range of the cells, since the
+    constraints, the cutoffs or the cell grid changed. They are rebuilt
+    before the next force calculation. */
+void constraints_cells_invalidate();
 #endif
 
 #endif
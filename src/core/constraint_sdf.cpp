@@ -0,0 +1,242 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file constraint_sdf.cpp
+ *
+ *  Implementation of \ref constraint_sdf.hpp "constraint_sdf.hpp".
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "constraint_sdf.hpp"
+#include "constraint.hpp"
+#include "errorhandling.hpp"
+#include "grid.hpp"
+#include "integrate.hpp"
+#include "interaction_data.hpp"
+
+#ifdef CONSTRAINTS
+
+namespace {
+
+/** largest number of grid points of a single grid on a node */
+const long max_grid_points = 1L << 26;
+
+/** \name Classes of the grid cells */
+/*@{*/
+const unsigned char CELL_INTERPOLATE = 0;
+const unsigned char CELL_EXACT = 1;
+const unsigned char CELL_FAR = 2;
+/*@}*/
+
+/** The sampled distance field of one constraint on this node. */
+struct SdfGrid {
+  bool valid;
+  /** parameters the grid was built for */
+  double spacing, tolerance, range, skin;
+  double left[3], local_box[3];
+  /** position of the first grid point */
+  double origin[3];
+  double inv_spacing;
+  /** number of grid points */
+  int n[3];
+  /** bounding box of the cells in range, lower bound inclusive,
+      upper exclusive */
+  int lo[3], hi[3];
+  /** distance and distance vector per grid point */
+  std::vector<double> data;
+  /** class per cell */
+  std::vector<unsigned char> cell;
+
+  SdfGrid() : valid(false) {}
+};
+
+std::vector<SdfGrid> grids;
+
+bool grid_up_to_date(const SdfGrid &g, const Constraint *con, double range) {
+  if (!g.valid || g.spacing != con->sdf_spacing ||
+      g.tolerance != con->sdf_tolerance || g.range != range || g.skin != skin)
+    return false;
+  for (int d = 0; d < 3; d++)
+    if (g.left[d] != my_left[d] || g.local_box[d] != local_box_l[d])
+      return false;
+  return true;
+}
+
+void build_grid(SdfGrid &g, Constraint *con, int num, double range) {
+  const double h = con->sdf_spacing;
+  const double margin = skin + h;
+  long n_points = 1;
+
+  g.valid = false;
+  g.spacing = h;
+  g.inv_spacing = 1.0 / h;
+  g.tolerance = con->sdf_tolerance;
+  g.range = range;
+  g.skin = skin;
+  for (int d = 0; d < 3; d++) {
+    g.left[d] = my_left[d];
+    g.local_box[d] = local_box_l[d];
+    g.origin[d] = my_left[d] - margin;
+    g.n[d] = (int)ceil((local_box_l[d] + 2 * margin) * g.inv_spacing) + 1;
+    n_points *= g.n[d];
+  }
+  if (n_points > max_grid_points) {
+    runtimeErrorMsg() << "distance field of constraint " << num << " needs "
+                      << n_points << " grid points per node, increase its "
+                                     "spacing";
+    g.data.clear();
+    g.cell.clear();
+    return;
+  }
+
+  /* sample the distance at the grid points. The positions are not
+     folded, so that the field continues smoothly across the box
+     boundaries for the folded positions inside. */
+  g.data.resize(4 * n_points);
+  int idx = 0;
+  for (int i = 0; i < g.n[0]; i++)
+    for (int j = 0; j < g.n[1]; j++)
+      for (int k = 0; k < g.n[2]; k++, idx++) {
+        double pos[3] = {g.origin[0] + i * h, g.origin[1] + j * h,
+                         g.origin[2] + k * h};
+        calculate_constraint_dist(con, pos, &g.data[4 * idx],
+                                  &g.data[4 * idx + 1]);
+      }
+
+  /* classify the cells. The distance changes at most as fast as the
+     position, so a cell is out of range if all corners are further
+     away than the cutoff plus half the cell diagonal. */
+  const int nc[3] = {g.n[0] - 1, g.n[1] - 1, g.n[2] - 1};
+  const double far = range + 0.5 * sqrt(3.0) * h;
+  g.cell.resize((long)nc[0] * nc[1] * nc[2]);
+  for (int d = 0; d < 3; d++) {
+    g.lo[d] = nc[d];
+    g.hi[d] = 0;
+  }
+  idx = 0;
+  for (int i = 0; i < nc[0]; i++)
+    for (int j = 0; j < nc[1]; j++)
+      for (int k = 0; k < nc[2]; k++, idx++) {
+        double mean[4] = {0.0, 0.0, 0.0, 0.0};
+        double min_dist = far + 1.0;
+        for (int c = 0; c < 8; c++) {
+          const double *v = &g.data[4 * (((i + (c >> 2)) * g.n[1] +
+                                          j + ((c >> 1) & 1)) * g.n[2] +
+                                         k + (c & 1))];
+          min_dist = std::min(min_dist, v[0]);
+          for (int l = 0; l < 4; l++)
+            mean[l] += 0.125 * v[l];
+        }
+        if (min_dist > far) {
+          g.cell[idx] = CELL_FAR;
+          continue;
+        }
+
+        /* compare with the exact value in the center, where the
+           interpolation error of smooth fields is largest */
+        double pos[3] = {g.origin[0] + (i + 0.5) * h,
+                         g.origin[1] + (j + 0.5) * h,
+                         g.origin[2] + (k + 0.5) * h};
+        double exact[4];
+        calculate_constraint_dist(con, pos, &exact[0], &exact[1]);
+        double err = 0.0;
+        for (int l = 0; l < 4; l++)
+          err = std::max(err, fabs(exact[l] - mean[l]));
+        g.cell[idx] = (err > g.tolerance) ? CELL_EXACT : CELL_INTERPOLATE;
+
+        const int ijk[3] = {i, j, k};
+        for (int d = 0; d < 3; d++) {
+          g.lo[d] = std::min(g.lo[d], ijk[d]);
+          g.hi[d] = std::max(g.hi[d], ijk[d] + 1);
+        }
+      }
+
+  g.valid = true;
+}
+}
+
+void constraints_sdf_update() {
+  grids.resize(n_constraints);
+
+  for (int n = 0; n < n_constraints; n++) {
+    Constraint *con = &constraints[n];
+    SdfGrid &g = grids[n];
+
+    if (con->sdf_spacing <= 0.0) {
+      if (g.valid) {
+        g = SdfGrid();
+      }
+      continue;
+    }
+
+    double range = constraint_range(con);
+    if (!grid_up_to_date(g, con, range))
+      build_grid(g, con, n, range);
+  }
+}
+
+void constraints_sdf_invalidate() { grids.clear(); }
+
+int constraint_sdf_dist(int n, double ppos[3], double *dist, double *vec) {
+  if (constraints[n].sdf_spacing <= 0.0 || n >= (int)grids.size() ||
+      !grids[n].valid)
+    return SDF_EXACT;
+
+  const SdfGrid &g = grids[n];
+  double s[3];
+  int i[3];
+  for (int d = 0; d < 3; d++) {
+    s[d] = (ppos[d] - g.origin[d]) * g.inv_spacing;
+    i[d] = (int)floor(s[d]);
+    if (i[d] < 0 || i[d] >= g.n[d] - 1)
+      return SDF_EXACT;
+    s[d] -= i[d];
+  }
+
+  for (int d = 0; d < 3; d++)
+    if (i[d] < g.lo[d] || i[d] >= g.hi[d])
+      return SDF_FAR;
+
+  switch (g.cell[((long)i[0] * (g.n[1] - 1) + i[1]) * (g.n[2] - 1) + i[2]]) {
+  case CELL_FAR:
+    return SDF_FAR;
+  case CELL_EXACT:
+    return SDF_EXACT;
+  }
+
+  double res[4] = {0.0, 0.0, 0.0, 0.0};
+  for (int c = 0; c < 8; c++) {
+    const int a = c >> 2, b = (c >> 1) & 1, e = c & 1;
+    const double w = (a ? s[0] : 1.0 - s[0]) * (b ? s[1] : 1.0 - s[1]) *
+                     (e ? s[2] : 1.0 - s[2]);
+    const double *v =
+        &g.data[4 * (((long)(i[0] + a) * g.n[1] + i[1] + b) * g.n[2] + i[2] + e)];
+    for (int l = 0; l < 4; l++)
+      res[l] += w * v[l];
+  }
+
+  *dist = res[0];
+  vec[0] = res[1];
+  vec[1] = res[2];
+  vec[2] = res[3];
+  return SDF_HIT;
+}
+
+#endif
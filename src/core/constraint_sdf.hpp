@@ -0,0 +1,83 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CONSTRAINT_SDF_H
+#define CONSTRAINT_SDF_H
+/** \file constraint_sdf.hpp
+ *
+ *  Cached signed distance fields of constraints.
+ *
+ *  If the \ref Constraint::sdf_spacing of a shaped constraint is
+ *  positive, each node samples the distance and the distance vector of
+ *  the constraint on a regular grid with this spacing, which covers its
+ *  domain plus the skin. During the force and energy calculation, the
+ *  distance of a particle is then interpolated trilinearly from the
+ *  eight surrounding grid points instead of being calculated from the
+ *  geometry.
+ *
+ *  When the grid is sampled, every grid cell is classified:
+ *  - cells in which the distance is larger than the largest cutoff of
+ *    the constraint everywhere are out of range, and particles in them
+ *    skip the constraint. The bounding box of the cells in range
+ *    allows to skip most of these particles without looking at the
+ *    cells.
+ *  - cells in which the interpolated distance or distance vector
+ *    differs from the exact one by more than \ref
+ *    Constraint::sdf_tolerance in the center, e.g. at edges of the
+ *    constraint, are calculated exactly.
+ *  - all other cells are interpolated.
+ *
+ *  The grids are rebuilt before the next force calculation whenever
+ *  the constraints, the domain of the node, the skin or the cutoffs
+ *  change. Particles outside of the grid, and all particles while the
+ *  grids are not built, are calculated exactly.
+ */
+
+#include "config.hpp"
+
+#ifdef CONSTRAINTS
+
+/** \name Results of \ref constraint_sdf_dist */
+/*@{*/
+/** the distance has to be calculated exactly */
+#define SDF_EXACT 0
+/** the distance was interpolated */
+#define SDF_HIT   1
+/** the particle is out of range of the constraint */
+#define SDF_FAR   2
+/*@}*/
+
+/** Rebuild the grids of the constraints that have a cache, if
+    necessary. Called on all nodes before the forces are calculated. */
+void constraints_sdf_update();
+
+/** Drop all grids, since the constraints changed. */
+void constraints_sdf_invalidate();
+
+/** Look up the distance of a position to constraint n.
+    @param n    the constraint.
+    @param ppos the folded position.
+    @param dist where to store the distance, for \ref SDF_HIT.
+    @param vec  where to store the distance vector, for \ref SDF_HIT.
+    @return \ref SDF_EXACT, \ref SDF_HIT or \ref SDF_FAR.
+*/
+int constraint_sdf_dist(int n, double ppos[3], double *dist, double *vec);
+
+#endif
+
+#endif
@@ -35,6 +35,7 @@
 #include "constraint.hpp"
 #include "initialize.hpp"
 #include "external_potential.hpp"
+#include "threads.hpp"
 
 /************************************************/
 /** \name Defines */
@@ -54,7 +55,7 @@
 #ifdef LEES_EDWARDS
 le_dd_comms_manager le_mgr;
 #endif
-DomainDecomposition dd = { 1, {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, NULL };
+DomainDecomposition dd = { 1, {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, NULL, 0, {0}, NULL, {0} };
 
 int max_num_cells = CELLS_MAX_NUM_CELLS;
 int min_num_cells = 1;
@@ -119,11 +120,17 @@ void dd_create_cell_grid()
 {
   int i,n_local_cells,new_cells,min_ind;
   double cell_range[3], min_size, scale, volume;
+  /* the domain the cell size is chosen for. For a non-uniform node
+     grid, the cell size is chosen for the average domain, so that all
+     nodes use about the same cell size. */
+  double cell_box_l[3];
   CELL_TRACE(fprintf(stderr, "%d: dd_create_cell_grid: max_range %f\n",this_node,max_range));
   CELL_TRACE(fprintf(stderr, "%d: dd_create_cell_grid: local_box %f-%f, %f-%f, %f-%f,\n",this_node,my_left[0],my_right[0],my_left[1],my_right[1],my_left[2],my_right[2]));
   
   /* initialize */
   cell_range[0]=cell_range[1]=cell_range[2] = max_range;
+  for(i=0;i<3;i++)
+    cell_box_l[i] = grid_uniform ? local_box_l[i] : box_l[i]/node_grid[i];
 
   if (max_range < ROUND_ERROR_PREC*box_l[0]) {
     /* this is the initialization case */
@@ -138,30 +145,30 @@ void dd_create_cell_grid()
   }
   else {
     /* Calculate initial cell grid */
-    volume = local_box_l[0];
-    for(i=1;i<3;i++) volume *= local_box_l[i];
+    volume = cell_box_l[0];
+    for(i=1;i<3;i++) volume *= cell_box_l[i];
     scale = pow(max_num_cells/volume, 1./3.);
     for(i=0;i<3;i++) {
       /* this is at least 1 */
-      dd.cell_grid[i] = (int)ceil(local_box_l[i]*scale);
-      cell_range[i] = local_box_l[i]/dd.cell_grid[i];
+      dd.cell_grid[i] = (int)ceil(cell_box_l[i]*scale);
+      cell_range[i] = cell_box_l[i]/dd.cell_grid[i];
 
       if ( cell_range[i] < max_range ) {
 	/* ok, too many cells for this direction, set to minimum */
-	dd.cell_grid[i] = (int)floor(local_box_l[i]/max_range);
+	dd.cell_grid[i] = (int)floor(cell_box_l[i]/max_range);
 	if ( dd.cell_grid[i] < 1 ) {
 	  runtimeErrorMsg() << "interaction range " << max_range << " in direction "
-	      << i << " is larger than the local box size " << local_box_l[i];
+	      << i << " is larger than the local box size " << cell_box_l[i];
 	  dd.cell_grid[i] = 1;
 	}
 #ifdef LEES_EDWARDS
         if ( (i == 0) && (dd.cell_grid[0] < 2) ) {
 	  runtimeErrorMsg() << "interaction range " << max_range << " in direction "
-	      << i << " is larger than half the local box size " << local_box_l[i] << "/2";
+	      << i << " is larger than half the local box size " << cell_box_l[i] << "/2";
 	  dd.cell_grid[0] = 2;
         }
 #endif
-	cell_range[i] = local_box_l[i]/dd.cell_grid[i];
+	cell_range[i] = cell_box_l[i]/dd.cell_grid[i];
       }
     }
 
@@ -192,10 +199,24 @@ void dd_create_cell_grid()
       CELL_TRACE(fprintf(stderr, "%d: minimal coordinate %d, size %f, grid %d\n", this_node,min_ind, min_size, dd.cell_grid[min_ind]));
 
       dd.cell_grid[min_ind]--;
-      cell_range[min_ind] = local_box_l[min_ind]/dd.cell_grid[min_ind];
+      cell_range[min_ind] = cell_box_l[min_ind]/dd.cell_grid[min_ind];
     }
     CELL_TRACE(fprintf(stderr, "%d: final %d %d %d\n", this_node, dd.cell_grid[0], dd.cell_grid[1], dd.cell_grid[2]));
 
+    if (!grid_uniform) {
+      /* fill the actual domain with cells of about that size */
+      for(i=0;i<3;i++) {
+        dd.cell_grid[i] = (int)floor(local_box_l[i]/cell_range[i]*(1.0 + ROUND_ERROR_PREC));
+        if ( dd.cell_grid[i] < 1 ) {
+          if ( local_box_l[i] < max_range )
+            runtimeErrorMsg() << "interaction range " << max_range << " in direction "
+                              << i << " is larger than the local box size " << local_box_l[i];
+          dd.cell_grid[i] = 1;
+        }
+      }
+      n_local_cells = dd.cell_grid[0] * dd.cell_grid[1] * dd.cell_grid[2];
+    }
+
     /* sanity check */
     if (n_local_cells < min_num_cells) {
         runtimeErrorMsg() << "number of cells "<< n_local_cells << " is smaller than minimum " << min_num_cells <<
@@ -203,8 +224,9 @@ void dd_create_cell_grid()
     }
   }
 
-  /* quit program if unsuccesful */
-  if(n_local_cells > max_num_cells) {
+  /* quit program if unsuccesful. A larger than average domain of a
+     non-uniform grid may exceed the limit. */
+  if(grid_uniform && n_local_cells > max_num_cells) {
       runtimeErrorMsg() << "no suitable cell grid found ";
   }
 
@@ -488,6 +510,56 @@ void dd_update_communicators_w_boxl()
   }
 }
 
+/** Sort the local cells by color, see \ref DomainDecomposition::color_cells.
+    The cells are colored by their position in the cell grid modulo
+    (3,3,2), and keep their order within a color. */
+void dd_init_cell_colors()
+{
+  int m,n,o,col,c_cnt=0,nb,pass;
+  int g[3];
+  int *color, *boundary;
+
+  color = (int *) Utils::malloc(local_cells.n*sizeof(int));
+  boundary = (int *) Utils::malloc(local_cells.n*sizeof(int));
+  dd.color_cells = (int *) Utils::realloc(dd.color_cells, local_cells.n*sizeof(int));
+  for(col=0; col<=DD_MAX_COLORS; col++)
+    dd.color_start[col] = 0;
+
+  DD_LOCAL_CELLS_LOOP(m,n,o) {
+    color[c_cnt] = (m%3) + 3*(n%3) + 9*(o%2);
+    dd.color_start[color[c_cnt] + 1]++;
+    /* a boundary cell interacts with a ghost cell */
+    boundary[c_cnt] = 0;
+    for(nb=0; nb<dd.cell_inter[c_cnt].n_neighbors; nb++) {
+      get_grid_pos(dd.cell_inter[c_cnt].nList[nb].cell_ind, &g[0], &g[1], &g[2],
+                   dd.ghost_cell_grid);
+      for(int i=0; i<3; i++)
+        if(g[i] == 0 || g[i] == dd.ghost_cell_grid[i] - 1)
+          boundary[c_cnt] = 1;
+    }
+    c_cnt++;
+  }
+  for(col=0; col<DD_MAX_COLORS; col++)
+    dd.color_start[col + 1] += dd.color_start[col];
+  /* inner cells first, then the boundary cells of each color */
+  for(pass=0; pass<2; pass++) {
+    for(c_cnt=0; c_cnt<local_cells.n; c_cnt++)
+      if(boundary[c_cnt] == pass)
+        dd.color_cells[dd.color_start[color[c_cnt]]++] = c_cnt;
+    if(pass == 0)
+      for(col=0; col<DD_MAX_COLORS; col++)
+        dd.color_boundary[col] = dd.color_start[col];
+  }
+  /* the fill loop advanced every start to the next color */
+  for(col=DD_MAX_COLORS; col>0; col--)
+    dd.color_start[col] = dd.color_start[col - 1];
+  dd.color_start[0] = 0;
+
+  dd.n_colors = DD_MAX_COLORS;
+  free(boundary);
+  free(color);
+}
+
 /** Init cell interactions for cell system domain decomposition.
  * initializes the interacting neighbor cell list of a cell The
  * created list of interacting neighbor cells is used by the verlet
@@ -502,6 +574,7 @@ void dd_init_cell_interactions()
   for(m=0; m<local_cells.n; m++) { 
     dd.cell_inter[m].nList = NULL; 
     dd.cell_inter[m].n_neighbors=0; 
+    init_pairList(&dd.cell_inter[m].vList);
   }
 
   /* loop all local cells */
@@ -518,7 +591,6 @@ void dd_init_cell_interactions()
           if(ind2 >= ind1) {
             dd.cell_inter[c_cnt].nList[n_cnt].cell_ind = ind2;
             dd.cell_inter[c_cnt].nList[n_cnt].pList    = &cells[ind2];
-            init_pairList(&dd.cell_inter[c_cnt].nList[n_cnt].vList);
 #ifdef CELL_DEBUG
     dd.cell_inter[c_cnt].nList[n_cnt].my_pos[0] = my_left[0] + r * dd.cell_size[0];
     dd.cell_inter[c_cnt].nList[n_cnt].my_pos[1] = my_left[1] + q * dd.cell_size[1];
@@ -533,6 +605,8 @@ void dd_init_cell_interactions()
     c_cnt++;
   }
 
+  dd_init_cell_colors();
+
 #ifdef CELL_DEBUG
   FILE *cells_fp;
   char cLogName[64];
@@ -735,6 +809,14 @@ void dd_on_geometry_change(int flags) {
     
   } 
 
+  /* give up a non-uniform node grid if the interaction range has
+     grown beyond the smallest domain. */
+  if (!grid_uniform && min_local_box_l < max_range) {
+    grid_reset_node_bounds();
+    grid_changed_box_l();
+    flags |= CELL_FLAG_GRIDCHANGED;
+  }
+
   /* check that the CPU domains are still sufficiently large. */
   for (int i = 0; i < 3; i++)
     if (local_box_l[i] < max_range) {
@@ -763,29 +845,31 @@ void dd_on_geometry_change(int flags) {
 
   CELL_TRACE(fprintf(stderr, "%d: dd_on_geometry_change: max_range = %f, min_cell_size = %f, max_skin = %f\n", this_node, max_range, min_cell_size, max_skin));
   
-  if (max_range > min_cell_size) {
-    /* if new box length leads to too small cells, redo cell structure
-       using smaller number of cells. */
-    cells_re_init(CELL_STRUCTURE_DOMDEC);
-    return;
-  }
+  /* if new box length leads to too small cells, redo cell structure
+     using smaller number of cells. */
+  int redo = (max_range > min_cell_size);
 
   /* If we are not in a hurry, check if we can maybe optimize the cell
      system by using smaller cells. */
-  if (!(flags & CELL_FLAG_FAST)) {
-    int i;
-    for(i=0; i<3; i++) {
+  if (!redo && !(flags & CELL_FLAG_FAST)) {
+    for(int i=0; i<3; i++) {
       int poss_size = (int)floor(local_box_l[i]/max_range);
       if (poss_size > dd.cell_grid[i])
-	break;
-    }
-    if (i < 3) {
-      /* new range/box length allow smaller cells, redo cell structure,
-	 possibly using smaller number of cells. */
-      cells_re_init(CELL_STRUCTURE_DOMDEC);
-      return;
+	redo = 1;
     }
   }
+
+  /* the cell system is re-initialized collectively, but the domains of
+     a non-uniform node grid differ. */
+  if (!grid_uniform)
+    MPI_Allreduce(MPI_IN_PLACE, &redo, 1, MPI_INT, MPI_LOR, comm_cart);
+
+  if (redo) {
+    /* new range/box length allow or require a different cell size, redo
+       cell structure. */
+    cells_re_init(CELL_STRUCTURE_DOMDEC);
+    return;
+  }
 #ifdef LEES_EDWARDS
   le_dd_update_communicators_w_boxl(&le_mgr);
 #else
@@ -892,15 +976,16 @@ void dd_topology_init(CellPList *old)
 /************************************************************/
 void dd_topology_release()
 {
-  int i,j;
+  int i;
   CELL_TRACE(fprintf(stderr,"%d: dd_topology_release:\n",this_node));
   /* release cell interactions */
   for(i=0; i<local_cells.n; i++) {
-    for(j=0; j<dd.cell_inter[i].n_neighbors; j++) 
-      free_pairList(&dd.cell_inter[i].nList[j].vList);
+    free_pairList(&dd.cell_inter[i].vList);
     dd.cell_inter[i].nList = (IA_Neighbor *) Utils::realloc(dd.cell_inter[i].nList,0);
   }
   dd.cell_inter = (IA_Neighbor_List *) Utils::realloc(dd.cell_inter,0);
+  dd.color_cells = (int *) Utils::realloc(dd.color_cells,0);
+  dd.n_colors = 0;
   /* free ghost cell pointer list */
   realloc_cellplist(&ghost_cells, ghost_cells.n = 0);
   /* free ghost communicators */
@@ -1135,49 +1220,86 @@ int calc_processor_min_num_cells()
   return min;
 }
 
-void calc_link_cell()
+/** Calculate the pair forces of local cell \a c with the link cell method.
+    @param c      index of the cell in \ref local_cells.
+    @param single whether to also calculate the bonded and single
+                  particle forces of the cell particles. */
+static void calc_link_cell_pairs(int c, int single)
 {
-  int c, np1, n, np2, i ,j, j_start;
+  int np1, n, np2, i ,j, j_start;
   Cell *cell;
   IA_Neighbor *neighbor;
   Particle *p1, *p2;
   double dist2, vec21[3];
 
-  /* Loop local cells */
-  for (c = 0; c < local_cells.n; c++) {
-
-    cell = local_cells.cell[c];
-    p1   = cell->part;
-    np1  = cell->n;
-
-    /* Loop cell neighbors */
-    for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-      neighbor = &dd.cell_inter[c].nList[n];
-      p2  = neighbor->pList->part;
-      np2 = neighbor->pList->n;
-      /* Loop cell particles */
-      for(i=0; i < np1; i++) {
-	j_start = 0;
-	/* Tasks within cell: bonded forces */
-	if(n == 0) {
+  cell = local_cells.cell[c];
+  p1   = cell->part;
+  np1  = cell->n;
+
+  /* Loop cell neighbors */
+  for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
+    neighbor = &dd.cell_inter[c].nList[n];
+    p2  = neighbor->pList->part;
+    np2 = neighbor->pList->n;
+    /* Loop cell particles */
+    for(i=0; i < np1; i++) {
+      j_start = 0;
+      /* Tasks within cell: bonded forces */
+      if(n == 0) {
+        if (single) {
           add_single_particle_force(&p1[i]);
-	  if (rebuild_verletlist)
-	    memcpy(p1[i].l.p_old, p1[i].r.p, 3*sizeof(double));
-
-	  j_start = i+1;
-	}
-	/* Loop neighbor cell particles */
-	for(j = j_start; j < np2; j++) {
+          if (rebuild_verletlist)
+            memcpy(p1[i].l.p_old, p1[i].r.p, 3*sizeof(double));
+        }
+        j_start = i+1;
+      }
+      /* Loop neighbor cell particles */
+      for(j = j_start; j < np2; j++) {
 #ifdef EXCLUSIONS
-          if(do_nonbonded(&p1[i], &p2[j]))
+        if(do_nonbonded(&p1[i], &p2[j]))
 #endif
-	    {
-	      dist2 = distance2vec(p1[i].r.p, p2[j].r.p, vec21);
-	      add_non_bonded_pair_force(&(p1[i]), &(p2[j]), vec21, sqrt(dist2), dist2);
-	    }
-	}
+          {
+            dist2 = distance2vec(p1[i].r.p, p2[j].r.p, vec21);
+            add_non_bonded_pair_force(&(p1[i]), &(p2[j]), vec21, sqrt(dist2), dist2);
+          }
+      }
+    }
+  }
+}
+
+void calc_link_cell()
+{
+  int c;
+
+#ifdef THREADED_PAIR_LOOP
+  if (threads_pair_loop_active()) {
+    int col, k, i, np;
+    Particle *p;
+
+    /* bonded forces may act on any particle, see threads.hpp */
+    for (c = 0; c < local_cells.n; c++) {
+      p  = local_cells.cell[c]->part;
+      np = local_cells.cell[c]->n;
+      for(i = 0; i < np; i++) {
+        add_single_particle_force(&p[i]);
+        if (rebuild_verletlist)
+          memcpy(p[i].l.p_old, p[i].r.p, 3*sizeof(double));
       }
     }
+
+    ES_OMP_PRAGMA(omp parallel private(col, k))
+    for (col = 0; col < dd.n_colors; col++) {
+      ES_OMP_PRAGMA(omp for schedule(dynamic))
+      for (k = dd.color_start[col]; k < dd.color_start[col+1]; k++)
+        calc_link_cell_pairs(dd.color_cells[k], 0);
+    }
+  }
+  else
+#endif
+  {
+    /* Loop local cells */
+    for (c = 0; c < local_cells.n; c++)
+      calc_link_cell_pairs(c, 1);
   }
   rebuild_verletlist = 0;
 }
@@ -61,6 +61,11 @@
 #include "verlet.hpp"
 #include "thermostat.hpp"
 
+/** Number of colors of the cell coloring. The interacting neighbor
+    cells of a cell span three cells in x and y and two in z, hence
+    cells with the same index modulo (3,3,2) never share a neighbor. */
+#define DD_MAX_COLORS 18
+
 /** Structure containing information about non bonded interactions
     with particles in a neighbor cell. */
 typedef struct {
@@ -68,8 +73,6 @@ typedef struct {
   int cell_ind;
   /** Pointer to particle list of neighbor cell. */
   ParticleList *pList;
-  /** Verlet list for non bonded interactions of a cell with a neighbor cell. */
-  PairList vList;
 
 #ifdef CELL_DEBUG
   double my_pos[3];  /* position of the cell corner, only here for debug */
@@ -100,8 +103,20 @@ typedef struct {
   int n_neighbors;
   /** Interacting neighbor cell list  */
   IA_Neighbor *nList;
+  /** Verlet list for non bonded interactions of the cell with all
+      its neighbor cells. */
+  PairList vList;
 } IA_Neighbor_List;
 
+/** Resolve a packed Verlet pair partner, see \ref verlet_pack_partner.
+    @param il  the neighbor list of the cell the pair list belongs to.
+    @param idx the packed partner.
+    @return pointer to the partner particle. */
+inline Particle *dd_pair_partner(const IA_Neighbor_List *il, unsigned int idx)
+{
+  return &il->nList[idx >> VERLET_PART_BITS].pList->part[idx & VERLET_PART_MASK];
+}
+
 /** Structure containing the information about the cell grid used for domain decomposition. */
 typedef struct {
   /** flag for using Verlet List */
@@ -117,6 +132,19 @@ typedef struct {
   double inv_cell_size[3];
   /** Array containing information about the interactions between the cells. */
   IA_Neighbor_List *cell_inter;
+  /** Number of colors of the cell coloring, 0 if there is none. */
+  int n_colors;
+  /** Start of the cells of each color in \ref color_cells. */
+  int color_start[DD_MAX_COLORS + 1];
+  /** Indices of the local cells, sorted by color. The pair forces of
+      a cell act on the cell and its interacting neighbor cells
+      (\ref IA_Neighbor_List). These sets are disjoint for cells of
+      the same color, see \ref threads.hpp. */
+  int *color_cells;
+  /** Within each color, the inner cells come first. This is the
+      start of the boundary cells of each color in \ref color_cells,
+      which interact with ghost cells. */
+  int color_boundary[DD_MAX_COLORS];
 }  DomainDecomposition;
 
 /************************************************************/
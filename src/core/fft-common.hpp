@@ -110,6 +110,13 @@ typedef struct {
   /** Maximal local mesh size. */
   int max_mesh_size;
 
+  /** Direction of the k-space mesh (index into plan[3].new_mesh) in
+      which only the wave vectors 0 ... mesh/2 are stored, because the
+      first FFT is real to complex. */
+  int ks_half_dir;
+  /** Full mesh size in direction \ref ks_half_dir. */
+  int ks_half_mesh;
+
   /** send buffer. */
   double *send_buf;
   /** receive buffer. */
@@ -132,6 +139,20 @@ typedef struct {
 /* Tag for wisdom file I/O */
 #  define FFTW_FAILURE 0
 
+/** Weight of a k-space mesh point in a sum over the full k-space mesh,
+ *  if only the wave vectors with non-negative index in direction
+ *  ks_half_dir are stored. All other points stand for themselves and
+ *  their complex conjugate, only n=0 and n=mesh/2 are their own mirror
+ *  images.
+ *
+ * \param n     global index of the point in direction ks_half_dir.
+ * \param mesh  full mesh size in that direction (ks_half_mesh).
+ */
+inline double fft_hermitian_weight(int n, int mesh)
+{
+  return (n == 0 || 2*n == mesh) ? 1.0 : 2.0;
+}
+
 /** Initialize FFT data structure. */
 void fft_common_pre_init(fft_data_struct *fft);
 
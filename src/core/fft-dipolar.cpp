@@ -78,6 +78,9 @@ int dfft_init(double **data,
   int my_pos[4][3]; /* The position of this_node in the node grids. */
   int *n_id[4];     /* linear node identity lists for the node grids. */
   int *n_pos[4];    /* positions of nodes in the node grids. */
+  /* global k-space mesh: only half of the wave vectors in the first FFT direction */
+  int ks_mesh_dim[3];
+  int half[3];
   /* FFTW WISDOM stuff. */
   char wisdom_file_name[255];
   FILE *wisdom_file;
@@ -116,12 +119,22 @@ int dfft_init(double **data,
   dfft.plan[2].row_dir = (dfft.plan[1].row_dir-1)%3;
   dfft.plan[3].row_dir = (dfft.plan[1].row_dir-2)%3;
 
+  /* The first FFT is real to complex. Its output and the meshes of the
+     following FFTs only contain the wave vectors with non-negative
+     index in the first direction, the others are the complex
+     conjugates. */
+  for(i=0;i<3;i++) ks_mesh_dim[i] = global_mesh_dim[i];
+  ks_mesh_dim[dfft.plan[1].row_dir] = global_mesh_dim[dfft.plan[1].row_dir]/2 + 1;
+
 
 
   /* === communication groups === */
   /* copy local mesh off real space charge assignment grid */
   for(i=0;i<3;i++) dfft.plan[0].new_mesh[i] = local_mesh_dim[i];
   for(i=1; i<4;i++) {
+    /* the first FFT is done on the real mesh */
+    int *mesh = (i==1) ? global_mesh_dim : ks_mesh_dim;
+
     dfft.plan[i].g_size=fft_find_comm_groups(n_grid[i-1], n_grid[i], n_id[i-1], n_id[i], 
 					dfft.plan[i].group, n_pos[i], my_pos[i]);
     if(dfft.plan[i].g_size==-1) {
@@ -142,7 +155,7 @@ int dfft_init(double **data,
     dfft.plan[i].recv_block = (int *)Utils::realloc(dfft.plan[i].recv_block, 6*dfft.plan[i].g_size*sizeof(int));
     dfft.plan[i].recv_size  = (int *)Utils::realloc(dfft.plan[i].recv_size, 1*dfft.plan[i].g_size*sizeof(int));
 
-    dfft.plan[i].new_size = fft_calc_local_mesh(my_pos[i], n_grid[i], global_mesh_dim,
+    dfft.plan[i].new_size = fft_calc_local_mesh(my_pos[i], n_grid[i], mesh,
 					   global_mesh_off, dfft.plan[i].new_mesh, 
 					   dfft.plan[i].start);  
     permute_ifield(dfft.plan[i].new_mesh,3,-(dfft.plan[i].n_permute));
@@ -156,7 +169,7 @@ int dfft_init(double **data,
       node = dfft.plan[i].group[j];
       dfft.plan[i].send_size[j] 
 	= fft_calc_send_block(my_pos[i-1], n_grid[i-1], &(n_pos[i][3*node]), n_grid[i],
-			      global_mesh_dim, global_mesh_off, &(dfft.plan[i].send_block[6*j]));
+			      mesh, global_mesh_off, &(dfft.plan[i].send_block[6*j]));
       permute_ifield(&(dfft.plan[i].send_block[6*j]),3,-(dfft.plan[i-1].n_permute));
       permute_ifield(&(dfft.plan[i].send_block[6*j+3]),3,-(dfft.plan[i-1].n_permute));
       if(dfft.plan[i].send_size[j] > dfft.max_comm_size) 
@@ -171,7 +184,7 @@ int dfft_init(double **data,
       /* recv block: this_node from comm-group-node i (identity: node) */
       dfft.plan[i].recv_size[j] 
 	= fft_calc_send_block(my_pos[i], n_grid[i], &(n_pos[i-1][3*node]), n_grid[i-1],
-			      global_mesh_dim, global_mesh_off,&(dfft.plan[i].recv_block[6*j]));
+			      mesh, global_mesh_off,&(dfft.plan[i].recv_block[6*j]));
       permute_ifield(&(dfft.plan[i].recv_block[6*j]),3,-(dfft.plan[i].n_permute));
       permute_ifield(&(dfft.plan[i].recv_block[6*j+3]),3,-(dfft.plan[i].n_permute));
       if(dfft.plan[i].recv_size[j] > dfft.max_comm_size) 
@@ -179,6 +192,8 @@ int dfft_init(double **data,
     }
 
     for(j=0;j<3;j++) dfft.plan[i].old_mesh[j] = dfft.plan[i-1].new_mesh[j];
+    /* rows of the first FFT have only half of the wave vectors */
+    if(i==2) dfft.plan[2].old_mesh[2] = ks_mesh_dim[dfft.plan[1].row_dir];
     if(i==1) 
       dfft.plan[i].element = 1; 
     else {
@@ -198,9 +213,19 @@ int dfft_init(double **data,
   /* Factor 2 for complex fields */
   dfft.max_comm_size *= 2;
   dfft.max_mesh_size = (local_mesh_dim[0]*local_mesh_dim[1]*local_mesh_dim[2]);
-  for(i=1;i<4;i++) 
+  /* real input and complex output of the first FFT */
+  if(dfft.plan[1].new_size > dfft.max_mesh_size) dfft.max_mesh_size = dfft.plan[1].new_size;
+  if(2*dfft.plan[1].n_ffts*ks_mesh_dim[dfft.plan[1].row_dir] > dfft.max_mesh_size)
+    dfft.max_mesh_size = 2*dfft.plan[1].n_ffts*ks_mesh_dim[dfft.plan[1].row_dir];
+  for(i=2;i<4;i++) 
     if(2*dfft.plan[i].new_size > dfft.max_mesh_size) dfft.max_mesh_size = 2*dfft.plan[i].new_size;
 
+  /* position of the halved direction in the k-space mesh */
+  for(i=0;i<3;i++) half[i] = (i == dfft.plan[1].row_dir);
+  permute_ifield(half,3,-(dfft.plan[3].n_permute));
+  for(i=0;i<3;i++) if(half[i]) dfft.ks_half_dir = i;
+  dfft.ks_half_mesh = global_mesh_dim[dfft.plan[1].row_dir];
+
   FFT_TRACE(fprintf(stderr,"%d: dfft.max_comm_size = %d, dfft.max_mesh_size = %d\n",
 		    this_node,dfft.max_comm_size,dfft.max_mesh_size));
 
@@ -239,7 +264,7 @@ int dfft_init(double **data,
     /* FFT plan creation. 
        Attention: destroys contents of c_data/data and c_data_buf/data_buf. */
     wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"dfftw3_1d_wisdom_forw_n%d.file",
+    sprintf(wisdom_file_name,(i==1) ? "dfftw3_1d_wisdom_r2c_n%d.file" : "dfftw3_1d_wisdom_forw_n%d.file",
 	    dfft.plan[i].new_mesh[2]);
     if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
       wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
@@ -247,11 +272,18 @@ int dfft_init(double **data,
     }
     if(dfft.init_tag==1) fftw_destroy_plan(dfft.plan[i].our_fftw_plan);
 //printf("dfft.plan[%d].n_ffts=%d\n",i,dfft.plan[i].n_ffts);
-    dfft.plan[i].our_fftw_plan =
-      fftw_plan_many_dft(1,&dfft.plan[i].new_mesh[2],dfft.plan[i].n_ffts,
-                         c_data,NULL,1,dfft.plan[i].new_mesh[2],
-                         c_data,NULL,1,dfft.plan[i].new_mesh[2],
-                         dfft.plan[i].dir,FFTW_PATIENT);
+    if(i==1)
+      dfft.plan[i].our_fftw_plan =
+        fftw_plan_many_dft_r2c(1,&dfft.plan[i].new_mesh[2],dfft.plan[i].n_ffts,
+                               dfft.data_buf,NULL,1,dfft.plan[i].new_mesh[2],
+                               c_data,NULL,1,ks_mesh_dim[dfft.plan[1].row_dir],
+                               FFTW_PATIENT);
+    else
+      dfft.plan[i].our_fftw_plan =
+        fftw_plan_many_dft(1,&dfft.plan[i].new_mesh[2],dfft.plan[i].n_ffts,
+                           c_data,NULL,1,dfft.plan[i].new_mesh[2],
+                           c_data,NULL,1,dfft.plan[i].new_mesh[2],
+                           dfft.plan[i].dir,FFTW_PATIENT);
     if( wisdom_status == FFTW_FAILURE && 
 	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
       fftw_export_wisdom_to_file(wisdom_file);
@@ -265,18 +297,25 @@ int dfft_init(double **data,
   for(i=1;i<4;i++) {
     dfft.back[i].dir = FFTW_BACKWARD;
     wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"dfftw3_1d_wisdom_back_n%d.file",
+    sprintf(wisdom_file_name,(i==1) ? "dfftw3_1d_wisdom_c2r_n%d.file" : "dfftw3_1d_wisdom_back_n%d.file",
 	    dfft.plan[i].new_mesh[2]);
     if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
       wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
       fclose(wisdom_file);
     }    
     if(dfft.init_tag==1) fftw_destroy_plan(dfft.back[i].our_fftw_plan);
-    dfft.back[i].our_fftw_plan =
-      fftw_plan_many_dft(1,&dfft.plan[i].new_mesh[2],dfft.plan[i].n_ffts,
-                         c_data,NULL,1,dfft.plan[i].new_mesh[2],
-                         c_data,NULL,1,dfft.plan[i].new_mesh[2],
-                         dfft.back[i].dir,FFTW_PATIENT);
+    if(i==1)
+      dfft.back[i].our_fftw_plan =
+        fftw_plan_many_dft_c2r(1,&dfft.plan[i].new_mesh[2],dfft.plan[i].n_ffts,
+                               c_data,NULL,1,ks_mesh_dim[dfft.plan[1].row_dir],
+                               dfft.data_buf,NULL,1,dfft.plan[i].new_mesh[2],
+                               FFTW_PATIENT);
+    else
+      dfft.back[i].our_fftw_plan =
+        fftw_plan_many_dft(1,&dfft.plan[i].new_mesh[2],dfft.plan[i].n_ffts,
+                           c_data,NULL,1,dfft.plan[i].new_mesh[2],
+                           c_data,NULL,1,dfft.plan[i].new_mesh[2],
+                           dfft.back[i].dir,FFTW_PATIENT);
     if( wisdom_status == FFTW_FAILURE && 
 	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
       fftw_export_wisdom_to_file(wisdom_file);
@@ -303,7 +342,6 @@ int dfft_init(double **data,
 
 void dfft_perform_forw(double *data)
 {
-  int i;
   /* int m,n,o; */
   /* ===== first direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_forw: dir 1:\n",this_node));
@@ -329,13 +367,8 @@ void dfft_perform_forw(double *data)
     }
   */
 
-  /* complexify the real data array (in is data_buf) */
-  for(i=0;i<dfft.plan[1].new_size;i++) {
-    data[2*i]     = dfft.data_buf[i];     /* real value */
-    data[(2*i)+1] = 0;       /* complex value */
-  }
-  /* perform FFT (in/out is data)*/
-  fftw_execute_dft(dfft.plan[1].our_fftw_plan,c_data,c_data);
+  /* perform real to complex FFT (in is dfft.data_buf, out is data) */
+  fftw_execute_dft_r2c(dfft.plan[1].our_fftw_plan,dfft.data_buf,c_data);
   /* ===== second direction ===== */
   FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_forw: dir 2:\n",this_node));
   /* communication to current dir row format (in is data) */
@@ -356,7 +389,6 @@ void dfft_perform_forw(double *data)
 
 void dfft_perform_back(double *data)
 {
-  int i;
 
   fftw_complex *c_data     = (fftw_complex *) data;
   fftw_complex *c_data_buf = (fftw_complex *) dfft.data_buf;
@@ -379,17 +411,8 @@ void dfft_perform_back(double *data)
 
   /* ===== first direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 1:\n",this_node));
-  /* perform FFT (in is data) */
-  fftw_execute_dft(dfft.back[1].our_fftw_plan,c_data,c_data);
-  /* throw away the (hopefully) empty complex component (in is data)*/
-  for(i=0;i<dfft.plan[1].new_size;i++) {
-    dfft.data_buf[i] = data[2*i]; /* real value */
-    //Vincent:
-    if (data[2*i+1]>1e-5) {
-      printf("dipoar fft - Complex value is not zero (i=%d,data=%g)!!!\n",i,data[2*i+1]);
-      if (i>100) errexit();
-    }
-  }
+  /* perform complex to real FFT (in is data, out is dfft.data_buf) */
+  fftw_execute_dft_c2r(dfft.back[1].our_fftw_plan,c_data,dfft.data_buf);
   /* communicate (in is data_buf) */
   dfft_back_grid_comm(dfft.plan[1],dfft.back[1],dfft.data_buf,data);
 
@@ -32,9 +32,13 @@
  *  1D-FFT. After performing the FFT on theat direction the data is
  *  redistributed.
  *
- *  For simplicity at the moment I have implemented a full complex to
- *  complex FFT (even though a real to complex FFT would be
- *  sufficient)
+ *  The first 1D-FFT is a real to complex FFT. Since the mesh is real,
+ *  the k-space mesh is hermitian and only the wave vectors with
+ *  non-negative index in the first direction are stored (mesh/2+1
+ *  points instead of mesh, see dfft.ks_half_dir), which halves the
+ *  memory and the communication of the following steps. Sums over
+ *  the full k-space mesh have to weight the points with
+ *  \ref fft_hermitian_weight.
  *
  *  \todo Combine the forward and backward structures.
  *  \todo The packing routines could be moved to utils.hpp when they are needed elsewhere.
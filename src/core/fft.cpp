@@ -75,6 +75,9 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
   int my_pos[4][3]; /* The position of this_node in the node grids. */
   int *n_id[4];     /* linear node identity lists for the node grids. */
   int *n_pos[4];    /* positions of nodes in the node grids. */
+  /* global k-space mesh: only half of the wave vectors in the first FFT direction */
+  int ks_mesh_dim[3];
+  int half[3];
   /* FFTW WISDOM stuff. */
   char wisdom_file_name[255];
   FILE *wisdom_file;
@@ -115,12 +118,22 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
   fft.plan[2].row_dir = (fft.plan[1].row_dir-1)%3;
   fft.plan[3].row_dir = (fft.plan[1].row_dir-2)%3;
 
+  /* The first FFT is real to complex. Its output and the meshes of the
+     following FFTs only contain the wave vectors with non-negative
+     index in the first direction, the others are the complex
+     conjugates. */
+  for(i=0;i<3;i++) ks_mesh_dim[i] = global_mesh_dim[i];
+  ks_mesh_dim[fft.plan[1].row_dir] = global_mesh_dim[fft.plan[1].row_dir]/2 + 1;
+
 
 
   /* === communication groups === */
   /* copy local mesh off real space charge assignment grid */
   for(i=0;i<3;i++) fft.plan[0].new_mesh[i] = ca_mesh_dim[i];
   for(i=1; i<4;i++) {
+    /* the first FFT is done on the real mesh */
+    int *mesh = (i==1) ? global_mesh_dim : ks_mesh_dim;
+
     fft.plan[i].g_size=fft_find_comm_groups(n_grid[i-1], n_grid[i], n_id[i-1], n_id[i], 
 					fft.plan[i].group, n_pos[i], my_pos[i]);
     if(fft.plan[i].g_size==-1) {
@@ -141,7 +154,7 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
     fft.plan[i].recv_block = (int *)Utils::realloc(fft.plan[i].recv_block, 6*fft.plan[i].g_size*sizeof(int));
     fft.plan[i].recv_size  = (int *)Utils::realloc(fft.plan[i].recv_size, 1*fft.plan[i].g_size*sizeof(int));
 
-    fft.plan[i].new_size = fft_calc_local_mesh(my_pos[i], n_grid[i], global_mesh_dim,
+    fft.plan[i].new_size = fft_calc_local_mesh(my_pos[i], n_grid[i], mesh,
 					   global_mesh_off, fft.plan[i].new_mesh, 
 					   fft.plan[i].start);  
     permute_ifield(fft.plan[i].new_mesh,3,-(fft.plan[i].n_permute));
@@ -159,7 +172,7 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
       node = fft.plan[i].group[j];
       fft.plan[i].send_size[j] 
 	= fft_calc_send_block(my_pos[i-1], n_grid[i-1], &(n_pos[i][3*node]), n_grid[i],
-			      global_mesh_dim, global_mesh_off, &(fft.plan[i].send_block[6*j]));
+			      mesh, global_mesh_off, &(fft.plan[i].send_block[6*j]));
       permute_ifield(&(fft.plan[i].send_block[6*j]),3,-(fft.plan[i-1].n_permute));
       permute_ifield(&(fft.plan[i].send_block[6*j+3]),3,-(fft.plan[i-1].n_permute));
       if(fft.plan[i].send_size[j] > fft.max_comm_size) 
@@ -174,7 +187,7 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
       /* recv block: this_node from comm-group-node i (identity: node) */
       fft.plan[i].recv_size[j] 
 	= fft_calc_send_block(my_pos[i], n_grid[i], &(n_pos[i-1][3*node]), n_grid[i-1],
-			      global_mesh_dim, global_mesh_off, &(fft.plan[i].recv_block[6*j]));
+			      mesh, global_mesh_off, &(fft.plan[i].recv_block[6*j]));
       permute_ifield(&(fft.plan[i].recv_block[6*j]),3,-(fft.plan[i].n_permute));
       permute_ifield(&(fft.plan[i].recv_block[6*j+3]),3,-(fft.plan[i].n_permute));
       if(fft.plan[i].recv_size[j] > fft.max_comm_size) 
@@ -182,6 +195,8 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
     }
 
     for(j=0;j<3;j++) fft.plan[i].old_mesh[j] = fft.plan[i-1].new_mesh[j];
+    /* rows of the first FFT have only half of the wave vectors */
+    if(i==2) fft.plan[2].old_mesh[2] = ks_mesh_dim[fft.plan[1].row_dir];
     if(i==1) 
       fft.plan[i].element = 1; 
     else {
@@ -201,9 +216,19 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
   /* Factor 2 for complex fields */
   fft.max_comm_size *= 2;
   fft.max_mesh_size = (ca_mesh_dim[0]*ca_mesh_dim[1]*ca_mesh_dim[2]);
-  for(i=1;i<4;i++) 
+  /* real input and complex output of the first FFT */
+  if(fft.plan[1].new_size > fft.max_mesh_size) fft.max_mesh_size = fft.plan[1].new_size;
+  if(2*fft.plan[1].n_ffts*ks_mesh_dim[fft.plan[1].row_dir] > fft.max_mesh_size)
+    fft.max_mesh_size = 2*fft.plan[1].n_ffts*ks_mesh_dim[fft.plan[1].row_dir];
+  for(i=2;i<4;i++) 
     if(2*fft.plan[i].new_size > fft.max_mesh_size) fft.max_mesh_size = 2*fft.plan[i].new_size;
 
+  /* position of the halved direction in the k-space mesh */
+  for(i=0;i<3;i++) half[i] = (i == fft.plan[1].row_dir);
+  permute_ifield(half,3,-(fft.plan[3].n_permute));
+  for(i=0;i<3;i++) if(half[i]) fft.ks_half_dir = i;
+  fft.ks_half_mesh = global_mesh_dim[fft.plan[1].row_dir];
+
   FFT_TRACE(fprintf(stderr,"%d: fft.max_comm_size = %d, fft.max_mesh_size = %d\n",
 		    this_node,fft.max_comm_size,fft.max_mesh_size));
 
@@ -244,7 +269,7 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
     /* FFT plan creation. 
        Attention: destroys contents of c_data/data and c_fft.data_buf/data_buf. */
     wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"fftw3_1d_wisdom_forw_n%d.file",
+    sprintf(wisdom_file_name,(i==1) ? "fftw3_1d_wisdom_r2c_n%d.file" : "fftw3_1d_wisdom_forw_n%d.file",
 	    fft.plan[i].new_mesh[2]);
     if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
       wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
@@ -252,11 +277,18 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
     }
     if(fft.init_tag==1) fftw_destroy_plan(fft.plan[i].our_fftw_plan);
 //printf("fft.plan[%d].n_ffts=%d\n",i,fft.plan[i].n_ffts);
-    fft.plan[i].our_fftw_plan =
-      fftw_plan_many_dft(1,&fft.plan[i].new_mesh[2],fft.plan[i].n_ffts,
-                         c_data,NULL,1,fft.plan[i].new_mesh[2],
-                         c_data,NULL,1,fft.plan[i].new_mesh[2],
-                         fft.plan[i].dir,FFTW_PATIENT);
+    if(i==1)
+      fft.plan[i].our_fftw_plan =
+        fftw_plan_many_dft_r2c(1,&fft.plan[i].new_mesh[2],fft.plan[i].n_ffts,
+                               fft.data_buf,NULL,1,fft.plan[i].new_mesh[2],
+                               c_data,NULL,1,ks_mesh_dim[fft.plan[1].row_dir],
+                               FFTW_PATIENT);
+    else
+      fft.plan[i].our_fftw_plan =
+        fftw_plan_many_dft(1,&fft.plan[i].new_mesh[2],fft.plan[i].n_ffts,
+                           c_data,NULL,1,fft.plan[i].new_mesh[2],
+                           c_data,NULL,1,fft.plan[i].new_mesh[2],
+                           fft.plan[i].dir,FFTW_PATIENT);
     if( wisdom_status == FFTW_FAILURE && 
 	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
       fftw_export_wisdom_to_file(wisdom_file);
@@ -270,18 +302,25 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
   for(i=1;i<4;i++) {
     fft.back[i].dir = FFTW_BACKWARD;
     wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"fftw3_1d_wisdom_back_n%d.file",
+    sprintf(wisdom_file_name,(i==1) ? "fftw3_1d_wisdom_c2r_n%d.file" : "fftw3_1d_wisdom_back_n%d.file",
 	    fft.plan[i].new_mesh[2]);
     if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
       wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
       fclose(wisdom_file);
     }    
     if(fft.init_tag==1) fftw_destroy_plan(fft.back[i].our_fftw_plan);
-    fft.back[i].our_fftw_plan =
-      fftw_plan_many_dft(1,&fft.plan[i].new_mesh[2],fft.plan[i].n_ffts,
-                         c_data,NULL,1,fft.plan[i].new_mesh[2],
-                         c_data,NULL,1,fft.plan[i].new_mesh[2],
-                         fft.back[i].dir,FFTW_PATIENT);
+    if(i==1)
+      fft.back[i].our_fftw_plan =
+        fftw_plan_many_dft_c2r(1,&fft.plan[i].new_mesh[2],fft.plan[i].n_ffts,
+                               c_data,NULL,1,ks_mesh_dim[fft.plan[1].row_dir],
+                               fft.data_buf,NULL,1,fft.plan[i].new_mesh[2],
+                               FFTW_PATIENT);
+    else
+      fft.back[i].our_fftw_plan =
+        fftw_plan_many_dft(1,&fft.plan[i].new_mesh[2],fft.plan[i].n_ffts,
+                           c_data,NULL,1,fft.plan[i].new_mesh[2],
+                           c_data,NULL,1,fft.plan[i].new_mesh[2],
+                           fft.back[i].dir,FFTW_PATIENT);
     if( wisdom_status == FFTW_FAILURE && 
 	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
       fftw_export_wisdom_to_file(wisdom_file);
@@ -307,7 +346,6 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
 
 void fft_perform_forw(double *data)
 {
-  int i;
 
   /* int m,n,o; */
   /* ===== first direction  ===== */
@@ -334,13 +372,8 @@ void fft_perform_forw(double *data)
     }
   */
 
-  /* complexify the real data array (in is fft.data_buf) */
-  for(i=0;i<fft.plan[1].new_size;i++) {
-    data[2*i]     = fft.data_buf[i];     /* real value */
-    data[(2*i)+1] = 0;       /* complex value */
-  }
-  /* perform FFT (in/out is data)*/
-  fftw_execute_dft(fft.plan[1].our_fftw_plan,c_data,c_data);
+  /* perform real to complex FFT (in is fft.data_buf, out is data) */
+  fftw_execute_dft_r2c(fft.plan[1].our_fftw_plan,fft.data_buf,c_data);
   /* ===== second direction ===== */
   FFT_TRACE(fprintf(stderr,"%d: fft_perform_forw: dir 2:\n",this_node));
   /* communication to current dir row format (in is data) */
@@ -360,7 +393,6 @@ void fft_perform_forw(double *data)
 
 void fft_perform_back(double *data)
 {
-  int i;
   
   fftw_complex *c_data     = (fftw_complex *) data;
   fftw_complex *c_data_buf = (fftw_complex *) fft.data_buf;
@@ -383,17 +415,8 @@ void fft_perform_back(double *data)
 
   /* ===== first direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 1:\n",this_node));
-  /* perform FFT (in is data) */
-  fftw_execute_dft(fft.back[1].our_fftw_plan,c_data,c_data);
-  /* throw away the (hopefully) empty complex component (in is data)*/
-  for(i=0;i<fft.plan[1].new_size;i++) {
-    fft.data_buf[i] = data[2*i]; /* real value */
-    //Vincent:
-    if (data[2*i+1]>1e-5) {
-      printf("Complex value is not zero (i=%d,data=%g)!!!\n",i,data[2*i+1]);
-      if (i>100) errexit();
-      } 
-  }
+  /* perform complex to real FFT (in is data, out is fft.data_buf) */
+  fftw_execute_dft_c2r(fft.back[1].our_fftw_plan,c_data,fft.data_buf);
   /* communicate (in is fft.data_buf) */
   fft_back_grid_comm(fft.plan[1],fft.back[1],fft.data_buf,data);
 
@@ -30,8 +30,13 @@
 #include "maggs.hpp"
 #include "forces_inline.hpp"
 #include "electrokinetics.hpp"
+#include "load_balance.hpp"
+#include "phase_timers.hpp"
+#include "integrate.hpp"
 
 #include <cassert>
+#include <vector>
+#include <mpi.h>
 ActorList forceActors;
 
 void init_forces()
@@ -50,10 +55,14 @@ void init_forces()
 #endif
 
 
+  /* new thermal noise for this force calculation */
+  thermo_noise_step++;
+
   /* initialize forces with langevin thermostat forces
      or zero depending on the thermostat
      set torque to zero for all and rescale quaternions
   */
+  ES_OMP_PRAGMA(omp parallel for private(cell, p, np, i) schedule(static) if(propagate_threaded()))
   for (c = 0; c < local_cells.n; c++) {
     cell = local_cells.cell[c];
     p  = cell->part;
@@ -119,10 +128,37 @@ void check_forces()
   }
 }
 
+/** Check whether the update of the ghost positions can run in the
+    background until the short range forces are calculated, i.e.
+    nothing in between accesses the ghost particles. */
+static int ghost_update_overlaps()
+{
+#if defined(VIRTUAL_SITES) || defined(LJ_ANGLE)
+  return 0;
+#else
+  if (!forceActors.empty())
+    return 0;
+#ifdef ELECTROSTATICS
+  if (iccp3m_initialized && iccp3m_cfg.set_flag)
+    return 0;
+  if (coulomb.method == COULOMB_MAGGS)
+    return 0;
+#endif
+  return 1;
+#endif
+}
+
 void force_calc()
 {
+  phase_timer_begin(PHASE_FORCE_CALC);
+
   // Communication step: distribute ghost positions
-  cells_update_ghosts();
+  phase_timer_begin(PHASE_GHOST_UPDATE);
+  if (ghost_update_overlaps())
+    cells_start_update_ghosts();
+  else
+    cells_update_ghosts();
+  phase_timer_end(PHASE_GHOST_UPDATE);
 
   // VIRTUAL_SITES pos (and vel for DPD) update for security reason !!!
 #ifdef VIRTUAL_SITES
@@ -159,7 +195,9 @@ espressoSystemInterface.update();
   if (iccp3m_initialized && iccp3m_cfg.set_flag)
     iccp3m_iteration();
 #endif
+  phase_timer_begin(PHASE_THERMOSTAT);
   init_forces();
+  phase_timer_end(PHASE_THERMOSTAT);
 
   for (ActorList::iterator actor = forceActors.begin();
           actor != forceActors.end(); ++actor)
@@ -170,16 +208,26 @@ espressoSystemInterface.update();
 #endif
   }
 
-  calc_long_range_forces();
+  phase_timer_begin(PHASE_LONG_RANGE);
+  if (respa_steps > 1 && integ_switch != INTEG_METHOD_STEEPEST_DESCENT)
+    calc_long_range_forces_respa();
+  else
+    calc_long_range_forces();
+  phase_timer_end(PHASE_LONG_RANGE);
 
+  phase_timer_begin(PHASE_SHORT_RANGE);
+  double short_range_start = MPI_Wtime();
   switch (cell_structure.type) {
   case CELL_STRUCTURE_LAYERED:
     layered_calculate_ia();
     break;
   case CELL_STRUCTURE_DOMDEC:
     if(dd.use_vList) {
-      if (rebuild_verletlist)
+      if (rebuild_verletlist) {
+        phase_timer_begin(PHASE_VERLET_REBUILD);
         build_verlet_lists_and_calc_verlet_ia();
+        phase_timer_end(PHASE_VERLET_REBUILD);
+      }
       else
     calculate_verlet_ia();
     }
@@ -190,6 +238,10 @@ espressoSystemInterface.update();
     nsq_calculate_ia();
 
   }
+  /* in case the short range forces did not need the ghosts */
+  ghost_communicator_finish();
+  load_balance_add_time(MPI_Wtime() - short_range_start);
+  phase_timer_end(PHASE_SHORT_RANGE);
 
 #ifdef OIF_GLOBAL_FORCES
     double area_volume[2]; //There are two global quantities that need to be evaluated: object's surface and object's volume. One can add another quantity.
@@ -232,7 +284,9 @@ espressoSystemInterface.update();
 #endif
 
   // Communication Step: ghost forces
+  phase_timer_begin(PHASE_GHOST_FORCES);
   ghost_communicator(&cell_structure.collect_ghost_force_comm);
+  phase_timer_end(PHASE_GHOST_FORCES);
 
   // apply trap forces to trapped molecules
 #ifdef MOLFORCES
@@ -247,6 +301,43 @@ espressoSystemInterface.update();
   // mark that forces are now up-to-date
   recalc_forces = 0;
 
+  phase_timer_end(PHASE_FORCE_CALC);
+
+}
+
+void calc_long_range_forces_respa()
+{
+  if (respa_phase != 0)
+    return;
+
+  /* the forces so far, i.e. the thermostat and external forces */
+  std::vector<double> f_fast;
+  for (int c = 0; c < local_cells.n; c++) {
+    Cell *cell = local_cells.cell[c];
+    for (int i = 0; i < cell->n; i++) {
+      Particle *p = &cell->part[i];
+      f_fast.insert(f_fast.end(), p->f.f, p->f.f + 3);
+#ifdef ROTATION
+      f_fast.insert(f_fast.end(), p->f.torque, p->f.torque + 3);
+#endif
+    }
+  }
+
+  calc_long_range_forces();
+
+  int j = 0;
+  for (int c = 0; c < local_cells.n; c++) {
+    Cell *cell = local_cells.cell[c];
+    for (int i = 0; i < cell->n; i++) {
+      Particle *p = &cell->part[i];
+      for (int k = 0; k < 3; k++, j++)
+        p->f.f[k] = f_fast[j] + respa_steps*(p->f.f[k] - f_fast[j]);
+#ifdef ROTATION
+      for (int k = 0; k < 3; k++, j++)
+        p->f.torque[k] = f_fast[j] + respa_steps*(p->f.torque[k] - f_fast[j]);
+#endif
+    }
+  }
 }
 
 void calc_long_range_forces()
@@ -256,6 +347,7 @@ void calc_long_range_forces()
   switch (coulomb.method) {
 #ifdef P3M
   case COULOMB_ELC_P3M:
+    phase_timer_begin(PHASE_P3M);
     if (elc_params.dielectric_contrast_on) {
       ELC_P3M_modify_p3m_sums_both();
       ELC_p3m_charge_assign_both();
@@ -268,17 +360,22 @@ void calc_long_range_forces()
     
     if (elc_params.dielectric_contrast_on)
       ELC_P3M_restore_p3m_sums();
+    phase_timer_end(PHASE_P3M);
     
+    phase_timer_begin(PHASE_ELC);
     ELC_add_force();
+    phase_timer_end(PHASE_ELC);
     
     break;
 #endif
 #ifdef CUDA
   case COULOMB_P3M_GPU:
+    phase_timer_begin(PHASE_P3M);
     if (this_node == 0) {
       FORCE_TRACE(printf("Computing GPU P3M forces.\n"));
       p3m_gpu_add_farfield_force();
     }
+    phase_timer_end(PHASE_P3M);
     /* there is no NPT handling here as long as we cannot compute energies.
        This is checked in integrator_npt_sanity_checks() when integration starts. */
     break;
@@ -286,6 +383,7 @@ void calc_long_range_forces()
 #ifdef P3M
   case COULOMB_P3M:
     FORCE_TRACE(printf("%d: Computing P3M forces.\n", this_node));
+    phase_timer_begin(PHASE_P3M);
     p3m_charge_assign();
 #ifdef NPT
     if (integ_switch == INTEG_METHOD_NPT_ISO)
@@ -293,19 +391,26 @@ void calc_long_range_forces()
     else
 #endif
       p3m_calc_kspace_forces(1, 0);
+    phase_timer_end(PHASE_P3M);
     break;
 #endif
   case COULOMB_MAGGS:
+    phase_timer_begin(PHASE_MAGGS);
     maggs_calc_forces();
+    phase_timer_end(PHASE_MAGGS);
     break;
   case COULOMB_MMM2D:
+    phase_timer_begin(PHASE_MMM2D);
     MMM2D_add_far_force();
     MMM2D_dielectric_layers_force_contribution();
+    phase_timer_end(PHASE_MMM2D);
     break;
 #ifdef SCAFACOS
   case COULOMB_SCAFACOS:
     assert(! Scafacos::dipolar());
+    phase_timer_begin(PHASE_SCAFACOS);
     Scafacos::add_long_range_force();
+    phase_timer_end(PHASE_SCAFACOS);
     break;
 #endif
   default:
@@ -324,9 +429,12 @@ void calc_long_range_forces()
   switch (coulomb.Dmethod) {
 #ifdef DP3M
   case DIPOLAR_MDLC_P3M:
+    phase_timer_begin(PHASE_MDLC);
     add_mdlc_force_corrections();
+    phase_timer_end(PHASE_MDLC);
     //fall through 
   case DIPOLAR_P3M:
+    phase_timer_begin(PHASE_DP3M);
     dp3m_dipole_assign();
 #ifdef NPT
     if(integ_switch == INTEG_METHOD_NPT_ISO) {
@@ -335,17 +443,24 @@ void calc_long_range_forces()
     } else
 #endif
       dp3m_calc_kspace_forces(1,0);
+    phase_timer_end(PHASE_DP3M);
     
     break;
 #endif
   case DIPOLAR_ALL_WITH_ALL_AND_NO_REPLICA: 
+    phase_timer_begin(PHASE_DIPOLAR_DIRECT);
     dawaanr_calculations(1,0);
+    phase_timer_end(PHASE_DIPOLAR_DIRECT);
     break;
   case DIPOLAR_MDLC_DS:
+    phase_timer_begin(PHASE_MDLC);
     add_mdlc_force_corrections();
+    phase_timer_end(PHASE_MDLC);
     //fall through 
   case DIPOLAR_DS: 
+    phase_timer_begin(PHASE_DIPOLAR_DIRECT);
     magnetic_dipolar_direct_sum_calculations(1,0);
+    phase_timer_end(PHASE_DIPOLAR_DIRECT);
     break;
   case DIPOLAR_DS_GPU: 
     // Do nothing. It's an actor
@@ -353,7 +468,9 @@ void calc_long_range_forces()
 #ifdef SCAFACOS_DIPOLES
   case DIPOLAR_SCAFACOS: 
     assert(Scafacos::dipolar());
+    phase_timer_begin(PHASE_SCAFACOS);
     Scafacos::add_long_range_force();
+    phase_timer_end(PHASE_SCAFACOS);
 #endif
   case DIPOLAR_NONE:
       break;
@@ -55,6 +55,10 @@ void check_forces();
 /** Calculate long range forces (P3M, MMM2d...). */
 void calc_long_range_forces();
 
+/** Calculate the long range forces for the r-RESPA scheme, only on the
+    outer steps and multiplied by \ref respa_steps. */
+void calc_long_range_forces_respa();
+
 void 
 calc_non_bonded_pair_force_from_partcfg(Particle *p1, Particle *p2, 
                                         IA_parameters *ia_params,
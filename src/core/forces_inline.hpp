@@ -183,7 +183,7 @@ inline void init_local_particle_force(Particle *part) {
  *       <li> ANGLE (cos bend potential)
  *       </ul>
  *  <li> Calculate non-bonded short range interaction forces:<br>
- *       Loop all \ref IA_Neighbor::vList "verlet lists" of all \ref #cells.
+ *       Loop all \ref IA_Neighbor_List::vList "verlet lists" of all \ref #cells.
  *       <ul>
  *       <li> Lennard-Jones.
  *       <li> Buckingham.
@@ -40,23 +40,64 @@
 
 /** Tag for communication in ghost_comm. */
 #define REQ_GHOST_SEND 100
+/** Tag for the bond lists, which follow the particle data. */
+#define REQ_GHOST_BONDS 101
+/** Tag for the announcement of data in shared memory. */
+#define REQ_GHOST_SHM 102
+/** Tag for the acknowledgement that the shared memory data was read. */
+#define REQ_GHOST_SHM_DONE 103
 
-static int n_s_buffer = 0;
-static int max_s_buffer = 0;
-/** send buffer. Just grows, which should be ok */
-static char *s_buffer = NULL;
+#if defined(MPI_VERSION) && MPI_VERSION >= 3
+/** shared memory windows are available */
+#define GHOST_SHM
+#endif
+
+/** alignment of the data of the operations in a shared memory segment */
+#define GHOST_SHM_ALIGN 64
 
-std::vector<int> s_bondbuffer;
+/** Announcement of ghost data that was packed into the shared memory
+    segment of the sender. */
+typedef struct {
+  /** offset of the data in the segment of the sender, or -1 if the
+      segment was too small and the data follows as ordinary messages */
+  MPI_Aint offset;
+  /** size of the particle data in bytes */
+  int n_data;
+  /** number of bond list entries following the particle data */
+  int n_bonds;
+} GhostShmHeader;
 
-static int n_r_buffer = 0;
-static int max_r_buffer = 0;
-/** recv buffer. Just grows, which should be ok */
-static char *r_buffer = NULL;
+/** Send or receive buffer of a ghost communication. */
+typedef struct {
+  /** particle data. Just grows, which should be ok */
+  std::vector<char> data;
+  /** bond and exclusion lists, transferred in a second message */
+  std::vector<int> bonds;
+  /** header for transfers through shared memory */
+  GhostShmHeader shm;
+} GhostBuffer;
 
-std::vector<int> r_bondbuffer;
+/** buffers of the blocking collective communications */
+static GhostBuffer s_buf, r_buf;
 
 static MPI_Op MPI_FORCES_SUM;
 
+/** \name Shared memory transport between the ranks of a node */
+/*@{*/
+/** communicator of the ranks that can share memory with this one */
+static MPI_Comm shm_comm = MPI_COMM_NULL;
+/** for each rank of \ref comm_cart, its rank in \ref shm_comm or -1 */
+static std::vector<int> shm_rank;
+/** window with one send segment per rank of \ref shm_comm */
+static MPI_Win shm_win = MPI_WIN_NULL;
+/** size of the segments */
+static MPI_Aint shm_size = 0;
+/** base addresses of the segments of the ranks of \ref shm_comm */
+static std::vector<char *> shm_base;
+/** largest segment size needed since the last resize */
+static MPI_Aint shm_wanted = 0;
+/*@}*/
+
 /** whether the ghosts should also have velocity information, e. g. for DPD or RATTLE.
     You need this whenever you need the relative velocity of two particles.
     NO CHANGES OF THIS VALUE OUTSIDE OF \ref on_ghost_flags_change !!!!
@@ -134,22 +175,19 @@ int calc_transmit_size(GhostCommunication *gc, int data_parts)
   return n_buffer_new;
 }
 
-void prepare_send_buffer(GhostCommunication *gc, int data_parts)
+/** Pack the data of the particle lists of a ghost communication.
+    @param buffer     where to put the data, of size n_s_buffer
+    @param n_s_buffer size of the data as given by \ref calc_transmit_size
+    @param s_bondbuffer receives the bond and exclusion lists
+    @param gc         the ghost communication
+    @param data_parts the data to pack */
+static void pack_data(char *buffer, int n_s_buffer, std::vector<int> &s_bondbuffer,
+                      GhostCommunication *gc, int data_parts)
 {
-  GHOST_TRACE(fprintf(stderr, "%d: prepare sending to/bcast from %d\n", this_node, gc->node));
-
-  /* reallocate send buffer */
-  n_s_buffer = calc_transmit_size(gc, data_parts);
-  if (n_s_buffer > max_s_buffer) {
-    max_s_buffer = n_s_buffer;
-    s_buffer = (char*)Utils::realloc(s_buffer, max_s_buffer);
-  }
-  GHOST_TRACE(fprintf(stderr, "%d: will send %d\n", this_node, n_s_buffer));
-
   s_bondbuffer.resize(0);
 
   /* put in data */
-  char *insert = s_buffer;
+  char *insert = buffer;
   for (int pl = 0; pl < gc->n_part_lists; pl++) {
     int np   = gc->part_lists[pl]->n;
     if (data_parts & GHOSTTRANS_PARTNUM) {
@@ -226,14 +264,26 @@ void prepare_send_buffer(GhostCommunication *gc, int data_parts)
     insert += sizeof(int);
   }
 
-  if (insert - s_buffer != n_s_buffer) {
+  if (insert - buffer != n_s_buffer) {
     fprintf(stderr, "%d: INTERNAL ERROR: send buffer size %d "
             "differs from what I put in (%ld)\n",
-            this_node, n_s_buffer, insert - s_buffer);
+            this_node, n_s_buffer, insert - buffer);
     errexit();
   }
 }
 
+static void prepare_send_buffer(GhostBuffer *sb, GhostCommunication *gc, int data_parts)
+{
+  GHOST_TRACE(fprintf(stderr, "%d: prepare sending to/bcast from %d\n", this_node, gc->node));
+
+  /* reallocate send buffer */
+  int n_s_buffer = calc_transmit_size(gc, data_parts);
+  sb->data.resize(n_s_buffer);
+  GHOST_TRACE(fprintf(stderr, "%d: will send %d\n", this_node, n_s_buffer));
+
+  pack_data(sb->data.data(), n_s_buffer, sb->bonds, gc, data_parts);
+}
+
 static void prepare_ghost_cell(Cell *cell, int size)
 {
 #ifdef GHOSTS_HAVE_BONDS
@@ -270,24 +320,34 @@ static void prepare_ghost_cell(Cell *cell, int size)
   }
 }
 
-void prepare_recv_buffer(GhostCommunication *gc, int data_parts)
+static void prepare_recv_buffer(GhostBuffer *rb, GhostCommunication *gc, int data_parts)
 {
   GHOST_TRACE(fprintf(stderr, "%d: prepare receiving from %d\n", this_node, gc->node));
   /* reallocate recv buffer */
-  n_r_buffer = calc_transmit_size(gc, data_parts);
-  if (n_r_buffer > max_r_buffer) {
-    max_r_buffer = n_r_buffer;
-    r_buffer = (char*)Utils::realloc(r_buffer, max_r_buffer);
-  }
-  GHOST_TRACE(fprintf(stderr, "%d: will get %d\n", this_node, n_r_buffer));
+  rb->data.resize(calc_transmit_size(gc, data_parts));
+  rb->bonds.resize(0);
+  GHOST_TRACE(fprintf(stderr, "%d: will get %ld\n", this_node, rb->data.size()));
 }
 
-void put_recv_buffer(GhostCommunication *gc, int data_parts)
+/** number of bond list entries announced at the end of a received buffer */
+static int recv_buffer_n_bonds(GhostBuffer *rb)
 {
-  /* put back data */
-  char *retrieve = r_buffer;
+  return *(int *)(rb->data.data() + rb->data.size() - sizeof(int));
+}
 
-  std::vector<int>::const_iterator bond_retrieve = r_bondbuffer.begin();
+/** Write received data into the particle lists of a ghost communication.
+    @param data       the particle data, of size n_r_buffer
+    @param n_r_buffer size of the data
+    @param bonds      the bond and exclusion lists
+    @param n_bonds    number of entries of bonds
+    @param gc         the ghost communication
+    @param data_parts the data to unpack */
+static void unpack_data(char *data, int n_r_buffer, const int *bonds, int n_bonds,
+                        GhostCommunication *gc, int data_parts)
+{
+  /* put back data */
+  char *retrieve = data;
+  const int *bond_retrieve = bonds;
 
   for (int pl = 0; pl < gc->n_part_lists; pl++) {
     ParticleList *cur_list = gc->part_lists[pl];
@@ -382,28 +442,38 @@ void put_recv_buffer(GhostCommunication *gc, int data_parts)
     retrieve += sizeof(int);
   }
 
-  if (retrieve - r_buffer != n_r_buffer) {
+  if (retrieve - data != n_r_buffer) {
     fprintf(stderr, "%d: recv buffer size %d differs "
             "from what I read out (%ld)\n",
-            this_node, n_r_buffer, retrieve - r_buffer);
+            this_node, n_r_buffer, retrieve - data);
     errexit();
   }
-  if (bond_retrieve != r_bondbuffer.end()) {
+  if (bond_retrieve != bonds + n_bonds) {
     fprintf(stderr, "%d: recv bond buffer was not used up, %ld elements remain\n",
-            this_node, r_bondbuffer.end() - bond_retrieve );
+            this_node, bonds + n_bonds - bond_retrieve );
     errexit();
   }
-  r_bondbuffer.resize(0);
 }
 
-void add_forces_from_recv_buffer(GhostCommunication *gc)
+static void put_recv_buffer(GhostBuffer *rb, GhostCommunication *gc, int data_parts)
+{
+  unpack_data(rb->data.data(), rb->data.size(), rb->bonds.data(), rb->bonds.size(),
+              gc, data_parts);
+  rb->bonds.resize(0);
+}
+
+/** Add received forces to the particles of a ghost communication.
+    @param data       the forces, of size n_r_buffer
+    @param n_r_buffer size of the data
+    @param gc         the ghost communication */
+static void add_forces_from_data(char *data, int n_r_buffer, GhostCommunication *gc)
 {
   int pl, p, np;
   Particle *part, *pt;
   char *retrieve;
 
   /* put back data */
-  retrieve = r_buffer;
+  retrieve = data;
   for (pl = 0; pl < gc->n_part_lists; pl++) {
     np   = gc->part_lists[pl]->n;
     part = gc->part_lists[pl]->part;
@@ -413,14 +483,19 @@ void add_forces_from_recv_buffer(GhostCommunication *gc)
       retrieve +=  sizeof(ParticleForce);
     }
   }
-  if (retrieve - r_buffer != n_r_buffer) {
+  if (retrieve - data != n_r_buffer) {
     fprintf(stderr, "%d: recv buffer size %d differs "
             "from what I put in %ld\n",
-            this_node, n_r_buffer, retrieve - r_buffer);
+            this_node, n_r_buffer, retrieve - data);
     errexit();
   }
 }
 
+static void add_forces_from_recv_buffer(GhostBuffer *rb, GhostCommunication *gc)
+{
+  add_forces_from_data(rb->data.data(), rb->data.size(), gc);
+}
+
 void cell_cell_transfer(GhostCommunication *gc, int data_parts)
 {
   int pl, p, offset;
@@ -530,7 +605,9 @@ static int is_recv_op(int comm_type, int node)
           (comm_type == GHOST_RDCE && node == this_node));
 }
 
-void ghost_communicator(GhostCommunicator *gc)
+/** Blocking ghost communication, in the order of the operations. Used
+    for communicators containing collective operations. */
+static void ghost_communicator_blocking(GhostCommunicator *gc)
 {
   MPI_Status status;
   int n, n2;
@@ -554,11 +631,11 @@ void ghost_communicator(GhostCommunicator *gc)
       if (is_send_op(comm_type, node)) {
 	/* ok, we send this step, prepare send buffer if not yet done */
 	if (!prefetch)
-	  prepare_send_buffer(gcn, data_parts);
+	  prepare_send_buffer(&s_buf, gcn, data_parts);
 	else {
 	  GHOST_TRACE(fprintf(stderr, "%d: ghost_comm using prefetched data for operation %d, sending to %d\n", this_node, n, node));
 #ifdef ADDITIONAL_CHECKS
-	  if (n_s_buffer != calc_transmit_size(gcn, data_parts)) {
+	  if (int(s_buf.data.size()) != calc_transmit_size(gcn, data_parts)) {
 	    fprintf(stderr, "%d: ghost_comm transmission size and current size of cells to transmit do not match\n", this_node);
 	    errexit();
 	  }
@@ -576,7 +653,7 @@ void ghost_communicator(GhostCommunicator *gc)
 	    int node2      = gcn2->node;
 	    if (is_send_op(comm_type2, node2) && prefetch2) {
 	      GHOST_TRACE(fprintf(stderr, "%d: ghost_comm prefetch operation %d, is send/bcast to/from %d\n", this_node, n2, node2));
-	      prepare_send_buffer(gcn2, data_parts);
+	      prepare_send_buffer(&s_buf, gcn2, data_parts);
 	      break;
 	    }
 	  }
@@ -585,68 +662,68 @@ void ghost_communicator(GhostCommunicator *gc)
 
       /* recv buffer for recv and multinode operations to this node */
       if (is_recv_op(comm_type, node))
-         prepare_recv_buffer(gcn, data_parts);
+         prepare_recv_buffer(&r_buf, gcn, data_parts);
 
       /* transfer data */
       switch (comm_type) {
       case GHOST_RECV: {
-	GHOST_TRACE(fprintf(stderr, "%d: ghost_comm receive from %d (%d bytes)\n", this_node, node, n_r_buffer));
-	MPI_Recv(r_buffer, n_r_buffer, MPI_BYTE, node, REQ_GHOST_SEND, comm_cart, &status);
+	GHOST_TRACE(fprintf(stderr, "%d: ghost_comm receive from %d (%ld bytes)\n", this_node, node, r_buf.data.size()));
+	MPI_Recv(r_buf.data.data(), r_buf.data.size(), MPI_BYTE, node, REQ_GHOST_SEND, comm_cart, &status);
         if (data_parts & GHOSTTRANS_PROPRTS) {
-          int n_bonds = *(int *)(r_buffer + n_r_buffer - sizeof(int));
+          int n_bonds = recv_buffer_n_bonds(&r_buf);
           GHOST_TRACE(fprintf(stderr, "%d: ghost_comm receive from %d (%d bonds)\n", this_node, node, n_bonds));
           if (n_bonds) {
-            r_bondbuffer.resize(n_bonds);
-            MPI_Recv(&r_bondbuffer[0], n_bonds, MPI_INT, node, REQ_GHOST_SEND, comm_cart, &status);
+            r_buf.bonds.resize(n_bonds);
+            MPI_Recv(r_buf.bonds.data(), n_bonds, MPI_INT, node, REQ_GHOST_BONDS, comm_cart, &status);
           }
         }
 	break;
       }
       case GHOST_SEND: {
-	GHOST_TRACE(fprintf(stderr, "%d: ghost_comm send to %d (%d bytes)\n", this_node, node, n_s_buffer));
-	MPI_Send(s_buffer, n_s_buffer, MPI_BYTE, node, REQ_GHOST_SEND, comm_cart);
-        int n_bonds = s_bondbuffer.size();
+	GHOST_TRACE(fprintf(stderr, "%d: ghost_comm send to %d (%ld bytes)\n", this_node, node, s_buf.data.size()));
+	MPI_Send(s_buf.data.data(), s_buf.data.size(), MPI_BYTE, node, REQ_GHOST_SEND, comm_cart);
+        int n_bonds = s_buf.bonds.size();
         if (!(data_parts & GHOSTTRANS_PROPRTS) && n_bonds > 0) {
           fprintf(stderr, "%d: INTERNAL ERROR: not sending properties, but bond buffer not empty\n", this_node);
           errexit();
         }
         GHOST_TRACE(fprintf(stderr, "%d: ghost_comm send to %d (%d ints)\n", this_node, node, n_bonds));
         if (n_bonds) {
-          MPI_Send(&s_bondbuffer[0], n_bonds, MPI_INT, node, REQ_GHOST_SEND, comm_cart);
+          MPI_Send(s_buf.bonds.data(), n_bonds, MPI_INT, node, REQ_GHOST_BONDS, comm_cart);
         }
         break;
       }
       case GHOST_BCST:
-	GHOST_TRACE(fprintf(stderr, "%d: ghost_comm bcast from %d (%d bytes)\n", this_node, node,
-			    (node == this_node) ? n_s_buffer : n_r_buffer));
+	GHOST_TRACE(fprintf(stderr, "%d: ghost_comm bcast from %d (%ld bytes)\n", this_node, node,
+			    (node == this_node) ? s_buf.data.size() : r_buf.data.size()));
 	if (node == this_node) {
-	  MPI_Bcast(s_buffer, n_s_buffer, MPI_BYTE, node, comm_cart);
-          int n_bonds = s_bondbuffer.size();
+	  MPI_Bcast(s_buf.data.data(), s_buf.data.size(), MPI_BYTE, node, comm_cart);
+          int n_bonds = s_buf.bonds.size();
           if (!(data_parts & GHOSTTRANS_PROPRTS) && n_bonds > 0) {
             fprintf(stderr, "%d: INTERNAL ERROR: not sending properties, but bond buffer not empty\n", this_node);
             errexit();
           }
           if (n_bonds) {
-            MPI_Bcast(&s_bondbuffer[0], n_bonds, MPI_INT, node, comm_cart);
+            MPI_Bcast(s_buf.bonds.data(), n_bonds, MPI_INT, node, comm_cart);
           }
         }
 	else {
-	  MPI_Bcast(r_buffer, n_r_buffer, MPI_BYTE, node, comm_cart);
+	  MPI_Bcast(r_buf.data.data(), r_buf.data.size(), MPI_BYTE, node, comm_cart);
           if (data_parts & GHOSTTRANS_PROPRTS) {
-            int n_bonds = *(int *)(r_buffer + n_r_buffer - sizeof(int));
+            int n_bonds = recv_buffer_n_bonds(&r_buf);
             if (n_bonds) {
-              r_bondbuffer.resize(n_bonds);
-              MPI_Bcast(&r_bondbuffer[0], n_bonds, MPI_INT, node, comm_cart);
+              r_buf.bonds.resize(n_bonds);
+              MPI_Bcast(r_buf.bonds.data(), n_bonds, MPI_INT, node, comm_cart);
             }
           }
         }
 	break;
       case GHOST_RDCE:
-	GHOST_TRACE(fprintf(stderr, "%d: ghost_comm reduce to %d (%d bytes)\n", this_node, node, n_s_buffer));
+	GHOST_TRACE(fprintf(stderr, "%d: ghost_comm reduce to %d (%ld bytes)\n", this_node, node, s_buf.data.size()));
 	if (node == this_node)
-	  MPI_Reduce(s_buffer, r_buffer, n_s_buffer, MPI_BYTE, MPI_FORCES_SUM, node, comm_cart);
+	  MPI_Reduce(s_buf.data.data(), r_buf.data.data(), s_buf.data.size(), MPI_BYTE, MPI_FORCES_SUM, node, comm_cart);
 	else
-	  MPI_Reduce(s_buffer, NULL, n_s_buffer, MPI_BYTE, MPI_FORCES_SUM, node, comm_cart);
+	  MPI_Reduce(s_buf.data.data(), NULL, s_buf.data.size(), MPI_BYTE, MPI_FORCES_SUM, node, comm_cart);
 	break;
       }
       //GHOST_TRACE(MPI_Barrier(comm_cart));
@@ -658,9 +735,9 @@ void ghost_communicator(GhostCommunicator *gc)
 	  /* forces have to be added, the rest overwritten. Exception is RDCE, where the addition
 	     is integrated into the communication. */
 	  if (data_parts == GHOSTTRANS_FORCE && comm_type != GHOST_RDCE)
-	    add_forces_from_recv_buffer(gcn);
+	    add_forces_from_recv_buffer(&r_buf, gcn);
 	  else
-	    put_recv_buffer(gcn, data_parts);
+	    put_recv_buffer(&r_buf, gcn, data_parts);
 	}
 	else {
 	  GHOST_TRACE(fprintf(stderr, "%d: ghost_comm delaying operation %d, recv from %d\n", this_node, n, node));
@@ -678,16 +755,16 @@ void ghost_communicator(GhostCommunicator *gc)
 	    if (is_recv_op(comm_type2, node2) && poststore2) {
 	      GHOST_TRACE(fprintf(stderr, "%d: ghost_comm storing delayed recv, operation %d, from %d\n", this_node, n2, node2));
 #ifdef ADDITIONAL_CHECKS
-	      if (n_r_buffer != calc_transmit_size(gcn2, data_parts)) {
+	      if (int(r_buf.data.size()) != calc_transmit_size(gcn2, data_parts)) {
 		fprintf(stderr, "%d: ghost_comm transmission size and current size of cells to transmit do not match\n", this_node);
 		errexit();
 	      }
 #endif
 	      /* as above */
 	      if (data_parts == GHOSTTRANS_FORCE && comm_type != GHOST_RDCE)
-		add_forces_from_recv_buffer(gcn2);
+		add_forces_from_recv_buffer(&r_buf, gcn2);
 	      else
-		put_recv_buffer(gcn2, data_parts);
+		put_recv_buffer(&r_buf, gcn2, data_parts);
 	      break;
 	    }
 	  }
@@ -697,9 +774,478 @@ void ghost_communicator(GhostCommunicator *gc)
   }
 }
 
+/** Whether the ghost data exchanged with a node could go through
+    shared memory. */
+static int is_shm_peer(int node)
+{
+  return node != this_node && shm_rank[node] >= 0;
+}
+
+/** Whether the ghost data exchanged with a node goes through shared
+    memory. Equal on both sides, since the window is collective. */
+static int is_shm_op(int node)
+{
+  return shm_win != MPI_WIN_NULL && is_shm_peer(node);
+}
+
+/** Synchronize the public and private copies of the window. */
+static void shm_sync()
+{
+#ifdef GHOST_SHM
+  MPI_Win_sync(shm_win);
+#endif
+}
+
+/** Set up \ref shm_comm and \ref shm_rank. The ranks of \ref
+    comm_cart equal those of MPI_COMM_WORLD, since it is created
+    without reordering. */
+static void shm_init()
+{
+  shm_rank.assign(n_nodes, -1);
+#ifdef GHOST_SHM
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, this_node,
+                      MPI_INFO_NULL, &shm_comm);
+
+  MPI_Group world_group, shm_group;
+  MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+  MPI_Comm_group(shm_comm, &shm_group);
+  std::vector<int> world_ranks(n_nodes);
+  for (int i = 0; i < n_nodes; i++)
+    world_ranks[i] = i;
+  MPI_Group_translate_ranks(world_group, n_nodes, world_ranks.data(),
+                            shm_group, shm_rank.data());
+  for (int i = 0; i < n_nodes; i++)
+    if (shm_rank[i] == MPI_UNDEFINED)
+      shm_rank[i] = -1;
+  MPI_Group_free(&world_group);
+  MPI_Group_free(&shm_group);
+#endif
+}
+
+/** Grow the shared memory segments to the largest size needed by any
+    rank of the node. Collective on \ref shm_comm, therefore only
+    called at the start of communicators that all nodes run. */
+static void shm_resize()
+{
+#ifdef GHOST_SHM
+  if (shm_comm == MPI_COMM_NULL)
+    return;
+
+  MPI_Aint wanted;
+  MPI_Allreduce(&shm_wanted, &wanted, 1, MPI_AINT, MPI_MAX, shm_comm);
+  if (wanted <= shm_size)
+    return;
+
+  if (shm_win != MPI_WIN_NULL) {
+    MPI_Win_unlock_all(shm_win);
+    MPI_Win_free(&shm_win);
+  }
+  shm_size = wanted + wanted/2;
+
+  char *base;
+  MPI_Win_allocate_shared(shm_size, 1, MPI_INFO_NULL, shm_comm, &base, &shm_win);
+  int n_shm;
+  MPI_Comm_size(shm_comm, &n_shm);
+  shm_base.resize(n_shm);
+  for (int i = 0; i < n_shm; i++) {
+    MPI_Aint size;
+    int disp_unit;
+    MPI_Win_shared_query(shm_win, i, &size, &disp_unit, &shm_base[i]);
+  }
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, shm_win);
+
+  GHOST_TRACE(fprintf(stderr, "%d: ghost shared memory segments of %ld bytes\n", this_node, (long)shm_size));
+#endif
+}
+
+/** Pack the data of a send operation to a rank on the same node into
+    the own shared memory segment. If the segment is too small, the
+    data is packed into the send buffer instead and is sent as
+    ordinary messages.
+    @param sb         send buffer of the operation, receives the header
+    @param gc         the ghost communication
+    @param data_parts the data to pack
+    @param offset     first free byte of the segment
+    @return the first free byte of the segment after packing. */
+static MPI_Aint shm_pack(GhostBuffer *sb, GhostCommunication *gc, int data_parts,
+                         MPI_Aint offset)
+{
+  int n_data = calc_transmit_size(gc, data_parts);
+  MPI_Aint end = offset + n_data;
+
+  if (end <= shm_size) {
+    char *data = shm_base[shm_rank[this_node]] + offset;
+    pack_data(data, n_data, sb->bonds, gc, data_parts);
+    end += sb->bonds.size()*sizeof(int);
+    if (end <= shm_size) {
+      std::copy(sb->bonds.begin(), sb->bonds.end(), (int *)(data + n_data));
+      sb->shm.offset  = offset;
+      sb->shm.n_data  = n_data;
+      sb->shm.n_bonds = sb->bonds.size();
+      sb->bonds.resize(0);
+      shm_wanted = std::max(shm_wanted, end);
+      return (end + GHOST_SHM_ALIGN - 1)/GHOST_SHM_ALIGN*GHOST_SHM_ALIGN;
+    }
+    /* the bonds do not fit */
+    sb->data.assign(data, data + n_data);
+  }
+  else {
+    prepare_send_buffer(sb, gc, data_parts);
+    end += sb->bonds.size()*sizeof(int);
+  }
+  sb->shm.offset  = -1;
+  sb->shm.n_data  = n_data;
+  sb->shm.n_bonds = sb->bonds.size();
+  shm_wanted = std::max(shm_wanted, end);
+  return offset;
+}
+
+/** \name State of the non-blocking ghost communication */
+/*@{*/
+/** communicator in flight, NULL if none */
+static GhostCommunicator *pending_comm = NULL;
+/** operations of the current stage */
+static int stage_begin = 0, stage_end = 0;
+/** progress of the current stage: 0 while waiting for the first
+    messages, 1 for the bond lists and overflowing shared memory data,
+    and 2 for the acknowledgements of the data read from shared memory */
+static int stage_phase = 0;
+/** requests for the particle data or shared memory headers of the
+    current stage */
+static std::vector<MPI_Request> stage_recv_reqs;
+/** requests for all sends and the bond list receives of the current stage */
+static std::vector<MPI_Request> stage_other_reqs;
+/** requests for the acknowledgements of the current stage */
+static std::vector<MPI_Request> stage_ack_reqs;
+/** one buffer per operation of the current stage */
+static std::vector<GhostBuffer> stage_buffers;
+/** per cell, the number of the stage that last wrote it */
+static std::vector<unsigned int> cell_stamp;
+static unsigned int stage_stamp = 0;
+/*@}*/
+
+/** Check whether a communicator consists only of point-to-point and
+    local operations. */
+static int is_point_to_point_comm(GhostCommunicator *gc)
+{
+  for (int n = 0; n < gc->num; n++) {
+    int comm_type = gc->comm[n].type & GHOST_JOBMASK;
+    if (comm_type == GHOST_BCST || comm_type == GHOST_RDCE)
+      return 0;
+  }
+  return 1;
+}
+
+/** Mark or check a range of the particle lists of an operation
+    against the cells written in the current stage.
+    @return 1 if one of the lists was written in the current stage or
+    is not a cell of \ref cells, otherwise 0. */
+static int stage_touch(ParticleList **lists, int n, int mark)
+{
+  for (int i = 0; i < n; i++) {
+    ptrdiff_t c = lists[i] - cells;
+    if (c < 0 || c >= n_cells)
+      return 1;
+    if (mark)
+      cell_stamp[c] = stage_stamp;
+    else if (cell_stamp[c] == stage_stamp)
+      return 1;
+  }
+  return 0;
+}
+
+/** Find the end of the stage starting at operation begin. A stage is
+    the longest run of operations that do not read or write a cell
+    written by an earlier operation of the same run. The operations of
+    a stage can therefore be started all at once, provided that all
+    send buffers are packed before any received data is written back. */
+static int find_stage_end(GhostCommunicator *gc, int begin)
+{
+  if (int(cell_stamp.size()) != n_cells)
+    cell_stamp.assign(n_cells, 0);
+  if (++stage_stamp == 0) {
+    std::fill(cell_stamp.begin(), cell_stamp.end(), 0);
+    stage_stamp = 1;
+  }
+
+  for (int n = begin; n < gc->num; n++) {
+    GhostCommunication *gcn = &gc->comm[n];
+    int comm_type = gcn->type & GHOST_JOBMASK;
+    int half = gcn->n_part_lists/2;
+
+    if (stage_touch(gcn->part_lists, gcn->n_part_lists, 0))
+      return (n == begin) ? n + 1 : n;
+
+    if (comm_type == GHOST_RECV)
+      stage_touch(gcn->part_lists, gcn->n_part_lists, 1);
+    else if (comm_type == GHOST_LOCL)
+      stage_touch(gcn->part_lists + half, gcn->n_part_lists - half, 1);
+  }
+  return gc->num;
+}
+
+/** Post the operations of the next stage(s) of \ref pending_comm.
+    Stages without any message are completed directly, if all stages
+    are done, the communication is finished. */
+static void ghost_start_stage()
+{
+  GhostCommunicator *gc = pending_comm;
+  int data_parts = gc->data_parts;
+
+  while (stage_end < gc->num) {
+    stage_begin = stage_end;
+    stage_end = find_stage_end(gc, stage_begin);
+
+    GHOST_TRACE(fprintf(stderr, "%d: ghost_comm %p stage %d-%d\n", this_node, gc, stage_begin, stage_end));
+
+    if (int(stage_buffers.size()) < stage_end - stage_begin)
+      stage_buffers.resize(stage_end - stage_begin);
+    stage_recv_reqs.resize(0);
+    stage_other_reqs.resize(0);
+    stage_ack_reqs.resize(0);
+    stage_phase = 0;
+
+    /* pack before anything of this stage is written. Data for ranks
+       on the same node goes directly into the shared segment, which
+       is free again, since all reads of the last stage were
+       acknowledged. */
+    MPI_Aint shm_used = 0;
+    int shm_packed = 0;
+    for (int n = stage_begin; n < stage_end; n++) {
+      GhostCommunication *gcn = &gc->comm[n];
+      if ((gcn->type & GHOST_JOBMASK) != GHOST_SEND)
+        continue;
+      GhostBuffer *sb = &stage_buffers[n - stage_begin];
+      if (is_shm_peer(gcn->node)) {
+        if (!shm_packed && shm_win != MPI_WIN_NULL) {
+          shm_sync();
+          shm_packed = 1;
+        }
+        shm_used = shm_pack(sb, gcn, data_parts, shm_used);
+      }
+      else
+        prepare_send_buffer(sb, gcn, data_parts);
+    }
+    if (shm_packed)
+      shm_sync();
+
+    /* receives first, so that the sends can be delivered directly */
+    for (int n = stage_begin; n < stage_end; n++) {
+      GhostCommunication *gcn = &gc->comm[n];
+      if ((gcn->type & GHOST_JOBMASK) != GHOST_RECV)
+        continue;
+      GhostBuffer *rb = &stage_buffers[n - stage_begin];
+      MPI_Request req;
+      if (is_shm_op(gcn->node)) {
+        GHOST_TRACE(fprintf(stderr, "%d: ghost_comm receive from %d via shared memory\n", this_node, gcn->node));
+        MPI_Irecv(&rb->shm, sizeof(GhostShmHeader), MPI_BYTE, gcn->node, REQ_GHOST_SHM, comm_cart, &req);
+      }
+      else {
+        prepare_recv_buffer(rb, gcn, data_parts);
+        GHOST_TRACE(fprintf(stderr, "%d: ghost_comm receive from %d (%ld bytes)\n", this_node, gcn->node, rb->data.size()));
+        MPI_Irecv(rb->data.data(), rb->data.size(), MPI_BYTE, gcn->node, REQ_GHOST_SEND, comm_cart, &req);
+      }
+      stage_recv_reqs.push_back(req);
+    }
+
+    for (int n = stage_begin; n < stage_end; n++) {
+      GhostCommunication *gcn = &gc->comm[n];
+      if ((gcn->type & GHOST_JOBMASK) != GHOST_SEND)
+        continue;
+      GhostBuffer *sb = &stage_buffers[n - stage_begin];
+      MPI_Request req;
+      if (is_shm_op(gcn->node)) {
+        MPI_Isend(&sb->shm, sizeof(GhostShmHeader), MPI_BYTE, gcn->node, REQ_GHOST_SHM, comm_cart, &req);
+        stage_other_reqs.push_back(req);
+        if (sb->shm.offset >= 0) {
+          GHOST_TRACE(fprintf(stderr, "%d: ghost_comm send to %d via shared memory (%d bytes)\n", this_node, gcn->node, sb->shm.n_data));
+          /* the segment is reused once the data was read */
+          MPI_Irecv(NULL, 0, MPI_BYTE, gcn->node, REQ_GHOST_SHM_DONE, comm_cart, &req);
+          stage_ack_reqs.push_back(req);
+          continue;
+        }
+      }
+      GHOST_TRACE(fprintf(stderr, "%d: ghost_comm send to %d (%ld bytes)\n", this_node, gcn->node, sb->data.size()));
+      MPI_Isend(sb->data.data(), sb->data.size(), MPI_BYTE, gcn->node, REQ_GHOST_SEND, comm_cart, &req);
+      stage_other_reqs.push_back(req);
+      int n_bonds = sb->bonds.size();
+      if (!(data_parts & GHOSTTRANS_PROPRTS) && n_bonds > 0) {
+        fprintf(stderr, "%d: INTERNAL ERROR: not sending properties, but bond buffer not empty\n", this_node);
+        errexit();
+      }
+      if (n_bonds) {
+        MPI_Isend(sb->bonds.data(), n_bonds, MPI_INT, gcn->node, REQ_GHOST_BONDS, comm_cart, &req);
+        stage_other_reqs.push_back(req);
+      }
+    }
+
+    /* the local transfers overlap with the messages */
+    for (int n = stage_begin; n < stage_end; n++)
+      if ((gc->comm[n].type & GHOST_JOBMASK) == GHOST_LOCL)
+        cell_cell_transfer(&gc->comm[n], data_parts);
+
+    if (!stage_recv_reqs.empty() || !stage_other_reqs.empty() || !stage_ack_reqs.empty())
+      return;
+  }
+  pending_comm = NULL;
+}
+
+/** Complete a set of requests.
+    @param reqs the requests.
+    @param wait whether to block until they are complete.
+    @return whether all requests are complete. */
+static int ghost_complete(std::vector<MPI_Request> &reqs, int wait)
+{
+  int flag = 1;
+  if (reqs.empty())
+    return 1;
+  if (wait)
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+  else
+    MPI_Testall(reqs.size(), reqs.data(), &flag, MPI_STATUSES_IGNORE);
+  return flag;
+}
+
+/** Advance the communication in flight as far as possible.
+    @param wait whether to block until it is finished.
+    @return whether the communication is finished. */
+static int ghost_progress(int wait)
+{
+  while (pending_comm) {
+    GhostCommunicator *gc = pending_comm;
+    int data_parts = gc->data_parts;
+
+    if (stage_phase == 0) {
+      if (!ghost_complete(stage_recv_reqs, wait))
+        return 0;
+      /* the number of bond list entries comes with the particle data
+         or the shared memory header. Data that did not fit into the
+         shared segment follows as ordinary messages. */
+      for (int n = stage_begin; n < stage_end; n++) {
+        GhostCommunication *gcn = &gc->comm[n];
+        if ((gcn->type & GHOST_JOBMASK) != GHOST_RECV)
+          continue;
+        GhostBuffer *rb = &stage_buffers[n - stage_begin];
+        MPI_Request req;
+        int n_bonds = 0;
+        if (is_shm_op(gcn->node)) {
+          if (rb->shm.offset >= 0)
+            continue;
+          rb->data.resize(rb->shm.n_data);
+          MPI_Irecv(rb->data.data(), rb->data.size(), MPI_BYTE, gcn->node, REQ_GHOST_SEND, comm_cart, &req);
+          stage_other_reqs.push_back(req);
+          n_bonds = rb->shm.n_bonds;
+        }
+        else if (data_parts & GHOSTTRANS_PROPRTS)
+          n_bonds = recv_buffer_n_bonds(rb);
+        GHOST_TRACE(fprintf(stderr, "%d: ghost_comm receive from %d (%d bonds)\n", this_node, gcn->node, n_bonds));
+        if (n_bonds) {
+          rb->bonds.resize(n_bonds);
+          MPI_Irecv(rb->bonds.data(), n_bonds, MPI_INT, gcn->node, REQ_GHOST_BONDS, comm_cart, &req);
+          stage_other_reqs.push_back(req);
+        }
+      }
+      stage_phase = 1;
+    }
+    if (stage_phase == 1) {
+      if (!ghost_complete(stage_other_reqs, wait))
+        return 0;
+
+      /* write back in the order of the operations */
+      int shm_read = 0;
+      for (int n = stage_begin; n < stage_end; n++) {
+        GhostCommunication *gcn = &gc->comm[n];
+        if ((gcn->type & GHOST_JOBMASK) != GHOST_RECV)
+          continue;
+        GhostBuffer *rb = &stage_buffers[n - stage_begin];
+        if (is_shm_op(gcn->node) && rb->shm.offset >= 0) {
+          /* read directly from the segment of the sender */
+          if (!shm_read) {
+            shm_sync();
+            shm_read = 1;
+          }
+          char *data = shm_base[shm_rank[gcn->node]] + rb->shm.offset;
+          if (data_parts == GHOSTTRANS_FORCE)
+            add_forces_from_data(data, rb->shm.n_data, gcn);
+          else
+            unpack_data(data, rb->shm.n_data, (int *)(data + rb->shm.n_data),
+                        rb->shm.n_bonds, gcn, data_parts);
+        }
+        else if (data_parts == GHOSTTRANS_FORCE)
+          add_forces_from_recv_buffer(rb, gcn);
+        else
+          put_recv_buffer(rb, gcn, data_parts);
+      }
+
+      /* release the segments of the senders */
+      if (shm_read) {
+        shm_sync();
+        for (int n = stage_begin; n < stage_end; n++) {
+          GhostCommunication *gcn = &gc->comm[n];
+          if ((gcn->type & GHOST_JOBMASK) != GHOST_RECV ||
+              !is_shm_op(gcn->node) || stage_buffers[n - stage_begin].shm.offset < 0)
+            continue;
+          MPI_Request req;
+          MPI_Isend(NULL, 0, MPI_BYTE, gcn->node, REQ_GHOST_SHM_DONE, comm_cart, &req);
+          stage_ack_reqs.push_back(req);
+        }
+      }
+      stage_phase = 2;
+    }
+    /* the own segment may only be reused after the receivers have read it */
+    if (!ghost_complete(stage_ack_reqs, wait))
+      return 0;
+    ghost_start_stage();
+  }
+  return 1;
+}
+
+void ghost_communicator_begin(GhostCommunicator *gc)
+{
+  GHOST_TRACE(fprintf(stderr, "%d: ghost_comm %p, data_parts %d\n", this_node, gc, gc->data_parts));
+
+  ghost_communicator_finish();
+
+  /* resizing the shared segments is collective, which is fine for
+     the cell size communicator that all nodes run at the same time
+     after resorting */
+  if (gc->data_parts & GHOSTTRANS_PARTNUM)
+    shm_resize();
+
+  if (!is_point_to_point_comm(gc)) {
+    ghost_communicator_blocking(gc);
+    return;
+  }
+  pending_comm = gc;
+  stage_end = 0;
+  ghost_start_stage();
+}
+
+int ghost_communicator_test()
+{
+  return ghost_progress(0);
+}
+
+void ghost_communicator_finish()
+{
+  ghost_progress(1);
+}
+
+int ghost_communicator_pending()
+{
+  return pending_comm != NULL;
+}
+
+void ghost_communicator(GhostCommunicator *gc)
+{
+  ghost_communicator_begin(gc);
+  ghost_communicator_finish();
+}
+
 void ghost_init()
 {
   MPI_Op_create(reduce_forces_sum, 1, &MPI_FORCES_SUM);
+  shm_init();
 }
 
 /** Go through \ref ghost_cells and remove the ghost entries from \ref
@@ -80,7 +80,36 @@ its send buffer. Therefore there is the prefetch flag which can be set on a pair
 recv operation with prefetch, the next send operation (which must have the prefetch set!!) is searched and the send buffer already created.
 When sending, this precreated send buffer is used. In the scenario above, all nodes create the send buffers simultaneously in the first
 communication step, thereby reducing the latency a little bit. The pststore is similar and postpones the write back of received data until a
-send operation (with a precreated send buffer) is finished.
+send operation (with a precreated send buffer) is finished. These flags are only evaluated by the blocking
+communication, since the non-blocking one always prepares all send buffers of a stage up front.
+
+<h2> Non-blocking communication </h2>
+Communicators that consist only of GHOST_SEND, GHOST_RECV and GHOST_LOCL operations are executed
+non-blocking. The operations are split into stages, where a stage ends before the first operation
+that reads or writes a cell written by an earlier operation of the stage. In domain decomposition,
+this gives one stage per direction. For each stage, all send buffers are packed into separate buffers,
+all receives are posted up front, and the sends and local transfers are started. The received data is
+written back in the order of the operations once all messages of the stage have arrived. Since the
+messages are posted in the same order as in the blocking scheme, a communicator that is deadlock free
+when executed blocking is deadlock free non-blocking. Communicators containing GHOST_BCST or GHOST_RDCE
+are executed blocking, in the order of the operations.
+
+<h2> Shared memory </h2>
+Ranks on the same shared memory node exchange the data of the non-blocking communicators through
+an MPI-3 shared memory window, in which every rank owns one segment. The sender packs the data of
+all its operations of a stage to ranks on the same node directly into its segment, and announces
+offset and size by a small header message. The receiver writes the ghosts directly from the segment
+of the sender, without a receive buffer and without the data passing through MPI, and acknowledges
+this, after which the sender may reuse the segment for the next stage. The segments are grown
+collectively at the start of the communicator transferring the cell sizes, which all nodes run at
+the same time after resorting. Until then, or if a stage does not fit into the segment, the data
+is sent as ordinary messages after the header. Particle migration and the blocking communicators
+always use ordinary messages.
+
+\ref ghost_communicator_begin starts a communication and returns as soon as the first stage is posted.
+Until \ref ghost_communicator_finish is called, the caller may work on data that is neither sent nor
+received, e.g. calculate the forces within the inner cells, and drive the communication by
+calling \ref ghost_communicator_test from time to time. \ref ghost_communicator does both in one go.
 
 The ghost communicators are created in the init routines of the cell systems, therefore have a look at \ref dd_topology_init or
 \ref nsq_topology_init for further details.
@@ -196,6 +225,26 @@ void ghost_init();
 /** do a ghost communication */
 void ghost_communicator(GhostCommunicator *gc);
 
+/** Start a ghost communication. A communication that is still in
+    flight is finished first. Only the data that is not transferred
+    by the communicator may be accessed until \ref
+    ghost_communicator_finish has been called.
+    @param gc the communicator, which must not be modified until the
+    communication is finished. */
+void ghost_communicator_begin(GhostCommunicator *gc);
+
+/** Advance the ghost communication in flight without blocking. Must
+    be called by the master thread.
+    @return 1 if the communication is finished, otherwise 0. */
+int ghost_communicator_test();
+
+/** Wait until the ghost communication in flight is finished. Does
+    nothing if there is none. */
+void ghost_communicator_finish();
+
+/** Check whether a ghost communication is in flight. */
+int ghost_communicator_pending();
+
 /** Go through \ref ghost_cells and remove the ghost entries from \ref
     local_particles. Part of \ref dd_exchange_and_sort_particles.*/
 void invalidate_ghosts();
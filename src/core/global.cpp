@@ -35,6 +35,11 @@
 #include "ghmc.hpp"
 #include "lb.hpp"
 #include "integrate_sd.hpp"
+#include "nonbonded_batch.hpp"
+#include "threads.hpp"
+#include "load_balance.hpp"
+#include "skin_tune.hpp"
+#include "phase_timers.hpp"
 
 /** This array contains the description of all global variables.
 
@@ -102,6 +107,14 @@ const Datafield fields[] = {
   {&sd_random_precision,     TYPE_DOUBLE, 1, "sd_precision_random",        4 },         /* 58 from integrate_sd.cpp */
   {&smaller_time_step,TYPE_DOUBLE,1, "smaller_time_step", 5 },         /* 59 from integrate.cpp */
   {configtemp,       TYPE_DOUBLE, 2, "configtemp",        1 },         /* 60 from integrate.cpp */
+  {&nonbonded_batch,    TYPE_INT, 1, "nonbonded_batch",   4 },         /* 61 from nonbonded_batch.cpp */
+  {&n_threads,          TYPE_INT, 1, "n_threads",         3 },         /* 62 from threads.cpp */
+  {&balance_interval,   TYPE_INT, 1, "balance_interval",  3 },         /* 63 from load_balance.cpp */
+  {&load_imbalance,  TYPE_DOUBLE, 1, "load_imbalance",    6 },         /* 64 from load_balance.cpp */
+  {&phase_timers,       TYPE_INT, 1, "phase_timers",      3 },         /* 65 from phase_timers.cpp */
+  {&skin_tune_interval, TYPE_INT, 1, "skin_tune_interval", 6 },        /* 66 from skin_tune.cpp */
+  {&respa_steps,        TYPE_INT, 1, "respa_steps",       3 },         /* 67 from integrate.cpp */
+  {&sort_interval,      TYPE_INT, 1, "sort_interval",     4 },         /* 68 from cells.cpp */
   { NULL, 0, 0, NULL, 0 }
 };
 
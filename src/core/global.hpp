@@ -196,6 +196,22 @@ extern const Datafield fields[];
 #define FIELD_SMALLERTIMESTEP     59
 /** index of \ref configtemp in \ref #fields */
 #define FIELD_CONFIGTEMP          60
+/** index of \ref nonbonded_batch in \ref #fields */
+#define FIELD_NONBONDED_BATCH     61
+/** index of \ref n_threads in \ref #fields */
+#define FIELD_N_THREADS           62
+/** index of \ref balance_interval in \ref #fields */
+#define FIELD_BALANCE_INTERVAL    63
+/** index of \ref load_imbalance in \ref #fields */
+#define FIELD_LOAD_IMBALANCE      64
+/** index of \ref phase_timers in \ref #fields */
+#define FIELD_PHASE_TIMERS        65
+/** index of \ref skin_tune_interval in \ref #fields */
+#define FIELD_SKIN_TUNE_INTERVAL  66
+/** index of \ref respa_steps in \ref #fields */
+#define FIELD_RESPA_STEPS         67
+/** index of \ref sort_interval in \ref #fields */
+#define FIELD_SORT_INTERVAL       68
 
 /*@}*/
 
@@ -35,6 +35,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <mpi.h>
+#include <vector>
+#include <algorithm>
 
 /************************************************
  * defines
@@ -66,6 +68,11 @@ double local_box_l[3] = {1, 1, 1};
 double min_local_box_l;
 double my_left[3] = {0, 0, 0};
 double my_right[3] = {1, 1, 1};
+int grid_uniform = 1;
+
+/** Boundaries of the node domains as fractions of the box length, see
+    \ref grid_set_node_bounds. Only used if \ref grid_uniform is 0. */
+static std::vector<double> node_bounds[3];
 
 /************************************************************/
 
@@ -86,7 +93,12 @@ int map_position_node_array(double pos[3]) {
   fold_position(f_pos, im);
 
   for (i = 0; i < 3; i++) {
-    im[i] = (int)floor(node_grid[i] * f_pos[i] * box_l_i[i]);
+    if (grid_uniform)
+      im[i] = (int)floor(node_grid[i] * f_pos[i] * box_l_i[i]);
+    else
+      im[i] = (int)(std::upper_bound(node_bounds[i].begin(), node_bounds[i].end(),
+                                     f_pos[i] * box_l_i[i]) -
+                    node_bounds[i].begin()) - 1;
     if (im[i] < 0)
       im[i] = 0;
     else if (im[i] >= node_grid[i])
@@ -256,9 +268,15 @@ void grid_changed_box_l() {
   GRID_TRACE(fprintf(stderr, "%d: node_grid %d %d %d\n", this_node,
                      node_grid[0], node_grid[1], node_grid[2]));
   for (i = 0; i < 3; i++) {
-    local_box_l[i] = box_l[i] / (double)node_grid[i];
-    my_left[i] = node_pos[i] * local_box_l[i];
-    my_right[i] = (node_pos[i] + 1) * local_box_l[i];
+    if (grid_uniform) {
+      local_box_l[i] = box_l[i] / (double)node_grid[i];
+      my_left[i] = node_pos[i] * local_box_l[i];
+      my_right[i] = (node_pos[i] + 1) * local_box_l[i];
+    } else {
+      my_left[i] = node_bounds[i][node_pos[i]] * box_l[i];
+      my_right[i] = node_bounds[i][node_pos[i] + 1] * box_l[i];
+      local_box_l[i] = my_right[i] - my_left[i];
+    }
     box_l_i[i] = 1 / box_l[i];
   }
 
@@ -280,6 +298,9 @@ void grid_changed_n_nodes() {
   mpi_reshape_communicator({node_grid[0], node_grid[1], node_grid[2]},
                            { 1, 1, 1});
 
+  /* the old domain boundaries do not fit the new grid */
+  grid_reset_node_bounds();
+
   MPI_Cart_coords(comm_cart, this_node, 3, node_pos);
 
   calc_node_neighbors(this_node);
@@ -303,10 +324,40 @@ void calc_minimal_box_dimensions() {
   min_local_box_l = MAX_INTERACTION_RANGE;
   for (i = 0; i < 3; i++) {
     min_box_l = dmin(min_box_l, box_l[i]);
-    min_local_box_l = dmin(min_local_box_l, local_box_l[i]);
+    if (grid_uniform)
+      min_local_box_l = dmin(min_local_box_l, local_box_l[i]);
+    else {
+      /* the smallest domain of all nodes */
+      for (int k = 0; k < node_grid[i]; k++)
+        min_local_box_l =
+            dmin(min_local_box_l,
+                 (node_bounds[i][k + 1] - node_bounds[i][k]) * box_l[i]);
+    }
   }
 }
 
+double grid_node_bound(int dir, int k) {
+  if (grid_uniform)
+    return (double)k / node_grid[dir];
+  return node_bounds[dir][k];
+}
+
+void grid_set_node_bounds(double *bounds[3]) {
+  for (int i = 0; i < 3; i++) {
+    node_bounds[i].assign(bounds[i], bounds[i] + node_grid[i] + 1);
+    /* make sure that the domains cover the box exactly */
+    node_bounds[i].front() = 0.0;
+    node_bounds[i].back() = 1.0;
+  }
+  grid_uniform = 0;
+}
+
+void grid_reset_node_bounds() {
+  for (int i = 0; i < 3; i++)
+    node_bounds[i].clear();
+  grid_uniform = 1;
+}
+
 void calc_2d_grid(int n, int grid[3]) {
   int i;
   i = (int)sqrt((double)n);
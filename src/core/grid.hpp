@@ -97,6 +97,12 @@ extern double min_local_box_l;
 extern double my_left[3];
 /** Right (top, back) corner of this nodes local box. */ 
 extern double my_right[3];
+/** Whether the node domains are of equal size (the default). If not,
+    the boundaries along each direction are given by \ref
+    grid_set_node_bounds, i.e. the domains still form a rectilinear
+    grid, and the nodes in one slab of the node grid share the
+    extension in that direction. */
+extern int grid_uniform;
 
 /*@}*/
 
@@ -151,6 +157,26 @@ void grid_changed_n_nodes();
 /** called from \ref mpi_bcast_parameter . */
 void grid_changed_box_l();
 
+/** Position of a boundary between the node domains.
+    @param dir  direction.
+    @param k    index of the boundary, 0 to \ref node_grid[dir].
+    @return the left boundary of the domains at \ref node_pos[dir] == k,
+    as fraction of \ref box_l[dir]. */
+double grid_node_bound(int dir, int k);
+
+/** Set non-uniform boundaries of the node domains. Has to be called on
+    all nodes with the same arguments, followed by \ref
+    grid_changed_box_l and a re-initialization of the cell system.
+    @param bounds for each direction \ref node_grid[dir]+1 increasing
+    boundaries as fractions of the box length, starting with 0 and
+    ending with 1. */
+void grid_set_node_bounds(double *bounds[3]);
+
+/** Return to equally sized node domains. Like \ref
+    grid_set_node_bounds, has to be followed by \ref
+    grid_changed_box_l and a re-initialization of the cell system. */
+void grid_reset_node_bounds();
+
 /** Calculates the smallest box and local box dimensions for periodic
  * directions.  This is needed to check if the interaction ranges are
  * compatible with the box dimensions and the node grid.  
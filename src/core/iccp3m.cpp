@@ -61,8 +61,6 @@ int iccp3m_initialized = 0;
  * excluding forces other than the electrostatic ones */
 void init_forces_iccp3m();
 void calc_long_range_forces_iccp3m();
-inline void add_pair_iccp3m(PairList *pl, Particle *p1, Particle *p2);
-void resize_verlet_list_iccp3m(PairList *pl);
 inline void init_local_particle_force_iccp3m(Particle *part);
 inline void init_ghost_force_iccp3m(Particle *part);
 extern void on_particle_change();
@@ -75,9 +73,6 @@ int imod(int x,int y);
 void iccp3m_revive_forces();
 void iccp3m_store_forces();
 
-/** Granularity of the verlet list */
-#define LIST_INCREMENT 20
-
 void iccp3m_set_initialized() {
     iccp3m_initialized = 1;
 }
@@ -347,7 +342,7 @@ void build_verlet_lists_and_calc_verlet_ia_iccp3m()
 {
     int c, np1, n, np2, i ,j, j_start=0;
     Cell *cell;
-    IA_Neighbor *neighbor;
+    IA_Neighbor_List *il;
     Particle *p1, *p2;
     PairList *pl;
     double dist2, vec21[3];
@@ -365,55 +360,50 @@ void build_verlet_lists_and_calc_verlet_ia_iccp3m()
     for (c = 0; c < local_cells.n; c++) {
         VERLET_TRACE(fprintf(stderr,"%d: cell %d with %d neighbors\n",this_node,c, dd.cell_inter[c].n_neighbors));
 
-        /* Loop local cells */
-        for (c = 0; c < local_cells.n; c++) {
-            VERLET_TRACE(fprintf(stderr,"%d: cell %d with %d neighbors\n",this_node,c, dd.cell_inter[c].n_neighbors));
+        cell = local_cells.cell[c];
+        p1   = cell->part;
+        np1  = cell->n;
+        il   = &dd.cell_inter[c];
+        pl   = &il->vList;
+        /* init pair list */
+        verlet_list_begin(pl, np1, estimate_verlet_pairs(c));
+
+        /* Loop cell particles */
+        for(i=0; i < np1; i++) {
+            verlet_list_open(pl, i);
+            /* (no bonded forces) store old position */
+            memmove(p1[i].l.p_old, p1[i].r.p, 3*sizeof(double));
 
-            cell = local_cells.cell[c];
-            p1   = cell->part;
-            np1  = cell->n;
             /* Loop cell neighbors */
-            for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-                neighbor = &dd.cell_inter[c].nList[n];
-                p2  = neighbor->pList->part;
-                np2 = neighbor->pList->n;
-                VERLET_TRACE(fprintf(stderr,"%d: neighbor %d contains %d parts\n",this_node,n,np2));
-                /* init pair list */
-                pl  = &neighbor->vList;
-                pl->n = 0;
-                /* Loop cell particles */
-                for(i=0; i < np1; i++) {
-                    j_start = 0;
-                    /* Tasks within cell: (no bonded forces) store old position, avoid double counting */
-                    if(n == 0) {
-                        memmove(p1[i].l.p_old, p1[i].r.p, 3*sizeof(double));
-                        j_start = i+1;
-                    }
-                    /* Loop neighbor cell particles */
-                    for(j = j_start; j < np2; j++) {
+            for (n = 0; n < il->n_neighbors; n++) {
+                p2  = il->nList[n].pList->part;
+                np2 = il->nList[n].pList->n;
+                /* avoid double counting within the cell */
+                j_start = (n == 0) ? i+1 : 0;
+                /* Loop neighbor cell particles */
+                for(j = j_start; j < np2; j++) {
 #ifdef EXCLUSIONS
-                        if(do_nonbonded(&p1[i], &p2[j]))
+                    if(do_nonbonded(&p1[i], &p2[j]))
 #endif
-                        {
-                            dist2 = distance2vec(p1[i].r.p, p2[j].r.p, vec21);
-
-                            VERLET_TRACE(fprintf(stderr,"%d: pair %d %d has distance %f\n",this_node,p1[i].p.identity,p2[j].p.identity,sqrt(dist2)));
-                            if(verlet_list_criterion(p1+i,p2+j, dist2)) {
-                                ONEPART_TRACE(if(p1[i].p.identity==check_id) fprintf(stderr,"%d: OPT: Verlet Pair %d %d (Cells %d,%d %d,%d dist %f)\n",this_node,p1[i].p.identity,p2[j].p.identity,c,i,n,j,sqrt(dist2)));
-                                ONEPART_TRACE(if(p2[j].p.identity==check_id) fprintf(stderr,"%d: OPT: Verlet Pair %d %d (Cells %d %d dist %f)\n",this_node,p1[i].p.identity,p2[j].p.identity,c,n,sqrt(dist2)));
-
-                                add_pair_iccp3m(pl, &p1[i], &p2[j]);
-                                /* calc non bonded interactions */ 
-                                add_non_bonded_pair_force_iccp3m(&(p1[i]), &(p2[j]), vec21, sqrt(dist2), dist2);
-                            }
+                    {
+                        dist2 = distance2vec(p1[i].r.p, p2[j].r.p, vec21);
+
+                        VERLET_TRACE(fprintf(stderr,"%d: pair %d %d has distance %f\n",this_node,p1[i].p.identity,p2[j].p.identity,sqrt(dist2)));
+                        if(verlet_list_criterion(p1+i,p2+j, dist2)) {
+                            ONEPART_TRACE(if(p1[i].p.identity==check_id) fprintf(stderr,"%d: OPT: Verlet Pair %d %d (Cells %d,%d %d,%d dist %f)\n",this_node,p1[i].p.identity,p2[j].p.identity,c,i,n,j,sqrt(dist2)));
+                            ONEPART_TRACE(if(p2[j].p.identity==check_id) fprintf(stderr,"%d: OPT: Verlet Pair %d %d (Cells %d %d dist %f)\n",this_node,p1[i].p.identity,p2[j].p.identity,c,n,sqrt(dist2)));
+
+                            add_pair(pl, n, j);
+                            /* calc non bonded interactions */ 
+                            add_non_bonded_pair_force_iccp3m(&(p1[i]), &(p2[j]), vec21, sqrt(dist2), dist2);
                         }
                     }
                 }
-                resize_verlet_list_iccp3m(pl);
-                VERLET_TRACE(fprintf(stderr,"%d: neighbor %d has %d pairs\n",this_node,n,pl->n));
-                VERLET_TRACE(sum += pl->n);
             }
         }
+        verlet_list_close(pl);
+        VERLET_TRACE(fprintf(stderr,"%d: cell %d has %d pairs\n",this_node,c,pl->n));
+        VERLET_TRACE(sum += pl->n);
     }
 
     VERLET_TRACE(fprintf(stderr,"%d: total number of interaction pairs: %d (should be around %d)\n",this_node,sum,estimate));
@@ -423,26 +413,23 @@ void build_verlet_lists_and_calc_verlet_ia_iccp3m()
 
 void calculate_verlet_ia_iccp3m()
 {
-    int c, np, n, i;
-    Cell *cell;
-    Particle *p1, *p2, **pairs;
+    int c, i, k;
+    IA_Neighbor_List *il;
+    PairList *pl;
+    Particle *p1, *p2;
     double dist2, vec21[3];
 
     /* Loop local cells */
     for (c = 0; c < local_cells.n; c++) {
-        cell = local_cells.cell[c];
-        p1   = cell->part;
-        np  = cell->n;
-        /* Loop cell neighbors */
-        for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-            pairs = dd.cell_inter[c].nList[n].vList.pair;
-            np    = dd.cell_inter[c].nList[n].vList.n;
-            /* verlet list loop */
-            for(i=0; i<2*np; i+=2) {
-                p1 = pairs[i];                    /* pointer to particle 1 */
-                p2 = pairs[i+1];                  /* pointer to particle 2 */
-                dist2 = distance2vec(p1->r.p, p2->r.p, vec21); 
-                add_non_bonded_pair_force_iccp3m(p1, p2, vec21, sqrt(dist2), dist2);
+        p1 = local_cells.cell[c]->part;
+        il = &dd.cell_inter[c];
+        pl = &il->vList;
+        /* verlet list loop */
+        for(i = 0; i < pl->np; i++) {
+            for(k = pl->start[i]; k < pl->start[i+1]; k++) {
+                p2 = dd_pair_partner(il, pl->partner[k]);
+                dist2 = distance2vec(p1[i].r.p, p2->r.p, vec21); 
+                add_non_bonded_pair_force_iccp3m(&p1[i], p2, vec21, sqrt(dist2), dist2);
             }
         }
     }
@@ -642,37 +629,6 @@ void calc_long_range_forces_iccp3m()
 /************************************************************/
 /*@{*/
 
-/** Add a particle pair to a verlet pair list.
-  Checks verlet pair list size and reallocates memory if necessary.
- *  \param p1 Pointer to paricle one.
- *  \param p2 Pointer to paricle two.
- *  \param pl Pointer to the verlet pair list.
- */
-inline void add_pair_iccp3m(PairList *pl, Particle *p1, Particle *p2)
-{
-    /* check size of verlet List */
-    if(pl->n+1 >= pl->max) {
-        pl->max += LIST_INCREMENT;
-        pl->pair = (Particle **)Utils::realloc(pl->pair, 2*pl->max*sizeof(Particle *));
-    }
-    /* add pair */
-    pl->pair[(2*pl->n)  ] = p1;
-    pl->pair[(2*pl->n)+1] = p2;
-    /* increase number of pairs */
-    pl->n++;
-}
-
-void resize_verlet_list_iccp3m(PairList *pl)
-{
-    int diff;
-    diff = pl->max - pl->n;
-    if( diff > 2*LIST_INCREMENT ) {
-        diff = (diff/LIST_INCREMENT)-1;
-        pl->max -= diff*LIST_INCREMENT;
-        pl->pair = (Particle **)Utils::realloc(pl->pair, 2*pl->max*sizeof(Particle *));
-    }
-}
-
 /** initialize the forces for a real particle */
 inline void init_local_particle_force_iccp3m(Particle *part)
 {
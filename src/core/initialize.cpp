@@ -66,6 +66,11 @@
 #include "cuda_init.hpp"
 #include "cuda_interface.hpp"
 #include "scafacos.hpp"
+#include "threads.hpp"
+#include "load_balance.hpp"
+#include "skin_tune.hpp"
+#include "phase_timers.hpp"
+#include "constraint_sdf.hpp"
 
 /** whether the thermostat has to be reinitialized before integration */
 static int reinit_thermo = 1;
@@ -103,6 +108,7 @@ void on_program_start()
     call the initialization of the modules here
   */
   Random::init_random();
+  threads_init();
 
   init_node_grid();
   /* calculate initial minimal number of cells (see tclcallback_min_num_cells) */
@@ -180,6 +186,9 @@ void on_integration_start()
   /* end sanity checks                        */
   /********************************************/
 
+  /* the cell structure may have changed since the last balancing */
+  load_balance_check();
+
 
 #ifdef LB_GPU
   if(lattice_switch & LATTICE_LB_GPU && this_node == 0){
@@ -289,6 +298,9 @@ void on_coulomb_change()
   EVENT_TRACE(fprintf(stderr, "%d: on_coulomb_change\n", this_node));
   invalidate_obs();
 
+  /* the mesh based methods require equally sized domains */
+  load_balance_check();
+
   recalc_coulomb_prefactor();
 
 #ifdef ELECTROSTATICS
@@ -356,6 +368,11 @@ void on_short_range_ia_change()
 
   recalc_maximal_cutoff();
   cells_on_geometry_change(0);
+#ifdef CONSTRAINTS
+  /* the ranges of the constraints can have changed */
+  constraints_sdf_invalidate();
+  constraints_cells_invalidate();
+#endif
 
   recalc_forces = 1;
 }
@@ -364,6 +381,10 @@ void on_constraint_change()
 {
   EVENT_TRACE(fprintf(stderr, "%d: on_constraint_change\n", this_node));
   invalidate_obs();
+#ifdef CONSTRAINTS
+  constraints_sdf_invalidate();
+  constraints_cells_invalidate();
+#endif
   recalc_forces = 1;
 }
 
@@ -562,6 +583,7 @@ void on_parameter_change(int field)
     cells_on_geometry_change(0);
     break;
   case FIELD_SKIN:
+    skin_tune_reset();
     cells_on_geometry_change(0);
   case FIELD_PERIODIC:
     cells_on_geometry_change(CELL_FLAG_GRIDCHANGED);
@@ -623,12 +645,31 @@ void on_parameter_change(int field)
     break;
 #ifdef LB
   case FIELD_LATTICE_SWITCH:
+    /* the lattice requires equally sized domains */
+    load_balance_check();
     /* LB needs ghost velocities */
     on_ghost_flags_change();
     break;
 #endif
   case FIELD_DPD_IGNORE_FIXED_PARTICLES:
     break;
+  case FIELD_N_THREADS:
+    threads_set_num();
+    break;
+  case FIELD_BALANCE_INTERVAL:
+    load_balance_check();
+    break;
+  case FIELD_PHASE_TIMERS:
+    phase_timers_reset();
+    break;
+  case FIELD_SKIN_TUNE_INTERVAL:
+    skin_tune_reset();
+    break;
+  case FIELD_RESPA_STEPS:
+    /* start with an outer step, the forces have the wrong weight */
+    respa_phase = 0;
+    recalc_forces = 1;
+    break;
   }
 }
 
@@ -38,6 +38,9 @@
 #include "interaction_data.hpp"
 #include "particle_data.hpp"
 #include "communication.hpp"
+#include "load_balance.hpp"
+#include "skin_tune.hpp"
+#include "phase_timers.hpp"
 #include "grid.hpp"
 #include "cells.hpp"
 #include "verlet.hpp"
@@ -63,6 +66,7 @@
 #include "immersed_boundary/ibm_main.hpp"
 #include "immersed_boundary/ibm_volume_conservation.hpp"
 #include "minimize_energy.hpp"
+#include "threads.hpp"
 
 #ifdef VALGRIND_INSTRUMENTATION
 #include <callgrind.h>
@@ -100,6 +104,9 @@ double virial_store[3]            = {0.,0.,0.};
 #endif
 #endif
 
+int    respa_steps                = 1;
+int    respa_phase                = 0;
+
 /** For configurational temperature only */
 double configtemp[2]              = {0.,0.};
 
@@ -146,6 +153,29 @@ void integrator_sanity_checks()
   if ( time_step < 0.0 ) {
       runtimeErrorMsg() << "time_step not set";
   }
+
+  if (respa_steps > 1) {
+#ifdef MULTI_TIMESTEP
+    if (smaller_time_step > 0)
+      runtimeErrorMsg() << "respa_steps cannot be combined with smaller_time_step";
+#endif
+#ifdef NPT
+    if (integ_switch == INTEG_METHOD_NPT_ISO)
+      runtimeErrorMsg() << "respa_steps does not work with the NpT integrator";
+#endif
+#ifdef ELECTROSTATICS
+    switch (coulomb.method) {
+    case COULOMB_MAGGS:
+#ifdef CUDA
+    case COULOMB_P3M_GPU:
+#endif
+      runtimeErrorMsg() << "respa_steps does not work with MEMD or P3M on the GPU";
+      break;
+    default:
+      break;
+    }
+#endif
+  }
 }
 
 #ifdef NPT
@@ -325,10 +355,13 @@ void integrate_vv(int n_steps, int reuse_forces)
 #ifdef VALGRIND_INSTRUMENTATION
   CALLGRIND_START_INSTRUMENTATION;
 #endif
+
+  skin_tune_start();
     
   /* Integration loop */
   for (int step=0; step<n_steps; step++) {
     INTEG_TRACE(fprintf(stderr,"%d: STEP %d\n", this_node, step));
+    phase_timer_begin(PHASE_INTEGRATE);
 
 #ifdef BOND_CONSTRAINT
     save_old_pos();
@@ -358,6 +391,7 @@ void integrate_vv(int n_steps, int reuse_forces)
        NOTE 2: Depending on the integration method Step 1 and Step 2 
        cannot be combined for the translation. 
     */
+    phase_timer_begin(PHASE_PROPAGATE);
     if (integ_switch == INTEG_METHOD_NPT_ISO || nemd_method != NEMD_METHOD_OFF) {
       propagate_vel();
       propagate_pos(); 
@@ -367,6 +401,7 @@ void integrate_vv(int n_steps, int reuse_forces)
     } else { 
       propagate_vel_pos();
     }
+    phase_timer_end(PHASE_PROPAGATE);
 
 #ifdef BOND_CONSTRAINT
     /**Correct those particle positions that participate in a rigid/constrained bond */
@@ -434,6 +469,9 @@ void integrate_vv(int n_steps, int reuse_forces)
     transfer_momentum_gpu = 1;
 #endif
 
+    if (respa_steps > 1)
+      respa_phase = (respa_phase + 1) % respa_steps;
+
     force_calc();
     
 // IMMERSED_BOUNDARY
@@ -462,10 +500,12 @@ void integrate_vv(int n_steps, int reuse_forces)
     /* Integration Step: Step 4 of Velocity Verlet scheme:
        v(t+dt) = v(t+0.5*dt) + 0.5*dt * f(t+dt) */
     if(integ_switch != INTEG_METHOD_STEEPEST_DESCENT) {
+      phase_timer_begin(PHASE_PROPAGATE);
       rescale_forces_propagate_vel();
 #ifdef ROTATION
     convert_torques_propagate_omega();
 #endif
+      phase_timer_end(PHASE_PROPAGATE);
     }
     // SHAKE velocity updates
 #ifdef BOND_CONSTRAINT
@@ -481,14 +521,17 @@ void integrate_vv(int n_steps, int reuse_forces)
 
     // progagate one-step functionalities
 #ifdef LB
+    phase_timer_begin(PHASE_LB);
     if (lattice_switch & LATTICE_LB)
       lattice_boltzmann_update();
+    phase_timer_end(PHASE_LB);
       
     if (check_runtime_errors())
       break;
 #endif
 
 #ifdef LB_GPU
+    phase_timer_begin(PHASE_LB);
     if(this_node == 0){
 #ifdef ELECTROKINETICS
       if (ek_initialized) {
@@ -502,6 +545,7 @@ void integrate_vv(int n_steps, int reuse_forces)
       }
 #endif
     }
+    phase_timer_end(PHASE_LB);
 #endif //LB_GPU
     
 // IMMERSED_BOUNDARY
@@ -549,6 +593,12 @@ void integrate_vv(int n_steps, int reuse_forces)
     #ifdef COLLISION_DETECTION
       handle_collisions();
     #endif
+
+    phase_timer_end(PHASE_INTEGRATE);
+    phase_timers_count_step();
+
+    load_balance_step();
+    skin_tune_step();
   }
 
 #ifdef VALGRIND_INSTRUMENTATION
@@ -559,6 +609,9 @@ void integrate_vv(int n_steps, int reuse_forces)
   if(n_verlet_updates>0) verlet_reuse = n_steps/(double) n_verlet_updates;
   else verlet_reuse = 0;
 
+  /* load balance statistics */
+  load_balance_finish();
+
 #ifdef NPT
   if(integ_switch == INTEG_METHOD_NPT_ISO) {
     nptiso.invalidate_p_vel = 0;
@@ -601,6 +654,21 @@ void rescale_velocities(double scale)
 /* Privat functions */
 /************************************************************/
 
+int propagate_threaded()
+{
+#ifdef ADDITIONAL_CHECKS
+  return 0;
+#else
+  if(integ_switch == INTEG_METHOD_NPT_ISO)
+    return 0;
+#ifdef NEMD
+  if(nemd_method != NEMD_METHOD_OFF)
+    return 0;
+#endif
+  return 1;
+#endif
+}
+
 void rescale_forces()
 {
   Particle *p;
@@ -619,6 +687,7 @@ void rescale_forces()
       scale = 0.5 * smaller_time_step *         time_step;
   }
 #endif
+  ES_OMP_PRAGMA(omp parallel for private(cell, p, np, i) schedule(static) if(propagate_threaded()))
   for (c = 0; c < local_cells.n; c++) {
     cell = local_cells.cell[c];
     p  = cell->part;
@@ -658,6 +727,7 @@ void rescale_forces_propagate_vel()
 #endif
   INTEG_TRACE(fprintf(stderr,"%d: rescale_forces_propagate_vel:\n",this_node));
 
+  ES_OMP_PRAGMA(omp parallel for private(cell, p, np, i, j) schedule(static) if(propagate_threaded()))
   for (c = 0; c < local_cells.n; c++) {
     cell = local_cells.cell[c];
     p  = cell->part;
@@ -878,6 +948,7 @@ void propagate_vel()
 
   INTEG_TRACE(fprintf(stderr,"%d: propagate_vel:\n",this_node));
 
+  ES_OMP_PRAGMA(omp parallel for private(cell, p, np, i, j) schedule(static) if(propagate_threaded()))
   for (c = 0; c < local_cells.n; c++) {
     cell = local_cells.cell[c];
     p  = cell->part;
@@ -946,8 +1017,9 @@ void propagate_pos()
   else {
     Cell *cell;
     Particle *p;
-    int c, i, j, np;
+    int c, i, j, np, resort = 0;
 
+    ES_OMP_PRAGMA(omp parallel for private(cell, p, np, i, j) reduction(|:resort) schedule(static) if(propagate_threaded()))
     for (c = 0; c < local_cells.n; c++) {
       cell = local_cells.cell[c];
       p  = cell->part;
@@ -970,9 +1042,11 @@ void propagate_pos()
             }
         }
         /* Verlet criterion check */
-        if(distance2(p[i].r.p,p[i].l.p_old) > skin2 ) resort_particles = 1;
+        if(distance2(p[i].r.p,p[i].l.p_old) > skin2 ) resort = 1;
       }
     }
+    if (resort)
+      resort_particles = 1;
   }
   announce_resort_particles();
 }
@@ -981,7 +1055,7 @@ void propagate_vel_pos()
 {
   Cell *cell;
   Particle *p;
-  int c, i, j, np;
+  int c, i, j, np, resort = 0;
 
   INTEG_TRACE(fprintf(stderr,"%d: propagate_vel_pos:\n",this_node));
 
@@ -990,6 +1064,7 @@ void propagate_vel_pos()
   db_maxf_id = db_maxv_id = -1;
 #endif
 
+  ES_OMP_PRAGMA(omp parallel for private(cell, p, np, i, j) reduction(|:resort) schedule(static) if(propagate_threaded()))
   for (c = 0; c < local_cells.n; c++) {
     cell = local_cells.cell[c];
     p  = cell->part;
@@ -1045,7 +1120,7 @@ void propagate_vel_pos()
                          p[i].l.i[1]     += delta_box; 
                          while( p[i].r.p[1] >  box_l[1] ) {p[i].r.p[1] -= box_l[1]; p[i].l.i[1]++;}
                          while( p[i].r.p[1] <  0.0 )      {p[i].r.p[1] += box_l[1]; p[i].l.i[1]--;}
-                         resort_particles = 1;
+                         resort = 1;
                     }
                     /* Branch prediction on most systems should mean there is minimal cost here */ 
                     while( p[i].r.p[0] >  box_l[0] ) {p[i].r.p[0] -= box_l[0]; p[i].l.i[0]++;}
@@ -1059,11 +1134,13 @@ void propagate_vel_pos()
       if(SQR(p[i].r.p[0]-p[i].l.p_old[0]) 
         +SQR(p[i].r.p[1]-p[i].l.p_old[1])
         +SQR(p[i].r.p[2]-p[i].l.p_old[2]) > skin2) 
-            resort_particles=1;
+            resort = 1;
 
 
     }
   }
+  if (resort)
+    resort_particles = 1;
 
 #ifdef LEES_EDWARDS /* would be nice to be more refined about this */
   resort_particles = 1;
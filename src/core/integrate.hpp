@@ -64,6 +64,19 @@ extern double virial_store[3];
 #endif
 #endif
 
+/** Number of inner steps per outer step of the r-RESPA multiple time
+    step scheme (setmd respa_steps), 1 switches it off. The bonded and
+    short range forces are calculated every (inner) \ref time_step, the
+    long range forces of \ref calc_long_range_forces only every
+    respa_steps steps. On these outer steps, the long range forces are
+    multiplied by respa_steps, so that the two half steps of the
+    velocity Verlet scheme apply their impulse for the whole outer step
+    (Tuckerman, Berne and Martyna, J. Chem. Phys. 97, 1990 (1992)). */
+extern int respa_steps;
+/** Number of inner steps since the last outer step of the r-RESPA
+    scheme, the long range forces are calculated if it is 0. */
+extern int respa_phase;
+
 /** Store configurational temperature terms (numerator/denominator) */
 extern double configtemp[2];
 
@@ -75,6 +88,8 @@ extern double sim_time;
 extern double max_cut;
 /** Verlet list skin. */
 extern double skin;
+/** Square of half the skin, the displacement that triggers a resort. */
+extern double skin2;
 /** True iff the user has changed the skin setting. */
 extern bool skin_set;
 
@@ -112,6 +127,11 @@ void integrate_vv(int n_steps, int reuse_forces);
     new time step. */
 void rescale_velocities(double scale); 
 
+/** Whether the particle loops of the propagation steps can be
+    distributed over threads. NpT, NEMD and the additional checks
+    accumulate over all particles. */
+int propagate_threaded();
+
 /*@}*/
 
 int python_integrate(int n_steps, bool recalc_forces, bool reuse_forces);
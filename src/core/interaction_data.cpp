@@ -66,6 +66,7 @@
 #include "mdlc_correction.hpp"
 #include "initialize.hpp"
 #include "interaction_data.hpp"
+#include "nonbonded_batch.hpp"
 #include "actor/DipolarDirectSum.hpp"
 
 /****************************************
@@ -146,6 +147,7 @@ void force_and_energy_tables_init() {
 void initialize_ia_params(IA_parameters *params) {
  
   params->particlesInteract = 0;
+  params->batchKernel = 0;
   params->max_cut = max_cut_global;
 
 #ifdef LENNARD_JONES
@@ -719,6 +721,9 @@ static void recalc_maximal_cutoff_nonbonded()
 	 short-ranged one (that writes to the nonbonded energy) */
       data_sym->particlesInteract =
 	data->particlesInteract = (max_cut_current > 0.0);
+
+      data_sym->batchKernel =
+	data->batchKernel = nonbonded_batch_eligible(data);
       
       /* Bigger cutoffs are chosen due to dpd and the like. 
          Coulomb and dipolar interactions are handled in the Verlet lists
@@ -236,6 +236,11 @@ typedef struct {
    e.g. electrostatics. */
   int particlesInteract;
 
+  /** flag that tells whether all short-ranged interactions of this
+      pair can be evaluated by the batched kernel, see \ref
+      nonbonded_batch.hpp. */
+  int batchKernel;
+
   /** maximal cutoff for this pair of particle types. This contains
       contributions from the short-ranged interactions, plus any
       cutoffs from global interactions like electrostatics.
@@ -1170,6 +1175,13 @@ typedef struct {
   /** particle representation of this constraint. Actually needed are only the identity,
       the type and the force. */
   Particle part_rep;
+
+  /** spacing of the grid on which the distance to the constraint is
+      cached, or 0 to always calculate it exactly, see \ref
+      constraint_sdf.hpp */
+  double sdf_spacing;
+  /** largest deviation of the cached from the exact distance */
+  double sdf_tolerance;
 } Constraint;
 /*@}*/
 #endif
@@ -30,6 +30,7 @@
 #include <mpi.h>
 #include <cstdio>
 #include <iostream>
+#include <algorithm>
 #include "utils.hpp"
 #include "communication.hpp"
 #include "grid.hpp"
@@ -40,6 +41,7 @@
 #include "lb-d3q19.hpp"
 #include "lb-boundaries.hpp"
 #include "lb.hpp"
+#include "threads.hpp"
 #include "immersed_boundary/ibm_main.hpp"
 
 #include "cuda_interface.hpp"
@@ -1513,11 +1515,11 @@ static void halo_push_communication() {
     for (z=0; z<lblattice.halo_grid[2]; z++) {
         for (y=0; y<lblattice.halo_grid[1]; y++) {
 
-            buffer[0] = lbfluid[1][1][index];
-            buffer[1] = lbfluid[1][7][index];
-            buffer[2] = lbfluid[1][9][index];
-            buffer[3] = lbfluid[1][11][index];
-            buffer[4] = lbfluid[1][13][index];
+            buffer[0] = lbfluid[0][1][index];
+            buffer[1] = lbfluid[0][7][index];
+            buffer[2] = lbfluid[0][9][index];
+            buffer[3] = lbfluid[0][11][index];
+            buffer[4] = lbfluid[0][13][index];
             buffer += 5;
 
             index += yperiod;
@@ -1537,11 +1539,11 @@ static void halo_push_communication() {
     for (z=0; z<lblattice.halo_grid[2]; z++) {
         for (y=0; y<lblattice.halo_grid[1]; y++) {
 
-            lbfluid[1][1][index] = buffer[0];
-            lbfluid[1][7][index] = buffer[1];
-            lbfluid[1][9][index] = buffer[2];
-            lbfluid[1][11][index] = buffer[3];
-            lbfluid[1][13][index] = buffer[4];
+            lbfluid[0][1][index] = buffer[0];
+            lbfluid[0][7][index] = buffer[1];
+            lbfluid[0][9][index] = buffer[2];
+            lbfluid[0][11][index] = buffer[3];
+            lbfluid[0][13][index] = buffer[4];
             buffer += 5;
 
             index += yperiod;
@@ -1557,11 +1559,11 @@ static void halo_push_communication() {
     for (z=0; z<lblattice.halo_grid[2]; z++) {
         for (y=0; y<lblattice.halo_grid[1]; y++) {
 
-            buffer[0] = lbfluid[1][2][index];
-            buffer[1] = lbfluid[1][8][index];
-            buffer[2] = lbfluid[1][10][index];
-            buffer[3] = lbfluid[1][12][index];
-            buffer[4] = lbfluid[1][14][index];
+            buffer[0] = lbfluid[0][2][index];
+            buffer[1] = lbfluid[0][8][index];
+            buffer[2] = lbfluid[0][10][index];
+            buffer[3] = lbfluid[0][12][index];
+            buffer[4] = lbfluid[0][14][index];
             buffer += 5;
 
             index += yperiod;
@@ -1581,11 +1583,11 @@ static void halo_push_communication() {
     for (z=0; z<lblattice.halo_grid[2]; z++) {
         for (y=0; y<lblattice.halo_grid[1]; y++) {
 
-            lbfluid[1][2][index] = buffer[0];
-            lbfluid[1][8][index] = buffer[1];
-            lbfluid[1][10][index] = buffer[2];
-            lbfluid[1][12][index] = buffer[3];
-            lbfluid[1][14][index] = buffer[4];
+            lbfluid[0][2][index] = buffer[0];
+            lbfluid[0][8][index] = buffer[1];
+            lbfluid[0][10][index] = buffer[2];
+            lbfluid[0][12][index] = buffer[3];
+            lbfluid[0][14][index] = buffer[4];
             buffer += 5;
 
             index += yperiod;
@@ -1608,11 +1610,11 @@ static void halo_push_communication() {
     for (z=0; z<lblattice.halo_grid[2]; z++) {
         for (x=0; x<lblattice.halo_grid[0]; x++) {
 
-            buffer[0] = lbfluid[1][3][index];
-            buffer[1] = lbfluid[1][7][index];
-            buffer[2] = lbfluid[1][10][index];
-            buffer[3] = lbfluid[1][15][index];
-            buffer[4] = lbfluid[1][17][index];
+            buffer[0] = lbfluid[0][3][index];
+            buffer[1] = lbfluid[0][7][index];
+            buffer[2] = lbfluid[0][10][index];
+            buffer[3] = lbfluid[0][15][index];
+            buffer[4] = lbfluid[0][17][index];
             buffer += 5;
 
             ++index;
@@ -1633,11 +1635,11 @@ static void halo_push_communication() {
     for (z=0; z<lblattice.halo_grid[2]; z++) {
         for (x=0; x<lblattice.halo_grid[0]; x++) {
 
-            lbfluid[1][3][index] = buffer[0];
-            lbfluid[1][7][index] = buffer[1];
-            lbfluid[1][10][index] = buffer[2];
-            lbfluid[1][15][index] = buffer[3];
-            lbfluid[1][17][index] = buffer[4];
+            lbfluid[0][3][index] = buffer[0];
+            lbfluid[0][7][index] = buffer[1];
+            lbfluid[0][10][index] = buffer[2];
+            lbfluid[0][15][index] = buffer[3];
+            lbfluid[0][17][index] = buffer[4];
             buffer += 5;
 
             ++index;
@@ -1654,11 +1656,11 @@ static void halo_push_communication() {
     for (z=0; z<lblattice.halo_grid[2]; z++) {
         for (x=0; x<lblattice.halo_grid[0]; x++) {
 
-            buffer[0] = lbfluid[1][4][index];
-            buffer[1] = lbfluid[1][8][index];
-            buffer[2] = lbfluid[1][9][index];
-            buffer[3] = lbfluid[1][16][index];
-            buffer[4] = lbfluid[1][18][index];
+            buffer[0] = lbfluid[0][4][index];
+            buffer[1] = lbfluid[0][8][index];
+            buffer[2] = lbfluid[0][9][index];
+            buffer[3] = lbfluid[0][16][index];
+            buffer[4] = lbfluid[0][18][index];
             buffer += 5;
 
             ++index;
@@ -1679,11 +1681,11 @@ static void halo_push_communication() {
     for (z=0; z<lblattice.halo_grid[2]; z++) {
         for (x=0; x<lblattice.halo_grid[0]; x++) {
 
-            lbfluid[1][4][index] = buffer[0];
-            lbfluid[1][8][index] = buffer[1];
-            lbfluid[1][9][index] = buffer[2];
-            lbfluid[1][16][index] = buffer[3];
-            lbfluid[1][18][index] = buffer[4];
+            lbfluid[0][4][index] = buffer[0];
+            lbfluid[0][8][index] = buffer[1];
+            lbfluid[0][9][index] = buffer[2];
+            lbfluid[0][16][index] = buffer[3];
+            lbfluid[0][18][index] = buffer[4];
             buffer += 5;
 
             ++index;
@@ -1707,11 +1709,11 @@ static void halo_push_communication() {
     for (y=0; y<lblattice.halo_grid[1]; y++) {
         for (x=0; x<lblattice.halo_grid[0]; x++) {
 
-            buffer[0] = lbfluid[1][5][index];
-            buffer[1] = lbfluid[1][11][index];
-            buffer[2] = lbfluid[1][14][index];
-            buffer[3] = lbfluid[1][15][index];
-            buffer[4] = lbfluid[1][18][index];
+            buffer[0] = lbfluid[0][5][index];
+            buffer[1] = lbfluid[0][11][index];
+            buffer[2] = lbfluid[0][14][index];
+            buffer[3] = lbfluid[0][15][index];
+            buffer[4] = lbfluid[0][18][index];
             buffer += 5;
 
             ++index;
@@ -1731,11 +1733,11 @@ static void halo_push_communication() {
     for (y=0; y<lblattice.halo_grid[1]; y++) {
         for (x=0; x<lblattice.halo_grid[0]; x++) {
 
-            lbfluid[1][5][index] = buffer[0];
-            lbfluid[1][11][index] = buffer[1];
-            lbfluid[1][14][index] = buffer[2];
-            lbfluid[1][15][index] = buffer[3];
-            lbfluid[1][18][index] = buffer[4];
+            lbfluid[0][5][index] = buffer[0];
+            lbfluid[0][11][index] = buffer[1];
+            lbfluid[0][14][index] = buffer[2];
+            lbfluid[0][15][index] = buffer[3];
+            lbfluid[0][18][index] = buffer[4];
             buffer += 5;
 
             ++index;
@@ -1751,11 +1753,11 @@ static void halo_push_communication() {
     for (y=0; y<lblattice.halo_grid[1]; y++) {
         for (x=0; x<lblattice.halo_grid[0]; x++) {
 
-            buffer[0] = lbfluid[1][6][index];
-            buffer[1] = lbfluid[1][12][index];
-            buffer[2] = lbfluid[1][13][index];
-            buffer[3] = lbfluid[1][16][index];
-            buffer[4] = lbfluid[1][17][index];
+            buffer[0] = lbfluid[0][6][index];
+            buffer[1] = lbfluid[0][12][index];
+            buffer[2] = lbfluid[0][13][index];
+            buffer[3] = lbfluid[0][16][index];
+            buffer[4] = lbfluid[0][17][index];
             buffer += 5;
 
             ++index;
@@ -1775,11 +1777,11 @@ static void halo_push_communication() {
     for (y=0; y<lblattice.halo_grid[1]; y++) {
         for (x=0; x<lblattice.halo_grid[0]; x++) {
 
-            lbfluid[1][6][index] = buffer[0];
-            lbfluid[1][12][index] = buffer[1];
-            lbfluid[1][13][index] = buffer[2];
-            lbfluid[1][16][index] = buffer[3];
-            lbfluid[1][17][index] = buffer[4];
+            lbfluid[0][6][index] = buffer[0];
+            lbfluid[0][12][index] = buffer[1];
+            lbfluid[0][13][index] = buffer[2];
+            lbfluid[0][16][index] = buffer[3];
+            lbfluid[0][17][index] = buffer[4];
             buffer += 5;
 
             ++index;
@@ -1838,8 +1840,13 @@ int lb_sanity_checks() {
 void lb_pre_init() {
     lbfluid[0]    = (double**) Utils::malloc(lbmodel.n_veloc*sizeof(double *));
     lbfluid[0][0] = (double*) Utils::malloc(lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(double));
+#ifdef PULL
     lbfluid[1]    = (double**) Utils::malloc(lbmodel.n_veloc*sizeof(double *));
     lbfluid[1][0] = (double*) Utils::malloc(lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(double));
+#else // PULL
+    /* the push scheme streams in place */
+    lbfluid[1]    = lbfluid[0];
+#endif // PULL
 }
 
 
@@ -1850,13 +1857,19 @@ static void lb_realloc_fluid() {
     LB_TRACE(printf("reallocating fluid\n"));
 
     lbfluid[0]    = (double**) Utils::realloc(lbfluid[0],lbmodel.n_veloc*sizeof(double *));
-    lbfluid[1]    = (double**) Utils::realloc(lbfluid[1],lbmodel.n_veloc*sizeof(double *));
     lbfluid[0][0] = (double*) Utils::realloc(lbfluid[0][0],lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(double));
+#ifdef PULL
+    lbfluid[1]    = (double**) Utils::realloc(lbfluid[1],lbmodel.n_veloc*sizeof(double *));
     lbfluid[1][0] = (double*) Utils::realloc(lbfluid[1][0],lblattice.halo_grid_volume*lbmodel.n_veloc*sizeof(double));
+#else // PULL
+    lbfluid[1]    = lbfluid[0];
+#endif // PULL
 
     for (i=0; i<lbmodel.n_veloc; ++i) {
         lbfluid[0][i] = lbfluid[0][0] + i*lblattice.halo_grid_volume;
+#ifdef PULL
         lbfluid[1][i] = lbfluid[1][0] + i*lblattice.halo_grid_volume;
+#endif // PULL
     }
 
     lbfields = (LB_FluidNode*) Utils::realloc(lbfields,lblattice.halo_grid_volume*sizeof(*lbfields));
@@ -2095,8 +2108,10 @@ void lb_init() {
 void lb_release_fluid() {
     free(lbfluid[0][0]);
     free(lbfluid[0]);
+#ifdef PULL
     free(lbfluid[1][0]);
     free(lbfluid[1]);
+#endif // PULL
     free(lbfields);
 }
 
@@ -2419,82 +2434,68 @@ inline void lb_relax_modes(index_t index, double *mode)
 }
 
 
-inline void lb_thermalize_modes(index_t index, double *mode) {
-    double fluct[6];
-#ifdef GAUSSRANDOM
-    double rootrho_gauss = sqrt(fabs(mode[0]+lbpar.rho[0]*lbpar.agrid*lbpar.agrid*lbpar.agrid));
-
-    /* stress modes */
-    mode[4] += (fluct[0] = rootrho_gauss*lb_phi[4]*gaussian_random());
-    mode[5] += (fluct[1] = rootrho_gauss*lb_phi[5]*gaussian_random());
-    mode[6] += (fluct[2] = rootrho_gauss*lb_phi[6]*gaussian_random());
-    mode[7] += (fluct[3] = rootrho_gauss*lb_phi[7]*gaussian_random());
-    mode[8] += (fluct[4] = rootrho_gauss*lb_phi[8]*gaussian_random());
-    mode[9] += (fluct[5] = rootrho_gauss*lb_phi[9]*gaussian_random());
-
-#ifndef OLD_FLUCT
-    /* ghost modes */
-    mode[10] += rootrho_gauss*lb_phi[10]*gaussian_random();
-    mode[11] += rootrho_gauss*lb_phi[11]*gaussian_random();
-    mode[12] += rootrho_gauss*lb_phi[12]*gaussian_random();
-    mode[13] += rootrho_gauss*lb_phi[13]*gaussian_random();
-    mode[14] += rootrho_gauss*lb_phi[14]*gaussian_random();
-    mode[15] += rootrho_gauss*lb_phi[15]*gaussian_random();
-    mode[16] += rootrho_gauss*lb_phi[16]*gaussian_random();
-    mode[17] += rootrho_gauss*lb_phi[17]*gaussian_random();
-    mode[18] += rootrho_gauss*lb_phi[18]*gaussian_random();
-#endif // !OLD_FLUCT
-
-#elif defined (GAUSSRANDOMCUT)
-    double rootrho_gauss = sqrt(fabs(mode[0]+lbpar.rho[0]*lbpar.agrid*lbpar.agrid*lbpar.agrid));
+/** Number of consecutive nodes along x that are collided together.
+ *  The mode transformations work on arrays of this length so that
+ *  the compiler can vectorize them over the nodes. */
+#define LB_RUN_LENGTH 16
 
-    /* stress modes */
-    mode[4] += (fluct[0] = rootrho_gauss*lb_phi[4]*gaussian_random_cut());
-    mode[5] += (fluct[1] = rootrho_gauss*lb_phi[5]*gaussian_random_cut());
-    mode[6] += (fluct[2] = rootrho_gauss*lb_phi[6]*gaussian_random_cut());
-    mode[7] += (fluct[3] = rootrho_gauss*lb_phi[7]*gaussian_random_cut());
-    mode[8] += (fluct[4] = rootrho_gauss*lb_phi[8]*gaussian_random_cut());
-    mode[9] += (fluct[5] = rootrho_gauss*lb_phi[9]*gaussian_random_cut());
+uint64_t lb_noise_step = 0;
 
-#ifndef OLD_FLUCT
-    /* ghost modes */
-    mode[10] += rootrho_gauss*lb_phi[10]*gaussian_random_cut();
-    mode[11] += rootrho_gauss*lb_phi[11]*gaussian_random_cut();
-    mode[12] += rootrho_gauss*lb_phi[12]*gaussian_random_cut();
-    mode[13] += rootrho_gauss*lb_phi[13]*gaussian_random_cut();
-    mode[14] += rootrho_gauss*lb_phi[14]*gaussian_random_cut();
-    mode[15] += rootrho_gauss*lb_phi[15]*gaussian_random_cut();
-    mode[16] += rootrho_gauss*lb_phi[16]*gaussian_random_cut();
-    mode[17] += rootrho_gauss*lb_phi[17]*gaussian_random_cut();
-    mode[18] += rootrho_gauss*lb_phi[18]*gaussian_random_cut();
-#endif // OLD_FLUCT
+/** Draw the thermal noise of the fluid for a run of nodes along x.
+ *  The noise is keyed on the global lattice site and \ref
+ *  lb_noise_step, so it does not depend on the node grid.
+ *
+ * @param x, y, z  coordinates of the first node in the halo grid
+ * @param len      number of nodes, at most \ref LB_RUN_LENGTH
+ * @param xi       noise of the modes 4 to 18 of each node (Output)
+ */
+static void lb_fluid_noise(int x, int y, int z, int len, double xi[16][LB_RUN_LENGTH]) {
+    uint32_t id = (uint32_t)(x - 1 + lblattice.local_index_offset[0])
+        + (uint32_t)lblattice.global_grid[0]*((uint32_t)(y - 1 + lblattice.local_index_offset[1])
+        + (uint32_t)lblattice.global_grid[1]*(uint32_t)(z - 1 + lblattice.local_index_offset[2]));
+
+    for (int block = 0; block < 4; block++) {
+        double *out[4] = { xi[4*block], xi[4*block+1], xi[4*block+2], xi[4*block+3] };
+        thermo_noise_batch(Random::NOISE_LB_FLUID, lb_noise_step, id, block, len, out);
+    }
+}
 
+/** Add the thermal fluctuations to the modes of a node.
+ *
+ * @param index  the node
+ * @param mode   modes of the node
+ * @param xi     noise of the modes 4 to 18, see \ref lb_fluid_noise
+ */
+inline void lb_thermalize_modes(index_t index, double *mode, const double *xi) {
+    double fluct[6];
+#if defined (GAUSSRANDOM) || defined (GAUSSRANDOMCUT)
+    double rootrho = sqrt(fabs(mode[0]+lbpar.rho[0]*lbpar.agrid*lbpar.agrid*lbpar.agrid));
 #elif defined (FLATNOISE)
     double rootrho = sqrt(fabs(12.0*(mode[0]+lbpar.rho[0]*lbpar.agrid*lbpar.agrid*lbpar.agrid)));
+#else // GAUSSRANDOM
+#error No noise type defined for the CPU LB
+#endif //GAUSSRANDOM
 
     /* stress modes */
-    mode[4] += (fluct[0] = rootrho*lb_phi[4]*(d_random()-0.5));
-    mode[5] += (fluct[1] = rootrho*lb_phi[5]*(d_random()-0.5));
-    mode[6] += (fluct[2] = rootrho*lb_phi[6]*(d_random()-0.5));
-    mode[7] += (fluct[3] = rootrho*lb_phi[7]*(d_random()-0.5));
-    mode[8] += (fluct[4] = rootrho*lb_phi[8]*(d_random()-0.5));
-    mode[9] += (fluct[5] = rootrho*lb_phi[9]*(d_random()-0.5));
+    mode[4] += (fluct[0] = rootrho*lb_phi[4]*xi[0]);
+    mode[5] += (fluct[1] = rootrho*lb_phi[5]*xi[1]);
+    mode[6] += (fluct[2] = rootrho*lb_phi[6]*xi[2]);
+    mode[7] += (fluct[3] = rootrho*lb_phi[7]*xi[3]);
+    mode[8] += (fluct[4] = rootrho*lb_phi[8]*xi[4]);
+    mode[9] += (fluct[5] = rootrho*lb_phi[9]*xi[5]);
 
 #ifndef OLD_FLUCT
     /* ghost modes */
-    mode[10] += rootrho*lb_phi[10]*(d_random()-0.5);
-    mode[11] += rootrho*lb_phi[11]*(d_random()-0.5);
-    mode[12] += rootrho*lb_phi[12]*(d_random()-0.5);
-    mode[13] += rootrho*lb_phi[13]*(d_random()-0.5);
-    mode[14] += rootrho*lb_phi[14]*(d_random()-0.5);
-    mode[15] += rootrho*lb_phi[15]*(d_random()-0.5);
-    mode[16] += rootrho*lb_phi[16]*(d_random()-0.5);
-    mode[17] += rootrho*lb_phi[17]*(d_random()-0.5);
-    mode[18] += rootrho*lb_phi[18]*(d_random()-0.5);
+    mode[10] += rootrho*lb_phi[10]*xi[6];
+    mode[11] += rootrho*lb_phi[11]*xi[7];
+    mode[12] += rootrho*lb_phi[12]*xi[8];
+    mode[13] += rootrho*lb_phi[13]*xi[9];
+    mode[14] += rootrho*lb_phi[14]*xi[10];
+    mode[15] += rootrho*lb_phi[15]*xi[11];
+    mode[16] += rootrho*lb_phi[16]*xi[12];
+    mode[17] += rootrho*lb_phi[17]*xi[13];
+    mode[18] += rootrho*lb_phi[18]*xi[14];
 #endif // !OLD_FLUCT
-#else // GAUSSRANDOM
-#error No noise type defined for the CPU LB
-#endif //GAUSSRANDOM
 
 #ifdef ADDITIONAL_CHECKS
     rancounter += 15;
@@ -2613,99 +2614,305 @@ inline void lb_calc_n_from_modes(index_t index, double *mode)
 }
 
 
-inline void lb_calc_n_from_modes_push(index_t index, double *m) {
-#ifdef D3Q19
-    int yperiod = lblattice.halo_grid[0];
-    int zperiod = lblattice.halo_grid[0]*lblattice.halo_grid[1];
-    index_t next[19];
-    next[0]  = index;
-    next[1]  = index + 1;
-    next[2]  = index - 1;
-    next[3]  = index + yperiod;
-    next[4]  = index - yperiod;
-    next[5]  = index + zperiod;
-    next[6]  = index - zperiod;
-    next[7]  = index + (1 + yperiod);
-    next[8]  = index - (1 + yperiod);
-    next[9]  = index + (1 - yperiod);
-    next[10] = index - (1 - yperiod);
-    next[11] = index + (1 + zperiod);
-    next[12] = index - (1 + zperiod);
-    next[13] = index + (1 - zperiod);
-    next[14] = index - (1 - zperiod);
-    next[15] = index + (yperiod + zperiod);
-    next[16] = index - (yperiod + zperiod);
-    next[17] = index + (yperiod - zperiod);
-    next[18] = index - (yperiod - zperiod);
-
-    /* normalization factors enter in the back transformation */
-    for (int i = 0; i < lbmodel.n_veloc; i++) 
-        m[i] = (1./d3q19_modebase[19][i])*m[i];
+/** Number of lattice rows along y that are swept as one tile, see
+ *  \ref lb_collide_stream. */
+#define LB_TILE_Y 8
+
+/** State of a neighbor node in the sweep of \ref lb_collide_stream */
+enum { LB_NEIGHBOR_HALO, LB_NEIGHBOR_DONE, LB_NEIGHBOR_LATER };
+
+/** Opposite velocity of each velocity of the D3Q19 model */
+static const int lb_reverse[19] = { 0, 2, 1, 4, 3, 6, 5, 8, 7, 10, 9, 12, 11, 14, 13, 16, 15, 18, 17 };
+
+/** Offsets of the neighbor nodes in the halo grid, set up at the
+ *  start of every \ref lb_collide_stream. */
+static index_t lb_next[19];
+
+/** Collisions of a run of nodes along x.
+ *
+ *  The modes and the back transformation are computed for all nodes
+ *  of the run at once, the relaxation, the fluctuations and the
+ *  forces node by node. Boundary nodes are not collided and their
+ *  post-collision populations are undefined.
+ *
+ * @param index    index of the first node of the run
+ * @param x, y, z  coordinates of the first node of the run
+ * @param len      number of nodes, at most \ref LB_RUN_LENGTH
+ * @param post     post-collision populations of the run (Output)
+ */
+static void lb_collide_run(index_t index, int x, int y, int z, int len,
+                           double post[19][LB_RUN_LENGTH]) {
+#ifndef D3Q19
+#error Only D3Q19 is implemened!
+#endif
+    double mode[19][LB_RUN_LENGTH];
+    double xi[16][LB_RUN_LENGTH];
+    double m[19], xi_node[15];
+    const double *n[19];
+    const double *w = lbmodel.w;
+    int i, k;
+
+    for (i = 0; i < 19; i++) n[i] = lbfluid[0][i] + index;
+
+    /* calculate modes, see lb_calc_modes() */
+    ES_OMP_PRAGMA(omp simd)
+    for (k = 0; k < len; k++) {
+        double n0, n1p, n1m, n2p, n2m, n3p, n3m, n4p, n4m, n5p, n5m, n6p, n6m, n7p, n7m, n8p, n8m, n9p, n9m;
+
+        n0  = n[0][k];
+        n1p = n[1][k] + n[2][k];
+        n1m = n[1][k] - n[2][k];
+        n2p = n[3][k] + n[4][k];
+        n2m = n[3][k] - n[4][k];
+        n3p = n[5][k] + n[6][k];
+        n3m = n[5][k] - n[6][k];
+        n4p = n[7][k] + n[8][k];
+        n4m = n[7][k] - n[8][k];
+        n5p = n[9][k] + n[10][k];
+        n5m = n[9][k] - n[10][k];
+        n6p = n[11][k] + n[12][k];
+        n6m = n[11][k] - n[12][k];
+        n7p = n[13][k] + n[14][k];
+        n7m = n[13][k] - n[14][k];
+        n8p = n[15][k] + n[16][k];
+        n8m = n[15][k] - n[16][k];
+        n9p = n[17][k] + n[18][k];
+        n9m = n[17][k] - n[18][k];
+
+        mode[0][k] = n0 + n1p + n2p + n3p + n4p + n5p + n6p + n7p + n8p + n9p;
+
+        mode[1][k] = n1m + n4m + n5m + n6m + n7m;
+        mode[2][k] = n2m + n4m - n5m + n8m + n9m;
+        mode[3][k] = n3m + n6m - n7m + n8m - n9m;
+
+        mode[4][k] = -n0 + n4p + n5p + n6p + n7p + n8p + n9p;
+        mode[5][k] = n1p - n2p + n6p + n7p - n8p - n9p;
+        mode[6][k] = n1p + n2p - n6p - n7p - n8p - n9p - 2.*(n3p - n4p - n5p);
+        mode[7][k] = n4p - n5p;
+        mode[8][k] = n6p - n7p;
+        mode[9][k] = n8p - n9p;
 
 #ifndef OLD_FLUCT
-    lbfluid[1][ 0][next[0]] = m[0] - m[4] + m[16];
-    lbfluid[1][ 1][next[1]] = m[0] + m[1] + m[5] + m[6] - m[17] - m[18] - 2.*(m[10] + m[16]);
-    lbfluid[1][ 2][next[2]] = m[0] - m[1] + m[5] + m[6] - m[17] - m[18] + 2.*(m[10] - m[16]);
-    lbfluid[1][ 3][next[3]] = m[0] + m[2] - m[5] + m[6] + m[17] - m[18] - 2.*(m[11] + m[16]);
-    lbfluid[1][ 4][next[4]] = m[0] - m[2] - m[5] + m[6] + m[17] - m[18] + 2.*(m[11] - m[16]);
-    lbfluid[1][ 5][next[5]] = m[0] + m[3] - 2.*(m[6] + m[12] + m[16] - m[18]);
-    lbfluid[1][ 6][next[6]] = m[0] - m[3] - 2.*(m[6] - m[12] + m[16] - m[18]);
-    lbfluid[1][ 7][next[7]] = m[0] + m[1] + m[2] + m[4] + 2.*m[6] + m[7] + m[10] + m[11] + m[13] + m[14] + m[16] + 2.*m[18];
-    lbfluid[1][ 8][next[8]] = m[0] - m[1] - m[2] + m[4] + 2.*m[6] + m[7] - m[10] - m[11] - m[13] - m[14] + m[16] + 2.*m[18];
-    lbfluid[1][ 9][next[9]] = m[0] + m[1] - m[2] + m[4] + 2.*m[6] - m[7] + m[10] - m[11] + m[13] - m[14] + m[16] + 2.*m[18];
-    lbfluid[1][10][next[10]] = m[0] - m[1] + m[2] + m[4] + 2.*m[6] - m[7] - m[10] + m[11] - m[13] + m[14] + m[16] + 2.*m[18];
-    lbfluid[1][11][next[11]] = m[0] + m[1] + m[3] + m[4] + m[5] - m[6] + m[8] + m[10] + m[12] - m[13] + m[15] + m[16] + m[17] - m[18];
-    lbfluid[1][12][next[12]] = m[0] - m[1] - m[3] + m[4] + m[5] - m[6] + m[8] - m[10] - m[12] + m[13] - m[15] + m[16] + m[17] - m[18];
-    lbfluid[1][13][next[13]] = m[0] + m[1] - m[3] + m[4] + m[5] - m[6] - m[8] + m[10] - m[12] - m[13] - m[15] + m[16] + m[17] - m[18];
-    lbfluid[1][14][next[14]] = m[0] - m[1] + m[3] + m[4] + m[5] - m[6] - m[8] - m[10] + m[12] + m[13] + m[15] + m[16] + m[17] - m[18];
-    lbfluid[1][15][next[15]] = m[0] + m[2] + m[3] + m[4] - m[5] - m[6] + m[9] + m[11] + m[12] - m[14] - m[15] + m[16] - m[17] - m[18];
-    lbfluid[1][16][next[16]] = m[0] - m[2] - m[3] + m[4] - m[5] - m[6] + m[9] - m[11] - m[12] + m[14] + m[15] + m[16] - m[17] - m[18];
-    lbfluid[1][17][next[17]] = m[0] + m[2] - m[3] + m[4] - m[5] - m[6] - m[9] + m[11] - m[12] - m[14] + m[15] + m[16] - m[17] - m[18];
-    lbfluid[1][18][next[18]] = m[0] - m[2] + m[3] + m[4] - m[5] - m[6] - m[9] - m[11] + m[12] + m[14] - m[15] + m[16] - m[17] - m[18];
+        mode[10][k] = -2.*n1m + n4m + n5m + n6m + n7m;
+        mode[11][k] = -2.*n2m + n4m - n5m + n8m + n9m;
+        mode[12][k] = -2.*n3m + n6m - n7m + n8m - n9m;
+        mode[13][k] = n4m + n5m - n6m - n7m;
+        mode[14][k] = n4m - n5m - n8m - n9m;
+        mode[15][k] = n6m - n7m - n8m + n9m;
+        mode[16][k] = n0 + n4p + n5p + n6p + n7p + n8p + n9p
+            - 2.*(n1p + n2p + n3p);
+        mode[17][k] = - n1p + n2p + n6p + n7p - n8p - n9p;
+        mode[18][k] = - n1p - n2p -n6p - n7p - n8p - n9p
+            + 2.*(n3p + n4p + n5p);
 #else // !OLD_FLUCT
-    lbfluid[1][ 0][next[0]] = m[0] - m[4];
-    lbfluid[1][ 1][next[1]] = m[0] + m[1] + m[5] + m[6];
-    lbfluid[1][ 2][next[2]] = m[0] - m[1] + m[5] + m[6];
-    lbfluid[1][ 3][next[3]] = m[0] + m[2] - m[5] + m[6];
-    lbfluid[1][ 4][next[4]] = m[0] - m[2] - m[5] + m[6];
-    lbfluid[1][ 5][next[5]] = m[0] + m[3] - 2.*m[6];
-    lbfluid[1][ 6][next[6]] = m[0] - m[3] - 2.*m[6];
-    lbfluid[1][ 7][next[7]] = m[0] + m[1] + m[2] + m[4] + 2.*m[6] + m[7];
-    lbfluid[1][ 8][next[8]] = m[0] - m[1] - m[2] + m[4] + 2.*m[6] + m[7];
-    lbfluid[1][ 9][next[9]] = m[0] + m[1] - m[2] + m[4] + 2.*m[6] - m[7];
-    lbfluid[1][10][next[10]] = m[0] - m[1] + m[2] + m[4] + 2.*m[6] - m[7];
-    lbfluid[1][11][next[11]] = m[0] + m[1] + m[3] + m[4] + m[5] - m[6] + m[8];
-    lbfluid[1][12][next[12]] = m[0] - m[1] - m[3] + m[4] + m[5] - m[6] + m[8];
-    lbfluid[1][13][next[13]] = m[0] + m[1] - m[3] + m[4] + m[5] - m[6] - m[8];
-    lbfluid[1][14][next[14]] = m[0] - m[1] + m[3] + m[4] + m[5] - m[6] - m[8];
-    lbfluid[1][15][next[15]] = m[0] + m[2] + m[3] + m[4] - m[5] - m[6] + m[9];
-    lbfluid[1][16][next[16]] = m[0] - m[2] - m[3] + m[4] - m[5] - m[6] + m[9];
-    lbfluid[1][17][next[17]] = m[0] + m[2] - m[3] + m[4] - m[5] - m[6] - m[9];
-    lbfluid[1][18][next[18]] = m[0] - m[2] + m[3] + m[4] - m[5] - m[6] - m[9];
+        mode[10][k] = mode[11][k] = mode[12][k] = mode[13][k] = mode[14][k] = 0.;
+        mode[15][k] = mode[16][k] = mode[17][k] = mode[18][k] = 0.;
 #endif // !OLD_FLUCT
+    }
 
-    /* weights enter in the back transformation */
-    for (int i = 0; i < lbmodel.n_veloc; i++)
-        lbfluid[1][i][next[i]] *= lbmodel.w[i];
-#else // D3Q19
-    double **e = lbmodel.e;
-    index_t next[lbmodel.n_veloc];
-    for (int i = 0; i < lbmodel.n_veloc; i++) {
-        next[i] = get_linear_index(c[i][0],c[i][1],c[i][2],lblattic.halo_grid);
-        lbfluid[1][i][next[i]] = 0.0;
-        for (int j = 0; j < lbmodel.n_veloc; j++)
-          lbfluid[1][i][next[i]] += mode[j]*e[j][i]/e[19][j];
-        lbfluid[1][i][index] *= w[i];
+    if (fluct) lb_fluid_noise(x, y, z, len, xi);
+
+    for (k = 0; k < len; k++) {
+#ifdef LB_BOUNDARIES
+        if (lbfields[index+k].boundary) continue;
+#endif // LB_BOUNDARIES
+
+        for (i = 0; i < 19; i++) m[i] = mode[i][k];
+
+        /* deterministic collisions */
+        lb_relax_modes(index+k, m);
+
+        /* fluctuating hydrodynamics */
+        if (fluct) {
+            for (i = 0; i < 15; i++) xi_node[i] = xi[i][k];
+            lb_thermalize_modes(index+k, m, xi_node);
+        }
+
+        /* apply forces */
+#ifdef EXTERNAL_FORCES
+        lb_apply_forces(index+k, m);
+#else // EXTERNAL_FORCES
+        if (lbfields[index+k].has_force) lb_apply_forces(index+k, m);
+#endif // EXTERNAL_FORCES
+
+        /* normalization factors enter in the back transformation */
+        for (i = 0; i < 19; i++) mode[i][k] = (1./d3q19_modebase[19][i])*m[i];
     }
-#endif // D3Q19
+
+    /* transform back to populations, weights enter in the back transformation */
+    ES_OMP_PRAGMA(omp simd)
+    for (k = 0; k < len; k++) {
+        double m0 = mode[0][k], m1 = mode[1][k], m2 = mode[2][k], m3 = mode[3][k];
+        double m4 = mode[4][k], m5 = mode[5][k], m6 = mode[6][k], m7 = mode[7][k];
+        double m8 = mode[8][k], m9 = mode[9][k];
+#ifndef OLD_FLUCT
+        double m10 = mode[10][k], m11 = mode[11][k], m12 = mode[12][k], m13 = mode[13][k];
+        double m14 = mode[14][k], m15 = mode[15][k], m16 = mode[16][k], m17 = mode[17][k];
+        double m18 = mode[18][k];
+
+        post[ 0][k] = (m0 - m4 + m16) * w[0];
+        post[ 1][k] = (m0 + m1 + m5 + m6 - m17 - m18 - 2.*(m10 + m16)) * w[1];
+        post[ 2][k] = (m0 - m1 + m5 + m6 - m17 - m18 + 2.*(m10 - m16)) * w[2];
+        post[ 3][k] = (m0 + m2 - m5 + m6 + m17 - m18 - 2.*(m11 + m16)) * w[3];
+        post[ 4][k] = (m0 - m2 - m5 + m6 + m17 - m18 + 2.*(m11 - m16)) * w[4];
+        post[ 5][k] = (m0 + m3 - 2.*(m6 + m12 + m16 - m18)) * w[5];
+        post[ 6][k] = (m0 - m3 - 2.*(m6 - m12 + m16 - m18)) * w[6];
+        post[ 7][k] = (m0 + m1 + m2 + m4 + 2.*m6 + m7 + m10 + m11 + m13 + m14 + m16 + 2.*m18) * w[7];
+        post[ 8][k] = (m0 - m1 - m2 + m4 + 2.*m6 + m7 - m10 - m11 - m13 - m14 + m16 + 2.*m18) * w[8];
+        post[ 9][k] = (m0 + m1 - m2 + m4 + 2.*m6 - m7 + m10 - m11 + m13 - m14 + m16 + 2.*m18) * w[9];
+        post[10][k] = (m0 - m1 + m2 + m4 + 2.*m6 - m7 - m10 + m11 - m13 + m14 + m16 + 2.*m18) * w[10];
+        post[11][k] = (m0 + m1 + m3 + m4 + m5 - m6 + m8 + m10 + m12 - m13 + m15 + m16 + m17 - m18) * w[11];
+        post[12][k] = (m0 - m1 - m3 + m4 + m5 - m6 + m8 - m10 - m12 + m13 - m15 + m16 + m17 - m18) * w[12];
+        post[13][k] = (m0 + m1 - m3 + m4 + m5 - m6 - m8 + m10 - m12 - m13 - m15 + m16 + m17 - m18) * w[13];
+        post[14][k] = (m0 - m1 + m3 + m4 + m5 - m6 - m8 - m10 + m12 + m13 + m15 + m16 + m17 - m18) * w[14];
+        post[15][k] = (m0 + m2 + m3 + m4 - m5 - m6 + m9 + m11 + m12 - m14 - m15 + m16 - m17 - m18) * w[15];
+        post[16][k] = (m0 - m2 - m3 + m4 - m5 - m6 + m9 - m11 - m12 + m14 + m15 + m16 - m17 - m18) * w[16];
+        post[17][k] = (m0 + m2 - m3 + m4 - m5 - m6 - m9 + m11 - m12 - m14 + m15 + m16 - m17 - m18) * w[17];
+        post[18][k] = (m0 - m2 + m3 + m4 - m5 - m6 - m9 - m11 + m12 + m14 - m15 + m16 - m17 - m18) * w[18];
+#else // !OLD_FLUCT
+        post[ 0][k] = (m0 - m4) * w[0];
+        post[ 1][k] = (m0 + m1 + m5 + m6) * w[1];
+        post[ 2][k] = (m0 - m1 + m5 + m6) * w[2];
+        post[ 3][k] = (m0 + m2 - m5 + m6) * w[3];
+        post[ 4][k] = (m0 - m2 - m5 + m6) * w[4];
+        post[ 5][k] = (m0 + m3 - 2.*m6) * w[5];
+        post[ 6][k] = (m0 - m3 - 2.*m6) * w[6];
+        post[ 7][k] = (m0 + m1 + m2 + m4 + 2.*m6 + m7) * w[7];
+        post[ 8][k] = (m0 - m1 - m2 + m4 + 2.*m6 + m7) * w[8];
+        post[ 9][k] = (m0 + m1 - m2 + m4 + 2.*m6 - m7) * w[9];
+        post[10][k] = (m0 - m1 + m2 + m4 + 2.*m6 - m7) * w[10];
+        post[11][k] = (m0 + m1 + m3 + m4 + m5 - m6 + m8) * w[11];
+        post[12][k] = (m0 - m1 - m3 + m4 + m5 - m6 + m8) * w[12];
+        post[13][k] = (m0 + m1 - m3 + m4 + m5 - m6 - m8) * w[13];
+        post[14][k] = (m0 - m1 + m3 + m4 + m5 - m6 - m8) * w[14];
+        post[15][k] = (m0 + m2 + m3 + m4 - m5 - m6 + m9) * w[15];
+        post[16][k] = (m0 - m2 - m3 + m4 - m5 - m6 + m9) * w[16];
+        post[17][k] = (m0 + m2 - m3 + m4 - m5 - m6 - m9) * w[17];
+        post[18][k] = (m0 - m2 + m3 + m4 - m5 - m6 - m9) * w[18];
+#endif // !OLD_FLUCT
+    }
+}
+
+/** Whether the lattice row (y,z) is swept before the row (y0,z0) in
+ *  \ref lb_collide_stream. The rows are swept in tiles of \ref
+ *  LB_TILE_Y rows along y, within a tile plane by plane. */
+inline int lb_row_before(int y, int z, int y0, int z0) {
+    int tile = (y-1)/LB_TILE_Y, tile0 = (y0-1)/LB_TILE_Y;
+    if (tile != tile0) return tile < tile0;
+    if (z != z0) return z < z0;
+    return y < y0;
 }
 
+/** Streaming of a collided run of nodes, see \ref lb_collide_stream.
+ *
+ * @param index      index of the first node of the run
+ * @param x          x coordinate of the first node of the run
+ * @param len        number of nodes in the run
+ * @param row_state  state of the neighbor of a node in the middle of
+ *                   the row, for every velocity
+ * @param post       post-collision populations of the run
+ * @param vectorize  whether the run contains neither boundary nodes
+ *                   nor nodes at the x faces of the local lattice
+ */
+static void lb_stream_run(index_t index, int x, int len, const int *row_state,
+                          double post[19][LB_RUN_LENGTH], int vectorize) {
+    double **n = lbfluid[0];
+    int i, k;
+
+    if (vectorize) {
+        for (k = 0; k < len; k++) n[0][index+k] = post[0][k];
+
+        /* first the populations that go into the halo or wait for
+           their destination, then exchange with the nodes already
+           swept. Within the row, the latter read what the former
+           stored at the node before. */
+        for (i = 1; i < 19; i++) {
+            double *p = post[i];
+            if (row_state[i] == LB_NEIGHBOR_HALO) {
+                double *dest = n[i] + index + lb_next[i];
+                ES_OMP_PRAGMA(omp simd)
+                for (k = 0; k < len; k++) dest[k] = p[k];
+            }
+            else if (row_state[i] == LB_NEIGHBOR_LATER) {
+                double *own = n[lb_reverse[i]] + index;
+                ES_OMP_PRAGMA(omp simd)
+                for (k = 0; k < len; k++) own[k] = p[k];
+            }
+        }
+        for (i = 1; i < 19; i++) {
+            if (row_state[i] == LB_NEIGHBOR_DONE) {
+                double *p = post[i];
+                double *own = n[lb_reverse[i]] + index;
+                double *dest = n[i] + index + lb_next[i];
+                ES_OMP_PRAGMA(omp simd)
+                for (k = 0; k < len; k++) {
+                    own[k] = dest[k];
+                    dest[k] = p[k];
+                }
+            }
+        }
+        return;
+    }
+
+    for (k = 0; k < len; k++, index++) {
+#ifdef LB_BOUNDARIES
+        if (lbfields[index].boundary) {
+            /* fetch what the swept neighbors stored for this node */
+            for (i = 1; i < 19; i++) {
+                int xn = x + k + (int)lbmodel.c[i][0];
+                if (xn > 0 && xn <= lblattice.grid[0] && row_state[i] == LB_NEIGHBOR_DONE)
+                    n[lb_reverse[i]][index] = n[i][index+lb_next[i]];
+            }
+            continue;
+        }
+#endif // LB_BOUNDARIES
+
+        n[0][index] = post[0][k];
+        for (i = 1; i < 19; i++) {
+            int xn = x + k + (int)lbmodel.c[i][0];
+            int state = (xn > 0 && xn <= lblattice.grid[0]) ? row_state[i] : LB_NEIGHBOR_HALO;
+            switch (state) {
+            case LB_NEIGHBOR_HALO:
+                n[i][index+lb_next[i]] = post[i][k];
+                break;
+            case LB_NEIGHBOR_LATER:
+                n[lb_reverse[i]][index] = post[i][k];
+                break;
+            default:
+                n[lb_reverse[i]][index] = n[i][index+lb_next[i]];
+                n[i][index+lb_next[i]] = post[i][k];
+                break;
+            }
+        }
+    }
+}
 
-/* Collisions and streaming (push scheme) */
+/** Collisions and streaming (push scheme).
+ *
+ *  The populations are streamed in place in a single array with the
+ *  swap algorithm of Latt, "How to implement your DdQq dynamics with
+ *  only q variables per node (instead of 2q)" (2007). The nodes are
+ *  swept once. A node is collided with the populations it received
+ *  in the previous step. A post-collision population that goes to a
+ *  node which is swept later is stored in the slot of the opposite
+ *  velocity of the node itself. When the destination node is swept,
+ *  it exchanges this slot with the one the population is going to.
+ *  After the sweep, all populations are at their destination and in
+ *  their natural slot, so outside of the update the layout is the
+ *  same as with two population arrays. Populations going into the
+ *  halo are written there and sent by \ref halo_push_communication.
+ *
+ *  The sweep goes over runs of \ref LB_RUN_LENGTH nodes along x, in
+ *  tiles of \ref LB_TILE_Y rows along y, so that the rows below and
+ *  behind a row are still in the cache when it is streamed.
+ */
 inline void lb_collide_stream() {
     index_t index;
-    int x, y, z;
-    double modes[19];
+    int x, y, z, y0, y1, i, len;
+    int yperiod = lblattice.halo_grid[0];
+    int zperiod = lblattice.halo_grid[0]*lblattice.halo_grid[1];
+    int row_state[19];
+    double post[19][LB_RUN_LENGTH];
 
     /* loop over all lattice cells (halo excluded) */
 #ifdef LB_BOUNDARIES
@@ -2715,8 +2922,8 @@ inline void lb_collide_stream() {
         lb_boundaries[i].force[2]=0.;
     }
 #endif // LB_BOUNDARIES
-  
-  
+
+
 #ifdef IMMERSED_BOUNDARY
 // Safeguard the node forces so that we can later use them for the IBM particle update
 // In the following loop the lbfields[XX].force are reset to zero
@@ -2727,53 +2934,50 @@ inline void lb_collide_stream() {
     lbfields[i].force_buf[2] = lbfields[i].force[2];
   }
 #endif
-  
-  
-  
 
-    index = lblattice.halo_offset;
-    for (z = 1; z <= lblattice.grid[2]; z++) {
-      for (y = 1; y<=lblattice.grid[1]; y++) {
-        for (x = 1; x<=lblattice.grid[0]; x++) {
-          // as we only want to apply this to non-boundary nodes we can throw out the if-clause
-          // if we have a non-bounded domain
+    /* new thermal noise for this update */
+    lb_noise_step++;
+
+    for (i = 0; i < 19; i++)
+        lb_next[i] = (index_t)lbmodel.c[i][0] + (index_t)lbmodel.c[i][1]*yperiod
+            + (index_t)lbmodel.c[i][2]*zperiod;
+
+    for (y0 = 1; y0 <= lblattice.grid[1]; y0 += LB_TILE_Y) {
+      y1 = std::min(y0 + LB_TILE_Y - 1, lblattice.grid[1]);
+      for (z = 1; z <= lblattice.grid[2]; z++) {
+        for (y = y0; y <= y1; y++) {
+
+          for (i = 1; i < 19; i++) {
+            int yn = y + (int)lbmodel.c[i][1], zn = z + (int)lbmodel.c[i][2];
+            if (yn < 1 || yn > lblattice.grid[1] || zn < 1 || zn > lblattice.grid[2])
+              row_state[i] = LB_NEIGHBOR_HALO;
+            else if (yn == y && zn == z)
+              row_state[i] = (lbmodel.c[i][0] > 0) ? LB_NEIGHBOR_LATER : LB_NEIGHBOR_DONE;
+            else
+              row_state[i] = lb_row_before(yn, zn, y, z) ? LB_NEIGHBOR_DONE : LB_NEIGHBOR_LATER;
+          }
+
+          index = get_linear_index(1,y,z,lblattice.halo_grid);
+          for (x = 1; x <= lblattice.grid[0]; x += len, index += len) {
+            int vectorize;
+            /* the nodes at the x faces have neighbors in the halo */
+            if (x == 1 || x == lblattice.grid[0]) {
+              len = 1;
+              vectorize = 0;
+            } else {
+              len = std::min(LB_RUN_LENGTH, lblattice.grid[0] - x);
+              vectorize = 1;
 #ifdef LB_BOUNDARIES
-          if (!lbfields[index].boundary)
+              for (int k = 0; k < len; k++)
+                if (lbfields[index+k].boundary) vectorize = 0;
 #endif // LB_BOUNDARIES
-            {
-
-              /* calculate modes locally */
-              lb_calc_modes(index, modes);
-
-              /* deterministic collisions */
-              lb_relax_modes(index, modes);
-
-              /* fluctuating hydrodynamics */
-              if (fluct) lb_thermalize_modes(index, modes);
-
-              /* apply forces */
-#ifdef EXTERNAL_FORCES
-              lb_apply_forces(index, modes);
-#else // EXTERNAL_FORCES
-              if (lbfields[index].has_force) lb_apply_forces(index, modes);
-#endif // EXTERNAL_FORCES
-
-              /* transform back to populations and streaming */
-              lb_calc_n_from_modes_push(index, modes);
-
             }
-//  #ifdef LB_BOUNDARIES
-//           else {
-//      // Here collision in the boundary nodes
-//      // can be included, if this is necessary
-//             //                     lb_boundary_collisions(index, modes);
-//           }
-// #endif // LB_BOUNDARIES
-                ++index; /* next node */
-            }
-            index += 2; /* skip halo region */
+
+            lb_collide_run(index, x, y, z, len, post);
+            lb_stream_run(index, x, len, row_state, post, vectorize);
+          }
         }
-        index += 2*lblattice.halo_grid[0]; /* skip halo region */
+      }
     }
 
     /* exchange halo regions */
@@ -2784,12 +2988,6 @@ inline void lb_collide_stream() {
     lb_bounce_back();
 #endif // LB_BOUNDARIES
 
-    /* swap the pointers for old and new population fields */
-    double **tmp;
-    tmp = lbfluid[0];
-    lbfluid[0] = lbfluid[1];
-    lbfluid[1] = tmp;
-
     /* halo region is invalid after update */
     lbpar.resend_halo = 1;
 }
@@ -2800,6 +2998,10 @@ inline void lb_stream_collide() {
     index_t index;
     int x, y, z;
     double modes[19];
+    double xi[16][LB_RUN_LENGTH], xi_node[15];
+
+    /* new thermal noise for this update */
+    lb_noise_step++;
 
     /* exchange halo regions */
     halo_communication(&update_halo_comm,(char*)**lbfluid);
@@ -2827,7 +3029,11 @@ inline void lb_stream_collide() {
                     lb_relax_modes(index, modes);
                     
                     /* fluctuating hydrodynamics */
-                    if (fluct) lb_thermalize_modes(index, modes);
+                    if (fluct) {
+                        lb_fluid_noise(x, y, z, 1, xi);
+                        for (int i = 0; i < 15; i++) xi_node[i] = xi[i][0];
+                        lb_thermalize_modes(index, modes, xi_node);
+                    }
                     
                     /* apply forces */
                     if (lbfields[index].has_force) lb_apply_forces(index, modes);
@@ -3250,18 +3456,16 @@ void calc_particle_lattice_ia() {
         np = cell->n ;
         for (int i = 0; i < np; i++) 
           {
-#ifdef GAUSSRANDOM
-            p[i].lc.f_random[0] = lb_coupl_pref2 * gaussian_random();
-            p[i].lc.f_random[1] = lb_coupl_pref2 * gaussian_random();
-            p[i].lc.f_random[2] = lb_coupl_pref2 * gaussian_random();
-#elif defined (GAUSSRANDOMCUT)
-            p[i].lc.f_random[0] = lb_coupl_pref2 * gaussian_random_cut();
-            p[i].lc.f_random[1] = lb_coupl_pref2 * gaussian_random_cut();
-            p[i].lc.f_random[2] = lb_coupl_pref2 * gaussian_random_cut();
+            double xi[4];
+            thermo_noise4(Random::NOISE_LB_COUPLING, thermo_noise_step, p[i].p.identity, xi);
+#if defined (GAUSSRANDOM) || defined (GAUSSRANDOMCUT)
+            p[i].lc.f_random[0] = lb_coupl_pref2 * xi[0];
+            p[i].lc.f_random[1] = lb_coupl_pref2 * xi[1];
+            p[i].lc.f_random[2] = lb_coupl_pref2 * xi[2];
 #elif defined (FLATNOISE)
-            p[i].lc.f_random[0] = lb_coupl_pref * (d_random()-0.5);
-            p[i].lc.f_random[1] = lb_coupl_pref * (d_random()-0.5);
-            p[i].lc.f_random[2] = lb_coupl_pref * (d_random()-0.5);
+            p[i].lc.f_random[0] = lb_coupl_pref * xi[0];
+            p[i].lc.f_random[1] = lb_coupl_pref * xi[1];
+            p[i].lc.f_random[2] = lb_coupl_pref * xi[2];
 #else // GAUSSRANDOM
 #error No noise type defined for the CPU LB
 #endif // GAUSSRANDOM
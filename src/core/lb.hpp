@@ -190,13 +190,17 @@ extern LB_Parameters lbpar;
 extern Lattice lblattice;
 
 /** Pointer to the velocity populations of the fluid.
- * lbfluid[0] contains pre-collision populations, lbfluid[1]
- * contains post-collision populations*/
+ * lbfluid[0] contains pre-collision populations. The push scheme
+ * streams in place, so lbfluid[1] is the same array. With the pull
+ * scheme, lbfluid[1] contains post-collision populations. */
 extern double **lbfluid[2];
 
 /** Pointer to the hydrodynamic fields of the fluid */
 extern LB_FluidNode *lbfields;
 
+/** Counter of the LB updates for the noise of the fluid, see \ref lb_fluid_noise. */
+extern uint64_t lb_noise_step;
+
 /** Switch indicating momentum exchange between particles and fluid */
 extern int transfer_momentum;
 
@@ -60,6 +60,7 @@ void le_dd_init_cell_interactions()
   for(m=0; m<local_cells.n; m++) { 
     dd.cell_inter[m].nList = NULL; 
     dd.cell_inter[m].n_neighbors=0; 
+    init_pairList(&dd.cell_inter[m].vList);
   }
 
   /* loop over non-ghost cells */
@@ -93,7 +94,6 @@ void le_dd_init_cell_interactions()
             if(ind2 >= ind1) {
                 dd.cell_inter[c_cnt].nList[n_cnt].cell_ind = ind2;
                 dd.cell_inter[c_cnt].nList[n_cnt].pList    = &cells[ind2];
-                init_pairList(&dd.cell_inter[c_cnt].nList[n_cnt].vList);
 #ifdef LE_DEBUG
     dd.cell_inter[c_cnt].nList[n_cnt].my_pos[0] = my_left[0] + r * dd.cell_size[0];
     dd.cell_inter[c_cnt].nList[n_cnt].my_pos[1] = my_left[1] + q * dd.cell_size[1];
@@ -34,6 +34,7 @@
 #include "interaction_data.hpp"
 #include "particle_data.hpp"
 #include "mol_cut.hpp"
+#include "threads.hpp"
 
 #ifdef LENNARD_JONES_GENERIC
 
@@ -89,8 +90,11 @@ inline void add_ljgen_pair_force(const Particle * const p1, const Particle * con
       int numfac = 0;
       if (p1->p.configtemp) numfac+=1;
       if (p2->p.configtemp) numfac+=1;
+      /* the pair forces may be calculated by several threads */
+      ES_OMP_PRAGMA(omp atomic)
       configtemp[0] += numfac*SQR(ia_params->LJGEN_eps * (ia_params->LJGEN_b1 * ia_params->LJGEN_a1 * pow(frac, ia_params->LJGEN_a1) 
         - ia_params->LJGEN_b2 * ia_params->LJGEN_a2 * pow(frac, ia_params->LJGEN_a2)) / r_off);
+      ES_OMP_PRAGMA(omp atomic)
       configtemp[1] += numfac* ia_params->LJGEN_eps * (-ia_params->LJGEN_b1 * ia_params->LJGEN_a1 * (ia_params->LJGEN_a1-1) * pow(frac, ia_params->LJGEN_a1) 
         + ia_params->LJGEN_b2 * ia_params->LJGEN_a2 * (ia_params->LJGEN_a2-1) * pow(frac, ia_params->LJGEN_a2)) / (SQR(r_off));
 #endif
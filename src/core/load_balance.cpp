@@ -0,0 +1,204 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file load_balance.cpp
+ *
+ *  Implementation of \ref load_balance.hpp "load_balance.hpp".
+ */
+#include <mpi.h>
+#include <vector>
+#include "load_balance.hpp"
+#include "communication.hpp"
+#include "grid.hpp"
+#include "cells.hpp"
+#include "integrate.hpp"
+#include "interaction_data.hpp"
+#include "lattice.hpp"
+
+/** Imbalance below which the domains are not changed. */
+#define LOAD_BALANCE_THRESHOLD 1.05
+/** Fraction of the distance to the estimated optimal position a
+    boundary is moved per balancing step. */
+#define LOAD_BALANCE_DAMPING 0.5
+/** Minimal domain size in units of the interaction range. */
+#define LOAD_BALANCE_MIN_WIDTH 1.01
+
+int balance_interval = 0;
+double load_imbalance = 1.0;
+
+/** Time of this node in the short range forces since the last measurement. */
+static double force_time = 0.0;
+/** Number of integration steps since the last measurement. */
+static int n_measured_steps = 0;
+
+void load_balance_add_time(double t)
+{
+  force_time += t;
+}
+
+/** Update \ref load_imbalance from the times of all nodes and start a
+    new measurement.
+    @return the time of this node. */
+static double load_balance_measure()
+{
+  double t = force_time, t_max, t_sum;
+
+  MPI_Allreduce(&t, &t_max, 1, MPI_DOUBLE, MPI_MAX, comm_cart);
+  MPI_Allreduce(&t, &t_sum, 1, MPI_DOUBLE, MPI_SUM, comm_cart);
+  load_imbalance = (t_sum > 0) ? t_max*n_nodes/t_sum : 1.0;
+
+  force_time = 0.0;
+  n_measured_steps = 0;
+  return t;
+}
+
+/** Move the boundaries of one direction towards equal load.
+    @param load   load of the n slabs of nodes.
+    @param n      number of nodes in this direction.
+    @param min_w  minimal width of a domain as fraction of the box.
+    @param bound  the n+1 boundaries, updated in place. */
+static void load_balance_place_bounds(const double *load, int n, double min_w,
+                                      std::vector<double> &bound)
+{
+  int j, k;
+  double total = 0;
+  std::vector<double> cumulative(n + 1), target(n + 1);
+
+  if (n < 2 || n*min_w >= 1.0)
+    return;
+
+  cumulative[0] = 0;
+  for (j = 0; j < n; j++)
+    cumulative[j + 1] = (total += load[j]);
+  if (total <= 0)
+    return;
+
+  /* invert the cumulative load, which is piecewise linear in
+     the old boundaries */
+  target[0] = 0.0;
+  target[n] = 1.0;
+  for (k = 1, j = 0; k < n; k++) {
+    double c = total*k/n;
+    while (j < n - 1 && cumulative[j + 1] < c)
+      j++;
+    target[k] = bound[j];
+    if (load[j] > 0)
+      target[k] += (c - cumulative[j])/load[j]*(bound[j + 1] - bound[j]);
+  }
+
+  for (k = 1; k < n; k++)
+    bound[k] += LOAD_BALANCE_DAMPING*(target[k] - bound[k]);
+
+  /* keep the domains larger than the interaction range */
+  for (k = 1; k < n; k++)
+    if (bound[k] < bound[k - 1] + min_w)
+      bound[k] = bound[k - 1] + min_w;
+  for (k = n - 1; k > 0; k--)
+    if (bound[k] > bound[k + 1] - min_w)
+      bound[k] = bound[k + 1] - min_w;
+}
+
+/** Adjust the domains to the load of the last interval.
+    @param t the time of this node. */
+static void load_balance_adjust(double t)
+{
+  int i, k, offset, n_slabs = node_grid[0] + node_grid[1] + node_grid[2];
+  std::vector<double> load(n_slabs, 0.0), bound[3];
+  double *bound_ptr[3];
+
+  /* the load of a slab of nodes is the sum of its nodes */
+  for (i = 0, offset = 0; i < 3; offset += node_grid[i++])
+    load[offset + node_pos[i]] = t;
+  MPI_Allreduce(MPI_IN_PLACE, &load[0], n_slabs, MPI_DOUBLE, MPI_SUM, comm_cart);
+
+  for (i = 0, offset = 0; i < 3; offset += node_grid[i++]) {
+    bound[i].resize(node_grid[i] + 1);
+    for (k = 0; k <= node_grid[i]; k++)
+      bound[i][k] = grid_node_bound(i, k);
+    load_balance_place_bounds(&load[offset], node_grid[i],
+                              LOAD_BALANCE_MIN_WIDTH*max_range/box_l[i], bound[i]);
+    /* all nodes have to use exactly the same boundaries */
+    MPI_Bcast(&bound[i][0], node_grid[i] + 1, MPI_DOUBLE, 0, comm_cart);
+    bound_ptr[i] = &bound[i][0];
+  }
+
+  grid_set_node_bounds(bound_ptr);
+  grid_changed_box_l();
+  /* redistributes the particles */
+  cells_on_geometry_change(CELL_FLAG_GRIDCHANGED);
+}
+
+void load_balance_step()
+{
+  n_measured_steps++;
+  if (balance_interval <= 0 || n_measured_steps < balance_interval)
+    return;
+
+  double t = load_balance_measure();
+  if (load_imbalance > LOAD_BALANCE_THRESHOLD && load_balance_possible())
+    load_balance_adjust(t);
+}
+
+void load_balance_finish()
+{
+  if (n_measured_steps > 0)
+    load_balance_measure();
+}
+
+int load_balance_possible()
+{
+  if (cell_structure.type != CELL_STRUCTURE_DOMDEC)
+    return 0;
+#ifdef LEES_EDWARDS
+  return 0;
+#endif
+  if (lattice_switch != LATTICE_OFF)
+    return 0;
+#ifdef ELECTROSTATICS
+  switch (coulomb.method) {
+  case COULOMB_NONE:
+  case COULOMB_DH:
+  case COULOMB_RF:
+  case COULOMB_INTER_RF:
+    break;
+  default:
+    return 0;
+  }
+#endif
+#ifdef DIPOLES
+  switch (coulomb.Dmethod) {
+  case DIPOLAR_NONE:
+  case DIPOLAR_ALL_WITH_ALL_AND_NO_REPLICA:
+  case DIPOLAR_DS:
+    break;
+  default:
+    return 0;
+  }
+#endif
+  return 1;
+}
+
+void load_balance_check()
+{
+  if (grid_uniform || (balance_interval > 0 && load_balance_possible()))
+    return;
+
+  grid_reset_node_bounds();
+  grid_changed_box_l();
+  cells_on_geometry_change(CELL_FLAG_GRIDCHANGED);
+}
@@ -0,0 +1,80 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef LOAD_BALANCE_H
+#define LOAD_BALANCE_H
+/** \file load_balance.hpp
+ *
+ *  Dynamic load balancing of the domain decomposition.
+ *
+ *  The time every node spends in the short range forces is measured
+ *  during the integration. The ratio of the maximal to the average
+ *  time is the load imbalance (\ref load_imbalance). Every \ref
+ *  balance_interval steps, the boundaries between the node domains
+ *  are moved such that the measured load is distributed equally.
+ *
+ *  The domains remain a rectilinear grid, i.e. all nodes with the same
+ *  \ref node_pos[dir] share the boundaries in direction dir, see \ref
+ *  grid_set_node_bounds. Each boundary plane is placed using the load
+ *  of the slabs of nodes in between, assuming that the load is
+ *  distributed evenly within a slab. The boundaries are only moved
+ *  half way to their estimated optimum to avoid oscillations, and no
+ *  domain becomes smaller than the interaction range. After moving
+ *  the boundaries, the cell system is re-initialized, which migrates
+ *  the particles to their new nodes.
+ *
+ *  The long range methods and the lattice algorithms assume equally
+ *  sized domains, so that the balancing is only done if none of them
+ *  is used, see \ref load_balance_possible.
+ */
+#include "config.hpp"
+
+/** Number of integration steps between two load balancing steps
+    (setmd balance_interval). 0, the default, switches the balancing
+    off and restores equally sized domains. */
+extern int balance_interval;
+
+/** Load imbalance of the short range forces during the last balancing
+    interval or the last integration, the maximal time of a node
+    divided by the average time (setmd load_imbalance, read-only). */
+extern double load_imbalance;
+
+/** Add the time spent in the short range forces of this node, called
+    from \ref force_calc. */
+void load_balance_add_time(double t);
+
+/** Called after each integration step. Every \ref balance_interval
+    steps, the domains are adjusted to the measured load. Has to be
+    called on all nodes. */
+void load_balance_step();
+
+/** Called at the end of the integration. Updates \ref load_imbalance
+    from the time measured since the last balancing step. Has to be
+    called on all nodes. */
+void load_balance_finish();
+
+/** Whether the node domains may have different sizes with the current
+    cell structure and long range methods. */
+int load_balance_possible();
+
+/** Return to equally sized node domains if these are required, i.e.
+    if the balancing is switched off or not possible. Has to be called
+    on all nodes. */
+void load_balance_check();
+
+#endif
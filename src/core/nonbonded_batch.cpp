@@ -0,0 +1,465 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file nonbonded_batch.cpp
+ *
+ *  Implementation of \ref nonbonded_batch.hpp "nonbonded_batch.hpp".
+ */
+#include <mpi.h>
+#include <vector>
+#include "utils.hpp"
+#include "nonbonded_batch.hpp"
+#include "cells.hpp"
+#include "domain_decomposition.hpp"
+#include "forces_inline.hpp"
+#include "integrate.hpp"
+#include "thermostat.hpp"
+#include "collision.hpp"
+
+/* The AVX and AVX-512 kernels are compiled with function target
+   attributes independent of the build flags and chosen at runtime. */
+#if defined(NONBONDED_BATCH_KERNEL) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NONBONDED_BATCH_X86
+#include <immintrin.h>
+#endif
+
+int nonbonded_batch = 1;
+
+int nonbonded_batch_eligible(IA_parameters *data)
+{
+#ifdef NONBONDED_BATCH_KERNEL
+  int covered = 0;
+
+#ifdef LENNARD_JONES
+  if (data->LJ_cut > 0.0)
+    covered = 1;
+#endif
+#ifdef LJCOS
+  if (data->LJCOS_cut > 0.0)
+    covered = 1;
+#endif
+#ifdef SOFT_SPHERE
+  if (data->soft_cut > 0.0)
+    covered = 1;
+#endif
+
+  if (!covered)
+    return 0;
+
+  /* any other active potential sends the pair down the scalar path */
+#ifdef INTER_DPD
+  if (data->dpd_r_cut > 0.0 || data->dpd_tr_cut > 0.0)
+    return 0;
+#endif
+#ifdef LENNARD_JONES_GENERIC
+  if (data->LJGEN_cut > 0.0)
+    return 0;
+#endif
+#ifdef LJ_ANGLE
+  if (data->LJANGLE_cut > 0.0)
+    return 0;
+#endif
+#ifdef SMOOTH_STEP
+  if (data->SmSt_cut > 0.0)
+    return 0;
+#endif
+#ifdef HERTZIAN
+  if (data->Hertzian_sig > 0.0)
+    return 0;
+#endif
+#ifdef GAUSSIAN
+  if (data->Gaussian_cut > 0.0)
+    return 0;
+#endif
+#ifdef BMHTF_NACL
+  if (data->BMHTF_cut > 0.0)
+    return 0;
+#endif
+#ifdef MORSE
+  if (data->MORSE_cut > 0.0)
+    return 0;
+#endif
+#ifdef BUCKINGHAM
+  if (data->BUCK_cut > 0.0)
+    return 0;
+#endif
+#ifdef AFFINITY
+  if (data->affinity_cut > 0.0)
+    return 0;
+#endif
+#ifdef MEMBRANE_COLLISION
+  if (data->membrane_cut > 0.0)
+    return 0;
+#endif
+#ifdef HAT
+  if (data->HAT_r > 0.0)
+    return 0;
+#endif
+#ifdef LJCOS2
+  if (data->LJCOS2_cut > 0.0)
+    return 0;
+#endif
+#ifdef GAY_BERNE
+  if (data->GB_cut > 0.0)
+    return 0;
+#endif
+#ifdef TABULATED
+  if (data->TAB_maxval > 0.0)
+    return 0;
+#endif
+#ifdef INTER_RF
+  if (data->rf_on)
+    return 0;
+#endif
+
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+int nonbonded_batch_active()
+{
+#ifdef NONBONDED_BATCH_KERNEL
+  if (!nonbonded_batch)
+    return 0;
+#ifdef COLLISION_DETECTION
+  if (collision_params.mode > 0)
+    return 0;
+#endif
+#ifdef DPD
+  if (thermo_switch & THERMO_DPD)
+    return 0;
+#endif
+#ifdef NPT
+  if (integ_switch == INTEG_METHOD_NPT_ISO)
+    return 0;
+#endif
+#ifdef DP3M
+  if (coulomb.Dmethod == DIPOLAR_P3M || coulomb.Dmethod == DIPOLAR_MDLC_P3M)
+    return 0;
+#endif
+#ifdef MULTI_TIMESTEP
+  if (smaller_time_step > 0.)
+    return 0;
+#endif
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+#ifdef NONBONDED_BATCH_KERNEL
+
+#ifdef LENNARD_JONES
+#ifdef NONBONDED_BATCH_X86
+/** AVX-512 part of \ref lj_batch_kernel, 8 pairs at a time. Returns
+    the number of pairs done. */
+__attribute__((target("avx512f")))
+static int lj_batch_kernel_avx512(int n, const double *dist,
+                                  const double *cut, const double *min,
+                                  const double *offset, const double *cap,
+                                  const double *sig, const double *eps,
+                                  double *fac)
+{
+  int k = 0;
+  const __m512d c48 = _mm512_set1_pd(48.0);
+  const __m512d half = _mm512_set1_pd(0.5);
+  for (; k + 8 <= n; k += 8) {
+    const __m512d r = _mm512_loadu_pd(dist + k);
+    const __m512d r_off = _mm512_max_pd(_mm512_sub_pd(r, _mm512_loadu_pd(offset + k)),
+                                        _mm512_loadu_pd(cap + k));
+    const __m512d s = _mm512_div_pd(_mm512_loadu_pd(sig + k), r_off);
+    const __m512d frac2 = _mm512_mul_pd(s, s);
+    const __m512d frac6 = _mm512_mul_pd(_mm512_mul_pd(frac2, frac2), frac2);
+    const __m512d num = _mm512_mul_pd(_mm512_mul_pd(_mm512_mul_pd(c48, _mm512_loadu_pd(eps + k)), frac6),
+                                      _mm512_sub_pd(frac6, half));
+    const __m512d f = _mm512_div_pd(num, _mm512_mul_pd(r_off, r));
+    const __mmask8 in = _mm512_cmp_pd_mask(r, _mm512_loadu_pd(cut + k), _CMP_LT_OQ)
+      & _mm512_cmp_pd_mask(r, _mm512_loadu_pd(min + k), _CMP_GT_OQ);
+    _mm512_storeu_pd(fac + k, _mm512_maskz_mov_pd(in, f));
+  }
+  return k;
+}
+
+/** AVX part of \ref lj_batch_kernel, 4 pairs at a time. Returns the
+    number of pairs done. */
+__attribute__((target("avx")))
+static int lj_batch_kernel_avx(int n, const double *dist,
+                               const double *cut, const double *min,
+                               const double *offset, const double *cap,
+                               const double *sig, const double *eps,
+                               double *fac)
+{
+  int k = 0;
+  const __m256d c48 = _mm256_set1_pd(48.0);
+  const __m256d half = _mm256_set1_pd(0.5);
+  for (; k + 4 <= n; k += 4) {
+    const __m256d r = _mm256_loadu_pd(dist + k);
+    const __m256d r_off = _mm256_max_pd(_mm256_sub_pd(r, _mm256_loadu_pd(offset + k)),
+                                        _mm256_loadu_pd(cap + k));
+    const __m256d s = _mm256_div_pd(_mm256_loadu_pd(sig + k), r_off);
+    const __m256d frac2 = _mm256_mul_pd(s, s);
+    const __m256d frac6 = _mm256_mul_pd(_mm256_mul_pd(frac2, frac2), frac2);
+    const __m256d num = _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(c48, _mm256_loadu_pd(eps + k)), frac6),
+                                      _mm256_sub_pd(frac6, half));
+    const __m256d f = _mm256_div_pd(num, _mm256_mul_pd(r_off, r));
+    const __m256d in = _mm256_and_pd(_mm256_cmp_pd(r, _mm256_loadu_pd(cut + k), _CMP_LT_OQ),
+                                     _mm256_cmp_pd(r, _mm256_loadu_pd(min + k), _CMP_GT_OQ));
+    _mm256_storeu_pd(fac + k, _mm256_and_pd(in, f));
+  }
+  return k;
+}
+
+/** Widest vector instruction set of the CPU the LJ kernel can use:
+    2 for AVX-512, 1 for AVX, 0 for none. */
+static int lj_batch_detect_simd()
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return 2;
+  if (__builtin_cpu_supports("avx"))
+    return 1;
+  return 0;
+}
+#endif
+
+/** Lennard-Jones force factors of \a n pairs, see \ref add_lj_pair_force.
+    The capped part is folded into the normal one by taking the
+    distance as at least the cap radius. Pairs outside of
+    [min, cut] (both including the offset) get a zero factor. */
+static void lj_batch_kernel(int n, const double *dist,
+                            const double *cut, const double *min,
+                            const double *offset, const double *cap,
+                            const double *sig, const double *eps,
+                            double *fac)
+{
+  int k = 0;
+
+#ifdef NONBONDED_BATCH_X86
+  /* detected once, the initialization is thread safe */
+  static const int simd = lj_batch_detect_simd();
+  if (simd == 2)
+    k = lj_batch_kernel_avx512(n, dist, cut, min, offset, cap, sig, eps, fac);
+  else if (simd == 1)
+    k = lj_batch_kernel_avx(n, dist, cut, min, offset, cap, sig, eps, fac);
+#endif
+
+  /* scalar fallback and remainder */
+  for (; k < n; k++) {
+    const double r_off = std::max(dist[k] - offset[k], cap[k]);
+    const double frac2 = SQR(sig[k]/r_off);
+    const double frac6 = frac2*frac2*frac2;
+    const double f = 48.0 * eps[k] * frac6*(frac6 - 0.5) / (r_off * dist[k]);
+    fac[k] = (dist[k] < cut[k] && dist[k] > min[k]) ? f : 0.0;
+  }
+}
+#endif
+
+#ifdef SOFT_SPHERE
+/** Soft-sphere force factors of \a n pairs, see \ref add_soft_pair_force. */
+static void soft_batch_kernel(int n, const double *dist,
+                              const double *cut, const double *offset,
+                              const double *a, const double *exponent,
+                              double *fac)
+{
+  for (int k = 0; k < n; k++) {
+    const double r_off = dist[k] - offset[k];
+    fac[k] = (dist[k] < cut[k] && r_off > 0.0) ?
+      soft_force_r(a[k], exponent[k], r_off)/dist[k] : 0.0;
+  }
+}
+#endif
+
+#ifdef LJCOS
+/** LJ-cos force factors of \a n pairs, see \ref add_ljcos_pair_force. */
+static void ljcos_batch_kernel(int n, const double *dist,
+                               const double *cut, const double *rmin,
+                               const double *offset, const double *alfa,
+                               const double *beta, const double *sig,
+                               const double *eps, double *fac)
+{
+  for (int k = 0; k < n; k++) {
+    const double r_off = dist[k] - offset[k];
+    if (!(dist[k] < cut[k]))
+      fac[k] = 0.0;
+    else if (dist[k] > rmin[k])
+      fac[k] = (r_off/dist[k]) * alfa[k] * eps[k] * sin(alfa[k] * SQR(r_off) + beta[k]);
+    else {
+      const double frac2 = SQR(sig[k]/r_off);
+      const double frac6 = frac2*frac2*frac2;
+      fac[k] = 48.0 * eps[k] * frac6*(frac6 - 0.5) / (r_off * dist[k]);
+    }
+  }
+}
+#endif
+
+/** Add fac * d to the force accumulators of the batch. */
+static void batch_add_forces(int n, const NonbondedBatch *b, const double *fac,
+                             double f[3][NONBONDED_BATCH_SIZE])
+{
+  for (int j = 0; j < 3; j++)
+    for (int k = 0; k < n; k++)
+      f[j][k] += fac[k] * b->d[j][k];
+}
+
+#endif
+
+void nonbonded_batch_flush(NonbondedBatch *b)
+{
+#ifdef NONBONDED_BATCH_KERNEL
+  const int n = b->n;
+  /* lane arrays for the parameters, gathered from the IA_parameters */
+  double prm[7][NONBONDED_BATCH_SIZE];
+  double dist[NONBONDED_BATCH_SIZE], fac[NONBONDED_BATCH_SIZE];
+  double f[3][NONBONDED_BATCH_SIZE];
+  int k, j;
+
+  for (k = 0; k < n; k++)
+    dist[k] = sqrt(b->dist2[k]);
+  for (j = 0; j < 3; j++)
+    for (k = 0; k < n; k++)
+      f[j][k] = 0.0;
+
+  /* same order of the potentials as in calc_non_bonded_pair_force_parts */
+#ifdef LENNARD_JONES
+  for (k = 0; k < n; k++) {
+    const IA_parameters *ia = b->ia[k];
+    prm[0][k] = ia->LJ_cut + ia->LJ_offset;
+    prm[1][k] = ia->LJ_min + ia->LJ_offset;
+    prm[2][k] = ia->LJ_offset;
+    prm[3][k] = ia->LJ_capradius;
+    prm[4][k] = ia->LJ_sig;
+    prm[5][k] = ia->LJ_eps;
+  }
+  lj_batch_kernel(n, dist, prm[0], prm[1], prm[2], prm[3], prm[4], prm[5], fac);
+  batch_add_forces(n, b, fac, f);
+#endif
+
+#ifdef SOFT_SPHERE
+  for (k = 0; k < n; k++) {
+    const IA_parameters *ia = b->ia[k];
+    prm[0][k] = ia->soft_cut + ia->soft_offset;
+    prm[1][k] = ia->soft_offset;
+    prm[2][k] = ia->soft_a;
+    prm[3][k] = ia->soft_n;
+  }
+  soft_batch_kernel(n, dist, prm[0], prm[1], prm[2], prm[3], fac);
+  batch_add_forces(n, b, fac, f);
+#endif
+
+#ifdef LJCOS
+  for (k = 0; k < n; k++) {
+    const IA_parameters *ia = b->ia[k];
+    prm[0][k] = ia->LJCOS_cut + ia->LJCOS_offset;
+    prm[1][k] = ia->LJCOS_rmin + ia->LJCOS_offset;
+    prm[2][k] = ia->LJCOS_offset;
+    prm[3][k] = ia->LJCOS_alfa;
+    prm[4][k] = ia->LJCOS_beta;
+    prm[5][k] = ia->LJCOS_sig;
+    prm[6][k] = ia->LJCOS_eps;
+  }
+  ljcos_batch_kernel(n, dist, prm[0], prm[1], prm[2], prm[3], prm[4], prm[5], prm[6], fac);
+  batch_add_forces(n, b, fac, f);
+#endif
+
+  /* scatter */
+  for (k = 0; k < n; k++) {
+    Particle *p1 = b->p1[k], *p2 = b->p2[k];
+    for (j = 0; j < 3; j++) {
+      p1->f.f[j] += f[j][k];
+      p2->f.f[j] -= f[j][k];
+    }
+  }
+#endif
+
+  b->n = 0;
+}
+
+/** Sweep once over the pairs of the local Verlet lists. */
+static void benchmark_sweep(int batched)
+{
+  NonbondedBatch batch;
+  double dist2, vec21[3];
+
+  batch.n = 0;
+  for (int c = 0; c < local_cells.n; c++) {
+    const IA_Neighbor_List *il = &dd.cell_inter[c];
+    const PairList *pl = &il->vList;
+    Particle *p1 = local_cells.cell[c]->part;
+    for (int i = 0; i < pl->np; i++) {
+      for (int k = pl->start[i]; k < pl->start[i+1]; k++) {
+        Particle *p2 = dd_pair_partner(il, pl->partner[k]);
+        dist2 = distance2vec(p1[i].r.p, p2->r.p, vec21);
+        if (batched) {
+          IA_parameters *ia = get_ia_param(p1[i].p.type, p2->p.type);
+          if (nonbonded_batch_accepts(&p1[i], p2, ia, dist2)) {
+            nonbonded_batch_add(&batch, &p1[i], p2, ia, vec21, dist2);
+            continue;
+          }
+        }
+        add_non_bonded_pair_force(&p1[i], p2, vec21, sqrt(dist2), dist2);
+      }
+    }
+  }
+  nonbonded_batch_flush(&batch);
+}
+
+int nonbonded_batch_benchmark(int rounds, int *n_pairs,
+                              double *t_scalar, double *t_batch)
+{
+  std::vector<double> forces;
+  int c, i, j;
+
+  if (cell_structure.type != CELL_STRUCTURE_DOMDEC || !dd.use_vList)
+    return ES_ERROR;
+
+  *n_pairs = 0;
+  for (c = 0; c < local_cells.n; c++)
+    *n_pairs += dd.cell_inter[c].vList.n;
+
+  /* the sweeps add to the forces, so keep the real ones */
+  for (c = 0; c < local_cells.n; c++)
+    for (i = 0; i < local_cells.cell[c]->n; i++)
+      for (j = 0; j < 3; j++)
+        forces.push_back(local_cells.cell[c]->part[i].f.f[j]);
+
+  double tick = MPI_Wtime();
+  for (i = 0; i < rounds; i++)
+    benchmark_sweep(0);
+  *t_scalar = (MPI_Wtime() - tick)/rounds;
+
+  /* time the kernel independent of the switch */
+  const int saved = nonbonded_batch;
+  nonbonded_batch = 1;
+  const int batched = nonbonded_batch_active();
+  nonbonded_batch = saved;
+
+  tick = MPI_Wtime();
+  for (i = 0; i < rounds; i++)
+    benchmark_sweep(batched);
+  *t_batch = (MPI_Wtime() - tick)/rounds;
+
+  std::vector<double>::const_iterator it = forces.begin();
+  for (c = 0; c < local_cells.n; c++)
+    for (i = 0; i < local_cells.cell[c]->n; i++)
+      for (j = 0; j < 3; j++)
+        local_cells.cell[c]->part[i].f.f[j] = *it++;
+
+  return ES_OK;
+}
@@ -0,0 +1,153 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NONBONDED_BATCH_H
+#define NONBONDED_BATCH_H
+/** \file nonbonded_batch.hpp
+ *
+ *  Batched evaluation of the simple non-bonded pair potentials
+ *  (Lennard-Jones, LJ-cos and soft-sphere).
+ *
+ *  Instead of running every Verlet pair through the full chain of
+ *  potentials in \ref add_non_bonded_pair_force, pairs whose type
+ *  combination only uses potentials covered here are collected into
+ *  a \ref NonbondedBatch. When the batch is full (or at the end of
+ *  the pair loop), the force factors are computed lane-wise on
+ *  contiguous arrays. On x86 with GCC compatible compilers the
+ *  Lennard-Jones kernel is built for AVX-512 (8 pairs) and AVX (4
+ *  pairs) irrespective of the build flags, and the widest set the CPU
+ *  supports is chosen at runtime. Other CPUs and the remainder use a
+ *  scalar loop. The results are identical to the per-pair code path up
+ *  to rounding.
+ *
+ *  Whether a type pair is eligible is decided once per change of the
+ *  interactions in \ref nonbonded_batch_eligible and stored in
+ *  \ref IA_parameters::batchKernel. Features that hook into the pair
+ *  loop (collision detection, DPD, NpT virial, dipolar P3M,
+ *  multi-timestepping) disable the batch at runtime, see \ref
+ *  nonbonded_batch_active.
+ *
+ *  The batch can be switched off with the global variable
+ *  \ref nonbonded_batch.
+ */
+#include "config.hpp"
+#include "particle_data.hpp"
+#include "interaction_data.hpp"
+
+#if (defined(LENNARD_JONES) || defined(LJCOS) || defined(SOFT_SPHERE)) \
+  && !defined(SHANCHEN) && !defined(CONFIGTEMP) && !defined(LJ_WARN_WHEN_CLOSE) \
+  && !defined(NO_INTRA_NB) && !defined(MOL_CUT)
+/** The batched kernel is available in this configuration. */
+#define NONBONDED_BATCH_KERNEL
+#endif
+
+/** Number of pairs collected before the kernel is evaluated. */
+#define NONBONDED_BATCH_SIZE 64
+
+/** Pairs waiting for the batched force evaluation. The distance
+    vectors are stored component-wise so that the kernels can load
+    several pairs at once. */
+typedef struct {
+  /** Number of pairs in the batch */
+  int n;
+  /** First particles of the pairs */
+  Particle *p1[NONBONDED_BATCH_SIZE];
+  /** Second particles of the pairs */
+  Particle *p2[NONBONDED_BATCH_SIZE];
+  /** Interaction parameters of the pairs */
+  IA_parameters *ia[NONBONDED_BATCH_SIZE];
+  /** Distance vectors p1 - p2 */
+  double d[3][NONBONDED_BATCH_SIZE];
+  /** Squared distances */
+  double dist2[NONBONDED_BATCH_SIZE];
+} NonbondedBatch;
+
+/** Switch for the batched kernel (1 = use it where possible, the default). */
+extern int nonbonded_batch;
+
+/** Decide whether the non-bonded interactions of a type pair are
+    completely covered by the batched kernel.
+    Called from \ref recalc_maximal_cutoff.
+    @return 1 if the pair can be handled by \ref nonbonded_batch_flush. */
+int nonbonded_batch_eligible(IA_parameters *data);
+
+/** Check the global state that decides whether the batch may be used
+    in the current force calculation, i.e. \ref nonbonded_batch is
+    set and nothing else hooks into the pair loop. */
+int nonbonded_batch_active();
+
+/** Evaluate the forces of all pairs in the batch, add them to the
+    particles and empty the batch. */
+void nonbonded_batch_flush(NonbondedBatch *b);
+
+/** Time the pair force loop over the local Verlet lists, once through
+    \ref add_non_bonded_pair_force and once through the batched kernel.
+    Only uses the data of this node and leaves the forces unchanged.
+    @param rounds   number of sweeps over the Verlet lists.
+    @param n_pairs  returns the number of pairs per sweep.
+    @param t_scalar returns the time per sweep of the scalar loop in s.
+    @param t_batch  returns the time per sweep of the batched loop in s.
+    @return ES_OK, or ES_ERROR if there are no Verlet lists. */
+int nonbonded_batch_benchmark(int rounds, int *n_pairs,
+                              double *t_scalar, double *t_batch);
+
+/** Check whether a pair can go into the batch.
+    @param p1    particle 1.
+    @param p2    particle 2.
+    @param ia    interaction parameters of the pair.
+    @param dist2 squared distance of the pair.
+*/
+inline int nonbonded_batch_accepts(const Particle *p1, const Particle *p2,
+                                   const IA_parameters *ia, double dist2)
+{
+  if (!ia->batchKernel || dist2 == 0.0)
+    return 0;
+#ifdef ELECTROSTATICS
+  /* real space electrostatics are only handled by the scalar path */
+  if (coulomb.method != COULOMB_NONE && p1->p.q*p2->p.q != 0.0)
+    return 0;
+#endif
+  return 1;
+}
+
+/** Append a pair to the batch, evaluating the batch if it is full.
+    @param b     the batch.
+    @param p1    particle 1.
+    @param p2    particle 2.
+    @param ia    interaction parameters of the pair.
+    @param d     distance vector p1 - p2.
+    @param dist2 squared distance of the pair.
+*/
+inline void nonbonded_batch_add(NonbondedBatch *b, Particle *p1, Particle *p2,
+                                IA_parameters *ia, const double d[3], double dist2)
+{
+  const int k = b->n;
+
+  b->p1[k] = p1;
+  b->p2[k] = p2;
+  b->ia[k] = ia;
+  b->d[0][k] = d[0];
+  b->d[1][k] = d[1];
+  b->d[2][k] = d[2];
+  b->dist2[k] = dist2;
+
+  if (++b->n == NONBONDED_BATCH_SIZE)
+    nonbonded_batch_flush(b);
+}
+
+#endif
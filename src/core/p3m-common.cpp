@@ -41,6 +41,7 @@ void p3m_common_parameter_pre_init(p3m_parameter_struct *params) {
   params->inter2 = 0;
   params->accuracy = 0.0;
   params->epsilon = P3M_EPSILON;
+  params->diff = P3M_DIFF_IK;
   params->cao_cut[0] = 0.0;
   params->cao_cut[1] = 0.0;
   params->cao_cut[2] = 0.0;
@@ -222,4 +223,10 @@ double p3m_caf(int i, double x, int cao_value) {
     return 0.0;
   }}}
 }
+
+double p3m_caf_derivative(int i, double x, int cao_value) {
+  if (cao_value == 1) return 0.0;
+  return ((i > 0)           ? p3m_caf(i-1, x, cao_value-1) : 0.0)
+    -    ((i < cao_value-1) ? p3m_caf(i,   x, cao_value-1) : 0.0);
+}
 #endif /* defined(P3M) || defined(DP3M) */
@@ -57,6 +57,18 @@
 /** This value for p3m.epsilon indicates metallic boundary conditions. */
 #define P3M_EPSILON_METALLIC 0.0
 
+/** \name Differentiation schemes for the mesh forces
+    (\ref p3m_parameter_struct::diff). */
+/*@{*/
+/** i*k differentiation in k-space, one back FFT per force component. */
+#define P3M_DIFF_IK 0
+/** analytical differentiation of the charge assignment function,
+    a single back FFT of the potential mesh. */
+#define P3M_DIFF_AD 1
+/** only for tuning: let \ref p3m_adaptive_tune choose the scheme. */
+#define P3M_DIFF_TUNE 2
+/*@}*/
+
 /** increment size of charge assignment fields. */
 #define CA_INCREMENT 32       
 /** precision limit for the r_cut zero */
@@ -141,6 +153,9 @@ typedef struct {
 
   /** epsilon of the "surrounding dielectric". */
   double epsilon;
+  /** differentiation scheme of the mesh forces (\ref P3M_DIFF_IK or
+      \ref P3M_DIFF_AD). Only used for charges. */
+  int    diff;
   /** Cutoff for charge assignment. */
   double cao_cut[3];
   /** mesh constant. */
@@ -197,6 +212,11 @@ double p3m_analytic_cotangent_sum(int n, double mesh_i, int cao);
     at value \a x. */
 double p3m_caf(int i, double x,int cao_value);
 
+/** Computes the derivative of the assignment function of the \a i'th
+    degree with respect to \a x, which is the difference of two
+    assignment functions of order \a cao_value-1. */
+double p3m_caf_derivative(int i, double x, int cao_value);
+
 #endif /* P3M || DP3M */
 
 #endif /* _P3M_COMMON_H */
@@ -434,7 +434,8 @@ double dp3m_average_dipolar_self_energy(double box_l, int mesh) {
 	  node_phi += 0.0;
 	else {
 		  U2 = dp3m_perform_aliasing_sums_dipolar_self_energy(n);
-		  node_phi += dp3m.g_energy[ind] * U2*(SQR(dp3m.d_op[n[0]])+SQR(dp3m.d_op[n[1]])+SQR(dp3m.d_op[n[2]]));
+		  node_phi += fft_hermitian_weight(n[dfft.ks_half_dir], dfft.ks_half_mesh)
+		    * dp3m.g_energy[ind] * U2*(SQR(dp3m.d_op[n[0]])+SQR(dp3m.d_op[n[1]])+SQR(dp3m.d_op[n[2]]));
 	}
       }}}
   
@@ -933,7 +934,9 @@ double dp3m_calc_kspace_forces(int force_flag, int energy_flag)
     for(j[0]=0; j[0]<dfft.plan[3].new_mesh[0]; j[0]++) {
       for(j[1]=0; j[1]<dfft.plan[3].new_mesh[1]; j[1]++) {
 	for(j[2]=0; j[2]<dfft.plan[3].new_mesh[2]; j[2]++) {
-	  node_k_space_energy_dip += dp3m.g_energy[i] * (
+	  /* only half of the hermitian k-space mesh is stored */
+	  node_k_space_energy_dip += fft_hermitian_weight(j[dfft.ks_half_dir]+dfft.plan[3].start[dfft.ks_half_dir], dfft.ks_half_mesh)
+	    * dp3m.g_energy[i] * (
 	  SQR(dp3m.rs_mesh_dip[0][ind]*dp3m.d_op[j[2]+dfft.plan[3].start[2]]+
 	      dp3m.rs_mesh_dip[1][ind]*dp3m.d_op[j[0]+dfft.plan[3].start[0]]+
 	      dp3m.rs_mesh_dip[2][ind]*dp3m.d_op[j[1]+dfft.plan[3].start[1]]
@@ -22,6 +22,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 #include "utils.hpp"
 #include "integrate.hpp"
@@ -167,7 +168,8 @@ static void p3m_calc_differential_operator(void);
  *
  *  See also: Hockney/Eastwood 8-22 (p275). Note the somewhat
  *  different convention for the prefactors, which is described in
- *  Deserno/Holm. */
+ *  Deserno/Holm. For ad differentiation, the optimal influence
+ *  function of Ballenegger/Cerda/Holm is used instead. */
 static void p3m_calc_influence_function_force(void);
 
 /** Calculates the influence function optimized for the energy and the
@@ -210,22 +212,26 @@ static double p3m_real_space_error(double prefac, double r_cut_iL, int n_c_part,
     P3M method in the book of Hockney and Eastwood (Eqn. 8.23) in
     order to obtain the rms error in the force for a system of N
     randomly distributed particles in a cubic box (k space part).
+    For ad differentiation the corresponding estimate of Ballenegger,
+    Cerda and Holm (J. Chem. Theory Comput. 8, 936 (2012)) is used.
     \param prefac   Prefactor of coulomb interaction.
     \param mesh     number of mesh points in one direction.
     \param cao      charge assignment order.
     \param n_c_part number of charged particles in the system.
     \param sum_q2   sum of square of charges in the system
     \param alpha_L  rescaled ewald splitting parameter.
+    \param diff     differentiation scheme (\ref P3M_DIFF_IK or \ref P3M_DIFF_AD).
     \return reciprocal (k) space error
 */
-static double p3m_k_space_error(double prefac, int mesh[3], int cao, int n_c_part, double sum_q2, double alpha_L);
+static double p3m_k_space_error(double prefac, int mesh[3], int cao, int n_c_part, double sum_q2, double alpha_L, int diff);
 
 
 
-/** aliasing sum used by \ref p3m_k_space_error. */
+/** aliasing sum used by \ref p3m_k_space_error. alias3 and alias4
+    are only needed for ad differentiation. */
 static void p3m_tune_aliasing_sums(int nx, int ny, int nz, 
 			    int mesh[3], double mesh_i[3], int cao, double alpha_L_i, 
-			    double *alias1, double *alias2);
+			    double *alias1, double *alias2, double *alias3, double *alias4);
 
 /** Template parameterized calculation of the charge assignment to be called by wrapper. 
     \param cao      charge assignment order.
@@ -251,8 +257,10 @@ void p3m_pre_init(void) {
   p3m.sum_q2 = 0.0;
   p3m.square_sum_q = 0.0;
 
-  for (int i = 0; i < 7; i++)
+  for (int i = 0; i < 7; i++) {
     p3m.int_caf[i] = NULL;
+    p3m.int_dcaf[i] = NULL;
+  }
   p3m.pos_shift = 0.0;
   p3m.meshift_x = NULL;
   p3m.meshift_y = NULL;
@@ -263,6 +271,8 @@ void p3m_pre_init(void) {
   p3m.d_op[2] = NULL;
   p3m.g_force = NULL;
   p3m.g_energy = NULL;
+  p3m.ad_self_green = NULL;
+  p3m.ad_self_green_valid = 0;
 
 #ifdef P3M_STORE_CA_FRAC
   p3m.ca_num = 0;
@@ -289,7 +299,11 @@ void p3m_free()
   free(p3m.recv_grid);
   free(p3m.rs_mesh);
   free(p3m.ks_mesh); 
-  for(i=0; i<p3m.params.cao; i++) free(p3m.int_caf[i]);
+  free(p3m.ad_self_green);
+  for(i=0; i<p3m.params.cao; i++) {
+    free(p3m.int_caf[i]);
+    free(p3m.int_dcaf[i]);
+  }
 }
 
 void p3m_set_bjerrum() {
@@ -372,7 +386,7 @@ void   p3m_init() {
 }
 
 void p3m_set_tune_params(double r_cut, int mesh[3], int cao,
-			 double alpha, double accuracy, int n_interpol)
+			 double alpha, double accuracy, int n_interpol, int diff)
 {
   if (r_cut >= 0) {
     p3m.params.r_cut    = r_cut;
@@ -401,6 +415,9 @@ void p3m_set_tune_params(double r_cut, int mesh[3], int cao,
   if (n_interpol != -1)
     p3m.params.inter = n_interpol;
 
+  if (diff != -1)
+    p3m.params.diff = diff;
+
   coulomb.prefactor = (temperature > 0) ? temperature*coulomb.bjerrum : coulomb.bjerrum;
 }
 
@@ -490,6 +507,19 @@ int p3m_set_ninterpol(int n)
 }
 
 
+int p3m_set_diff(int diff)
+{
+  if (diff != P3M_DIFF_IK && diff != P3M_DIFF_AD)
+    return ES_ERROR;
+
+  p3m.params.diff = diff;
+
+  mpi_bcast_coulomb_params();
+
+  return ES_OK;
+}
+
+
 /************************************* method ********************************/
 /*****************************************************************************/
 
@@ -513,6 +543,13 @@ void p3m_interpolate_charge_assignment_function()
     /* loop over all interpolation points */
     for (j=-p3m.params.inter; j<=p3m.params.inter; j++)
       p3m.int_caf[i][j+p3m.params.inter] = p3m_caf(i, j*dInterpol,p3m.params.cao);
+
+    /* the ad force assignment also needs the derivative */
+    if (p3m.params.diff == P3M_DIFF_AD) {
+      p3m.int_dcaf[i] = (double *) Utils::realloc(p3m.int_dcaf[i], sizeof(double)*(2*p3m.params.inter+1));
+      for (j=-p3m.params.inter; j<=p3m.params.inter; j++)
+        p3m.int_dcaf[i][j+p3m.params.inter] = p3m_caf_derivative(i, j*dInterpol,p3m.params.cao);
+    }
   }
   
 }
@@ -813,6 +850,183 @@ static void P3M_assign_forces(double force_prefac, int d_rs)
 
 
 
+/* calculate the real space force influence function p3m.ad_self_green,
+   the back transform of g_force, at the offsets of the mesh points of one
+   particle. Uses the k-space mesh as buffer. */
+static void p3m_calc_ad_self_green()
+{
+  const int n = 2*p3m.params.cao-1;
+  int i, d, r[3], l[3], ind = 0;
+  bool mine;
+
+  for(i=0; i<fft.plan[3].new_size; i++) {
+    p3m.ks_mesh[2*i]   = p3m.g_force[i];
+    p3m.ks_mesh[2*i+1] = 0.0;
+  }
+  fft_perform_back(p3m.ks_mesh);
+
+  /* every offset is on the inner mesh of exactly one node */
+  std::vector<double> local(n*n*n, 0.0);
+  for(r[0]=0; r[0]<n; r[0]++) {
+    for(r[1]=0; r[1]<n; r[1]++) {
+      for(r[2]=0; r[2]<n; r[2]++) {
+        mine = true;
+        for(d=0; d<3; d++) {
+          l[d] = ((r[d] - (p3m.params.cao-1)) % p3m.params.mesh[d] + p3m.params.mesh[d]) % p3m.params.mesh[d]
+            - p3m.local_mesh.ld_ind[d];
+          if (l[d] < p3m.local_mesh.in_ld[d] || l[d] >= p3m.local_mesh.in_ur[d])
+            mine = false;
+        }
+        if (mine)
+          local[ind] = p3m.ks_mesh[(l[0]*p3m.local_mesh.dim[1] + l[1])*p3m.local_mesh.dim[2] + l[2]];
+        ind++;
+      }
+    }
+  }
+
+  p3m.ad_self_green = (double *) Utils::realloc(p3m.ad_self_green, n*n*n*sizeof(double));
+  MPI_Allreduce(local.data(), p3m.ad_self_green, n*n*n, MPI_DOUBLE, MPI_SUM, comm_cart);
+  p3m.ad_self_green_valid = 1;
+}
+
+/* subtract the force of a particle on its own mesh charge from f. The
+   potential of the mesh charge at its own mesh points is the convolution
+   of the charge assignment function with p3m.ad_self_green, so the force
+   only depends on the correlations of the charge assignment function and
+   its derivative in each dimension. */
+template<int cao>
+static void p3m_subtract_ad_self_force(double caf[3][7], double dcaf[3][7],
+                                       double prefac, double f[3])
+{
+  const int n = 2*cao-1;
+  /* correlations at the mesh offsets -(cao-1) ... cao-1 */
+  double cc[3][13], dc[3][13];
+  double self[3] = {0.0, 0.0, 0.0}, g_c, g_d;
+  const double *g = p3m.ad_self_green;
+  int d, i, j, r0, r1, r2;
+
+  for(d=0; d<3; d++) {
+    for(i=0; i<n; i++)
+      cc[d][i] = dc[d][i] = 0.0;
+    for(i=0; i<cao; i++)
+      for(j=0; j<cao; j++) {
+        cc[d][i-j+cao-1] += caf[d][i]*caf[d][j];
+        dc[d][i-j+cao-1] += dcaf[d][i]*caf[d][j];
+      }
+  }
+
+  for(r0=0; r0<n; r0++) {
+    for(r1=0; r1<n; r1++) {
+      g_c = g_d = 0.0;
+      for(r2=0; r2<n; r2++) {
+        g_c += g[r2]*cc[2][r2];
+        g_d += g[r2]*dc[2][r2];
+      }
+      g += n;
+      self[0] += dc[0][r0]*cc[1][r1]*g_c;
+      self[1] += cc[0][r0]*dc[1][r1]*g_c;
+      self[2] += cc[0][r0]*cc[1][r1]*g_d;
+    }
+  }
+
+  /* the mesh force is -prefac*self */
+  for(d=0; d<3; d++)
+    f[d] += prefac*self[d];
+}
+
+/* assign the forces from the potential mesh (ad differentiation) */
+template<int cao>
+static void P3M_assign_forces_ad(double force_prefac)
+{
+  Cell *cell;
+  Particle *p;
+  int i,c,np,d,i0,i1,i2;
+  double q;
+  /* position of a particle in local mesh units */
+  double pos;
+  /* 1d-index of nearest mesh point */
+  int nmp;
+  /* distance to nearest mesh point */
+  double dist;
+  /* index for caf interpolation grid */
+  int arg;
+  /* charge assignment function and its derivative (in real space units) */
+  double caf[3][7], dcaf[3][7];
+  double tmp0[3], tmp1[3], phi;
+  /* index, index jumps for rs_mesh array */
+  int q_ind = 0;
+#ifdef P3M_STORE_CA_FRAC
+  /* charged particle counter */
+  int cp_cnt = 0;
+#endif
+
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for(i=0; i<np; i++) { 
+      if( (q=p[i].p.q) != 0.0 ) {
+	for(d=0;d<3;d++) {
+	  /* particle position in mesh coordinates */
+	  pos    = ((p[i].r.p[d]-p3m.local_mesh.ld_pos[d])*p3m.params.ai[d]) - p3m.pos_shift;
+	  /* nearest mesh point */
+	  nmp  = (int)pos;
+	  /* 3d-array index of nearest mesh point */
+	  q_ind = (d == 0) ? nmp : nmp + p3m.local_mesh.dim[d]*q_ind;
+	  if (p3m.params.inter == 0) {
+	    /* distance to nearest mesh point */
+	    dist = (pos-nmp)-0.5;
+	    for(i0=0; i0<cao; i0++) {
+	      caf[d][i0]  = p3m_caf(i0, dist, cao);
+	      dcaf[d][i0] = p3m_caf_derivative(i0, dist, cao)*p3m.params.ai[d];
+	    }
+	  }
+	  else {
+	    /* same interpolation as in the charge assignment */
+	    arg = (int) ((pos - nmp)*p3m.params.inter2);
+	    for(i0=0; i0<cao; i0++) {
+	      caf[d][i0]  = p3m.int_caf[i0][arg];
+	      dcaf[d][i0] = p3m.int_dcaf[i0][arg]*p3m.params.ai[d];
+	    }
+	  }
+	}
+#ifdef P3M_STORE_CA_FRAC
+	/* the charge fractions hold no derivatives, but the first mesh
+	   point is the one of the charge assignment */
+	q_ind = p3m.ca_fmp[cp_cnt++];
+#endif
+
+	/* gradient of the potential at the particle position */
+	for(i0=0; i0<cao; i0++) {
+	  for(i1=0; i1<cao; i1++) {
+	    tmp1[0] = dcaf[0][i0] * caf[1][i1];
+	    tmp1[1] = caf[0][i0]  * dcaf[1][i1];
+	    tmp1[2] = caf[0][i0]  * caf[1][i1];
+	    tmp0[0] = tmp0[1] = tmp0[2] = 0.0;
+	    for(i2=0; i2<cao; i2++) {
+	      phi = p3m.rs_mesh[q_ind];
+	      tmp0[0] += phi*caf[2][i2];
+	      tmp0[2] += phi*dcaf[2][i2];
+	      q_ind++;
+	    }
+	    tmp0[1] = tmp0[0];
+	    p[i].f.f[0] -= force_prefac*q*tmp1[0]*tmp0[0];
+	    p[i].f.f[1] -= force_prefac*q*tmp1[1]*tmp0[1];
+	    p[i].f.f[2] -= force_prefac*q*tmp1[2]*tmp0[2];
+	    q_ind += p3m.local_mesh.q_2_off;
+	  }
+	  q_ind += p3m.local_mesh.q_21_off;
+	}
+
+	/* the mesh force contains the force of the particle on itself */
+	p3m_subtract_ad_self_force<cao>(caf, dcaf, force_prefac*q*q, p[i].f.f);
+
+	ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: P3M  f = (%.3e,%.3e,%.3e)\n",this_node,p[i].f.f[0],p[i].f.f[1],p[i].f.f[2]));
+      }
+    }
+  }
+}
+
 double p3m_calc_kspace_forces(int force_flag, int energy_flag)
 {
     int i,d,d_rs,ind,j[3];
@@ -848,9 +1062,17 @@ double p3m_calc_kspace_forces(int force_flag, int energy_flag)
         **********************/
 
 
-      for(i=0;i<fft.plan[3].new_size;i++) {
-        // Use the energy optimized influence function for energy!
-        node_k_space_energy += p3m.g_energy[i] * ( SQR(p3m.rs_mesh[2*i]) + SQR(p3m.rs_mesh[2*i+1]) );
+      /* only half of the hermitian k-space mesh is stored */
+      i = 0;
+      for(j[0]=0; j[0]<fft.plan[3].new_mesh[0]; j[0]++) {
+        for(j[1]=0; j[1]<fft.plan[3].new_mesh[1]; j[1]++) {
+          for(j[2]=0; j[2]<fft.plan[3].new_mesh[2]; j[2]++) {
+            // Use the energy optimized influence function for energy!
+            node_k_space_energy += fft_hermitian_weight(j[fft.ks_half_dir] + fft.plan[3].start[fft.ks_half_dir], fft.ks_half_mesh)
+              * p3m.g_energy[i] * ( SQR(p3m.rs_mesh[2*i]) + SQR(p3m.rs_mesh[2*i+1]) );
+            i++;
+          }
+        }
       }
         node_k_space_energy *= force_prefac;
 
@@ -864,8 +1086,49 @@ double p3m_calc_kspace_forces(int force_flag, int energy_flag)
 
     } /* if (energy_flag) */
 
-    /* === K Space Force Calculation  === */
-    if(force_flag && p3m.sum_q2 > 0) {
+    /* === K Space Force Calculation (ad differentiation) === */
+    if(force_flag && p3m.sum_q2 > 0 && p3m.params.diff == P3M_DIFF_AD) {
+        /* apply the influence function, the result is the potential mesh */
+        for(i=0; i<fft.plan[3].new_size; i++) {
+            p3m.rs_mesh[2*i]   *= p3m.g_force[i];
+            p3m.rs_mesh[2*i+1] *= p3m.g_force[i];
+        }
+        /* Back FFT of the potential mesh */
+        fft_perform_back(p3m.rs_mesh);
+        /* redistribute potential mesh */
+        p3m_spread_force_grid(p3m.rs_mesh);
+        /* real space influence function for the self force */
+        if (!p3m.ad_self_green_valid)
+          p3m_calc_ad_self_green();
+        /* Assign all force components from the gradient of the charge
+           assignment function */
+        switch(p3m.params.cao) 
+          {
+          case 1:
+            P3M_assign_forces_ad<1>(force_prefac); 
+            break;
+          case 2:
+            P3M_assign_forces_ad<2>(force_prefac); 
+            break;
+          case 3:
+            P3M_assign_forces_ad<3>(force_prefac); 
+            break;
+          case 4:
+            P3M_assign_forces_ad<4>(force_prefac); 
+            break;
+          case 5:
+            P3M_assign_forces_ad<5>(force_prefac); 
+            break;
+          case 6:
+            P3M_assign_forces_ad<6>(force_prefac); 
+            break;
+          case 7:
+            P3M_assign_forces_ad<7>(force_prefac); 
+            break;
+          }
+    }
+    /* === K Space Force Calculation (ik differentiation) === */
+    else if(force_flag && p3m.sum_q2 > 0) {
        /***************************
         COULOMB FORCES (k-space)
         ****************************/
@@ -1176,6 +1439,44 @@ inline double perform_aliasing_sums_force(int n[3], double numerator[3])
 }
 
 
+/** Aliasing sums of the optimal influence function for ad
+    differentiation (Ballenegger, Cerda and Holm, J. Chem. Theory
+    Comput. 8, 936 (2012)). Returns numerator/(denominator1*denominator2). */
+template<int cao>
+inline double perform_aliasing_sums_force_ad(int n[3])
+{
+  using Utils::int_pow;
+
+  double numerator = 0.0, denominator1 = 0.0, denominator2 = 0.0;
+  /* lots of temporary variables... */
+  double sx, sy, sz, f1, mx, my, mz, nmx, nmy, nmz, nm2, expo;
+  double limit = 30;
+
+  f1 = SQR(PI/(p3m.params.alpha));
+
+  for(mx = -P3M_BRILLOUIN; mx <= P3M_BRILLOUIN; mx++) {
+    nmx = p3m.meshift_x[n[KX]] + p3m.params.mesh[RX]*mx;
+    sx  = int_pow<2*cao>(sinc(nmx/(double)p3m.params.mesh[RX]));
+    for(my = -P3M_BRILLOUIN; my <= P3M_BRILLOUIN; my++) {
+      nmy = p3m.meshift_y[n[KY]] + p3m.params.mesh[RY]*my;
+      sy  = sx*int_pow<2*cao>(sinc(nmy/(double)p3m.params.mesh[RY]));
+      for(mz = -P3M_BRILLOUIN; mz <= P3M_BRILLOUIN; mz++) {
+        nmz = p3m.meshift_z[n[KZ]] + p3m.params.mesh[RZ]*mz;
+        sz  = sy*int_pow<2*cao>(sinc(nmz/(double)p3m.params.mesh[RZ]));
+
+        nm2          =  SQR(nmx/box_l[RX]) + SQR(nmy/box_l[RY]) + SQR(nmz/box_l[RZ]);
+        expo         =  f1*nm2;
+
+        /* k_m * R(k_m), with R the reference force */
+        numerator    += (expo<limit) ? sz*exp(-expo) : 0.0;
+        denominator1 += sz;
+        denominator2 += sz*nm2;
+      }
+    }
+  }
+  return numerator/(denominator1*denominator2);
+}
+
 template<int cao>
 void calc_influence_function_force()
 {
@@ -1203,6 +1504,9 @@ void calc_influence_function_force()
         if( (n[KX]%(p3m.params.mesh[RX]/2)==0) && (n[KY]%(p3m.params.mesh[RY]/2)==0) && (n[KZ]%(p3m.params.mesh[RZ]/2)==0) ) {
           p3m.g_force[ind] = 0.0;
         }
+        else if (p3m.params.diff == P3M_DIFF_AD) {
+          p3m.g_force[ind] = 2*perform_aliasing_sums_force_ad<cao>(n)/(PI);
+        }
         else {
           const double denominator = perform_aliasing_sums_force<cao>(n,nominator);
 
@@ -1215,6 +1519,9 @@ void calc_influence_function_force()
       }
     }
   }
+
+  /* the self force needs the back transform of the new g_force */
+  p3m.ad_self_green_valid = 0;
 }
 
 } /* namespace */
@@ -1385,7 +1692,7 @@ static double p3m_get_accuracy(int mesh[3], int cao, double r_cut_iL, double *_a
     ks_err = p3m_k_space_error_gpu(coulomb.prefactor, mesh, cao, p3m.sum_qpart, p3m.sum_q2, alpha_L, box_l);
   else
 #endif
-    ks_err = p3m_k_space_error(coulomb.prefactor,mesh,cao,p3m.sum_qpart,p3m.sum_q2,alpha_L);
+    ks_err = p3m_k_space_error(coulomb.prefactor,mesh,cao,p3m.sum_qpart,p3m.sum_q2,alpha_L,p3m.params.diff);
 
   *_rs_err = rs_err;
   *_ks_err = ks_err;
@@ -1419,6 +1726,12 @@ static double p3m_mcr_time(int mesh[3], int cao, double r_cut_iL, double alpha_L
   return int_time;
 }
 
+/** name of a differentiation scheme for the tuning log */
+static const char *p3m_diff_name(int diff)
+{
+  return (diff == P3M_DIFF_AD) ? "ad" : "ik";
+}
+
 /** get the optimal alpha and the corresponding computation time for fixed mesh, cao. The r_cut is determined via
     a simple bisection. Returns -1 if the force evaluation does not work, -2 if there is no valid r_cut, and -3 if
     the charge assigment order is to large for this grid */
@@ -1438,7 +1751,7 @@ static double p3m_mc_time(char **log, int mesh[3], int cao,
   P3M_TRACE(fprintf(stderr, "p3m_mc_time: mesh=(%d, %d, %d), cao=%d, rmin=%f, rmax=%f\n",
 		    mesh[0],mesh[1],mesh[2], cao, r_cut_iL_min, r_cut_iL_max));
   if(cao >= imin(mesh[0],imin(mesh[1],mesh[2])) || k_cut >= (dmin(min_box_l,min_local_box_l) - skin)) {
-    sprintf(b, "%-4d %-3d cao too large for this mesh\n", mesh[0], cao);
+    sprintf(b, "%-4d %-3d %-4s cao too large for this mesh\n", mesh[0], cao, p3m_diff_name(p3m.params.diff));
     *log = strcat_alloc(*log, b);
     return -3;
   }
@@ -1448,8 +1761,8 @@ static double p3m_mc_time(char **log, int mesh[3], int cao,
   if ((*_accuracy = p3m_get_accuracy(mesh, cao, r_cut_iL_max, _alpha_L, &rs_err, &ks_err)) > p3m.params.accuracy) {
     /* print result */
     P3M_TRACE(puts("p3m_mc_time: accuracy not achieved."));
-    sprintf(b, "%-4d %-3d %.5e %.5e %.5e %.3e %.3e accuracy not achieved\n",
-	    mesh[0], cao, r_cut_iL_max, *_alpha_L, *_accuracy, rs_err, ks_err);
+    sprintf(b, "%-4d %-3d %-4s %.5e %.5e %.5e %.3e %.3e accuracy not achieved\n",
+	    mesh[0], cao, p3m_diff_name(p3m.params.diff), r_cut_iL_max, *_alpha_L, *_accuracy, rs_err, ks_err);
     *log = strcat_alloc(*log, b);
     return -2;
   }
@@ -1477,8 +1790,8 @@ static double p3m_mc_time(char **log, int mesh[3], int cao,
     P3M_TRACE(fprintf(stderr, "p3m_mc_time: mesh (%d, %d, %d) cao %d r_cut %f reject r_cut %f > gap %f\n", mesh[0],mesh[1],mesh[2], cao, r_cut_iL,
                      2*r_cut_iL*box_l[0], elc_params.gap_size));
     /* print result */
-    sprintf(b, "%-4d %-3d %.5e %.5e %.5e %.3e %.3e conflict with ELC\n",
-	    mesh[0], cao, r_cut_iL, *_alpha_L, *_accuracy, rs_err, ks_err);
+    sprintf(b, "%-4d %-3d %-4s %.5e %.5e %.5e %.3e %.3e conflict with ELC\n",
+	    mesh[0], cao, p3m_diff_name(p3m.params.diff), r_cut_iL, *_alpha_L, *_accuracy, rs_err, ks_err);
     *log = strcat_alloc(*log, b);
     return -P3M_TUNE_ELCTEST;
   }
@@ -1490,8 +1803,8 @@ static double p3m_mc_time(char **log, int mesh[3], int cao,
   if (n_cells < min_num_cells) {
     P3M_TRACE(fprintf(stderr, "p3m_mc_time: mesh (%d, %d, %d) cao %d r_cut %f reject n_cells %d\n", mesh[0], mesh[1], mesh[2], cao, r_cut_iL, n_cells));
     /* print result */
-    sprintf(b, "%-4d %-3d %.5e %.5e %.5e %.3e %.3e radius dangerously high\n\n",
-	    mesh[0], cao, r_cut_iL, *_alpha_L, *_accuracy, rs_err, ks_err);
+    sprintf(b, "%-4d %-3d %-4s %.5e %.5e %.5e %.3e %.3e radius dangerously high\n\n",
+	    mesh[0], cao, p3m_diff_name(p3m.params.diff), r_cut_iL, *_alpha_L, *_accuracy, rs_err, ks_err);
     *log = strcat_alloc(*log, b);
   }
   int_time = p3m_mcr_time(mesh, cao, r_cut_iL, *_alpha_L);
@@ -1504,8 +1817,8 @@ static double p3m_mc_time(char **log, int mesh[3], int cao,
 
   P3M_TRACE(fprintf(stderr, "p3m_mc_time: mesh (%d, %d, %d) cao %d r_cut %f time %f\n", mesh[0], mesh[1], mesh[2], cao, r_cut_iL, int_time));
   /* print result */
-  sprintf(b, "%-4d %-3d %.5e %.5e %.5e %.3e %.3e %-8.2f\n",
-	  mesh[0], cao, r_cut_iL, *_alpha_L, *_accuracy, rs_err, ks_err, int_time);
+  sprintf(b, "%-4d %-3d %-4s %.5e %.5e %.5e %.3e %.3e %-8.2f\n",
+	  mesh[0], cao, p3m_diff_name(p3m.params.diff), r_cut_iL, *_alpha_L, *_accuracy, rs_err, ks_err, int_time);
   *log = strcat_alloc(*log, b);
   return int_time;
 }
@@ -1642,9 +1955,23 @@ int p3m_adaptive_tune(char **log) {
   double                             accuracy = -1, tmp_accuracy=0.0;
   double                            time_best=1e20, tmp_time;
   double mesh_density = 0.0, mesh_density_min, mesh_density_max;
+  int    diff_min, diff_max,         diff     = P3M_DIFF_IK, tmp_diff;
+  double mesh_time, mesh_r_cut_iL;
   char b[3*ES_INTEGER_SPACE + 3*ES_DOUBLE_SPACE + 128];
   int tune_mesh = 0; //boolean to indicate if mesh should be tuned
 
+  /* differentiation scheme: if not fixed, try both. ad is not
+     implemented on the GPU. */
+  if (p3m.params.diff == P3M_DIFF_TUNE) {
+    diff_min = P3M_DIFF_IK;
+    diff_max = P3M_DIFF_AD;
+  }
+  else
+    diff_min = diff_max = p3m.params.diff;
+  if (coulomb.method == COULOMB_P3M_GPU)
+    diff_min = diff_max = P3M_DIFF_IK;
+  p3m.params.diff = diff_min;
+
   if (p3m.params.epsilon != P3M_EPSILON_METALLIC) {
     if( !((box_l[0] == box_l[1]) &&
 	  (box_l[1] == box_l[2]))) {
@@ -1726,7 +2053,12 @@ int p3m_adaptive_tune(char **log) {
     *log = strcat_alloc(*log, b);
   }
 
-  *log = strcat_alloc(*log, "mesh cao r_cut_iL     alpha_L      err          rs_err     ks_err     time [ms]\n");
+  if (diff_min == diff_max) {
+    sprintf(b, "fixed diff %s\n", p3m_diff_name(diff_min));
+    *log = strcat_alloc(*log, b);
+  }
+
+  *log = strcat_alloc(*log, "mesh cao diff r_cut_iL     alpha_L      err          rs_err     ks_err     time [ms]\n");
 
   /* mesh loop */
   /* we're tuning the density of mesh points, which is the same in every direction. */
@@ -1753,35 +2085,51 @@ int p3m_adaptive_tune(char **log) {
     if(tmp_mesh[2] % 2)
       tmp_mesh[2]++;
 
-    tmp_time = p3m_m_time(log, tmp_mesh,
-			  cao_min, cao_max, &tmp_cao,
-			  r_cut_iL_min, r_cut_iL_max, &tmp_r_cut_iL,
-			  &tmp_alpha_L, &tmp_accuracy); 
-    /* some error occured during the tuning force evaluation */
-    P3M_TRACE(fprintf(stderr,"delta_accuracy: %lf tune time: %lf\n", p3m.params.accuracy - tmp_accuracy,tmp_time));
-    //    if (tmp_time == -1) con;
+    mesh_time = -1;
+    mesh_r_cut_iL = 0.0;
+    /* differentiation scheme loop */
+    for (tmp_diff = diff_min; tmp_diff <= diff_max; tmp_diff++) {
+      /* the derivative of the nearest grid point assignment vanishes */
+      if (tmp_diff == P3M_DIFF_AD && cao_max < 2) continue;
+      p3m.params.diff = tmp_diff;
+      tmp_cao = (tmp_diff == P3M_DIFF_AD) ? imax(cao, 2) : cao;
+
+      tmp_time = p3m_m_time(log, tmp_mesh,
+			    (tmp_diff == P3M_DIFF_AD) ? imax(cao_min, 2) : cao_min, cao_max, &tmp_cao,
+			    r_cut_iL_min, r_cut_iL_max, &tmp_r_cut_iL,
+			    &tmp_alpha_L, &tmp_accuracy); 
+      /* some error occured during the tuning force evaluation */
+      P3M_TRACE(fprintf(stderr,"delta_accuracy: %lf tune time: %lf\n", p3m.params.accuracy - tmp_accuracy,tmp_time));
+      /* this mesh does not work with this scheme */
+      if (tmp_time < 0.0) continue;
+
+      if (mesh_time < 0.0 || tmp_time < mesh_time) mesh_time = tmp_time;
+      if (tmp_r_cut_iL > mesh_r_cut_iL) mesh_r_cut_iL = tmp_r_cut_iL;
+
+      /* new optimum */
+      if (tmp_time < time_best) {
+	P3M_TRACE(fprintf(stderr, "Found new optimum: time %lf, mesh (%d %d %d), diff %s\n", tmp_time, tmp_mesh[0], tmp_mesh[1], tmp_mesh[2], p3m_diff_name(tmp_diff)));
+	time_best = tmp_time;
+	mesh[0]   = tmp_mesh[0];
+	mesh[1]   = tmp_mesh[1];
+	mesh[2]   = tmp_mesh[2];
+	cao       = tmp_cao;
+	diff      = tmp_diff;
+	r_cut_iL  = tmp_r_cut_iL;
+	alpha_L   = tmp_alpha_L;
+	accuracy  = tmp_accuracy;
+      }
+    }
     /* this mesh does not work at all */
-    if (tmp_time < 0.0) continue;
+    if (mesh_time < 0.0) continue;
 
     /* the optimum r_cut for this mesh is the upper limit for higher meshes,
        everything else is slower */
     if(coulomb.method == COULOMB_P3M)
-      r_cut_iL_max = tmp_r_cut_iL;
+      r_cut_iL_max = mesh_r_cut_iL;
     
-    /* new optimum */
-    if (tmp_time < time_best) {
-      P3M_TRACE(fprintf(stderr, "Found new optimum: time %lf, mesh (%d %d %d)\n", tmp_time, tmp_mesh[0], tmp_mesh[1], tmp_mesh[2]));
-      time_best = tmp_time;
-      mesh[0]   = tmp_mesh[0];
-      mesh[1]   = tmp_mesh[1];
-      mesh[2]   = tmp_mesh[2];
-      cao       = tmp_cao;
-      r_cut_iL  = tmp_r_cut_iL;
-      alpha_L   = tmp_alpha_L;
-      accuracy  = tmp_accuracy;
-    }
     /* no hope of further optimisation */
-    else if (tmp_time > time_best + P3M_TIME_GRAN) {
+    if (mesh_time > time_best + P3M_TIME_GRAN) {
       P3M_TRACE(fprintf(stderr, "%d: %lf is mush slower then best time, aborting.\n", this_node, tmp_time));
       break;
     }
@@ -1789,6 +2137,7 @@ int p3m_adaptive_tune(char **log) {
   
   P3M_TRACE(fprintf(stderr,"%d: finished tuning, best time: %lf\n", this_node,time_best));
   if(time_best == 1e20) {
+    p3m.params.diff = diff_min;
     *log = strcat_alloc(*log, "failed to tune P3M parameters to required accuracy\n");
     return ES_ERROR;
   }
@@ -1799,6 +2148,7 @@ int p3m_adaptive_tune(char **log) {
   p3m.params.mesh[1]  = mesh[1];
   p3m.params.mesh[2]  = mesh[2];
   p3m.params.cao      = cao;
+  p3m.params.diff     = diff;
   p3m.params.alpha_L  = alpha_L;
   p3m.params.accuracy = accuracy;
   p3m_scaleby_box_l();
@@ -1809,8 +2159,8 @@ int p3m_adaptive_tune(char **log) {
   P3M_TRACE(p3m_print());
 
   /* Tell the user about the outcome */
-  sprintf(b, "\nresulting parameters:\n%-4d %-4d %-4d %-3d %.5e %.5e %.5e %-8.2f\n",
-	  mesh[0], mesh[1], mesh[2], cao, r_cut_iL, alpha_L, accuracy, time_best);
+  sprintf(b, "\nresulting parameters:\n%-4d %-4d %-4d %-3d %-4s %.5e %.5e %.5e %-8.2f\n",
+	  mesh[0], mesh[1], mesh[2], cao, p3m_diff_name(diff), r_cut_iL, alpha_L, accuracy, time_best);
   *log = strcat_alloc(*log, b);
   return ES_OK;
 }
@@ -1855,11 +2205,11 @@ double p3m_real_space_error(double prefac, double r_cut_iL,
   return (2.0*prefac*sum_q2*exp(-SQR(r_cut_iL*alpha_L))) / sqrt((double)n_c_part*r_cut_iL*box_l[0]*box_l[0]*box_l[1]*box_l[2]);
 }
 
-double p3m_k_space_error(double prefac, int mesh[3], int cao, int n_c_part, double sum_q2, double alpha_L)
+double p3m_k_space_error(double prefac, int mesh[3], int cao, int n_c_part, double sum_q2, double alpha_L, int diff)
 {
   int  nx, ny, nz;
   double he_q = 0.0, mesh_i[3] = {1.0/mesh[0], 1.0/mesh[1], 1.0/mesh[2]}, alpha_L_i = 1./alpha_L;
-  double alias1, alias2, n2, cs;
+  double alias1, alias2, alias3, alias4, n2, cs, d;
   double ctan_x, ctan_y;
 
   for (nx=-mesh[0]/2; nx<mesh[0]/2; nx++) {
@@ -1870,9 +2220,12 @@ double p3m_k_space_error(double prefac, int mesh[3], int cao, int n_c_part, doub
 	if((nx!=0) || (ny!=0) || (nz!=0)) {
 	  n2 = SQR(nx) + SQR(ny) + SQR(nz);
 	  cs = p3m_analytic_cotangent_sum(nz,mesh_i[2],cao)*ctan_y;
-	  p3m_tune_aliasing_sums(nx,ny,nz,mesh,mesh_i,cao,alpha_L_i,&alias1,&alias2);
+	  p3m_tune_aliasing_sums(nx,ny,nz,mesh,mesh_i,cao,alpha_L_i,&alias1,&alias2,&alias3,&alias4);
 
-	  double d = alias1  -  SQR(alias2/cs) / n2;
+	  if (diff == P3M_DIFF_AD)
+	    d = alias1  -  SQR(alias3) / (cs*alias4);
+	  else
+	    d = alias1  -  SQR(alias2/cs) / n2;
 	  /* at high precisions, d can become negative due to extinction;
 	     also, don't take values that have no significant digits left*/
 	  if (d > 0 && (fabs(d/alias1) > ROUND_ERROR_PREC))
@@ -1887,7 +2240,7 @@ double p3m_k_space_error(double prefac, int mesh[3], int cao, int n_c_part, doub
 
 void p3m_tune_aliasing_sums(int nx, int ny, int nz, 
 			    int mesh[3], double mesh_i[3], int cao, double alpha_L_i, 
-			    double *alias1, double *alias2)
+			    double *alias1, double *alias2, double *alias3, double *alias4)
 {
 
   int    mx,my,mz;
@@ -1898,7 +2251,7 @@ void p3m_tune_aliasing_sums(int nx, int ny, int nz,
 
   factor1 = SQR(PI*alpha_L_i);
 
-  *alias1 = *alias2 = 0.0;
+  *alias1 = *alias2 = *alias3 = *alias4 = 0.0;
   for (mx=-P3M_BRILLOUIN; mx<=P3M_BRILLOUIN; mx++) {
     fnmx = mesh_i[0] * (nmx = nx + mx*mesh[0]);
     for (my=-P3M_BRILLOUIN; my<=P3M_BRILLOUIN; my++) {
@@ -1913,6 +2266,8 @@ void p3m_tune_aliasing_sums(int nx, int ny, int nz,
 	
 	*alias1 += ex2 / nm2;
 	*alias2 += U2 * ex * (nx*nmx + ny*nmy + nz*nmz) / nm2;
+	*alias3 += U2 * ex;
+	*alias4 += U2 * nm2;
       }
     }
   }
@@ -2061,6 +2416,14 @@ int p3m_sanity_checks()
       runtimeErrorMsg() <<"P3M_init: cao is not yet set";
     ret = 1;
   }
+  if (p3m.params.diff == P3M_DIFF_AD && p3m.params.cao == 1) {
+      runtimeErrorMsg() <<"P3M_init: ad differentiation requires cao > 1";
+    ret = 1;
+  }
+  if (p3m.params.diff == P3M_DIFF_AD && coulomb.method == COULOMB_P3M_GPU) {
+      runtimeErrorMsg() <<"P3M_init: ad differentiation is not available on the GPU";
+    ret = 1;
+  }
   if (p3m.params.alpha < 0.0 ) {
       runtimeErrorMsg() <<"P3M_init: alpha must be >0";
     ret = 1;
@@ -2199,7 +2562,8 @@ void p3m_calc_kspace_stress (double* stress) {
                     }
                     else {
                         vterm = -2.0 * (1/sqk + SQR(1.0/2.0/p3m.params.alpha));
-                        node_k_space_energy =  p3m.g_energy[ind] * ( SQR(p3m.rs_mesh[2*ind]) + SQR(p3m.rs_mesh[2*ind + 1]) );
+                        node_k_space_energy =  fft_hermitian_weight(j[fft.ks_half_dir] + fft.plan[3].start[fft.ks_half_dir], fft.ks_half_mesh)
+                          * p3m.g_energy[ind] * ( SQR(p3m.rs_mesh[2*ind]) + SQR(p3m.rs_mesh[2*ind + 1]) );
                     }
                     ind++;
                     node_k_space_stress[0] += node_k_space_energy * (1.0 + vterm*SQR(kx));     /* sigma_xx */
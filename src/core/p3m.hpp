@@ -78,6 +78,9 @@ typedef struct {
 
   /** interpolation of the charge assignment function. */
   double *int_caf[7];
+  /** interpolation of the derivative of the charge assignment function
+      (ad differentiation only). */
+  double *int_dcaf[7];
 
   /** position shift for calc. of first assignment mesh point. */
   double pos_shift;
@@ -86,12 +89,17 @@ typedef struct {
   double *meshift_y;
   double *meshift_z;
 
-  /** Spatial differential operator in k-space. We use an i*k differentiation. */
+  /** Spatial differential operator in k-space for i*k differentiation. */
   double *d_op[3];
   /** Force optimised influence function (k-space) */
   double *g_force;
   /** Energy optimised influence function (k-space) */
   double *g_energy;
+  /** Real space force influence function at the mesh offsets
+      -(cao-1) ... cao-1 of each dimension, for the ad self force. */
+  double *ad_self_green;
+  /** whether \ref ad_self_green is up to date with \ref g_force. */
+  int ad_self_green_valid;
 
 #ifdef P3M_STORE_CA_FRAC
   /** number of charged particles on the node. */
@@ -183,6 +191,9 @@ enum P3M_TUNE_ERROR { P3M_TUNE_FAIL = 1, P3M_TUNE_NOCUTOFF = 2, P3M_TUNE_CAOTOLA
     For each setting \ref p3m_parameter_struct::alpha_L is calculated assuming that the
     error contributions of real and reciprocal space should be equal.
 
+    If \ref p3m_parameter_struct::diff is \ref P3M_DIFF_TUNE, both the ik
+    and the ad differentiation are tried for each mesh.
+
     After checking if the total error fulfils the accuracy goal the
     time needed for one force calculation (including verlet list
     update) is measured via \ref mpi_integrate (0).
@@ -239,7 +250,7 @@ inline double p3m_add_pair_force(double chgfac, double *d,double dist2,double di
 }
 
 void p3m_set_tune_params(double r_cut, int mesh[3], int cao,
-			 double alpha, double accuracy, int n_interpol);
+			 double alpha, double accuracy, int n_interpol, int diff);
 
 int p3m_set_params(double r_cut, int *mesh, int cao,
 		   double alpha, double accuracy);
@@ -250,6 +261,10 @@ int p3m_set_eps(double eps);
 
 int p3m_set_ninterpol(int n);
 
+/** Set the differentiation scheme of the mesh forces, \ref P3M_DIFF_IK
+    or \ref P3M_DIFF_AD. */
+int p3m_set_diff(int diff);
+
 
 /** Calculate real space contribution of coulomb pair energy. */
 inline double p3m_pair_energy(double chgfac, double *d,double dist2,double dist)
@@ -31,6 +31,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <vector>
 #include <mpi.h>
 #include "utils.hpp"
 #include "particle_data.hpp"
@@ -42,6 +43,7 @@
 #include "cells.hpp"
 #include "rotation.hpp"
 #include "virtual_sites.hpp"
+#include "statistics_cells.hpp"
 
 /************************************************
  * defines
@@ -380,6 +382,7 @@ int sortPartCfg()
     memmove(&sorted[partCfg[i].p.identity], &partCfg[i], sizeof(Particle));
   free(partCfg);
   partCfg = sorted;
+  analysis_cells_invalidate();
 
   partCfgSorted = 1;
 
@@ -391,6 +394,7 @@ void freePartCfg()
   free(partCfg);
   partCfg = NULL;
   realloc_intlist(&partCfg_bl, 0);
+  analysis_cells_invalidate();
 }
 
 /** resize \ref local_particles.
@@ -610,6 +614,171 @@ int place_particle(int part, double p[3])
   return retcode;
 }
 
+int set_particles_data(int n, const int *ids, const double *pos, const double *v,
+                       const int *type, const double *q)
+{
+  if (n <= 0)
+    return ES_OK;
+
+  if (!particle_node)
+    build_particle_node();
+
+  /* check the input before anything is changed */
+  int max_id = -1, max_type = -1;
+  for (int i = 0; i < n; i++) {
+    if (ids[i] < 0)
+      return ES_ERROR;
+    if (ids[i] > max_id)
+      max_id = ids[i];
+    if (!pos && (ids[i] > max_seen_particle || particle_node[ids[i]] == -1))
+      return ES_ERROR;
+    if (type) {
+      if (type[i] < 0)
+        return ES_ERROR;
+      if (type[i] > max_type)
+        max_type = type[i];
+    }
+  }
+  std::vector<char> seen(max_id + 1, 0);
+  for (int i = 0; i < n; i++) {
+    if (seen[ids[i]])
+      return ES_ERROR;
+    seen[ids[i]] = 1;
+  }
+
+  int fields = 0;
+  if (pos)
+    fields |= PARTICLES_DATA_POS;
+  if (v)
+    fields |= PARTICLES_DATA_V;
+  if (type)
+    fields |= PARTICLES_DATA_TYPE;
+#ifdef ELECTROSTATICS
+  if (q)
+    fields |= PARTICLES_DATA_Q;
+#endif
+
+  if (type) {
+    make_particle_type_exist(max_type);
+
+    if (Type_array_init) {
+      /* keep the particle lists of the types up to date, like
+         set_particle_type */
+      std::vector<int> old_ids;
+      for (int i = 0; i < n; i++)
+        if (ids[i] <= max_seen_particle && particle_node[ids[i]] != -1)
+          old_ids.push_back(ids[i]);
+      std::vector<int> old_types(old_ids.size());
+      get_particles_data(old_ids.size(), old_ids.data(), NULL, NULL,
+                         old_types.data(), NULL);
+      std::vector<int> old_type(max_id + 1, -1);
+      for (size_t i = 0; i < old_ids.size(); i++)
+        old_type[old_ids[i]] = old_types[i];
+
+      for (int i = 0; i < n; i++) {
+        if (old_type[ids[i]] != -1 && old_type[ids[i]] != type[i])
+          remove_id_type_array(ids[i], old_type[ids[i]]);
+        if (add_particle_to_list(ids[i], type[i]) == ES_ERROR)
+          return ES_ERROR;
+      }
+    }
+  }
+
+  /* the node of each particle, new particles go to the node of their
+     position */
+  if (max_id > max_seen_particle) {
+    realloc_particle_node(max_id);
+    for (int i = max_seen_particle + 1; i <= max_id; i++)
+      particle_node[i] = -1;
+  }
+  std::vector<int> node(n), counts(n_nodes, 0);
+  std::vector<char> is_new(n, 0);
+  int n_new = 0;
+  for (int i = 0; i < n; i++) {
+    int pnode = particle_node[ids[i]];
+    if (pnode == -1) {
+      double p[3] = { pos[3*i], pos[3*i + 1], pos[3*i + 2] };
+      pnode = cell_structure.position_to_node(p);
+      particle_node[ids[i]] = pnode;
+      is_new[i] = 1;
+      n_new++;
+    }
+    node[i] = pnode;
+    counts[pnode]++;
+  }
+
+  /* sort the particles by node */
+  std::vector<int> offset(n_nodes, 0);
+  for (int i = 1; i < n_nodes; i++)
+    offset[i] = offset[i - 1] + counts[i - 1];
+  std::vector<ParticleBulkData> data(n);
+  for (int i = 0; i < n; i++) {
+    ParticleBulkData *d = &data[offset[node[i]]++];
+    memset(d, 0, sizeof(ParticleBulkData));
+    d->identity = ids[i];
+    d->_new = is_new[i];
+    for (int j = 0; j < 3; j++) {
+      if (pos)
+        d->pos[j] = pos[3*i + j];
+      if (v)
+        d->v[j] = v[3*i + j];
+    }
+    if (type)
+      d->type = type[i];
+    if (q)
+      d->q = q[i];
+  }
+
+  mpi_set_particles_data(data.data(), counts.data(), fields, n_new, max_id);
+
+  return ES_OK;
+}
+
+int get_particles_data(int n, const int *ids, double *pos, double *v,
+                       int *type, double *q)
+{
+  if (n <= 0)
+    return ES_OK;
+
+  if (!particle_node)
+    build_particle_node();
+
+  std::vector<int> counts(n_nodes, 0);
+  for (int i = 0; i < n; i++) {
+    if (ids[i] < 0 || ids[i] > max_seen_particle || particle_node[ids[i]] == -1)
+      return ES_ERROR;
+    counts[particle_node[ids[i]]]++;
+  }
+
+  /* sort the requests by node, and remember where they came from */
+  std::vector<int> offset(n_nodes, 0), index(n), sorted_ids(n);
+  for (int i = 1; i < n_nodes; i++)
+    offset[i] = offset[i - 1] + counts[i - 1];
+  for (int i = 0; i < n; i++) {
+    index[i] = offset[particle_node[ids[i]]]++;
+    sorted_ids[index[i]] = ids[i];
+  }
+
+  std::vector<ParticleBulkData> data(n);
+  mpi_get_particles_data(sorted_ids.data(), data.data(), counts.data());
+
+  for (int i = 0; i < n; i++) {
+    const ParticleBulkData *d = &data[index[i]];
+    for (int j = 0; j < 3; j++) {
+      if (pos)
+        pos[3*i + j] = d->pos[j];
+      if (v)
+        v[3*i + j] = d->v[j];
+    }
+    if (type)
+      type[i] = d->type;
+    if (q)
+      q[i] = d->q;
+  }
+
+  return ES_OK;
+}
+
 int set_particle_v(int part, double v[3])
 {
   int pnode;
@@ -1419,6 +1588,71 @@ void added_particle(int part)
   }
 }
 
+void added_particles(int n_new, int max_id)
+{
+  n_part += n_new;
+
+  if (max_id > max_seen_particle) {
+    realloc_local_particles(max_id);
+    for (int i = max_seen_particle + 1; i <= max_id; i++)
+      local_particles[i] = NULL;
+    max_seen_particle = max_id;
+  }
+}
+
+void local_set_particles_data(ParticleBulkData *data, int n, int fields)
+{
+  for (int i = 0; i < n; i++) {
+    ParticleBulkData *d = &data[i];
+
+    /* placing a new particle can move the others in memory */
+    if (fields & PARTICLES_DATA_POS)
+      local_place_particle(d->identity, d->pos, d->_new);
+    Particle *p = local_particles[d->identity];
+
+    if (fields & PARTICLES_DATA_TYPE)
+      p->p.type = d->type;
+#ifdef ELECTROSTATICS
+    if (fields & PARTICLES_DATA_Q)
+      p->p.q = d->q;
+#endif
+    if (fields & PARTICLES_DATA_V) {
+      memmove(p->m.v, d->v, 3*sizeof(double));
+#ifdef MULTI_TIMESTEP
+      if (smaller_time_step > 0. && p->p.smaller_timestep)
+        for (int j = 0; j < 3; j++)
+          p->m.v[j] *= smaller_time_step / time_step;
+#endif
+    }
+  }
+}
+
+void local_get_particles_data(ParticleBulkData *data, int n)
+{
+  for (int i = 0; i < n; i++) {
+    ParticleBulkData *d = &data[i];
+    Particle *p = local_particles[d->identity];
+    int img[3];
+
+    memmove(d->pos, p->r.p, 3*sizeof(double));
+    memmove(img, p->l.i, 3*sizeof(int));
+    unfold_position(d->pos, img);
+
+    memmove(d->v, p->m.v, 3*sizeof(double));
+#ifdef MULTI_TIMESTEP
+    if (smaller_time_step > 0. && p->p.smaller_timestep)
+      for (int j = 0; j < 3; j++)
+        d->v[j] *= time_step / smaller_time_step;
+#endif
+    d->type = p->p.type;
+#ifdef ELECTROSTATICS
+    d->q = p->p.q;
+#else
+    d->q = 0.0;
+#endif
+  }
+}
+
 int local_change_bond(int part, int *bond, int _delete)
 {
   IntList *bl;
@@ -327,6 +327,27 @@ typedef struct {
 
 } Particle;
 
+/** \name Fields of \ref ParticleBulkData that are set by
+    \ref local_set_particles_data */
+/*@{*/
+#define PARTICLES_DATA_POS  1
+#define PARTICLES_DATA_V    2
+#define PARTICLES_DATA_TYPE 4
+#define PARTICLES_DATA_Q    8
+/*@}*/
+
+/** Properties of a particle as sent by \ref set_particles_data and
+    \ref get_particles_data. */
+typedef struct {
+  int identity;
+  /** whether the particle has to be created */
+  int _new;
+  int type;
+  double pos[3];
+  double v[3];
+  double q;
+} ParticleBulkData;
+
 /** List of particles. The particle array is resized using a sophisticated
     (we hope) algorithm to avoid unnecessary resizes.
     Access using \ref realloc_particlelist, \ref got_particle,...
@@ -482,8 +503,8 @@ void build_particle_node();
 */
 void particle_invalidate_part_node();
 
-/** Realloc \ref local_particles. */
-void realloc_local_particles();
+/** Realloc \ref local_particles so that it can hold particle part. */
+void realloc_local_particles(int part);
 
 /** Get particle data. Note that the bond intlist is
     allocated so that you are responsible to free it later.
@@ -503,6 +524,39 @@ int get_particle_data(int part, Particle *data);
 */
 int place_particle(int part, double p[3]);
 
+/** Call only on the master node: create or change many particles at
+    once. The data is sorted by node on the master and sent to the
+    nodes with a single scatter, instead of one message per particle
+    and property as with \ref place_particle and friends. New
+    particles are created on the node of their position.
+    @param n    number of particles.
+    @param ids  their identities, each at most once.
+    @param pos  3n positions, or NULL to keep the positions.
+                Required if one of the particles does not exist yet.
+    @param v    3n velocities in units of the time step as for
+                \ref set_particle_v, or NULL.
+    @param type n types, or NULL.
+    @param q    n charges, or NULL. Ignored without ELECTROSTATICS.
+    @return ES_OK, or ES_ERROR if an identity or type is illegal, in
+    which case nothing is changed.
+*/
+int set_particles_data(int n, const int *ids, const double *pos, const double *v,
+                       const int *type, const double *q);
+
+/** Call only on the master node: get the properties of many particles
+    at once, with one scatter and one gather. The arrays are in the
+    order of ids, and any of them can be NULL.
+    @param n    number of particles.
+    @param ids  their identities.
+    @param pos  3n unfolded positions.
+    @param v    3n velocities in units of the time step.
+    @param type n types.
+    @param q    n charges, 0 without ELECTROSTATICS.
+    @return ES_OK, or ES_ERROR if one of the particles does not exist.
+*/
+int get_particles_data(int n, const int *ids, double *pos, double *v,
+                       int *type, double *q);
+
 /** Call only on the master node: set particle velocity.
     @param part the particle.
     @param v its new velocity.
@@ -814,6 +868,28 @@ void local_place_particle(int part, double p[3], int _new);
 */
 void added_particle(int part);
 
+/** Used by \ref mpi_set_particles_data, should not be used elsewhere.
+    Called on all nodes after n_new particles were added.
+    @param n_new  number of new particles
+    @param max_id the largest identity among them
+*/
+void added_particles(int n_new, int max_id);
+
+/** Used by \ref mpi_set_particles_data, should not be used elsewhere.
+    Set the properties of local particles, or create them.
+    @param data   the particles.
+    @param n      their number.
+    @param fields which properties to set, see \ref PARTICLES_DATA_POS.
+*/
+void local_set_particles_data(ParticleBulkData *data, int n, int fields);
+
+/** Used by \ref mpi_get_particles_data, should not be used elsewhere.
+    Fill in the properties of local particles.
+    @param data the particles, only the identities are set on entry.
+    @param n    their number.
+*/
+void local_get_particles_data(ParticleBulkData *data, int n);
+
 /** Used by \ref mpi_send_bond, should not be used elsewhere.
     Modify a bond.
     @param part the identity of the particle to change
@@ -0,0 +1,95 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file phase_timers.cpp
+ *
+ *  Implementation of \ref phase_timers.hpp "phase_timers.hpp".
+ */
+#include "phase_timers.hpp"
+#include "communication.hpp"
+
+int phase_timers = 0;
+
+const char *phase_timer_names[PHASE_N] = {
+  "integrate", "propagate", "force_calc", "ghost_update", "resort",
+  "thermostat", "long_range", "p3m", "elc", "mmm2d", "maggs", "dp3m",
+  "mdlc", "dipolar_direct", "scafacos", "short_range", "verlet_rebuild",
+  "ghost_forces", "lb"
+};
+
+const int phase_timer_parent[PHASE_N] = {
+  -1,                  /* integrate */
+  PHASE_INTEGRATE,     /* propagate */
+  PHASE_INTEGRATE,     /* force_calc */
+  PHASE_FORCE_CALC,    /* ghost_update */
+  PHASE_GHOST_UPDATE,  /* resort */
+  PHASE_FORCE_CALC,    /* thermostat */
+  PHASE_FORCE_CALC,    /* long_range */
+  PHASE_LONG_RANGE,    /* p3m */
+  PHASE_LONG_RANGE,    /* elc */
+  PHASE_LONG_RANGE,    /* mmm2d */
+  PHASE_LONG_RANGE,    /* maggs */
+  PHASE_LONG_RANGE,    /* dp3m */
+  PHASE_LONG_RANGE,    /* mdlc */
+  PHASE_LONG_RANGE,    /* dipolar_direct */
+  PHASE_LONG_RANGE,    /* scafacos */
+  PHASE_FORCE_CALC,    /* short_range */
+  PHASE_SHORT_RANGE,   /* verlet_rebuild */
+  PHASE_FORCE_CALC,    /* ghost_forces */
+  PHASE_INTEGRATE      /* lb */
+};
+
+double phase_timer_start[PHASE_N];
+double phase_timer_sum[PHASE_N];
+
+/** Number of integration steps timed on this node. */
+static int phase_timer_steps = 0;
+
+void phase_timers_count_step()
+{
+  if (phase_timers)
+    phase_timer_steps++;
+}
+
+void phase_timers_reset()
+{
+  for (int i = 0; i < PHASE_N; i++)
+    phase_timer_sum[i] = 0.0;
+  phase_timer_steps = 0;
+}
+
+void phase_timers_gather(double *stats)
+{
+  double per_step[PHASE_N], t_min[PHASE_N], t_max[PHASE_N], t_sum[PHASE_N];
+  /* times outside of a complete step are still reported */
+  int steps = (phase_timer_steps > 0) ? phase_timer_steps : 1;
+
+  for (int i = 0; i < PHASE_N; i++)
+    per_step[i] = phase_timer_sum[i]/steps;
+
+  MPI_Reduce(per_step, t_min, PHASE_N, MPI_DOUBLE, MPI_MIN, 0, comm_cart);
+  MPI_Reduce(per_step, t_max, PHASE_N, MPI_DOUBLE, MPI_MAX, 0, comm_cart);
+  MPI_Reduce(per_step, t_sum, PHASE_N, MPI_DOUBLE, MPI_SUM, 0, comm_cart);
+
+  if (this_node == 0)
+    for (int i = 0; i < PHASE_N; i++) {
+      stats[3*i]     = t_min[i];
+      stats[3*i + 1] = t_sum[i]/n_nodes;
+      stats[3*i + 2] = t_max[i];
+    }
+}
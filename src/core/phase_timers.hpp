@@ -0,0 +1,124 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PHASE_TIMERS_H
+#define PHASE_TIMERS_H
+/** \file phase_timers.hpp
+ *
+ *  Wall clock timers for the phases of the integration step.
+ *
+ *  If \ref phase_timers is set, every node accumulates the time spent
+ *  in each phase of \ref integrate_vv. The phases form a tree (\ref
+ *  phase_timer_parent), e.g. the short range forces are part of the
+ *  force calculation, which is part of the integration step. A phase
+ *  may be entered several times per step, the times are summed.
+ *
+ *  If the timers are switched off, every \ref phase_timer_begin and
+ *  \ref phase_timer_end only costs a test of \ref phase_timers. The
+ *  timers must not be used inside of OpenMP parallel regions.
+ */
+#include <mpi.h>
+
+/** The timed phases. The parent of a phase always comes before it. */
+enum PhaseTimer {
+  /** one integration step */
+  PHASE_INTEGRATE,
+  /** propagation of the particles */
+  PHASE_PROPAGATE,
+  /** \ref force_calc */
+  PHASE_FORCE_CALC,
+  /** update of the ghost positions before the force calculation */
+  PHASE_GHOST_UPDATE,
+  /** resorting of the particles to the cells and nodes */
+  PHASE_RESORT,
+  /** force initialization including the thermostat forces */
+  PHASE_THERMOSTAT,
+  /** \ref calc_long_range_forces */
+  PHASE_LONG_RANGE,
+  /** P3M for charges, on the CPU or the GPU */
+  PHASE_P3M,
+  /** ELC correction to P3M */
+  PHASE_ELC,
+  /** MMM2D far formula */
+  PHASE_MMM2D,
+  /** MEMD */
+  PHASE_MAGGS,
+  /** P3M for dipoles */
+  PHASE_DP3M,
+  /** MDLC correction to the dipolar methods */
+  PHASE_MDLC,
+  /** direct summation of the dipolar interaction */
+  PHASE_DIPOLAR_DIRECT,
+  /** long range methods of the ScaFaCoS library */
+  PHASE_SCAFACOS,
+  /** short range forces, i.e. the pair loop and the bonded forces */
+  PHASE_SHORT_RANGE,
+  /** steps with a Verlet list rebuild. The pair forces of these steps
+      are calculated together with the lists and are included. */
+  PHASE_VERLET_REBUILD,
+  /** collection of the ghost forces */
+  PHASE_GHOST_FORCES,
+  /** lattice Boltzmann update, on the CPU or the GPU */
+  PHASE_LB,
+  /** number of phases */
+  PHASE_N
+};
+
+/** Switch for the timers (setmd phase_timers). Setting it, also to
+    its current value, resets the accumulated times. */
+extern int phase_timers;
+
+/** Names of the phases. */
+extern const char *phase_timer_names[PHASE_N];
+
+/** Phase that a phase is part of, -1 for the top level. */
+extern const int phase_timer_parent[PHASE_N];
+
+/** Start time of the phases that are currently timed. */
+extern double phase_timer_start[PHASE_N];
+
+/** Accumulated time of the phases on this node. */
+extern double phase_timer_sum[PHASE_N];
+
+/** Start timing a phase. */
+inline void phase_timer_begin(int phase)
+{
+  if (phase_timers)
+    phase_timer_start[phase] = MPI_Wtime();
+}
+
+/** Stop timing a phase. */
+inline void phase_timer_end(int phase)
+{
+  if (phase_timers)
+    phase_timer_sum[phase] += MPI_Wtime() - phase_timer_start[phase];
+}
+
+/** Count a completed integration step. */
+void phase_timers_count_step();
+
+/** Reset the accumulated times and steps of this node. */
+void phase_timers_reset();
+
+/** Collect the average time per integration step of all phases
+    from all nodes. Has to be called on all nodes.
+    @param stats on the master node, for each phase the minimum, mean
+    and maximum over the nodes. Has to hold 3*\ref PHASE_N values. */
+void phase_timers_gather(double *stats);
+
+#endif
@@ -914,8 +914,9 @@ int local_stress_tensor_calc(DoubleList *TensorInBin, int bins[3], int periodic[
   int c, np, n, bin;
   double centre[3];
   Cell *cell;
-  Particle *p1, *p2, **pairs;
+  Particle *p1, *p2;
   Particle *particles;
+  IA_Neighbor_List *il;
   double force[3];
   int k,l;
   int type_num;
@@ -991,15 +992,12 @@ int local_stress_tensor_calc(DoubleList *TensorInBin, int bins[3], int periodic[
       }
     }
 
-    // Loop cell neighbors
-    for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-      pairs = dd.cell_inter[c].nList[n].vList.pair;
-      np    = dd.cell_inter[c].nList[n].vList.n;
-
-      // verlet list loop //
-      for(i=0; i<2*np; i+=2) {
-	p1 = pairs[i];                    // pointer to particle 1
-	p2 = pairs[i+1];                  // pointer to particle 2
+    // verlet list loop
+    il = &dd.cell_inter[c];
+    for (n = 0; n < il->vList.np; n++) {
+      for (i = il->vList.start[n]; i < il->vList.start[n+1]; i++) {
+	p1 = &particles[n];                             // pointer to particle 1
+	p2 = dd_pair_partner(il, il->vList.partner[i]); // pointer to particle 2
 	if ((incubewithskin(p1->r.p,centre,range)) && (incubewithskin(p2->r.p,centre,range))) {
 	  get_nonbonded_interaction(p1,p2, force);
 	  PTENSOR_TRACE(fprintf(stderr,"%d:Looking at pair %d %d force is %f %f %f\n",this_node,p1->p.identity, p2->p.identity,force[0],force[1], force[2]));
@@ -34,6 +34,7 @@ using Communication::mpiCallbacks;
 std::mt19937 generator;
 std::normal_distribution<double> normal_distribution(0,1);
 std::uniform_real_distribution<double> uniform_real_distribution(0,1);
+uint32_t noise_seed = 0;
 
 /** Local functions */
 
@@ -65,6 +66,8 @@ void mpi_random_seed_slave(int pnode, int cnt) {
   RANDOM_TRACE(printf("%d: Received seed %d\n",this_node,this_idum));
 
   init_random_seed(this_idum);
+
+  MPI_Bcast(&noise_seed, 1, MPI_UNSIGNED, 0, comm_cart);
 }
 
 void mpi_random_seed(int cnt, vector<int> &seeds) {
@@ -76,6 +79,10 @@ void mpi_random_seed(int cnt, vector<int> &seeds) {
   RANDOM_TRACE(printf("%d: Received seed %d\n",this_node,this_idum));
 
   init_random_seed(this_idum);
+
+  /* the counter-based generator uses the same seed everywhere */
+  noise_seed = (uint32_t)seeds[0];
+  MPI_Bcast(&noise_seed, 1, MPI_UNSIGNED, 0, comm_cart);
 }
 
 void mpi_random_set_stat_slave(int, int) {
@@ -30,6 +30,9 @@
 #include <random>
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <cmath>
+#include "threads.hpp"
 
 namespace Random {
 extern std::mt19937 generator;
@@ -57,6 +60,18 @@ std::string mpi_random_get_stat();
  */
 void mpi_random_set_stat(const std::vector<std::string> &stat);
 
+/**
+ * @brief Get a string representation of the state of the PRNG
+ *        of this node.
+ */
+std::string get_state();
+
+/**
+ * @brief Set the state of the PRNG of this node from a string
+ *        representation returned by get_state.
+ */
+void set_state(const std::string &s);
+
 /**
  * @bief Initialize PRNG with MPI rank as seed.
  */
@@ -69,6 +84,100 @@ void init_random(void);
  */
 void init_random_seed(int seed);
 
+/** \name Counter-based generator
+ *
+ *  Random numbers that are a function of a counter and a key,
+ *  computed with the Philox4x32-10 bijection of Salmon et al.,
+ *  "Parallel random numbers: as easy as 1, 2, 3" (SC11). The thermal
+ *  noise is keyed on the particle identity or the global lattice
+ *  site and a step counter of the thermostat, so it does not depend
+ *  on the number of nodes or threads and on the order in which the
+ *  particles or sites are visited. The generator has no state that
+ *  has to be updated, so it can be used concurrently.
+ */
+/*@{*/
+
+/** Streams of the counter-based generator. Each user draws from its
+    own stream, so that the numbers of different users are
+    independent even for the same counter. */
+enum NoiseStream {
+  NOISE_LANGEVIN = 0,
+  NOISE_LANGEVIN_ROTATION,
+  NOISE_LB_FLUID,
+  NOISE_LB_COUPLING,
+  NOISE_REACTION
+};
+
+/** Seed of the counter-based generator, the same on all nodes. It
+    is set to the seed of the first node by \ref mpi_random_seed. */
+extern uint32_t noise_seed;
+
+/** The Philox4x32-10 bijection.
+ *
+ * @param ctr  counter, overwritten with the four random words.
+ * @param k0   first word of the key.
+ * @param k1   second word of the key.
+ */
+inline void philox4x32(uint32_t ctr[4], uint32_t k0, uint32_t k1) {
+  for (int round = 0; round < 10; round++) {
+    const uint64_t p0 = (uint64_t)0xD2511F53u * ctr[0];
+    const uint64_t p1 = (uint64_t)0xCD9E8D57u * ctr[2];
+    const uint32_t c1 = ctr[1], c3 = ctr[3];
+    ctr[0] = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+    ctr[1] = (uint32_t)p1;
+    ctr[2] = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+    ctr[3] = (uint32_t)p0;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+}
+
+/** Uniform random numbers in (0,1) for a batch of consecutive ids.
+ *
+ * @param stream  the \ref NoiseStream.
+ * @param step    step counter of the user.
+ * @param id      first id of the batch, e.g. particle identity or
+ *                global lattice site.
+ * @param block   block of four numbers per id, if more than four
+ *                numbers per id and step are needed.
+ * @param n       number of ids.
+ * @param u       four arrays of n random numbers (Output).
+ */
+inline void noise_uniform_batch(int stream, uint64_t step, uint32_t id, uint32_t block,
+                                int n, double *u[4]) {
+  const uint32_t step_lo = (uint32_t)step, step_hi = (uint32_t)(step >> 32);
+  const uint32_t k0 = noise_seed, k1 = (uint32_t)stream | (block << 8);
+  double *u0 = u[0], *u1 = u[1], *u2 = u[2], *u3 = u[3];
+
+  ES_OMP_PRAGMA(omp simd)
+  for (int k = 0; k < n; k++) {
+    uint32_t ctr[4] = { id + (uint32_t)k, step_lo, step_hi, 0 };
+    philox4x32(ctr, k0, k1);
+    /* map to the centers of 2^32 bins, so 0 and 1 are excluded */
+    u0[k] = (ctr[0] + 0.5) * 2.3283064365386963e-10;
+    u1[k] = (ctr[1] + 0.5) * 2.3283064365386963e-10;
+    u2[k] = (ctr[2] + 0.5) * 2.3283064365386963e-10;
+    u3[k] = (ctr[3] + 0.5) * 2.3283064365386963e-10;
+  }
+}
+
+/** Four uniform random numbers in (0,1), see \ref noise_uniform_batch. */
+inline void noise_uniform4(int stream, uint64_t step, uint32_t id, uint32_t block, double u[4]) {
+  double *uu[4] = { &u[0], &u[1], &u[2], &u[3] };
+  noise_uniform_batch(stream, step, id, block, 1, uu);
+}
+
+/** Turn two uniform random numbers in (0,1) into two numbers from the
+    normal distribution with mean 0 and variance 1 (Box-Muller). */
+inline void noise_box_muller(double &u0, double &u1) {
+  const double r = sqrt(-2.0*log(u0));
+  const double phi = 2.0*M_PI*u1;
+  u0 = r*cos(phi);
+  u1 = r*sin(phi);
+}
+
+/*@}*/
+
 } /* Random */
 
 /**
@@ -29,6 +29,8 @@
 #include "errorhandling.hpp"
 #include "cells.hpp"
 #include "domain_decomposition.hpp"
+#include "random.hpp"
+#include "threads.hpp"
 #include <vector>
 #include <algorithm>
 
@@ -36,17 +38,26 @@ reaction_struct reaction;
 
 #ifdef CATALYTIC_REACTIONS
 
+uint64_t reaction_noise_step = 0;
+
+/** Partner of the draws in \ref reaction_uniform4 that only concern a
+    single particle. */
+#define REACTION_NO_PARTNER (-1)
+
 void reactions_sanity_checks()
 {
 
   if(reaction.ct_rate != 0.0) {
 
-    if( dd.use_vList == 0 || cell_structure.type != CELL_STRUCTURE_DOMDEC) {
-        runtimeErrorMsg() <<"The CATALYTIC_REACTIONS feature requires verlet lists and domain decomposition";
+    if(cell_structure.type != CELL_STRUCTURE_DOMDEC) {
+        runtimeErrorMsg() <<"The CATALYTIC_REACTIONS feature requires domain decomposition";
     }
 
-    if(max_cut < reaction.range) {
-        runtimeErrorMsg() <<"Reaction range of " << reaction.range << " exceeds maximum cutoff of " << max_cut;
+    /* in the swap mode, the catalyzers competing for a particle are
+       up to twice the range apart */
+    double range = reaction.swap ? 2*reaction.range : reaction.range;
+    if(max_cut < range) {
+        runtimeErrorMsg() <<"Reaction range of " << range << " exceeds maximum cutoff of " << max_cut;
     }
   }
 }
@@ -72,157 +83,142 @@ void local_setup_reaction() {
   /* Make ESPResSo aware that reactants and catalyst are interacting species */
   IA_parameters *data = get_ia_param_safe(reaction.reactant_type, reaction.catalyzer_type);
   
-  /* Used for the range of the verlet lists */
-  data->REACTION_range = reaction.range;
+  /* Used for the cell size, so that the neighbor cells of a particle
+     contain all its reaction partners. In the swap mode, they also
+     have to contain the catalyzers that compete for the partners. */
+  data->REACTION_range = reaction.swap ? 2*reaction.range : reaction.range;
 
   /* Broadcast interaction parameters */
   mpi_bcast_ia_params(reaction.reactant_type, reaction.catalyzer_type);
 }
 
+// Four uniform random numbers in (0,1) for the particle id and its
+// reaction partner in the current step. They only depend on the
+// identities, so all nodes and threads that see the pair draw the
+// same numbers.
+static void reaction_uniform4(int id, int partner, double u[4])
+{
+  uint32_t ctr[4] = { (uint32_t)id, (uint32_t)partner,
+                      (uint32_t)reaction_noise_step,
+                      (uint32_t)(reaction_noise_step >> 32) };
+  Random::philox4x32(ctr, Random::noise_seed, Random::NOISE_REACTION);
+  for (int k = 0; k < 4; k++)
+    u[k] = (ctr[k] + 0.5) * 2.3283064365386963e-10;
+}
+
+// The 27 cells around a local cell of the domain decomposition,
+// including the cell itself and the ghost cells. Since the cells are
+// at least as large as the reaction range, they contain all reaction
+// partners of the particles in the cell.
+static void reaction_cell_neighbors(Cell *cell, Cell *around[27])
+{
+  int a, b, c, n = 0;
+  get_grid_pos(cell - cells, &a, &b, &c, dd.ghost_cell_grid);
+  for (int k = -1; k <= 1; k++)
+    for (int j = -1; j <= 1; j++)
+      for (int i = -1; i <= 1; i++)
+        around[n++] = &cells[get_linear_index(a + i, b + j, c + k, dd.ghost_cell_grid)];
+}
+
 void integrate_reaction_noswap() {
-  int c, np, n, i,
-    check_catalyzer;
-  Particle *p1, *p2, **pairs;
-  Cell *cell;
-  double dist2, vec21[3],
-    ct_ratexp, eq_ratexp,
-    rand, bernoulli;
+  double ct_ratexp, eq_ratexp;
 
   if(reaction.ct_rate > 0.0) {
 
-    /* Determine the reaction rate */
+    /* Determine the reaction rates */
     ct_ratexp = exp(-time_step*reaction.ct_rate);
-    
-    on_observable_calc();
-
-    for (c = 0; c < local_cells.n; c++) {
+    eq_ratexp = exp(-time_step*reaction.eq_rate);
 
-      /* Take into account only those cell neighbourhoods for which
-         the central cell contains a catalyzer particle */
+    on_observable_calc();
 
-      check_catalyzer = 0;
+    /* The new types are collected first and applied afterwards, so
+       that the threads do not change particles that other threads
+       are reading. */
+    std::vector<int> offset(local_cells.n + 1, 0);
+    for (int c = 0; c < local_cells.n; c++)
+      offset[c + 1] = offset[c] + local_cells.cell[c]->n;
+    std::vector<int> new_type(offset[local_cells.n]);
 
-      cell = local_cells.cell[c];
-      p1   = cell->part;
-      np  = cell->n;
-      
-      for(i = 0; i < np; i++) {
-        if(p1[i].p.type == reaction.catalyzer_type) {
-          check_catalyzer = 1;
-          break;
-        }
-      }	
-
-      /* If the central cell contains a catalyzer particle, ...*/
-      if ( check_catalyzer != 0 ) {
-
-        /* Loop cell neighbors */
-        for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-          pairs = dd.cell_inter[c].nList[n].vList.pair;
-          np = dd.cell_inter[c].nList[n].vList.n;
-
-          /* Verlet list loop */
-          for(i = 0; i < 2 * np; i += 2) {
-            p1 = pairs[i];   //pointer to particle 1
-            p2 = pairs[i+1]; //pointer to particle 2
-
-            if( (p1->p.type == reaction.reactant_type &&  p2->p.type == reaction.catalyzer_type) || (p2->p.type == reaction.reactant_type &&  p1->p.type == reaction.catalyzer_type) ) {
-              get_mi_vector(vec21, p1->r.p, p2->r.p);
-              dist2 = sqrlen(vec21);
-              
-              /* Count the number of times a reactant particle is
-                 checked against a catalyst */
-              if(dist2 < reaction.range * reaction.range) {
-
-                if(p1->p.type == reaction.reactant_type) {
-                  p1->p.catalyzer_count++;
-                }
-                else {
-                  p2->p.catalyzer_count++;
-                }
-              }
-            }  
+    ES_OMP_PRAGMA(omp parallel)
+    {
+      std::vector<int> catalyzers;
+      Cell *around[27];
+      double vec21[3], u[4];
+
+      ES_OMP_PRAGMA(omp for schedule(dynamic))
+      for (int c = 0; c < local_cells.n; c++) {
+        Cell *cell = local_cells.cell[c];
+        bool have_neighbors = false;
+
+        for (int i = 0; i < cell->n; i++) {
+          Particle &p1 = cell->part[i];
+          int type = p1.p.type;
+
+          if (type != reaction.reactant_type && type != reaction.product_type) {
+            new_type[offset[c] + i] = type;
+            continue;
           }
-        }
-      }
-    }
-
-    /* Now carry out the reaction on the particles which are tagged */
-    for (c = 0; c < local_cells.n; c++) {
-      cell = local_cells.cell[c];
-      p1   = cell->part;
-      np  = cell->n;
-        
-      for(i = 0; i < np; i++) {
-        if(p1[i].p.type == reaction.reactant_type){
-
-          if(p1[i].p.catalyzer_count > 0 ){
-
-            if( reaction.sing_mult == 0 )
-            {
-              rand = d_random();
+          reaction_uniform4(p1.p.identity, REACTION_NO_PARTNER, u);
 
-              bernoulli = pow(ct_ratexp, p1[i].p.catalyzer_count);
-
-              if(rand > bernoulli) {
-                p1[i].p.type = reaction.product_type; }
-            
+          if (type == reaction.reactant_type) {
+            if (!have_neighbors) {
+              reaction_cell_neighbors(cell, around);
+              have_neighbors = true;
             }
-            else /* We only consider each reactant once */
-            {
-              rand = d_random();
 
-              if(rand > ct_ratexp) {
-                p1[i].p.type = reaction.product_type; }
+            /* Collect the catalyzers within the range. A catalyzer
+               can be seen both as real particle and as periodic
+               image in the ghost cells, so it is only counted once. */
+            catalyzers.clear();
+            for (int n = 0; n < 27; n++) {
+              for (int j = 0; j < around[n]->n; j++) {
+                Particle &p2 = around[n]->part[j];
+                if (p2.p.type != reaction.catalyzer_type)
+                  continue;
+                get_mi_vector(vec21, p1.r.p, p2.r.p);
+                if (sqrlen(vec21) < reaction.range * reaction.range)
+                  catalyzers.push_back(p2.p.identity);
+              }
             }
-            
-            p1[i].p.catalyzer_count = 0;
-          }
-        }
-      }
-    }
-
-    /* We only need to do something when the equilibrium 
-       reaction rate constant is nonzero */
-    if (reaction.eq_rate > 0.0) { 
-
-      eq_ratexp = exp(-time_step*reaction.eq_rate);
-
-      for (c = 0; c < local_cells.n; c++) {
-        cell = local_cells.cell[c];
-        p1   = cell->part;
-        np  = cell->n;
-    
-        /* Convert products into reactants and vice versa
-           according to the specified rate constant */
-        for(i = 0; i < np; i++) {
-
-          if(p1[i].p.type == reaction.product_type) {
-            rand = d_random();
-            
-            if(rand > eq_ratexp) {
-              p1[i].p.type=reaction.reactant_type;
+            std::sort(catalyzers.begin(), catalyzers.end());
+            int count = std::unique(catalyzers.begin(), catalyzers.end()) - catalyzers.begin();
+
+            if (count > 0) {
+              /* With react_once, each reactant is only considered
+                 once, independent of the number of catalyzers */
+              double bernoulli = (reaction.sing_mult == 0) ? pow(ct_ratexp, count) : ct_ratexp;
+              if (u[0] > bernoulli)
+                type = reaction.product_type;
             }
           }
-          else if(p1[i].p.type == reaction.reactant_type) {
-            rand = d_random();
-            
-            if(rand > eq_ratexp) {
-              p1[i].p.type=reaction.product_type;
-            }
+
+          /* Convert products into reactants and vice versa according
+             to the equilibrium rate constant */
+          if (reaction.eq_rate > 0.0 && u[1] > eq_ratexp) {
+            if (type == reaction.product_type)
+              type = reaction.reactant_type;
+            else
+              type = reaction.product_type;
           }
 
+          new_type[offset[c] + i] = type;
         }
       }
     }
 
+    for (int c = 0; c < local_cells.n; c++) {
+      Cell *cell = local_cells.cell[c];
+      for (int i = 0; i < cell->n; i++)
+        cell->part[i].p.type = new_type[offset[c] + i];
+    }
+
     on_particle_change();
   }
 }
 
 #ifdef ROTATION
 
-bool in_lower_half_space(Particle p1, Particle p2)
+bool in_lower_half_space(Particle &p1, Particle &p2)
 {
   // This function determines whether the particle p2 is in the lower
   // half space of particle p1
@@ -233,29 +229,60 @@ bool in_lower_half_space(Particle p1, Particle p2)
   return (sgn+1)/2;
 }
 
+// Whether the particle p can react at the catalyzer c: a reactant in
+// the lower or a product in the upper half space within the range
+static bool swap_candidate(Particle &c, Particle &p)
+{
+  double vec21[3];
+  get_mi_vector(vec21, c.r.p, p.r.p);
+  if (sqrlen(vec21) >= reaction.range * reaction.range)
+    return false;
+
+  if (p.p.type == reaction.reactant_type)
+    return in_lower_half_space(c, p);
+  if (p.p.type == reaction.product_type)
+    return !in_lower_half_space(c, p);
+  return false;
+}
 
-void integrate_reaction_swap()
+// Whether the catalyzer c claims its candidate p. If p can react at
+// several catalyzers, it only reacts at the one with the smallest
+// random number for the pair, so that it is not converted twice. The
+// competitors are at most twice the range away from c, and therefore
+// in the cells around c.
+static bool swap_claims(Particle &c, Particle &p, Cell *around[27])
 {
-  int np, check_catalyzer;
-  Particle *p_local, *p_neigh;
-  int pairs;
-  Cell *cell;
-  double dist2, vec21[3], ct_ratexp, eq_ratexp, rand;
-  int n_reactions;
-
-  std::vector<int> catalyzers, reactants, products;
-
-  // If multiple catalyzers get close to each other, they might eat up
-  // each others reactants.  If we traverse the cells in a sorted
-  // manner, then catalyzers in the upper left will use up all the
-  // reactants of the catalyzers which are below right of them.  This
-  // process is biased.  To rectify this issue we set up a vector
-  // which goes through the cells in a randomized manner.
-  std::vector<int> rand_cells(local_cells.n);
-  for ( int i = 0; i < local_cells.n; i++ )
-    rand_cells[i] = i;
-  std::random_shuffle(rand_cells.begin(), rand_cells.end());
+  double u[4];
+  reaction_uniform4(p.p.identity, c.p.identity, u);
+  const double u_c = u[0];
+
+  for (int n = 0; n < 27; n++) {
+    for (int j = 0; j < around[n]->n; j++) {
+      Particle &q = around[n]->part[j];
+      if (q.p.type != reaction.catalyzer_type || q.p.identity == c.p.identity ||
+          !swap_candidate(q, p))
+        continue;
+      reaction_uniform4(p.p.identity, q.p.identity, u);
+      if (u[0] < u_c || (u[0] == u_c && q.p.identity < c.p.identity))
+        return false;
+    }
+  }
+  return true;
+}
 
+typedef struct {
+  int id;
+  Particle *p;
+  /** random number for the conversion */
+  double convert;
+  /** random number for the choice of the partners */
+  double choice;
+} reaction_candidate;
+
+void integrate_reaction_swap()
+{
+  double ct_ratexp;
+  std::vector<int> flips;
 
   if ( reaction.ct_rate > 0.0 )
   {
@@ -264,165 +291,127 @@ void integrate_reaction_swap()
 
     on_observable_calc();
 
-    // Iterate over all the local cells
-    for ( std::vector<int>::iterator c = rand_cells.begin(); c != rand_cells.end(); c++ )
+    // Each real catalyzer determines the particles it converts. Since
+    // the random numbers only depend on the identities and each
+    // particle is claimed by a single catalyzer, the result does not
+    // depend on the order of the cells and catalyzers.
+    ES_OMP_PRAGMA(omp parallel)
     {
-      // Take into account only those cell neighborhoods for which
-      // the central cell contains a catalyzer particle
-      cell    = local_cells.cell[*c];
-      p_local = cell->part;
-      np      = cell->n;
-
-      // We find all catalyzers in a cell and then randomize their ids
-      // for the same reason as above and then start the catalytic
-      // reaction procedure
-      catalyzers.clear();
-      for ( int i = 0; i < np; i++ )
-      {
-        if ( p_local[i].p.type == reaction.catalyzer_type )
-          catalyzers.push_back(i);
-      }
-      std::random_shuffle(catalyzers.begin(), catalyzers.end());
-
-      // Loop cell neighbors
-      //for ( int n = 0; n < dd.cell_inter[*c].n_neighbors; n++ )
-      for ( int n = 0; n < n_cells; n++ )
-      {
-        cell    = &cells[n]; //dd.cell_inter[*c].nList[n].pList;
-        p_neigh = cell->part;
-        np      = cell->n;
-
-        // We loop over all the catalyzer particles
-        for ( std::vector<int>::iterator id = catalyzers.begin(); id != catalyzers.end(); id++ )
-        {
-          reactants.clear();
-          products.clear();
-
-          // Particle list loop
-          for ( int i = 0; i < np; i++ )
-          {
-            // Get the distance between a catalyst and another particle
-            get_mi_vector(vec21, p_local[*id].r.p, p_neigh[i].r.p);
-            dist2 = sqrlen(vec21);
-
-            // Check if the distance is within the reaction range and
-            // check if no reaction has taken place on the particle in
-            // the current step
-            if (dist2 < reaction.range * reaction.range && p_neigh[i].p.catalyzer_count == 0)
-            {
-              // If the particle is of correct type AND resides in the
-              // correct half space, append it to the lists of viable
-              // reaction candidates
-              if ( p_neigh[i].p.type == reaction.reactant_type &&  in_lower_half_space(p_local[*id],p_neigh[i]) )
-                reactants.push_back(i);
-              if ( p_neigh[i].p.type == reaction.product_type  && !in_lower_half_space(p_local[*id],p_neigh[i]) )
-                products.push_back(i);
-            }
+      std::vector<int> local_flips;
+      std::vector<reaction_candidate> candidates, reactants, products;
+      Cell *around[27];
+      double u[4];
+
+      ES_OMP_PRAGMA(omp for schedule(dynamic))
+      for (int c = 0; c < local_cells.n; c++) {
+        Cell *cell = local_cells.cell[c];
+        bool have_neighbors = false;
+
+        for (int i = 0; i < cell->n; i++) {
+          Particle &cat = cell->part[i];
+          if (cat.p.type != reaction.catalyzer_type)
+            continue;
+          if (!have_neighbors) {
+            reaction_cell_neighbors(cell, around);
+            have_neighbors = true;
           }
 
-          // If reactants and products were found, perform the reaction
-          if ( reactants.size() > 0 && products.size() > 0 )
-          {
-            // There cannot be more reactions than the minimum of
-            // the number of reactants and products.  Hence we need
-            // to determine which number is smaller and also count
-            // the number of reactions.
-            n_reactions = 0;
-
-            // If there are more products than reactants...
-            if ( reactants.size() <= products.size() )
-            {
-              // ...iterate the reactant...
-              for ( std::vector<int>::iterator rt = reactants.begin(); rt < reactants.end(); rt++ )
-              {
-                // ...draw a random number number and compare to the
-                // reaction rate...
-                rand = d_random();
-                if( rand > ct_ratexp )
-                {
-                  // ...tag the particle for modification...
-                  p_neigh[*rt].p.catalyzer_count = 1;
-                  n_reactions++;
-                }
+          // The viable reaction candidates, each only once, even if it
+          // is seen as real particle and as periodic image
+          candidates.clear();
+          for (int n = 0; n < 27; n++) {
+            for (int j = 0; j < around[n]->n; j++) {
+              Particle &p = around[n]->part[j];
+              if (swap_candidate(cat, p)) {
+                reaction_candidate rc = { p.p.identity, &p, 0.0, 0.0 };
+                candidates.push_back(rc);
               }
-
-              // ...tag as many products as there will be reactions
-              // at random
-              std::random_shuffle(products.begin(), products.end());
-              for ( int p = 0; p < n_reactions; p++ )
-                p_neigh[products[p]].p.catalyzer_count = 1;
             }
+          }
+          std::sort(candidates.begin(), candidates.end(),
+                    [](const reaction_candidate &a, const reaction_candidate &b) {
+                      return a.id < b.id;
+                    });
+          candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                                       [](const reaction_candidate &a, const reaction_candidate &b) {
+                                         return a.id == b.id;
+                                       }),
+                           candidates.end());
+
+          reactants.clear();
+          products.clear();
+          for (reaction_candidate &rc : candidates) {
+            if (!swap_claims(cat, *rc.p, around))
+              continue;
+            reaction_uniform4(rc.id, cat.p.identity, u);
+            rc.convert = u[1];
+            rc.choice = u[2];
+            if (rc.p->p.type == reaction.reactant_type)
+              reactants.push_back(rc);
             else
-            {
-              // Same as above, but for the case that the number of
-              // reactants is greater than the number of products
-              for ( std::vector<int>::iterator pt = products.begin(); pt < products.end(); pt++ )
-              {
-                rand = d_random();
-                if( rand > ct_ratexp )
-                {
-                  p_neigh[*pt].p.catalyzer_count = 1;
-                  n_reactions++;
-                }
-              }
+              products.push_back(rc);
+          }
 
-              std::random_shuffle(reactants.begin(), reactants.end());
-              for ( int p = 0; p < n_reactions; p++ )
-                p_neigh[reactants[p]].p.catalyzer_count = 1;
+          // There cannot be more reactions than the minimum of the
+          // number of reactants and products. The species with fewer
+          // particles is converted according to the reaction rate,
+          // and as many particles of the other species at random.
+          std::vector<reaction_candidate> &fewer =
+            (reactants.size() <= products.size()) ? reactants : products;
+          std::vector<reaction_candidate> &more =
+            (reactants.size() <= products.size()) ? products : reactants;
+          if (fewer.empty())
+            continue;
+
+          int n_reactions = 0;
+          for (const reaction_candidate &rc : fewer) {
+            if (rc.convert > ct_ratexp) {
+              local_flips.push_back(rc.id);
+              n_reactions++;
             }
           }
+
+          std::sort(more.begin(), more.end(),
+                    [](const reaction_candidate &a, const reaction_candidate &b) {
+                      return a.choice < b.choice || (a.choice == b.choice && a.id < b.id);
+                    });
+          for (int p = 0; p < n_reactions; p++)
+            local_flips.push_back(more[p].id);
         }
       }
+
+      ES_OMP_PRAGMA(omp critical)
+      flips.insert(flips.end(), local_flips.begin(), local_flips.end());
     }
 
-    // Apply the changes to the tagged particles.  Therefore, again
-    // loop over all cells
-    for ( std::vector<int>::iterator c = rand_cells.begin(); c != rand_cells.end(); c++)
-    {
-      cell    = local_cells.cell[*c];
-      p_local = cell->part;
-      np      = cell->n;
-      // Particle list loop
-      for ( int i = 0; i < np; i++ )
-      {
-        // If the particle has been tagged we perform the changes
-        if ( p_local[i].p.catalyzer_count != 0 )
-        {
+    // The converted particles can be ghosts of a neighboring node,
+    // which therefore has to be told about them.
+    std::vector<char> buf;
+    cells_neighbor_exchange(flips.data(), flips.size()*sizeof(int), buf);
+    const int *recv = reinterpret_cast<const int *>(buf.data());
+    flips.insert(flips.end(), recv, recv + buf.size()/sizeof(int));
+    std::sort(flips.begin(), flips.end());
+
+    // Apply the changes to the real particles of this node
+    for (int c = 0; c < local_cells.n; c++) {
+      Cell *cell = local_cells.cell[c];
+      for (int i = 0; i < cell->n; i++) {
+        Particle *p = &cell->part[i];
+        if (!std::binary_search(flips.begin(), flips.end(), p->p.identity))
+          continue;
+
 #ifdef ELECTROSTATICS
-          // Flip charge
-          p_local[i].p.q *= -1;
+        // Flip charge
+        p->p.q *= -1;
 #endif /* ELECTROSTATICS */
-          
-          // Flip type
-          if ( p_local[i].p.type == reaction.reactant_type )
-            p_local[i].p.type = reaction.product_type;
-          else
-            p_local[i].p.type = reaction.reactant_type;
-
-          // Reset the tag for the next step
-          p_local[i].p.catalyzer_count = 0;
-        }
-      }
-    }
 
-    /* TODO: remove if proved to be unnecessary
-    // Reset all the catalyzer counts, such that in the next time step
-    // a new reaction can take place
-    for ( std::vector<int>::iterator c = rand_cells.begin(); c != rand_cells.end(); c++)
-    {
-      for ( int n = 0; n < dd.cell_inter[*c].n_neighbors; n++ )
-      {
-        cell = dd.cell_inter[*c].nList[n].pList;
-        p2   = cell->part;
-        np   = cell->n;
-        // Particle list loop
-        for ( int i = 0; i < np; i++ )
-        {
-          p2[i].p.catalyzer_count = 0;
-        }
+        // Flip type
+        if ( p->p.type == reaction.reactant_type )
+          p->p.type = reaction.product_type;
+        else
+          p->p.type = reaction.reactant_type;
       }
     }
-    */
 
     on_particle_change();
   }
@@ -437,6 +426,8 @@ void integrate_reaction() {
   else
 #endif // ROTATION
     integrate_reaction_noswap();
+
+  reaction_noise_step++;
 }
 
 #endif
@@ -24,6 +24,7 @@
  *
  */
  
+#include <cstdint>
 #include "utils.hpp"
 #include "particle_data.hpp"
 
@@ -47,7 +48,16 @@ void reactions_sanity_checks();
     that the verlet radius is equal or bigger than the reaction range.
 **/
 void local_setup_reaction();
+/** Carry out the reactions of one time step. The cells are processed
+    in parallel by the threads, and the random numbers are drawn from
+    the counter-based generator keyed on the particle identities and
+    \ref reaction_noise_step, so that the result does not depend on
+    the number of nodes and threads. Has to be called on all nodes. */
 void integrate_reaction();
+
+/** Step counter of the reaction noise, incremented by \ref
+    integrate_reaction. */
+extern uint64_t reaction_noise_step;
 #endif
 
 #endif /* ifdef REACTION_H */
@@ -0,0 +1,147 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file skin_tune.cpp
+ *
+ *  Implementation of \ref skin_tune.hpp "skin_tune.hpp".
+ */
+#include <mpi.h>
+#include "skin_tune.hpp"
+#include "communication.hpp"
+#include "cells.hpp"
+#include "domain_decomposition.hpp"
+#include "integrate.hpp"
+#include "interaction_data.hpp"
+#include "utils.hpp"
+
+/** Relative change of the skin when starting a search. */
+#define SKIN_TUNE_INITIAL_STEP 0.2
+/** Relative change of the skin below which the search has converged. */
+#define SKIN_TUNE_MIN_STEP 0.02
+/** Relative increase of the time per step after convergence that
+    restarts the search. */
+#define SKIN_TUNE_RETUNE 0.1
+/** Minimal skin in units of the maximal cutoff. */
+#define SKIN_TUNE_MIN_SKIN 0.01
+
+int skin_tune_interval = 0;
+
+/** Wall time at the end of the last integration step. */
+static double last_step_end = 0.0;
+/** Time spent in the integration steps since the last measurement. */
+static double step_time = 0.0;
+/** Number of integration steps since the last measurement. */
+static int n_measured_steps = 0;
+/** Time per step with the previous skin, -1 if not measured. */
+static double previous_time = -1.0;
+/** The skin for which \ref previous_time was measured. */
+static double previous_skin = 0.0;
+/** Time per step when the search converged, -1 while searching. */
+static double converged_time = -1.0;
+/** Current relative change of the skin and its sign. */
+static double tune_step = SKIN_TUNE_INITIAL_STEP;
+
+void skin_tune_reset()
+{
+  previous_time = -1.0;
+  converged_time = -1.0;
+  tune_step = SKIN_TUNE_INITIAL_STEP;
+  step_time = 0.0;
+  n_measured_steps = 0;
+}
+
+void skin_tune_start()
+{
+  last_step_end = MPI_Wtime();
+}
+
+/** Change the skin on all nodes, the Verlet lists are rebuilt in the
+    next step. */
+static void skin_tune_set_skin(double new_skin)
+{
+  skin = new_skin;
+  skin2 = SQR(0.5*skin);
+  skin_set = true;
+  cells_on_geometry_change(0);
+  resort_particles = 1;
+}
+
+/** Choose the next skin from the time per step t of the current one. */
+static double skin_tune_next_skin(double t)
+{
+  if (converged_time > 0) {
+    if (t < converged_time*(1.0 + SKIN_TUNE_RETUNE))
+      return skin;
+    /* the system has changed, search again */
+    converged_time = -1.0;
+    previous_time = -1.0;
+    tune_step = SKIN_TUNE_INITIAL_STEP;
+  }
+
+  if (previous_time > 0 && t > previous_time) {
+    /* overshot the optimum, turn around with a smaller step */
+    tune_step *= -0.5;
+    if (fabs(tune_step) < SKIN_TUNE_MIN_STEP) {
+      converged_time = previous_time;
+      previous_time = -1.0;
+      /* go back to the better skin, which may differ from the
+         requested one if the previous step was clamped */
+      return previous_skin;
+    }
+  }
+  previous_time = t;
+  previous_skin = skin;
+  return skin*(1.0 + tune_step);
+}
+
+void skin_tune_step()
+{
+  double now = MPI_Wtime();
+  step_time += now - last_step_end;
+  last_step_end = now;
+
+  if (skin_tune_interval <= 0 || ++n_measured_steps < skin_tune_interval)
+    return;
+
+  /* all nodes have to take the same decision */
+  double t;
+  MPI_Allreduce(&step_time, &t, 1, MPI_DOUBLE, MPI_MAX, comm_cart);
+  t /= n_measured_steps;
+  step_time = 0.0;
+  n_measured_steps = 0;
+
+  if (cell_structure.type != CELL_STRUCTURE_DOMDEC || max_cut <= 0)
+    return;
+
+  /* max_skin is the largest skin that fits the current cell grid.
+     With a non-uniform node grid, it differs between the nodes, and
+     the skin has to fit on all of them. */
+  double global_max_skin;
+  MPI_Allreduce(&max_skin, &global_max_skin, 1, MPI_DOUBLE, MPI_MIN, comm_cart);
+
+  double new_skin = skin_tune_next_skin(t);
+  if (global_max_skin > 0)
+    new_skin = dmin(new_skin, global_max_skin);
+  new_skin = dmax(new_skin, SKIN_TUNE_MIN_SKIN*max_cut);
+
+  if (new_skin != skin)
+    skin_tune_set_skin(new_skin);
+
+  /* do not measure the change of the cell system */
+  last_step_end = MPI_Wtime();
+}
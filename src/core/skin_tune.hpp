@@ -0,0 +1,62 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SKIN_TUNE_H
+#define SKIN_TUNE_H
+/** \file skin_tune.hpp
+ *
+ *  Online tuning of the Verlet list skin.
+ *
+ *  A larger skin makes the Verlet lists longer and every force
+ *  calculation more expensive, but the lists, the cells and the ghosts
+ *  have to be rebuilt less often. The optimum depends on the density
+ *  and the temperature of the system, and therefore may drift during a
+ *  simulation.
+ *
+ *  If \ref skin_tune_interval is set, the wall time per integration
+ *  step, which contains both the rebuilds and the force calculations,
+ *  is measured over every \ref skin_tune_interval steps. After each
+ *  interval, the skin is changed by a relative step. If the time per
+ *  step increased, the direction is reversed and the step is halved,
+ *  until the step falls below a minimal size. The tuner then keeps
+ *  the skin, but restarts the search if the time per step deviates
+ *  significantly from the time at convergence.
+ *
+ *  The skin is only increased up to \ref max_skin, so that the cell
+ *  grid is not coarsened. Decreasing the skin may allow for a finer
+ *  cell grid, which is set up by \ref cells_on_geometry_change. The
+ *  tuning requires the domain decomposition.
+ */
+#include "config.hpp"
+
+/** Number of integration steps between two changes of the skin (setmd
+    skin_tune_interval). 0, the default, switches the tuning off. */
+extern int skin_tune_interval;
+
+/** Start the time measurement of the integration steps, called
+    before the integration loop. */
+void skin_tune_start();
+
+/** Called after each integration step. Every \ref skin_tune_interval
+    steps, the skin is adjusted. Has to be called on all nodes. */
+void skin_tune_step();
+
+/** Restart the tuning, e.g. after the user has changed the skin. */
+void skin_tune_reset();
+
+#endif
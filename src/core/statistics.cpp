@@ -30,6 +30,8 @@
 #include "statistics_molecule.hpp"
 #include "statistics_cluster.hpp"
 #include "statistics_fluid.hpp"
+#include "statistics_cells.hpp"
+#include "statistics_observable.hpp"
 //#include "statistics_correlation.hpp"
 #include "energy.hpp"
 #include "modes.hpp"
@@ -43,7 +45,9 @@
 #include "lb.hpp"
 #include "virtual_sites.hpp"
 #include "initialize.hpp"
+#include "threads.hpp"
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <map>
@@ -63,6 +67,111 @@ double min_distance2(double pos1[3], double pos2[3])
   return sqrlen(diff);
 }
 
+/** Multiplicity of the type of each particle of \ref partCfg in a list of types.
+    @param types   list of types
+    @param n_types length of types
+    @param w       number of times partCfg[i].p.type occurs in types (Output) */
+static void type_weights(int *types, int n_types, std::vector<int> &w)
+{
+  int i, t;
+
+  w.assign(n_part, 0);
+  for (i = 0; i < n_part; i++)
+    for (t = 0; t < n_types; t++)
+      if (partCfg[i].p.type == types[t])
+        w[i]++;
+}
+
+/** Histogram of the pair distances for the radial distribution
+    functions. The pairs (i,j) with distances in (r_min, r_max) are
+    counted with the weight w1[i]*w2[j], i.e. as often as their types
+    occur in the type lists.
+    @param g      cell grid on the configuration
+    @param w1     weights of the first particle of a pair
+    @param w2     weights of the second particle of a pair
+    @param mol    if not NULL, only pairs with different mol[i], mol[j] are counted
+    @param mixed  if 0, only pairs with j > i are counted
+    @param r_min  minimal distance
+    @param r_max  maximal distance
+    @param r_bins number of bins
+    @param hist   the histogram (Output) */
+static void rdf_histogram(const AnalysisCells *g, const int *w1, const int *w2,
+                          const int *mol, int mixed, double r_min, double r_max,
+                          int r_bins, double *hist)
+{
+  int l, np = g->id.size();
+  double bin_width = (r_max-r_min) / (double)r_bins;
+  double inv_bin_width = 1.0 / bin_width;
+
+  for (l = 0; l < r_bins; l++) hist[l] = 0.0;
+
+  ES_OMP_PRAGMA(omp parallel private(l))
+  {
+    std::vector<double> local(r_bins, 0.0);
+    std::vector<int> cells;
+
+    /* the particles in cell order, so that the neighbors stay in the cache */
+    ES_OMP_PRAGMA(omp for schedule(dynamic, 64))
+    for (int p = 0; p < np; p++) {
+      int i = g->part[p];
+      double *pi = const_cast<double *>(&g->pos[3*i]);
+      if (!w1[i])
+        continue;
+
+      analysis_cells_range(g, pi, r_max, cells);
+      for (size_t c = 0; c < cells.size(); c++) {
+        for (int q = g->start[cells[c]]; q < g->start[cells[c] + 1]; q++) {
+          int j = g->part[q];
+          double dist;
+          if (!w2[j] || (!mixed && j <= i) || (mol && mol[i] == mol[j]))
+            continue;
+          dist = min_distance(pi, const_cast<double *>(&g->pos[3*j]));
+          if (dist > r_min && dist < r_max) {
+            int ind = (int) ( (dist - r_min)*inv_bin_width );
+            if (ind < r_bins)
+              local[ind] += w1[i]*w2[j];
+          }
+        }
+      }
+    }
+
+    ES_OMP_PRAGMA(omp critical)
+    for (l = 0; l < r_bins; l++) hist[l] += local[l];
+  }
+}
+
+/** Number of pairs in the normalization of the radial distribution
+    functions, i.e. the sum of w1[i]*w2[j] over all pairs of \ref
+    rdf_histogram regardless of their distance. */
+static double rdf_pair_count(const int *w1, const int *w2, const int *mol, int mixed)
+{
+  int i;
+  double cnt, w11 = 0.0, w22 = 0.0, w12 = 0.0;
+  /* per molecule: sum of w1, sum of w2, sum of w1*w2 */
+  std::map<int, std::vector<double> > same;
+
+  for (i = 0; i < n_part; i++) {
+    w11 += w1[i];
+    w22 += w2[i];
+    w12 += w1[i]*w2[i];
+    if (mol) {
+      std::vector<double> &m = same[mol[i]];
+      m.resize(3, 0.0);
+      m[0] += w1[i];
+      m[1] += w2[i];
+      m[2] += w1[i]*w2[i];
+    }
+  }
+
+  /* all pairs (i,j) resp. i < j. For mixed == 0, w1 and w2 are the same. */
+  cnt = mixed ? w11*w22 : 0.5*(w11*w22 - w12);
+  for (std::map<int, std::vector<double> >::iterator it = same.begin(); it != same.end(); ++it) {
+    std::vector<double> &m = it->second;
+    cnt -= mixed ? m[0]*m[1] : 0.5*(m[0]*m[1] - m[2]);
+  }
+  return cnt;
+}
+
 
 /****************************************************************************************
  *                                 basic observables calculation
@@ -70,36 +179,47 @@ double min_distance2(double pos1[3], double pos2[3])
 
 double mindist(IntList *set1, IntList *set2)
 {
-  double mindist, pt[3];
-  int i, j, in_set;
+  double mindist2;
+  int i, n1 = 0, n2 = 0;
+  AnalysisCells *cells;
+  std::vector<int> in1, in2;
 
-  mindist = SQR(box_l[0] + box_l[1] + box_l[2]);
+  mindist2 = SQR(box_l[0] + box_l[1] + box_l[2]);
 
   updatePartCfg(WITHOUT_BONDS);
-  for (j=0; j<n_part-1; j++) {
-    pt[0] = partCfg[j].r.p[0];
-    pt[1] = partCfg[j].r.p[1];
-    pt[2] = partCfg[j].r.p[2];
-    /* check which sets particle j belongs to
-       bit 0: set1, bit1: set2
-    */
-    in_set = 0;
-    if (!set1 || intlist_contains(set1, partCfg[j].p.type))
-      in_set = 1;
-    if (!set2 || intlist_contains(set2, partCfg[j].p.type))
-      in_set |= 2;
-    if (in_set == 0)
-      continue;
-
-    for (i=j+1; i<n_part; i++)
-      /* accept a pair if particle j is in set1 and particle i in set2 or vice versa. */
-      if (((in_set & 1) && (!set2 || intlist_contains(set2, partCfg[i].p.type))) ||
-          ((in_set & 2) && (!set1 || intlist_contains(set1, partCfg[i].p.type))))
-        mindist = dmin(mindist, min_distance2(pt, partCfg[i].r.p));
+  cells = analysis_cells_partcfg();
+
+  in1.resize(n_part);
+  in2.resize(n_part);
+  for (i = 0; i < n_part; i++) {
+    in1[i] = (!set1 || intlist_contains(set1, partCfg[i].p.type));
+    in2[i] = (!set2 || intlist_contains(set2, partCfg[i].p.type));
+    n1 += in1[i];
+    n2 += in2[i];
   }
-  mindist = sqrt(mindist);
 
-  return mindist;
+  /* accept a pair if one particle is in set1 and the other one in
+     set2. Search around the particles of the smaller set. */
+  const std::vector<int> &from = (n1 <= n2) ? in1 : in2;
+  const std::vector<int> &to = (n1 <= n2) ? in2 : in1;
+
+  ES_OMP_PRAGMA(omp parallel)
+  {
+    double local = mindist2;
+
+    ES_OMP_PRAGMA(omp for schedule(dynamic, 64))
+    for (int p = 0; p < n_part; p++) {
+      int j = cells->part[p];
+      if (from[j])
+        local = analysis_cells_nearest2(cells, &cells->pos[3*j], &to[0],
+                                        partCfg[j].p.identity, local);
+    }
+
+    ES_OMP_PRAGMA(omp critical)
+    mindist2 = dmin(mindist2, local);
+  }
+
+  return sqrt(mindist2);
 }
 
 void merge_aggregate_lists(int *head_list, int *agg_id_list, int p1molid, int p2molid, int *link_list)
@@ -123,8 +243,9 @@ void merge_aggregate_lists(int *head_list, int *agg_id_list, int p1molid, int p2
 
 int aggregation(double dist_criteria2, int min_contact, int s_mol_id, int f_mol_id, int *head_list, int *link_list, int *agg_id_list, int *agg_num, int *agg_size, int *agg_max, int *agg_min, int *agg_avg, int *agg_std, int charge)
 {
-  int c, np, n, i;
-  Particle *p1, *p2, **pairs;
+  int c, i, j, k;
+  IA_Neighbor_List *il;
+  Particle *part, *p1, *p2;
   double dist2;
   int target1;
   int p1molid, p2molid;
@@ -149,14 +270,13 @@ int aggregation(double dist_criteria2, int min_contact, int s_mol_id, int f_mol_
   
   /* Loop local cells */
   for (c = 0; c < local_cells.n; c++) {
-    /* Loop cell neighbors */
-    for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-      pairs = dd.cell_inter[c].nList[n].vList.pair;
-      np    = dd.cell_inter[c].nList[n].vList.n;
-      /* verlet list loop */
-      for(i=0; i<2*np; i+=2) {
-	p1 = pairs[i];                    /* pointer to particle 1 */
-	p2 = pairs[i+1];                  /* pointer to particle 2 */
+    il   = &dd.cell_inter[c];
+    part = local_cells.cell[c]->part;
+    /* verlet list loop */
+    for (j = 0; j < il->vList.np; j++) {
+      for (k = il->vList.start[j]; k < il->vList.start[j+1]; k++) {
+	p1 = &part[j];                                  /* pointer to particle 1 */
+	p2 = dd_pair_partner(il, il->vList.partner[k]); /* pointer to particle 2 */
 	p1molid = p1->p.mol_id;
 	p2molid = p2->p.mol_id;
 	if (((p1molid <= f_mol_id) && (p1molid >= s_mol_id)) && ((p2molid <= f_mol_id) && (p2molid >= s_mol_id))) {
@@ -371,43 +491,42 @@ void momentofinertiamatrix(int type, double* MofImatrix)
 
 void calc_gyration_tensor(int type, std::vector<double>& gt)
 {
-  int i, j, count;
+  int i, j;
   std::vector<double> com (3);
   double eva[3],eve0[3],eve1[3],eve2[3];
   double tmp;
-  double Smatrix[9],p1[3];
+  double Smatrix[9],data[7];
+  observable_parallel_params params;
 
-  for (i=0; i<9; i++) Smatrix[i] = 0;
   /* 3*ev, rg, b, c, kappa, eve0[3], eve1[3], eve2[3]*/
   gt.resize(16);
 
-  updatePartCfg(WITHOUT_BONDS);
-
   /* Calculate the position of COM */
-  com = centerofmass(type);
+  memset(&params, 0, sizeof(observable_parallel_params));
+  params.kernel = OBS_PAR_MASS_WEIGHTED_POSITION;
+  params.n_A = 4;
+  params.n_ids = -1;
+  params.type = type;
+  observable_calc_parallel(&params, NULL, data);
+  for (j=0; j<3; j++) com[j] = data[j]/data[3];
 
   /* Calculate the gyration tensor Smatrix */
-  count=0;
-  for (i=0;i<n_part;i++) {
-    if ((partCfg[i].p.type == type) || (type == -1)) {
-      for ( j=0; j<3 ; j++ ) { 
-        p1[j] = partCfg[i].r.p[j] - com[j];
-      }
-      count ++;
-      Smatrix[0] += p1[0]*p1[0];
-      Smatrix[1] += p1[0]*p1[1];
-      Smatrix[2] += p1[0]*p1[2];
-      Smatrix[4] += p1[1]*p1[1];
-      Smatrix[5] += p1[1]*p1[2];
-      Smatrix[8] += p1[2]*p1[2];
-    }
-  }
+  params.kernel = OBS_PAR_GYRATION_TENSOR;
+  params.n_A = 7;
+  for (j=0; j<3; j++) params.dparams[j] = com[j];
+  observable_calc_parallel(&params, NULL, data);
+  Smatrix[0] = data[0];
+  Smatrix[1] = data[1];
+  Smatrix[2] = data[2];
+  Smatrix[4] = data[3];
+  Smatrix[5] = data[4];
+  Smatrix[8] = data[5];
   /* use symmetry */
   Smatrix[3]=Smatrix[1];
   Smatrix[6]=Smatrix[2];
   Smatrix[7]=Smatrix[5];
   for (i=0;i<9;i++){
-    Smatrix[i] /= count;
+    Smatrix[i] /= data[6];
   }
 
   /* Calculate the eigenvalues of Smatrix */
@@ -447,6 +566,29 @@ void nbhood(double pt[3], double r, IntList *il, int planedims[3] )
  
   updatePartCfg(WITHOUT_BONDS);
 
+  if ( (planedims[0] + planedims[1] + planedims[2]) == 3 ) {
+    AnalysisCells *cells = analysis_cells_partcfg();
+    std::vector<int> cell_list, found;
+
+    analysis_cells_range(cells, pt, r, cell_list);
+    for (size_t c = 0; c < cell_list.size(); c++) {
+      for (int q = cells->start[cell_list[c]]; q < cells->start[cell_list[c] + 1]; q++) {
+        i = cells->part[q];
+        get_mi_vector(d, pt, partCfg[i].r.p);
+        if (sqrlen(d) < r2)
+          found.push_back(i);
+      }
+    }
+
+    /* in the order of partCfg */
+    std::sort(found.begin(), found.end());
+    realloc_intlist(il, found.size());
+    for (i = 0; i < (int)found.size(); i++)
+      il->e[i] = partCfg[found[i]].p.identity;
+    il->n = found.size();
+    return;
+  }
+
   for (i = 0; i<n_part; i++) {
     if ( (planedims[0] + planedims[1] + planedims[2]) == 3 ) {
       get_mi_vector(d, pt, partCfg[i].r.p);
@@ -467,20 +609,13 @@ void nbhood(double pt[3], double r, IntList *il, int planedims[3] )
 
 double distto(double p[3], int pid)
 {
-  int i;
-  double d[3];
   double mindist;
 
   updatePartCfg(WITHOUT_BONDS);
 
   /* larger than possible */
   mindist=SQR(box_l[0] + box_l[1] + box_l[2]);
-  for (i=0; i<n_part; i++) {
-    if (pid != partCfg[i].p.identity) {
-      get_mi_vector(d, p, partCfg[i].r.p);
-      mindist = dmin(mindist, sqrlen(d));
-    }
-  }
+  mindist = analysis_cells_nearest2(analysis_cells_partcfg(), p, NULL, pid, mindist);
   return sqrt(mindist);
 }
 
@@ -587,9 +722,11 @@ void calc_part_distribution(int *p1_types, int n_p1, int *p2_types, int n_p2,
 			    double r_min, double r_max, int r_bins, int log_flag, 
 			    double *low, double *dist)
 {
-  int i,j,t1,t2,ind,cnt=0;
+  int i,cnt=0;
   double inv_bin_width=0.0;
-  double min_dist,min_dist2=0.0,start_dist2,act_dist2;
+  double start_dist2,low_cnt=0.0;
+  AnalysisCells *cells;
+  std::vector<int> w1, w2;
 
   start_dist2 = SQR(box_l[0] + box_l[1] + box_l[2]);
   /* bin preparation */
@@ -598,43 +735,50 @@ void calc_part_distribution(int *p1_types, int n_p1, int *p2_types, int n_p2,
   if(log_flag == 1) inv_bin_width = (double)r_bins/(log(r_max)-log(r_min));
   else              inv_bin_width = (double)r_bins / (r_max-r_min);
 
+  type_weights(p1_types, n_p1, w1);
+  type_weights(p2_types, n_p2, w2);
+  cells = analysis_cells_partcfg();
+
+  /* distances beyond r_max are not binned, so do not search further */
+  start_dist2 = dmin(start_dist2, SQR(2.0*r_max));
+
   /* particle loop: p1_types*/
-  for(i=0; i<n_part; i++) {
-    for(t1=0; t1<n_p1; t1++) {
-      if(partCfg[i].p.type == p1_types[t1]) {
-	min_dist2 = start_dist2;
-	/* particle loop: p2_types*/
-	for(j=0; j<n_part; j++) {
-	  if(j != i) {
-	    for(t2=0; t2<n_p2; t2++) {
-	      if(partCfg[j].p.type == p2_types[t2]) {
-		act_dist2 =  min_distance2(partCfg[i].r.p, partCfg[j].r.p);
-		if(act_dist2 < min_dist2) { min_dist2 = act_dist2; }
-	      }
-	    }
-	  }
-	}
-	min_dist = sqrt(min_dist2);
-	if(min_dist <= r_max) {
-	  if(min_dist >= r_min) {
-	    /* calculate bin index */
-	    if(log_flag == 1) ind = (int) ((log(min_dist) - log(r_min))*inv_bin_width);
-	    else              ind = (int) ((min_dist - r_min)*inv_bin_width);
-	    if(ind >= 0 && ind < r_bins) {
-	      dist[ind] += 1.0;
-	    }
-	  }
-	  else {
-	    *low += 1.0;
-	  }
-	}
-	cnt++;    
+  ES_OMP_PRAGMA(omp parallel private(i) reduction(+:cnt,low_cnt))
+  {
+    std::vector<double> local(r_bins, 0.0);
+
+    ES_OMP_PRAGMA(omp for schedule(dynamic, 64))
+    for(int p=0; p<n_part; p++) {
+      int ind, j = cells->part[p];
+      double min_dist;
+      if (!w1[j])
+        continue;
+
+      /* closest particle of p2_types */
+      min_dist = sqrt(analysis_cells_nearest2(cells, &cells->pos[3*j], &w2[0],
+                                              partCfg[j].p.identity, start_dist2));
+      if(min_dist <= r_max) {
+        if(min_dist >= r_min) {
+          /* calculate bin index */
+          if(log_flag == 1) ind = (int) ((log(min_dist) - log(r_min))*inv_bin_width);
+          else              ind = (int) ((min_dist - r_min)*inv_bin_width);
+          if(ind >= 0 && ind < r_bins) {
+            local[ind] += w1[j];
+          }
+        }
+        else {
+          low_cnt += w1[j];
+        }
       }
+      cnt += w1[j];
     }
+
+    ES_OMP_PRAGMA(omp critical)
+    for(i=0;i<r_bins;i++) dist[i] += local[i];
   }
   
   /* normalization */
-  *low /= (double)cnt;
+  *low = low_cnt / (double)cnt;
   for(i=0;i<r_bins;i++) dist[i] /= (double)cnt;
 }
 
@@ -648,11 +792,13 @@ void calc_rdf(std::vector<int> & p1_types, std::vector<int> & p2_types,
 void calc_rdf(int *p1_types, int n_p1, int *p2_types, int n_p2, 
 	      double r_min, double r_max, int r_bins, double *rdf)
 {
-  long int cnt=0;
-  int i,j,t1,t2,ind;
-  int mixed_flag=0,start;
-  double inv_bin_width=0.0,bin_width=0.0, dist;
+  double cnt;
+  int i;
+  int mixed_flag=0;
+  double bin_width=0.0;
   double volume, bin_volume, r_in, r_out;
+  AnalysisCells cells;
+  std::vector<int> w1, w2;
 
   if(n_p1 == n_p2) {
     for(i=0;i<n_p1;i++) 
@@ -661,31 +807,13 @@ void calc_rdf(int *p1_types, int n_p1, int *p2_types, int n_p2,
   else mixed_flag=1;
 
   bin_width     = (r_max-r_min) / (double)r_bins;
-  inv_bin_width = 1.0 / bin_width;
-  for(i=0;i<r_bins;i++) rdf[i] = 0.0;
-  /* particle loop: p1_types*/
-  for(i=0; i<n_part; i++) {
-    for(t1=0; t1<n_p1; t1++) {
-      if(partCfg[i].p.type == p1_types[t1]) {
-	/* distinguish mixed and identical rdf's */
-	if(mixed_flag == 1) start = 0;
-	else                start = (i+1);
-	/* particle loop: p2_types*/
-	for(j=start; j<n_part; j++) {
-	  for(t2=0; t2<n_p2; t2++) {
-	    if(partCfg[j].p.type == p2_types[t2]) {
-	      dist = min_distance(partCfg[i].r.p, partCfg[j].r.p);
-	      if(dist > r_min && dist < r_max) {
-		ind = (int) ( (dist - r_min)*inv_bin_width );
-		rdf[ind]++;
-	      }
-	      cnt++;
-	    }
-	  }
-	}
-      }
-    }
-  }
+
+  /* particle pairs within r_max, see rdf_histogram() */
+  type_weights(p1_types, n_p1, w1);
+  type_weights(p2_types, n_p2, w2);
+  analysis_cells_from_partcfg(&cells, r_max);
+  rdf_histogram(&cells, &w1[0], &w2[0], NULL, mixed_flag, r_min, r_max, r_bins, rdf);
+  cnt = rdf_pair_count(&w1[0], &w2[0], NULL, mixed_flag);
 
   /* normalization */
   volume = box_l[0]*box_l[1]*box_l[2];
@@ -708,12 +836,14 @@ void calc_rdf_av(std::vector<int> & p1_types, std::vector<int> & p2_types,
 void calc_rdf_av(int *p1_types, int n_p1, int *p2_types, int n_p2,
 		 double r_min, double r_max, int r_bins, double *rdf, int n_conf)
 {
-  long int cnt=0;
-  int i,j,k,l,t1,t2,ind,cnt_conf=1;
-  int mixed_flag=0,start;
-  double inv_bin_width=0.0,bin_width=0.0, dist;
+  double cnt;
+  int i,k,l,cnt_conf=1;
+  int mixed_flag=0;
+  double bin_width=0.0;
   double volume, bin_volume, r_in, r_out;
-  double *rdf_tmp, p1[3],p2[3];
+  double *rdf_tmp;
+  AnalysisCells cells;
+  std::vector<int> w1, w2;
 
   rdf_tmp = (double*)Utils::malloc(r_bins*sizeof(double));
 
@@ -723,38 +853,19 @@ void calc_rdf_av(int *p1_types, int n_p1, int *p2_types, int n_p2,
   }
   else mixed_flag=1;
   bin_width     = (r_max-r_min) / (double)r_bins;
-  inv_bin_width = 1.0 / bin_width;
   volume = box_l[0]*box_l[1]*box_l[2];
   for(l=0;l<r_bins;l++) rdf_tmp[l]=rdf[l] = 0.0;
 
+  type_weights(p1_types, n_p1, w1);
+  type_weights(p2_types, n_p2, w2);
+  cnt = rdf_pair_count(&w1[0], &w2[0], NULL, mixed_flag);
+
   while(cnt_conf<=n_conf) {
-    for(l=0;l<r_bins;l++) rdf_tmp[l]=0.0;
-    cnt=0;
     k=n_configs-cnt_conf;
-    for(i=0; i<n_part; i++) {
-      for(t1=0; t1<n_p1; t1++) {
-	if(partCfg[i].p.type == p1_types[t1]) {
-	  // distinguish mixed and identical rdf's
-	  if(mixed_flag == 1) start = 0;
-	  else                start = (i+1);
-	  //particle loop: p2_types
-	  for(j=start; j<n_part; j++) {
-	    for(t2=0; t2<n_p2; t2++) {
-	      if(partCfg[j].p.type == p2_types[t2]) {
-		p1[0]=configs[k][3*i  ];p1[1]=configs[k][3*i+1];p1[2]=configs[k][3*i+2];
-		p2[0]=configs[k][3*j  ];p2[1]=configs[k][3*j+1];p2[2]=configs[k][3*j+2];
-		dist =min_distance(p1, p2);
-		if(dist > r_min && dist < r_max) {
-		  ind = (int) ( (dist - r_min)*inv_bin_width );
-		  rdf_tmp[ind]++;
-		}
-		cnt++;
-	      }
-	    }
-	  }
-	}
-      }
-    }
+    /* particle pairs within r_max, see rdf_histogram() */
+    analysis_cells_from_config(&cells, k, r_max);
+    rdf_histogram(&cells, &w1[0], &w2[0], NULL, mixed_flag, r_min, r_max, r_bins, rdf_tmp);
+
     // normalization
   
     for(i=0; i<r_bins; i++) {
@@ -783,11 +894,14 @@ void calc_rdf_intermol_av(std::vector<int> & p1_types, std::vector<int> & p2_typ
 void calc_rdf_intermol_av(int *p1_types, int n_p1, int *p2_types, int n_p2,
 			  double r_min, double r_max, int r_bins, double *rdf, int n_conf)
 {
-  int i,j,k,l,t1,t2,ind,cnt=0,cnt_conf=1;
-  int mixed_flag=0,start;
-  double inv_bin_width=0.0,bin_width=0.0, dist;
+  double cnt;
+  int i,k,l,cnt_conf=1;
+  int mixed_flag=0;
+  double bin_width=0.0;
   double volume, bin_volume, r_in, r_out;
-  double *rdf_tmp, p1[3],p2[3];
+  double *rdf_tmp;
+  AnalysisCells cells;
+  std::vector<int> w1, w2, mol;
 
   rdf_tmp = (double*)Utils::malloc(r_bins*sizeof(double));
 
@@ -797,43 +911,24 @@ void calc_rdf_intermol_av(int *p1_types, int n_p1, int *p2_types, int n_p2,
   }
   else mixed_flag=1;
   bin_width     = (r_max-r_min) / (double)r_bins;
-  inv_bin_width = 1.0 / bin_width;
   volume = box_l[0]*box_l[1]*box_l[2];
   for(l=0;l<r_bins;l++) rdf_tmp[l]=rdf[l] = 0.0;
 
+  type_weights(p1_types, n_p1, w1);
+  type_weights(p2_types, n_p2, w2);
+  /* only pairs of different molecules */
+  mol.resize(n_part);
+  for(i=0; i<n_part; i++) mol[i] = partCfg[i].p.mol_id;
+  cnt = rdf_pair_count(&w1[0], &w2[0], &mol[0], mixed_flag);
+
   while(cnt_conf<=n_conf) {
-    for(l=0;l<r_bins;l++) rdf_tmp[l]=0.0;
-    cnt=0;
     k=n_configs-cnt_conf;
-    for(i=0; i<n_part; i++) {
-      for(t1=0; t1<n_p1; t1++) {
-	if(partCfg[i].p.type == p1_types[t1]) {
-	  // distinguish mixed and identical rdf's
-	  if(mixed_flag == 1) start = 0;
-	  else                start = (i+1);
-	  //particle loop: p2_types
-	  for(j=start; j<n_part; j++) {
-	    for(t2=0; t2<n_p2; t2++) {
-	      if(partCfg[j].p.type == p2_types[t2]) {
-		/*see if particles i and j belong to different molecules*/
-		if(partCfg[i].p.mol_id!=partCfg[j].p.mol_id) {
-		  p1[0]=configs[k][3*i  ];p1[1]=configs[k][3*i+1];p1[2]=configs[k][3*i+2];
-		  p2[0]=configs[k][3*j  ];p2[1]=configs[k][3*j+1];p2[2]=configs[k][3*j+2];
-		  dist =min_distance(p1, p2);
-		  if(dist > r_min && dist < r_max) {
-		    ind = (int) ( (dist - r_min)*inv_bin_width );
-		    rdf_tmp[ind]++;
-		  }
-		  cnt++;
-		}
-	      }
-	    }
-	  }
-	}
-      }
-    }
-    // normalization
+    /* particle pairs within r_max, see rdf_histogram() */
+    analysis_cells_from_config(&cells, k, r_max);
+    rdf_histogram(&cells, &w1[0], &w2[0], &mol[0], mixed_flag, r_min, r_max, r_bins, rdf_tmp);
 
+    // normalization
+  
     for(i=0; i<r_bins; i++) {
       r_in       = i*bin_width + r_min;
       r_out      = r_in + bin_width;
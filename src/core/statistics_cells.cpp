@@ -0,0 +1,217 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file statistics_cells.cpp
+ *
+ *  Implementation of \ref statistics_cells.hpp "statistics_cells.hpp".
+ */
+#include "statistics_cells.hpp"
+#include "grid.hpp"
+#include "particle_data.hpp"
+#include "statistics.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/** Minimal mean number of particles per cell */
+#define ANALYSIS_CELLS_FILL 2.0
+
+static AnalysisCells partcfg_cells;
+static int partcfg_cells_valid = 0;
+
+/** Cell coordinate of a position in one direction. */
+inline int analysis_cells_coord(const AnalysisCells *g, int d, double x)
+{
+  int c;
+
+  x -= g->lo[d];
+  if (PERIODIC(d))
+    x -= floor(x/g->l[d])*g->l[d];
+  c = (int)(x*g->inv_size[d]);
+  return std::max(0, std::min(c, g->n[d] - 1));
+}
+
+void analysis_cells_build(AnalysisCells *g, double cell_size)
+{
+  int i, d, c, n_cells, n_dims = 0, np = g->id.size();
+  double volume = 1.0;
+  std::vector<int> cell(np);
+
+  for (d = 0; d < 3; d++) {
+    if (PERIODIC(d) || np == 0) {
+      g->lo[d] = 0.0;
+      g->l[d] = box_l[d];
+    }
+    else {
+      double lo = g->pos[d], hi = g->pos[d];
+      for (i = 1; i < np; i++) {
+        lo = dmin(lo, g->pos[3*i + d]);
+        hi = dmax(hi, g->pos[3*i + d]);
+      }
+      g->lo[d] = lo;
+      g->l[d] = hi - lo;
+    }
+    if (g->l[d] > 0.0) {
+      volume *= g->l[d];
+      n_dims++;
+    }
+  }
+
+  /* not too many empty cells */
+  if (np > 0 && n_dims > 0)
+    cell_size = dmax(cell_size, pow(ANALYSIS_CELLS_FILL*volume/np, 1./n_dims));
+
+  for (d = 0; d < 3; d++) {
+    if (g->l[d] > 0.0 && cell_size > 0.0) {
+      g->n[d] = std::max(1, (int)std::min(g->l[d]/cell_size, (double)np + 1));
+      g->inv_size[d] = g->n[d]/g->l[d];
+    }
+    else {
+      g->n[d] = 1;
+      g->inv_size[d] = 0.0;
+    }
+  }
+  n_cells = g->n[0]*g->n[1]*g->n[2];
+
+  /* counting sort of the particles by cell */
+  g->start.assign(n_cells + 1, 0);
+  for (i = 0; i < np; i++) {
+    cell[i] = analysis_cells_coord(g, 0, g->pos[3*i])
+      + g->n[0]*(analysis_cells_coord(g, 1, g->pos[3*i + 1])
+                 + g->n[1]*analysis_cells_coord(g, 2, g->pos[3*i + 2]));
+    g->start[cell[i] + 1]++;
+  }
+  for (c = 0; c < n_cells; c++)
+    g->start[c + 1] += g->start[c];
+
+  g->part.resize(np);
+  std::vector<int> fill(g->start.begin(), g->start.end() - 1);
+  for (i = 0; i < np; i++)
+    g->part[fill[cell[i]]++] = i;
+}
+
+void analysis_cells_from_partcfg(AnalysisCells *g, double cell_size)
+{
+  int i;
+
+  g->pos.resize(3*n_part);
+  g->id.resize(n_part);
+  for (i = 0; i < n_part; i++) {
+    g->pos[3*i]     = partCfg[i].r.p[0];
+    g->pos[3*i + 1] = partCfg[i].r.p[1];
+    g->pos[3*i + 2] = partCfg[i].r.p[2];
+    g->id[i] = partCfg[i].p.identity;
+  }
+  analysis_cells_build(g, cell_size);
+}
+
+void analysis_cells_from_config(AnalysisCells *g, int k, double cell_size)
+{
+  int i;
+
+  g->pos.assign(configs[k], configs[k] + 3*n_part);
+  g->id.resize(n_part);
+  for (i = 0; i < n_part; i++)
+    g->id[i] = partCfg[i].p.identity;
+  analysis_cells_build(g, cell_size);
+}
+
+AnalysisCells *analysis_cells_partcfg()
+{
+  if (!partcfg_cells_valid) {
+    analysis_cells_from_partcfg(&partcfg_cells, 0.0);
+    partcfg_cells_valid = 1;
+  }
+  return &partcfg_cells;
+}
+
+void analysis_cells_invalidate()
+{
+  partcfg_cells_valid = 0;
+}
+
+int analysis_cells_range(const AnalysisCells *g, const double pt[3], double r,
+                         std::vector<int> &cells)
+{
+  int d, i, j, k, all = 1;
+  int lo[3], hi[3];
+
+  cells.clear();
+
+  for (d = 0; d < 3; d++) {
+    double x = pt[d] - g->lo[d];
+    if (PERIODIC(d))
+      x -= floor(x/g->l[d])*g->l[d];
+
+    /* the range covers the whole grid */
+    if (g->inv_size[d] == 0.0 || 2.0*r*g->inv_size[d] + 1.0 >= g->n[d]) {
+      lo[d] = 0;
+      hi[d] = g->n[d] - 1;
+      continue;
+    }
+    lo[d] = (int)floor((x - r)*g->inv_size[d]);
+    hi[d] = (int)floor((x + r)*g->inv_size[d]);
+    if (!PERIODIC(d)) {
+      lo[d] = std::max(lo[d], 0);
+      hi[d] = std::min(hi[d], g->n[d] - 1);
+      if (lo[d] > hi[d])
+        return 0;
+    }
+    if (lo[d] > 0 || hi[d] < g->n[d] - 1)
+      all = 0;
+  }
+
+  for (k = lo[2]; k <= hi[2]; k++) {
+    int ck = (k + g->n[2]) % g->n[2];
+    for (j = lo[1]; j <= hi[1]; j++) {
+      int cj = (j + g->n[1]) % g->n[1];
+      for (i = lo[0]; i <= hi[0]; i++)
+        cells.push_back((i + g->n[0]) % g->n[0] + g->n[0]*(cj + g->n[1]*ck));
+    }
+  }
+  return all;
+}
+
+double analysis_cells_nearest2(const AnalysisCells *g, const double pt[3],
+                               const int *accept, int exclude, double r2_max)
+{
+  std::vector<int> cells;
+  double best = r2_max, d[3];
+  double r = 1.0/dmax(g->inv_size[0], dmax(g->inv_size[1], g->inv_size[2]));
+  int all;
+
+  for (;;) {
+    all = analysis_cells_range(g, pt, r, cells);
+    for (size_t c = 0; c < cells.size(); c++) {
+      for (int p = g->start[cells[c]]; p < g->start[cells[c] + 1]; p++) {
+        int j = g->part[p];
+        if ((accept && !accept[j]) || g->id[j] == exclude)
+          continue;
+        get_mi_vector(d, const_cast<double *>(pt),
+                      const_cast<double *>(&g->pos[3*j]));
+        best = dmin(best, sqrlen(d));
+      }
+    }
+    /* everything closer than r has been seen */
+    if (all || r*r >= best)
+      break;
+    r *= 2.0;
+  }
+  return best;
+}
@@ -0,0 +1,107 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef STATISTICS_CELLS_H
+#define STATISTICS_CELLS_H
+/** \file statistics_cells.hpp
+ *
+ *  Linked-cell grid on a gathered configuration for the distance
+ *  based analysis routines (\ref calc_rdf, \ref mindist, \ref distto,
+ *  \ref nbhood, ...).
+ *
+ *  The particles are sorted into a regular grid of cells spanning the
+ *  box in the periodic directions and the bounding box of the
+ *  particles in the others, so that the particles near a point are
+ *  found by looking at a few cells only. Distances are always
+ *  calculated with the minimum image convention from the unfolded
+ *  positions, i.e. the results are the same as for a loop over all
+ *  particles.
+ *
+ *  The grid on \ref partCfg is cached until \ref partCfg is freed or
+ *  resorted, see \ref analysis_cells_partcfg.
+ */
+#include <vector>
+
+/** Linked-cell grid on a set of positions. */
+typedef struct {
+  /** number of cells in each direction */
+  int n[3];
+  /** lower corner of the grid */
+  double lo[3];
+  /** extent of the grid */
+  double l[3];
+  /** inverse cell size */
+  double inv_size[3];
+  /** positions of the particles, three per particle */
+  std::vector<double> pos;
+  /** identities of the particles */
+  std::vector<int> id;
+  /** the particles of cell c are part[start[c]] ... part[start[c+1]-1] */
+  std::vector<int> start;
+  /** particle indices sorted by cell */
+  std::vector<int> part;
+} AnalysisCells;
+
+/** Sort the particles into cells. \ref AnalysisCells::pos and
+    \ref AnalysisCells::id have to be filled before.
+    @param g          the grid
+    @param cell_size  minimal size of the cells. If this is smaller
+                      than the mean particle distance, larger cells
+                      are used.
+*/
+void analysis_cells_build(AnalysisCells *g, double cell_size);
+
+/** Build the grid on the current \ref partCfg. */
+void analysis_cells_from_partcfg(AnalysisCells *g, double cell_size);
+
+/** Build the grid on the stored configuration \ref configs[k]. The
+    identities are taken from \ref partCfg. */
+void analysis_cells_from_config(AnalysisCells *g, int k, double cell_size);
+
+/** Grid on \ref partCfg with a cell size for general searches. It is
+    built on first use and kept until \ref analysis_cells_invalidate is
+    called. \ref partCfg must be valid. */
+AnalysisCells *analysis_cells_partcfg();
+
+/** Drop the cached grid of \ref analysis_cells_partcfg. Called whenever
+    \ref partCfg is freed or reordered. */
+void analysis_cells_invalidate();
+
+/** Collect the cells that may contain particles closer than r to a point.
+    @param g      the grid
+    @param pt     the point
+    @param r      the distance
+    @param cells  the cell indices (Output)
+    @return 1 if these are all cells of the grid, 0 otherwise */
+int analysis_cells_range(const AnalysisCells *g, const double pt[3], double r,
+                         std::vector<int> &cells);
+
+/** Squared minimum image distance from a point to the closest particle
+    of the grid. The search is done in growing spheres around the point.
+    @param g        the grid
+    @param pt       the point
+    @param accept   particles j with accept[j] == 0 are ignored. May be
+                    NULL to accept all particles.
+    @param exclude  identity of a particle to ignore, or -1
+    @param r2_max   only distances below this are searched for
+    @return the squared distance, or r2_max if there is no particle
+            closer than that */
+double analysis_cells_nearest2(const AnalysisCells *g, const double pt[3],
+                               const int *accept, int exclude, double r2_max);
+
+#endif
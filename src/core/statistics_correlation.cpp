@@ -19,7 +19,9 @@
 #include "statistics_correlation.hpp"
 #include "particle_data.hpp"
 #include "integrate.hpp"
+#include <algorithm>
 #include <cstring>
+#include <string>
 
 /* global variables */
 double_correlation* correlations=0;
@@ -232,24 +234,29 @@ int double_correlation_init(double_correlation* self, double dt, unsigned int ta
   } else if ( strcmp(corr_operation_name,"componentwise_product") == 0 ) {
     dim_corr = dim_A;
     self->corr_operation = &componentwise_product;
+    self->corr_accumulate = &componentwise_product_accumulate;
     self->args = NULL;
   } else if ( strcmp(corr_operation_name,"complex_conjugate_product") == 0 ) {
     dim_corr = dim_A;
     self->corr_operation = &complex_conjugate_product;
+    self->corr_accumulate = &complex_conjugate_product_accumulate;
     self->args = NULL;
   } else if ( strcmp(corr_operation_name,"tensor_product") == 0 ) {
     dim_corr = dim_A*dim_B;
     self->corr_operation = &tensor_product;
+    self->corr_accumulate = &tensor_product_accumulate;
     self->args = NULL;
   } else if ( strcmp(corr_operation_name,"square_distance_componentwise") == 0 ) {
     dim_corr = dim_A;
     self->corr_operation = &square_distance_componentwise;
+    self->corr_accumulate = &square_distance_componentwise_accumulate;
     self->args = NULL;
   } else if ( strcmp(corr_operation_name,"fcs_acf") == 0 ) {
     if (dim_A %3 )
       return 18;
     dim_corr = dim_A/3;
     self->corr_operation = &fcs_acf;
+    self->corr_accumulate = NULL;
     self->args = args;
 // square_distance will be removed -- will be replaced by strides and blocks
 //  } else if ( strcmp(corr_operation_name,"square_distance") == 0 ) {
@@ -257,6 +264,7 @@ int double_correlation_init(double_correlation* self, double dt, unsigned int ta
   } else if ( strcmp(corr_operation_name,"scalar_product") == 0 ) {
     dim_corr=1;
     self->corr_operation = &scalar_product;
+    self->corr_accumulate = &scalar_product_accumulate;
     self->args = NULL;
   } else {
     return 11; 
@@ -336,6 +344,7 @@ int double_correlation_init(double_correlation* self, double dt, unsigned int ta
   self->tau = (int*)                Utils::malloc(self->n_result*sizeof(int));
   self->n_sweeps = (unsigned int*)  Utils::malloc(self->n_result*sizeof(int));
   self->result_data  = (double*)    Utils::malloc(self->n_result*dim_corr*sizeof(double));
+  self->corr_temp  = (double*)      Utils::malloc(dim_corr*sizeof(double));
   self->n_vals = (unsigned int*) Utils::malloc(hierarchy_depth*sizeof(unsigned int));
 
   // allocate space for convenience pointer to A and B buffers
@@ -387,6 +396,25 @@ int double_correlation_init(double_correlation* self, double dt, unsigned int ta
   return 0;
 }
 
+/** Add the correlation of A and B to the estimate at index_res */
+static int double_correlation_correlate( double_correlation* self, double* A, double* B, unsigned int index_res ) {
+  double* C = self->result[index_res];
+  int error;
+  if (self->corr_accumulate) {
+    error = (self->corr_accumulate)(A, self->dim_A, B, self->dim_B, C, self->dim_corr, self->args);
+  } else {
+    error = (self->corr_operation)(A, self->dim_A, B, self->dim_B, self->corr_temp, self->dim_corr, self->args);
+    if ( error == 0)
+      for (unsigned k = 0; k < self->dim_corr; k++) {
+        C[k] += self->corr_temp[k];
+      }
+  }
+  if ( error != 0)
+    return error;
+  self->n_sweeps[index_res]++;
+  return 0;
+}
+
 int double_correlation_get_data( double_correlation* self ) {
   // We must now go through the hierarchy and make sure there is space for the new 
   // datapoint. For every hierarchy level we have to decide if it necessary to move 
@@ -458,21 +486,14 @@ int double_correlation_get_data( double_correlation* self ) {
     }
   } 
 
-  double* temp = (double*)Utils::malloc(self->dim_corr*sizeof(double));
-  if (!temp)
-    return 4;
 // Now update the lowest level correlation estimates
   for ( j = 0; j < int(MIN(self->tau_lin+1, self->n_vals[0]) ); j++) {
     index_new = self->newest[0];
     index_old =  (self->newest[0] - j + self->tau_lin + 1) % (self->tau_lin + 1);
 //    printf("old %d new %d\n", index_old, index_new);
-    error = (self->corr_operation)(self->A[0][index_old], self->dim_A, self->B[0][index_new], self->dim_B, temp, self->dim_corr, self->args);
+    error = double_correlation_correlate(self, self->A[0][index_old], self->B[0][index_new], j);
     if ( error != 0)
       return error;
-    self->n_sweeps[j]++;
-    for (unsigned k = 0; k < self->dim_corr; k++) {
-      self->result[j][k] += temp[k];
-    }
   }
 // Now for the higher ones
   for ( int i = 1; i < highest_level_to_compress+2; i++) {
@@ -480,16 +501,11 @@ int double_correlation_get_data( double_correlation* self ) {
       index_new = self->newest[i];
       index_old = (self->newest[i] - j + self->tau_lin + 1) % (self->tau_lin + 1);
       index_res = self->tau_lin + (i-1)*self->tau_lin/2 + (j - self->tau_lin/2+1) -1;
-      error=(self->corr_operation)(self->A[i][index_old], self->dim_A, self->B[i][index_new], self->dim_B, temp, self->dim_corr, self->args);
+      error = double_correlation_correlate(self, self->A[i][index_old], self->B[i][index_new], index_res);
       if ( error != 0)
         return error;
-      self->n_sweeps[index_res]++;
-      for (unsigned k = 0; k < self->dim_corr; k++) {
-        self->result[index_res][k] += temp[k];
-      }
     }
   }
-  free(temp);
   return 0;
 }
 
@@ -515,24 +531,28 @@ void write_uint(FILE * fp, const unsigned int * data, unsigned int n, bool binar
 }
 int double_correlation_write_data_to_file(const double_correlation* self, const char * filename, bool binary){
   FILE* fp=0;
-  fp=fopen(filename, "w");
+  // write to a temporary file that replaces the old checkpoint only once it
+  // is complete, so that an interrupted write does not lose the checkpoint
+  std::string tmp_filename = std::string(filename) + ".tmp";
+  fp=fopen(tmp_filename.c_str(), "w");
   if (!fp) {
     return 1;
   }
-  for (unsigned int i=0; i<self->hierarchy_depth; i++) {
-    for (unsigned int j=0; j<self->tau_lin+1; j++) {
-      write_double(fp,self->A[i][j],self->dim_A,binary);
-    }
-  }
-  if (!self->autocorrelation){
-    for (unsigned int i=0; i<self->hierarchy_depth; i++) {
-      for (unsigned int j=0; j<self->tau_lin+1; j++) {
-	write_double(fp,self->B[i][j],self->dim_B,binary);
-      }
-    } 
-  }
-  for (unsigned int i=0; i<self->n_result; i++) {
-    write_double(fp,self->result[i],self->dim_corr,binary);
+  const unsigned int n_buffer = self->hierarchy_depth*(self->tau_lin+1);
+  if (binary) {
+    // the buffers are contiguous, so they are written in one go
+    write_double(fp,self->A_data,n_buffer*self->dim_A,binary);
+    if (!self->autocorrelation)
+      write_double(fp,self->B_data,n_buffer*self->dim_B,binary);
+    write_double(fp,self->result_data,self->n_result*self->dim_corr,binary);
+  } else {
+    for (unsigned int i=0; i<n_buffer; i++)
+      write_double(fp,self->A_data+i*self->dim_A,self->dim_A,binary);
+    if (!self->autocorrelation)
+      for (unsigned int i=0; i<n_buffer; i++)
+        write_double(fp,self->B_data+i*self->dim_B,self->dim_B,binary);
+    for (unsigned int i=0; i<self->n_result; i++)
+      write_double(fp,self->result[i],self->dim_corr,binary);
   }
   write_uint(fp,self->n_sweeps,self->n_result       ,binary);
   write_uint(fp,self->n_vals  ,self->hierarchy_depth,binary);
@@ -547,7 +567,13 @@ int double_correlation_write_data_to_file(const double_correlation* self, const
   write_uint(fp,&(self->n_data),1,binary);
   write_uint(fp,&(self->t     ),1,binary);
   write_double(fp,&(self->last_update),1,binary);
-  fclose(fp);
+  if (ferror(fp)) {
+    fclose(fp);
+    remove(tmp_filename.c_str());
+    return 1;
+  }
+  if (fclose(fp) != 0 || rename(tmp_filename.c_str(), filename) != 0)
+    return 1;
   return 0;
 }
 
@@ -584,21 +610,12 @@ int double_correlation_read_data_from_file(double_correlation* self, const char
   if (!fp) {
     return 2;
   }
-  for (unsigned int i=0; i<self->hierarchy_depth; i++) {
-    for (unsigned int j=0; j<self->tau_lin+1; j++) {
-      if (read_double(fp,self->A[i][j],self->dim_A,binary)) return 1;
-    }
-  }
+  const unsigned int n_buffer = self->hierarchy_depth*(self->tau_lin+1);
+  if (read_double(fp,self->A_data,n_buffer*self->dim_A,binary)) return 1;
   if (!self->autocorrelation){
-    for (unsigned int i=0; i<self->hierarchy_depth; i++) {
-      for (unsigned int j=0; j<self->tau_lin+1; j++) {
-	if (read_double(fp,self->B[i][j],self->dim_B,binary)) return 1;
-      }
-    } 
-  }
-  for (unsigned int i=0; i<self->n_result; i++) {
-    if (read_double(fp,self->result[i],self->dim_corr,binary))return 1;
+    if (read_double(fp,self->B_data,n_buffer*self->dim_B,binary)) return 1;
   }
+  if (read_double(fp,self->result_data,self->n_result*self->dim_corr,binary))return 1;
   if (read_uint(fp,self->n_sweeps,self->n_result       ,binary))return 1;
   if (read_uint(fp,self->n_vals  ,self->hierarchy_depth,binary))return 1;
   if (read_uint(fp,self->newest  ,self->hierarchy_depth,binary))return 1;
@@ -631,13 +648,9 @@ int double_correlation_finalize( double_correlation* self ) {
   unsigned tau_lin=self->tau_lin;
   int hierarchy_depth=self->hierarchy_depth;
 
-  double* temp = (double*)Utils::malloc(self->dim_corr*sizeof(double));
-
   // make a flag that the correlation is finalized
   self->finalized=1;
 
-  if (!temp)
-    return 4;
   //printf ("tau_lin:%d, hierarchy_depth: %d\n",tau_lin,hierarchy_depth); 
   //for(ll=0;ll<hierarchy_depth;ll++) printf("n_vals[l=%d]=%d\n",ll, self->n_vals[ll]);
   for(ll=0;ll<hierarchy_depth-1;ll++) {
@@ -701,13 +714,9 @@ int double_correlation_finalize( double_correlation* self ) {
           index_new = self->newest[i];
           index_old = (self->newest[i] - j + tau_lin + 1) % (tau_lin + 1);
           index_res = tau_lin + (i-1)*tau_lin/2 + (j - tau_lin/2+1) -1;
-          error=(self->corr_operation)(self->A[i][index_old], self->dim_A, self->B[i][index_new], self->dim_B, temp, self->dim_corr, self->args);
+          error = double_correlation_correlate(self, self->A[i][index_old], self->B[i][index_new], index_res);
           if ( error != 0)
             return error;
-          self->n_sweeps[index_res]++;
-          for (unsigned k = 0; k < self->dim_corr; k++) {
-            self->result[index_res][k] += temp[k];
-          }
         }
       }
       // lowest level exploited, go upwards
@@ -717,7 +726,6 @@ int double_correlation_finalize( double_correlation* self ) {
       }
     }
   }
-  free(temp);
   return 0;
 }
 
@@ -762,95 +770,110 @@ int obs_nothing (void* params, double* A, unsigned int n_A) {
 }
 
 int scalar_product ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
+  std::fill(C, C + dim_corr, 0.0);
+  return scalar_product_accumulate(A, dim_A, B, dim_B, C, dim_corr, args);
+}
+
+int componentwise_product ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
+  std::fill(C, C + dim_corr, 0.0);
+  return componentwise_product_accumulate(A, dim_A, B, dim_B, C, dim_corr, args);
+}
+
+int complex_conjugate_product ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
+  std::fill(C, C + dim_corr, 0.0);
+  return complex_conjugate_product_accumulate(A, dim_A, B, dim_B, C, dim_corr, args);
+}
+
+int tensor_product ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
+  std::fill(C, C + dim_corr, 0.0);
+  return tensor_product_accumulate(A, dim_A, B, dim_B, C, dim_corr, args);
+}
+
+int square_distance_componentwise ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
+  std::fill(C, C + dim_corr, 0.0);
+  return square_distance_componentwise_accumulate(A, dim_A, B, dim_B, C, dim_corr, args);
+}
+
+int fcs_acf ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
+  DoubleList *wsquare = (DoubleList*)args;
+  if (args == NULL )
+    return 1;
+  if (!(dim_A == dim_B )) {
+    return 5;
+  }
+  if ( dim_A / dim_corr != 3) {
+    return 6; 
+  }
+  for (unsigned i = 0; i < dim_corr; i++ ) 
+    C[i] = 0;
+  for (unsigned i = 0; i < dim_A; i++ ) {
+    C [i/3] -= ( (A[i]-B[i])*(A[i]-B[i]) ) / wsquare->e[i%3];
+  }
+  for (unsigned i = 0; i < dim_corr; i++ ) 
+    C[i] = exp(C[i]);
+  return 0;
+}
+
+
+int scalar_product_accumulate ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
   double temp = 0;
-  unsigned int i;
   if (!(dim_A == dim_B && dim_corr == 1 )) {
     printf("Error in scalar product: The vector sizes do not match");
     return 5;
   }
-  for ( i = 0; i < dim_A; i++ ) {
+  for (unsigned i = 0; i < dim_A; i++ ) {
     temp += A[i]*B[i];
   }
-  C[0] = temp; 
+  C[0] += temp;
   return 0;
 }
 
-int componentwise_product ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
-  unsigned int i;
-  if (!(dim_A == dim_B )) {
-    printf("Error in componentwise product: The vector sizes do not match");
-    return 5;
-  } 
-  if (!(dim_A == dim_corr )) {
+int componentwise_product_accumulate ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
+  if (!(dim_A == dim_B && dim_A == dim_corr )) {
     printf("Error in componentwise product: The vector sizes do not match");
     return 5;
   }
-  for ( i = 0; i < dim_A; i++ ) {
-    C[i] = A[i]*B[i];
+  for (unsigned i = 0; i < dim_A; i++ ) {
+    C[i] += A[i]*B[i];
   }
   return 0;
 }
 
-int complex_conjugate_product ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
-  unsigned int i,j;
+int complex_conjugate_product_accumulate ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
   if (!(dim_A == dim_B )) {
     printf("Error in complex_conjugate product: The vector sizes do not match");
     return 5;
   }
-  j=0;
-  for ( i = 0; i < dim_A/2; i++ ) {
-    C[j] = A[j]*B[j] + A[j+1]*B[j+1];
-    C[j+1] = A[j+1]*B[j] - A[j]*B[j+1];
-    j=j+2;
+  for (unsigned j = 0; j+1 < dim_A; j += 2 ) {
+    C[j]   += A[j]*B[j] + A[j+1]*B[j+1];
+    C[j+1] += A[j+1]*B[j] - A[j]*B[j+1];
   }
   return 0;
 }
 
-int tensor_product ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
-  unsigned int i,j;
-  for ( i = 0; i < dim_A; i++ )
-  {
-    for ( j = 0; j < dim_B; j++ )
-    {
-      C[i*dim_B + j] = A[i]*B[j];
+int tensor_product_accumulate ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
+  for (unsigned i = 0; i < dim_A; i++ ) {
+    const double a = A[i];
+    double* C_row = C + i*dim_B;
+    for (unsigned j = 0; j < dim_B; j++ ) {
+      C_row[j] += a*B[j];
     }
   }
   return 0;
 }
 
-int square_distance_componentwise ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
-  unsigned int i;
+int square_distance_componentwise_accumulate ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
   if (!(dim_A == dim_B )) {
     printf("Error in square distance componentwise: The vector sizes do not match\n");
     return 5;
   }
-  for ( i = 0; i < dim_A; i++ ) {
-    C[i] = (A[i]-B[i])*(A[i]-B[i]);
-  }
-  return 0;
-}
-
-int fcs_acf ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args ) {
-  DoubleList *wsquare = (DoubleList*)args;
-  if (args == NULL )
-    return 1;
-  if (!(dim_A == dim_B )) {
-    return 5;
-  }
-  if ( dim_A / dim_corr != 3) {
-    return 6; 
-  }
-  for (unsigned i = 0; i < dim_corr; i++ ) 
-    C[i] = 0;
   for (unsigned i = 0; i < dim_A; i++ ) {
-    C [i/3] -= ( (A[i]-B[i])*(A[i]-B[i]) ) / wsquare->e[i%3];
+    const double d = A[i]-B[i];
+    C[i] += d*d;
   }
-  for (unsigned i = 0; i < dim_corr; i++ ) 
-    C[i] = exp(C[i]);
   return 0;
 }
 
-
 void autoupdate_correlations() {
   for (unsigned i=0; i<n_correlations; i++) {
     if (correlations[i].autoupdate && sim_time-correlations[i].last_update>correlations[i].dt*0.99999) {
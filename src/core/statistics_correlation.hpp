@@ -182,6 +182,10 @@ typedef struct {
   // correlation function
   int (*corr_operation)  ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args );
   char *corr_operation_name;
+  // fused version of the correlation function, which adds its result to C
+  // instead of overwriting it; NULL if there is none
+  int (*corr_accumulate)  ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args );
+  double* corr_temp;                 // scratch space of dim_corr for corr_operation
 
   // Functions producing observables A and B from the input data
   observable* A_obs;
@@ -265,7 +269,10 @@ void write_double(FILE * fp, const double * data, unsigned int n, bool binary);
 void write_uint(FILE * fp, const unsigned int * data, unsigned int n, bool binary);
 int read_double(FILE * fp, double * data, unsigned int n, bool binary);
 int read_uint(FILE * fp, unsigned int * data, unsigned int n, bool binary);
-/** Write a checkpoint, saving all history buffers and other important variables of a correlation in a file
+/** Write a checkpoint, saving all history buffers and other important variables of a correlation in a file.
+    The file is always written completely and replaces the old one only when it is complete. Writing only the
+    changed parts would not save much, since every update changes the newest entries of the buffers and the
+    result rows of all lags of the first level.
 */
 int double_correlation_write_data_to_file(const double_correlation* self, const char * filename, bool binary);
 
@@ -341,4 +348,14 @@ int square_distance_cond ( double* A, unsigned int dim_A, double* B, unsigned in
 
 int square_distance_cond_chain ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args );
 
+/** Fused versions of the correlation operations that add the result to C.
+    They avoid the temporary result vector in the update of the correlation
+    estimates, and their loops are simple enough to be vectorized. The plain
+    operations above set C to zero and call these. */
+int scalar_product_accumulate ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args );
+int componentwise_product_accumulate ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args );
+int complex_conjugate_product_accumulate ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args );
+int tensor_product_accumulate ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args );
+int square_distance_componentwise_accumulate ( double* A, unsigned int dim_A, double* B, unsigned int dim_B, double* C, unsigned int dim_corr, void *args );
+
 #endif
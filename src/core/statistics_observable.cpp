@@ -23,6 +23,11 @@
 #include "lb.hpp"
 #include "pressure.hpp"
 #include "rotation.hpp"
+#include "cells.hpp"
+#include "communication.hpp"
+#include "grid.hpp"
+#include <algorithm>
+#include <vector>
 
 using std::ostringstream;
 
@@ -102,22 +107,250 @@ int observable_read(char *filename, observable *self, bool binary) {
   return ES_ERROR;
 }
 
-int observable_calc_particle_velocities(observable* self) {
-  double* A = self->last_value;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
+/****************** parallel evaluation ******************/
+
+/** Integer q vectors (in units of 2 pi/L) sampled by
+    \\ref observable_calc_structure_factor_fast, in the order of the result
+    array. Returns false if k_density is not supported. */
+static bool structure_factor_fast_q_vectors(int order_max, int k_density, std::vector<int>& q) {
+  q.clear();
+  if (k_density > 6)
+    return false;
+  for(int k=0; k<order_max*k_density; k++) {
+    int order=k/k_density+1;
+    int v[3];
+    switch (k % k_density){
+    case 0: // length sqrt(1)
+      for (int dir=0;dir<3;dir++){
+        v[0]=v[1]=v[2]=0;
+        v[dir]=1;
+        for (int i=0;i<3;i++) q.push_back(order*v[i]);
+      }
+      break;
+    case 1: // length sqrt(2)
+      for (int dir=0;dir<6;dir++){
+        int off1=(dir%3==2) ? 1 : 0;
+        int off2=(dir%3==0) ? 1 : 2;
+        v[0]=v[1]=v[2]=0;
+        v[off1]=(dir<3) ? 1 : -1;
+        v[off2]=1;
+        for (int i=0;i<3;i++) q.push_back(order*v[i]);
+      }
+      break;
+    case 2: // length sqrt(3)
+      for (int dir=0;dir<4;dir++){
+        v[0]=1-2*(dir%2);
+        v[1]=1-2*(dir/2);
+        v[2]=1;
+        for (int i=0;i<3;i++) q.push_back(order*v[i]);
+      }
+      break;
+    case 3: // length sqrt(5)
+      for (int dir=0;dir<6;dir++){
+        v[dir%3]=1-2*(dir/3);
+        v[(dir+1)%3]=2;
+        v[(dir+2)%3]=0;
+        for (int i=0;i<3;i++) q.push_back(order*v[i]);
+      }
+      break;
+    case 4: // length sqrt(6)
+      for (int dir=0;dir<6;dir++){
+        v[dir%3]=1;
+        v[(dir+1)%3]=(1-2*(dir/3))*2;
+        v[(dir+2)%3]=1;
+        for (int i=0;i<3;i++) q.push_back(order*v[i]);
+      }
+      break;
+    case 5: // length sqrt(9)
+      for (int dir=0;dir<6;dir++){
+        v[dir%3]=(1-2*(dir/3))*2;
+        v[(dir+1)%3]=2;
+        v[(dir+2)%3]=1;
+        for (int i=0;i<3;i++) q.push_back(order*v[i]);
+      }
+      break;
+    }
   }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-    A[3*i + 0] = partCfg[ids->e[i]].m.v[0]/time_step;
-    A[3*i + 1] = partCfg[ids->e[i]].m.v[1]/time_step;
-    A[3*i + 2] = partCfg[ids->e[i]].m.v[2]/time_step;
+  return true;
+}
+
+/** Cartesian bin of a folded position for the profile kernels, -1 if
+    outside of the profile. */
+static int observable_parallel_bin(const observable_parallel_params* params, double ppos[3]) {
+  int bin[3];
+  for (int i=0;i<3;i++) {
+    double min=params->dparams[2*i], max=params->dparams[2*i+1];
+    bin[i]=(int) floor(params->iparams[i]*(ppos[i]-min)/(max-min));
+    if (bin[i] < 0 || bin[i] >= params->iparams[i])
+      return -1;
   }
-  return 0;
+  return bin[0]*params->iparams[1]*params->iparams[2] + bin[1]*params->iparams[2] + bin[2];
+}
+
+/** Add the contribution of one local particle. slot is the position of
+    the particle in the id list, or -1 if selected by type. */
+static void observable_parallel_add(const observable_parallel_params* params,
+                                    const std::vector<int>& q,
+                                    Particle* p, int slot, double* A) {
+  double pos[3], vel[3];
+  int img[3];
+  memmove(pos, p->r.p, 3*sizeof(double));
+  memmove(vel, p->m.v, 3*sizeof(double));
+  memmove(img, p->l.i, 3*sizeof(int));
+  unfold_position(pos, vel, img);
+
+  switch (params->kernel) {
+  case OBS_PAR_PARTICLE_POSITIONS:
+    for (int i=0;i<3;i++) A[3*slot+i] = pos[i];
+    break;
+  case OBS_PAR_PARTICLE_VELOCITIES:
+    for (int i=0;i<3;i++) A[3*slot+i] = vel[i]/time_step;
+    break;
+  case OBS_PAR_PARTICLE_FORCES:
+    for (int i=0;i<3;i++) A[3*slot+i] = p->f.f[i]/time_step/time_step*2;
+    break;
+  case OBS_PAR_MASS_WEIGHTED_POSITION:
+    for (int i=0;i<3;i++) A[i] += p->p.mass*pos[i];
+    A[3] += p->p.mass;
+    break;
+  case OBS_PAR_MASS_WEIGHTED_VELOCITY:
+    for (int i=0;i<3;i++) A[i] += p->p.mass*vel[i]/time_step;
+    A[3] += p->p.mass;
+    break;
+  case OBS_PAR_FORCE_SUM:
+    for (int i=0;i<3;i++) A[i] += p->f.f[i]/time_step/time_step*2;
+    break;
+  case OBS_PAR_DENSITY_PROFILE:
+  case OBS_PAR_FORCE_DENSITY_PROFILE: {
+    /* We use folded coordinates here */
+    fold_position(pos, img);
+    int bin = observable_parallel_bin(params, pos);
+    if (bin < 0)
+      break;
+    double bin_volume = 1.;
+    for (int i=0;i<3;i++)
+      bin_volume *= (params->dparams[2*i+1]-params->dparams[2*i])/params->iparams[i];
+    if (params->kernel == OBS_PAR_DENSITY_PROFILE)
+      A[bin] += 1./bin_volume;
+    else
+      for (int i=0;i<3;i++)
+        A[3*bin+i] += p->f.f[i]/bin_volume;
+    break;
+  }
+  case OBS_PAR_STRUCTURE_FACTOR_FAST: {
+    // FIXME Currently scattering length is hardcoded as 1.0
+    const double twoPI_L = 2*PI/box_l[0];
+    for (int l=0; 3*l<(int) q.size() && 2*l+1<params->n_A; l++) {
+      double qr = twoPI_L*(q[3*l]*pos[0] + q[3*l+1]*pos[1] + q[3*l+2]*pos[2]);
+      A[2*l]   += cos(qr);
+      A[2*l+1] += sin(qr);
+    }
+    break;
+  }
+  case OBS_PAR_GYRATION_TENSOR: {
+    double d[3];
+    for (int i=0;i<3;i++) d[i] = pos[i] - params->dparams[i];
+    A[0] += d[0]*d[0];
+    A[1] += d[0]*d[1];
+    A[2] += d[0]*d[2];
+    A[3] += d[1]*d[1];
+    A[4] += d[1]*d[2];
+    A[5] += d[2]*d[2];
+    A[6] += 1.;
+    break;
+  }
+  }
+}
+
+/** Accumulate an observable over the local particles of this node. */
+static void observable_calc_local(const observable_parallel_params* params, const int* ids, double* A) {
+  std::vector<int> q;
+  if (params->kernel == OBS_PAR_STRUCTURE_FACTOR_FAST)
+    structure_factor_fast_q_vectors(params->iparams[0], params->iparams[1], q);
+
+  for (int i=0; i<params->n_A; i++)
+    A[i] = 0.;
+
+  /* slots of each id in the id list, sorted by id (counting sort) */
+  std::vector<int> slot_start, slots;
+  if (params->n_ids >= 0) {
+    int max_id = -1;
+    for (int i=0; i<params->n_ids; i++)
+      max_id = std::max(max_id, ids[i]);
+    slot_start.assign(max_id+2, 0);
+    for (int i=0; i<params->n_ids; i++)
+      slot_start[ids[i]+1]++;
+    for (int id=0; id<=max_id; id++)
+      slot_start[id+1] += slot_start[id];
+    slots.resize(params->n_ids);
+    std::vector<int> next(slot_start.begin(), slot_start.end()-1);
+    for (int i=0; i<params->n_ids; i++)
+      slots[next[ids[i]]++] = i;
+  }
+
+  for (int c = 0; c < local_cells.n; c++) {
+    Cell *cell = local_cells.cell[c];
+    for (int j = 0; j < cell->n; j++) {
+      Particle *p = &cell->part[j];
+      if (params->n_ids >= 0) {
+        int id = p->p.identity;
+        if (id + 1 >= (int) slot_start.size())
+          continue;
+        for (int s = slot_start[id]; s < slot_start[id+1]; s++)
+          observable_parallel_add(params, q, p, slots[s], A);
+      }
+      else if (params->type == -1 || p->p.type == params->type)
+        observable_parallel_add(params, q, p, -1, A);
+    }
+  }
+}
+
+int observable_calc_parallel(observable_parallel_params* params, int* ids, double* A) {
+  if (n_nodes == 1) {
+    observable_calc_local(params, ids, A);
+    return ES_OK;
+  }
+  mpi_observable_parallel();
+  MPI_Bcast(params, sizeof(observable_parallel_params), MPI_BYTE, 0, comm_cart);
+  if (params->n_ids > 0)
+    MPI_Bcast(ids, params->n_ids, MPI_INT, 0, comm_cart);
+  std::vector<double> data(params->n_A);
+  observable_calc_local(params, ids, data.data());
+  MPI_Reduce(data.data(), A, params->n_A, MPI_DOUBLE, MPI_SUM, 0, comm_cart);
+  return ES_OK;
+}
+
+void mpi_observable_parallel_slave_implementation() {
+  observable_parallel_params params;
+  MPI_Bcast(&params, sizeof(observable_parallel_params), MPI_BYTE, 0, comm_cart);
+  std::vector<int> ids(std::max(params.n_ids, 0));
+  if (params.n_ids > 0)
+    MPI_Bcast(ids.data(), params.n_ids, MPI_INT, 0, comm_cart);
+  std::vector<double> data(params.n_A);
+  observable_calc_local(&params, ids.data(), data.data());
+  MPI_Reduce(data.data(), 0, params.n_A, MPI_DOUBLE, MPI_SUM, 0, comm_cart);
+}
+
+/** Set up the parameters for a kernel on an id list. Returns false if an
+    id is not a valid particle. */
+static bool observable_parallel_init(observable_parallel_params* params, int kernel, int n_A, IntList* ids) {
+  for (int i = 0; i<ids->n; i++ )
+    if (ids->e[i] < 0 || ids->e[i] >= n_part)
+      return false;
+  memset(params, 0, sizeof(observable_parallel_params));
+  params->kernel = kernel;
+  params->n_A = n_A;
+  params->n_ids = ids->n;
+  params->type = -1;
+  return true;
+}
+
+int observable_calc_particle_velocities(observable* self) {
+  IntList* ids=(IntList*) self->container;
+  observable_parallel_params params;
+  if (!observable_parallel_init(&params, OBS_PAR_PARTICLE_VELOCITIES, 3*ids->n, ids))
+    return 1;
+  return observable_calc_parallel(&params, ids->e, self->last_value);
 }
 
 int observable_calc_particle_body_velocities(observable* self) {
@@ -326,25 +559,16 @@ int observable_calc_com_dipole_moment(observable* self) {
 
 int observable_calc_com_velocity(observable* self) {
   double* A = self->last_value;
-  double v_com[3] = { 0. , 0., 0. } ;
-  double total_mass = 0;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
+  IntList* ids=(IntList*) self->container;
+  observable_parallel_params params;
+  double data[4];
+  if (!observable_parallel_init(&params, OBS_PAR_MASS_WEIGHTED_VELOCITY, 4, ids))
+    return 1;
+  if (observable_calc_parallel(&params, ids->e, data) != ES_OK)
     return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-    v_com[0] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].m.v[0]/time_step;
-    v_com[1] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].m.v[1]/time_step;
-    v_com[2] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].m.v[2]/time_step;
-    total_mass += (partCfg[ids->e[i]]).p.mass;
-  }
-  A[0]=v_com[0]/total_mass;
-  A[1]=v_com[1]/total_mass;
-  A[2]=v_com[2]/total_mass;
+  A[0]=data[0]/data[3];
+  A[1]=data[1]/data[3];
+  A[2]=data[2]/data[3];
   return 0;
 }
 
@@ -418,49 +642,26 @@ int observable_calc_blocked_com_position(observable* self) {
 
 int observable_calc_com_position(observable* self) {
   double* A = self->last_value;
-  double p_com[3] = { 0. , 0., 0. } ;
-  double total_mass = 0;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
+  IntList* ids=(IntList*) self->container;
+  observable_parallel_params params;
+  double data[4];
+  if (!observable_parallel_init(&params, OBS_PAR_MASS_WEIGHTED_POSITION, 4, ids))
+    return 1;
+  if (observable_calc_parallel(&params, ids->e, data) != ES_OK)
     return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-    p_com[0] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].r.p[0];
-    p_com[1] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].r.p[1];
-    p_com[2] += (partCfg[ids->e[i]]).p.mass*partCfg[ids->e[i]].r.p[2];
-    total_mass += (partCfg[ids->e[i]]).p.mass;
-  }
-  A[0]=p_com[0]/total_mass;
-  A[1]=p_com[1]/total_mass;
-  A[2]=p_com[2]/total_mass;
+  A[0]=data[0]/data[3];
+  A[1]=data[1]/data[3];
+  A[2]=data[2]/data[3];
   return 0;
 }
 
 
 int observable_calc_com_force(observable* self) {
-  double* A = self->last_value;
-  double f_com[3] = { 0. , 0., 0. } ;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-    f_com[0] += partCfg[ids->e[i]].f.f[0]/time_step/time_step*2;
-    f_com[1] += partCfg[ids->e[i]].f.f[1]/time_step/time_step*2;
-    f_com[2] += partCfg[ids->e[i]].f.f[2]/time_step/time_step*2;
-  }
-  A[0]=f_com[0];
-  A[1]=f_com[1];
-  A[2]=f_com[2];
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  observable_parallel_params params;
+  if (!observable_parallel_init(&params, OBS_PAR_FORCE_SUM, 3, ids))
+    return 1;
+  return observable_calc_parallel(&params, ids->e, self->last_value);
 }
 
 
@@ -494,76 +695,37 @@ int observable_calc_blocked_com_force(observable* self) {
 
 
 int observable_calc_density_profile(observable* self) {
-  double* A = self->last_value;
-  int binx, biny, binz;
-  double ppos[3];
-  int img[3];
-  IntList* ids;
-  profile_data* pdata;
-
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  pdata=(profile_data*) self->container;
-  ids=pdata->id_list;
-  double bin_volume=(pdata->maxx-pdata->minx)*(pdata->maxy-pdata->miny)*(pdata->maxz-pdata->minz)/pdata->xbins/pdata->ybins/pdata->zbins;
-    
-  for ( int i = 0; i<self->n; i++ ) {
-    A[i]=0;
-  }
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-/* We use folded coordinates here */
-    memmove(ppos, partCfg[ids->e[i]].r.p, 3*sizeof(double));
-    memmove(img, partCfg[ids->e[i]].l.i, 3*sizeof(int));
-    fold_position(ppos, img);
-    binx= (int) floor( pdata->xbins*  (ppos[0]-pdata->minx)/(pdata->maxx-pdata->minx));
-    biny= (int) floor( pdata->ybins*  (ppos[1]-pdata->miny)/(pdata->maxy-pdata->miny));
-    binz= (int) floor( pdata->zbins*  (ppos[2]-pdata->minz)/(pdata->maxz-pdata->minz));
-    if (binx>=0 && binx < pdata->xbins && biny>=0 && biny < pdata->ybins && binz>=0 && binz < pdata->zbins) {
-      A[binx*pdata->ybins*pdata->zbins + biny*pdata->zbins + binz] += 1./bin_volume;
-    } 
-  }
-  return 0;
+  profile_data* pdata=(profile_data*) self->container;
+  observable_parallel_params params;
+  if (!observable_parallel_init(&params, OBS_PAR_DENSITY_PROFILE, self->n, pdata->id_list))
+    return 1;
+  params.iparams[0]=pdata->xbins;
+  params.iparams[1]=pdata->ybins;
+  params.iparams[2]=pdata->zbins;
+  params.dparams[0]=pdata->minx;
+  params.dparams[1]=pdata->maxx;
+  params.dparams[2]=pdata->miny;
+  params.dparams[3]=pdata->maxy;
+  params.dparams[4]=pdata->minz;
+  params.dparams[5]=pdata->maxz;
+  return observable_calc_parallel(&params, pdata->id_list->e, self->last_value);
 }
 
 int observable_calc_force_density_profile(observable* self) {
-  double* A = self->last_value;
-  int binx, biny, binz;
-  double ppos[3];
-  int img[3];
-  IntList* ids;
-  profile_data* pdata;
-
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  pdata=(profile_data*) self->container;
-  ids=pdata->id_list;
-  double bin_volume=(pdata->maxx-pdata->minx)*(pdata->maxy-pdata->miny)*(pdata->maxz-pdata->minz)/pdata->xbins/pdata->ybins/pdata->zbins;
-    
-  for ( int i = 0; i<self->n; i++ ) {
-    A[i]=0;
-  }
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-/* We use folded coordinates here */
-    memmove(ppos, partCfg[ids->e[i]].r.p, 3*sizeof(double));
-    memmove(img, partCfg[ids->e[i]].l.i, 3*sizeof(int));
-    fold_position(ppos, img);
-    binx= (int) floor( pdata->xbins*  (ppos[0]-pdata->minx)/(pdata->maxx-pdata->minx));
-    biny= (int) floor( pdata->ybins*  (ppos[1]-pdata->miny)/(pdata->maxy-pdata->miny));
-    binz= (int) floor( pdata->zbins*  (ppos[2]-pdata->minz)/(pdata->maxz-pdata->minz));
-    if (binx>=0 && binx < pdata->xbins && biny>=0 && biny < pdata->ybins && binz>=0 && binz < pdata->zbins) {
-      for(int dim = 0; dim < 3; dim++)
-        A[3*(binx*pdata->ybins*pdata->zbins + biny*pdata->zbins + binz) + dim] += partCfg[ids->e[i]].f.f[dim]/bin_volume;
-    } 
-  }
-  return 0;
+  profile_data* pdata=(profile_data*) self->container;
+  observable_parallel_params params;
+  if (!observable_parallel_init(&params, OBS_PAR_FORCE_DENSITY_PROFILE, self->n, pdata->id_list))
+    return 1;
+  params.iparams[0]=pdata->xbins;
+  params.iparams[1]=pdata->ybins;
+  params.iparams[2]=pdata->zbins;
+  params.dparams[0]=pdata->minx;
+  params.dparams[1]=pdata->maxx;
+  params.dparams[2]=pdata->miny;
+  params.dparams[3]=pdata->maxy;
+  params.dparams[4]=pdata->minz;
+  params.dparams[5]=pdata->maxz;
+  return observable_calc_parallel(&params, pdata->id_list->e, self->last_value);
 }
 
 #ifdef LB
@@ -982,39 +1144,19 @@ int observable_calc_flux_density_profile(observable* self) {
 }
 
 int observable_calc_particle_positions(observable* self) {
-  double* A = self->last_value;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-      A[3*i + 0] = partCfg[ids->e[i]].r.p[0];
-      A[3*i + 1] = partCfg[ids->e[i]].r.p[1];
-      A[3*i + 2] = partCfg[ids->e[i]].r.p[2];
-  }
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  observable_parallel_params params;
+  if (!observable_parallel_init(&params, OBS_PAR_PARTICLE_POSITIONS, 3*ids->n, ids))
+    return 1;
+  return observable_calc_parallel(&params, ids->e, self->last_value);
 }
 
 int observable_calc_particle_forces(observable* self) {
-  double* A = self->last_value;
-  IntList* ids;
-  if (!sortPartCfg()) {
-      runtimeErrorMsg() <<"could not sort partCfg";
-    return -1;
-  }
-  ids=(IntList*) self->container;
-  for (int i = 0; i<ids->n; i++ ) {
-    if (ids->e[i] >= n_part)
-      return 1;
-      A[3*i + 0] = partCfg[ids->e[i]].f.f[0]/time_step/time_step*2;
-      A[3*i + 1] = partCfg[ids->e[i]].f.f[1]/time_step/time_step*2;
-      A[3*i + 2] = partCfg[ids->e[i]].f.f[2]/time_step/time_step*2;
-  }
-  return 0;
+  IntList* ids=(IntList*) self->container;
+  observable_parallel_params params;
+  if (!observable_parallel_init(&params, OBS_PAR_PARTICLE_FORCES, 3*ids->n, ids))
+    return 1;
+  return observable_calc_parallel(&params, ids->e, self->last_value);
 }
 
 
@@ -1129,144 +1271,28 @@ int observable_calc_structure_factor(observable* self) {
 
 
 int observable_calc_structure_factor_fast(observable* self) {
-  //printf("calculating\n");
   double* A = self->last_value;
-  // FIXME Currently scattering length is hardcoded as 1.0
   observable_sf_params * params = (observable_sf_params*) self->container;
-  const int k_max = params->order * params->k_density;
-  const double scattering_length=1.0;
-  const double twoPI_L = 2*PI/box_l[0];
-  
-  if (!sortPartCfg()) {
-    runtimeErrorMsg() <<"could not sort partCfg";
+  std::vector<int> q;
+  if (!structure_factor_fast_q_vectors(params->order, params->k_density, q)) {
+    runtimeErrorMsg() <<"so many samples per order not yet implemented";
     return -1;
   }
-  
-  for(int p=0; p<self->n; p++) {
-    A[p]   = 0.0;
-  }
-  
-  float partCache[n_part*3];
-  for(int p=0; p<n_part; p++) {
-    for (int i=0;i<3;i++){
-      partCache[3*p+i]=partCfg[p].r.p[i];
-    }
-  }
-  int k_density = params->k_density;
-  int l=0;
-  for(int k=0; k<k_max; k++) {
-    int order=k/k_density+1;
-    switch (k % k_density){
-    case 0: // length sqrt(1)
-      for (int dir=0;dir<3;dir++){
-	double C_sum = 0;
-	double S_sum = 0;
-	for(int p=0; p<n_part; p++) {
-	//double qr = twoPI_L * k  * ( ix*partCache[3*p+0] + iy*partCache[3*p+1] + iz*partCache[3*p+2] );
-	  double qr = twoPI_L * order * ( partCache[3*p+dir]);
-	  C_sum+= scattering_length * cos(qr);
-	  S_sum+= scattering_length * sin(qr);
-	}
-	A[l]   =C_sum;
-	A[l+1] =S_sum;
-	l+=2;
-      }
-      break;
-    case 1: // length sqrt(2)
-      for (int dir=0;dir<6;dir++){
-	int fac1,fac2,off1,off2;
-	switch (dir){
-	case 0: fac1= 1; off1=0; fac2= 1; off2=1; break;
-	case 1: fac1= 1; off1=0; fac2= 1; off2=2; break;
-	case 2: fac1= 1; off1=1; fac2= 1; off2=2; break;
-	case 3: fac1=-1; off1=0; fac2= 1; off2=1; break;
-	case 4: fac1=-1; off1=0; fac2= 1; off2=2; break;
-	case 5: fac1=-1; off1=1; fac2= 1; off2=2; break;
-	}
-	double C_sum = 0;
-	double S_sum = 0;
-	for(int p=0; p<n_part; p++) {
-	  double qr = twoPI_L * order * ( partCache[3*p+off1]*fac1+ partCache[3*p+off2]*fac2);
-	  C_sum+= scattering_length * cos(qr);
-	  S_sum+= scattering_length * sin(qr);
-	}
-	A[l]   =C_sum;
-	A[l+1] =S_sum;
-	l+=2;
-      }
-      break;
-    case 2: // length sqrt(3)
-      for (int dir=0;dir<4;dir++){
-	double C_sum = 0;
-	double S_sum = 0;
-	int fac1=(1-2*(dir%2));
-	int fac2=(1-2*(dir/2));
-	for(int p=0; p<n_part; p++) {
-	  double qr = twoPI_L * order * ( partCache[3*p+0]*fac1 + partCache[3*p+1]*fac2 + partCache[3*p+2]);
-	  C_sum+= scattering_length * cos(qr);
-	  S_sum+= scattering_length * sin(qr);
-	}
-	A[l]   =C_sum;
-	A[l+1] =S_sum;
-	l+=2;
-      }
-      break;
-    case 3: // length sqrt(5) 
-      for (int dir=0;dir<6;dir++){
-	double C_sum = 0;
-	double S_sum = 0;
-	// pick 6 random vectors
-	int fac1=(1-2*(dir/3));
-	for(int p=0; p<n_part; p++) {
-	  double qr = twoPI_L * order * ( partCache[3*p+(dir%3)]*fac1 + partCache[3*p+((dir+1)%3)]*2);
-	  C_sum+= scattering_length * cos(qr);
-	  S_sum+= scattering_length * sin(qr);
-	}
-	A[l]   =C_sum;
-	A[l+1] =S_sum;
-	l+=2;
-      }
-      break;
-    case 4: // length sqrt(6) 
-      for (int dir=0;dir<6;dir++){
-	double C_sum = 0;
-	double S_sum = 0;
-	// pick 6 random vectors
-	int fac1=(1-2*(dir/3))*2;
-	for(int p=0; p<n_part; p++) {
-	  double qr = twoPI_L * order * ( partCache[3*p+(dir%3)] + partCache[3*p+((dir+1)%3)]*fac1 + partCache[3*p+((dir+2)%3)]);
-	  C_sum+= scattering_length * cos(qr);
-	  S_sum+= scattering_length * sin(qr);
-	}
-	A[l]   =C_sum;
-	A[l+1] =S_sum;
-	l+=2;
-      }
-      break;
-    case 5: // length sqrt(9)
-      for (int dir=0;dir<6;dir++){
-	double C_sum = 0;
-	double S_sum = 0;
-	// pick 6 random vectors
-	int fac1=(1-2*(dir/3))*2;
-	for(int p=0; p<n_part; p++) {
-	  double qr = twoPI_L * order * ( partCache[3*p+(dir%3)]*fac1 + partCache[3*p+((dir+1)%3)]*2 + partCache[3*p+((dir+2)%3)]);
-	  C_sum+= scattering_length * cos(qr);
-	  S_sum+= scattering_length * sin(qr);
-	}
-	A[l]   =C_sum;
-	A[l+1] =S_sum;
-	l+=2;
-      }
-      break;
-    default:
-      runtimeErrorMsg() <<"so many samples per order not yet implemented";
-      return -1;
-    }
-  }
+
+  observable_parallel_params pparams;
+  memset(&pparams, 0, sizeof(observable_parallel_params));
+  pparams.kernel = OBS_PAR_STRUCTURE_FACTOR_FAST;
+  pparams.n_A = std::min<int>(self->n, 2*q.size()/3);
+  pparams.n_ids = -1;
+  pparams.type = -1;
+  pparams.iparams[0] = params->order;
+  pparams.iparams[1] = params->k_density;
+  if (observable_calc_parallel(&pparams, NULL, A) != ES_OK)
+    return -1;
+
   for(int l=0;l<self->n;l++) {
     //devide by the sqrt of number_of_particle, average later
-    A[l] /= sqrt(n_part);
+    A[l] = (l < pparams.n_A) ? A[l]/sqrt(n_part) : 0.0;
   }
   return 0;
 }
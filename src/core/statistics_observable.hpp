@@ -176,6 +176,68 @@ typedef struct {
 
 void mpi_observable_lb_radial_velocity_profile_slave_implementation();
 
+/** \name Parallel evaluation of particle observables
+    Instead of gathering the complete configuration into \ref partCfg on
+    the master node, these observables are evaluated on the local particles
+    of every node. Each node accumulates the contributions of its particles
+    into an array of the size of the result, and the arrays are summed up
+    on the master node. Per-particle observables are written into the slots
+    of the id list, which are zero on all nodes that do not own the
+    particle. Only the parameters and the id list are broadcast. */
+/*@{*/
+
+enum ObservableParallelKernel {
+  /** per particle: unfolded position */
+  OBS_PAR_PARTICLE_POSITIONS,
+  /** per particle: velocity */
+  OBS_PAR_PARTICLE_VELOCITIES,
+  /** per particle: force */
+  OBS_PAR_PARTICLE_FORCES,
+  /** sum of m*r (unfolded) and of m */
+  OBS_PAR_MASS_WEIGHTED_POSITION,
+  /** sum of m*v and of m */
+  OBS_PAR_MASS_WEIGHTED_VELOCITY,
+  /** sum of the forces */
+  OBS_PAR_FORCE_SUM,
+  /** density histogram on a cartesian grid */
+  OBS_PAR_DENSITY_PROFILE,
+  /** force density histogram on a cartesian grid */
+  OBS_PAR_FORCE_DENSITY_PROFILE,
+  /** cosine and sine sums of \ref observable_calc_structure_factor_fast */
+  OBS_PAR_STRUCTURE_FACTOR_FAST,
+  /** upper triangle of sum of (r-c)(r-c)^T and the number of particles,
+      c is given in dparams[0..2] */
+  OBS_PAR_GYRATION_TENSOR
+};
+
+typedef struct {
+  /** one of \ref ObservableParallelKernel */
+  int kernel;
+  /** length of the result array */
+  int n_A;
+  /** length of the id list, or -1 to select the particles by type */
+  int n_ids;
+  /** particle type if selecting by type, -1 for all particles */
+  int type;
+  /** integer parameters, e.g. number of bins */
+  int iparams[3];
+  /** real parameters, e.g. profile boundaries */
+  double dparams[6];
+} observable_parallel_params;
+
+/** Evaluate an observable on the local particles of all nodes and sum up
+    the result on the master node.
+    @param params observable to calculate and its parameters
+    @param ids    id list of params->n_ids particles, may be NULL if
+                  selecting by type
+    @param A      result array of length params->n_A
+    @return ES_OK or ES_ERROR
+*/
+int observable_calc_parallel(observable_parallel_params* params, int* ids, double* A);
+
+void mpi_observable_parallel_slave_implementation();
+/*@}*/
+
 int observable_radial_density_distribution(observable* self);
 
 typedef struct { 
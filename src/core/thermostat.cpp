@@ -62,6 +62,8 @@ int ghmc_nmd = 1;
 // phi parameter for partial momentum update step in GHMC
 double ghmc_phi = 0;
 
+uint64_t thermo_noise_step = 0;
+
 double langevin_pref1, langevin_pref2, langevin_pref2_rotation;
 #ifdef MULTI_TIMESTEP
   double langevin_pref1_small, langevin_pref2_small;
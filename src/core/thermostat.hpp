@@ -105,6 +105,10 @@ extern int ghmc_nmd;
 /** Phi parameter for GHMC partial momenum update step */
 extern double ghmc_phi;
 
+/** Step counter of the counter-based thermostat noise. It is
+    increased once per force calculation, see \ref init_forces. */
+extern uint64_t thermo_noise_step;
+
 /************************************************
  * functions
  ************************************************/
@@ -131,6 +135,48 @@ int get_cpu_temp();
 /** Start the CPU thermostat */
 void set_cpu_temp(int temp);
 
+/** Thermal noise for a batch of consecutive ids from the counter-based
+    generator, see \ref Random::noise_uniform_batch. The numbers have
+    the distribution selected by FLATNOISE, GAUSSRANDOMCUT or
+    GAUSSRANDOM, like \ref noise.
+    @param stream  the \ref Random::NoiseStream
+    @param step    step counter of the caller
+    @param id      first id of the batch
+    @param block   block of four numbers per id
+    @param n       number of ids
+    @param xi      four arrays of n noise values (Output) */
+inline void thermo_noise_batch(int stream, uint64_t step, uint32_t id, uint32_t block,
+                               int n, double *xi[4])
+{
+  Random::noise_uniform_batch(stream, step, id, block, n, xi);
+
+  ES_OMP_PRAGMA(omp simd)
+  for (int k = 0; k < n; k++) {
+#if defined (FLATNOISE)
+    xi[0][k] -= 0.5;
+    xi[1][k] -= 0.5;
+    xi[2][k] -= 0.5;
+    xi[3][k] -= 0.5;
+#else
+    Random::noise_box_muller(xi[0][k], xi[1][k]);
+    Random::noise_box_muller(xi[2][k], xi[3][k]);
+#if defined (GAUSSRANDOMCUT)
+    for (int j = 0; j < 4; j++) {
+      const double g = 1.042267973*xi[j][k];
+      xi[j][k] = (g > 2*1.042267973) ? 2*1.042267973 : ((g < -2*1.042267973) ? -2*1.042267973 : g);
+    }
+#endif
+#endif
+  }
+}
+
+/** Four values of the thermal noise for one id, see \ref thermo_noise_batch. */
+inline void thermo_noise4(int stream, uint64_t step, uint32_t id, double xi[4])
+{
+  double *x[4] = { &xi[0], &xi[1], &xi[2], &xi[3] };
+  thermo_noise_batch(stream, step, id, 0, 1, x);
+}
+
 /** locally defined funcion to find Vx. In case of LEES_EDWARDS, that is relative to the LE shear frame
     @param i      coordinate index
     @param vel    velocity vector
@@ -289,6 +335,10 @@ inline void friction_thermo_langevin(Particle *p)
 #endif /* MULTI_TIMESTEP */
 
   
+  // The noise depends only on the particle and the step
+  double xi[4];
+  thermo_noise4(Random::NOISE_LANGEVIN, thermo_noise_step, p->p.identity, xi);
+
   // Do the actual thermostatting
   for ( j = 0 ; j < 3 ; j++) 
   {
@@ -300,7 +350,7 @@ inline void friction_thermo_langevin(Particle *p)
     #endif
     {
       // Apply the force
-      p->f.f[j] = langevin_pref1_temp*velocity[j] + switch_trans*langevin_pref2_temp*noise;
+      p->f.f[j] = langevin_pref1_temp*velocity[j] + switch_trans*langevin_pref2_temp*xi[j];
     }
   } // END LOOP OVER ALL COMPONENTS
 
@@ -369,13 +419,16 @@ inline void friction_thermo_langevin_rotation(Particle *p)
   // so no switching here
 
 
+  double xi[4];
+  thermo_noise4(Random::NOISE_LANGEVIN_ROTATION, thermo_noise_step, p->p.identity, xi);
+
   // Here the thermostats happens
   for ( j = 0 ; j < 3 ; j++) 
   {
 #ifdef ROTATIONAL_INERTIA
-    p->f.torque[j] = -langevin_pref1_temp*p->m.omega[j] + switch_rotate*langevin_pref2_temp*noise;
+    p->f.torque[j] = -langevin_pref1_temp*p->m.omega[j] + switch_rotate*langevin_pref2_temp*xi[j];
 #else
-    p->f.torque[j] = -langevin_pref1_temp*p->m.omega[j] + switch_rotate*langevin_pref2_temp*noise;
+    p->f.torque[j] = -langevin_pref1_temp*p->m.omega[j] + switch_rotate*langevin_pref2_temp*xi[j];
 #endif
   }
 
@@ -0,0 +1,103 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file threads.cpp
+ *
+ *  Implementation of \ref threads.hpp "threads.hpp".
+ */
+#include <cstdlib>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "threads.hpp"
+#include "cells.hpp"
+#include "domain_decomposition.hpp"
+#include "integrate.hpp"
+#include "thermostat.hpp"
+#include "collision.hpp"
+#include "interaction_data.hpp"
+
+int n_threads = 1;
+
+void threads_init()
+{
+#ifdef _OPENMP
+  /* only follow the OpenMP default if the user asked for it, otherwise
+     a pure MPI run would start one thread per core on every process */
+  if (getenv("OMP_NUM_THREADS"))
+    n_threads = omp_get_max_threads();
+  threads_set_num();
+#endif
+}
+
+void threads_set_num()
+{
+#ifdef _OPENMP
+  omp_set_num_threads(n_threads);
+#endif
+}
+
+#ifdef THREADED_PAIR_LOOP
+/** Whether a non-bonded interaction is set that changes more than the
+    pair of particles, and therefore cannot run concurrently. */
+static int threads_unsafe_interaction()
+{
+  for (int i = 0; i < n_particle_types; i++)
+    for (int j = i; j < n_particle_types; j++) {
+      IA_parameters *data = get_ia_param(i, j);
+#ifdef LJ_ANGLE
+      /* acts on the bonded neighbors of the pair */
+      if (data->LJANGLE_cut > 0.0)
+        return 1;
+#endif
+#ifdef AFFINITY
+      /* draws from the global random number generator */
+      if (data->affinity_cut > 0.0)
+        return 1;
+#endif
+      (void)data;
+    }
+  return 0;
+}
+#endif
+
+int threads_pair_loop_active()
+{
+#ifdef THREADED_PAIR_LOOP
+  if (cell_structure.type != CELL_STRUCTURE_DOMDEC || dd.n_colors == 0)
+    return 0;
+  /* these draw random numbers or write to global variables per pair */
+#ifdef COLLISION_DETECTION
+  if (collision_params.mode > 0)
+    return 0;
+#endif
+  if (thermo_switch & (THERMO_DPD | THERMO_INTER_DPD))
+    return 0;
+  if (integ_switch == INTEG_METHOD_NPT_ISO)
+    return 0;
+  if (threads_unsafe_interaction())
+    return 0;
+#if defined(ELECTROSTATICS) && defined(SCAFACOS)
+  if (coulomb.method == COULOMB_SCAFACOS)
+    return 0;
+#endif
+  return 1;
+#else
+  return 0;
+#endif
+}
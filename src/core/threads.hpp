@@ -0,0 +1,76 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef THREADS_H
+#define THREADS_H
+/** \file threads.hpp
+ *
+ *  Thread parallelism within one MPI process (OpenMP).
+ *
+ *  If the code is compiled with OpenMP, the short-range pair forces
+ *  of the domain decomposition and the particle propagation steps of
+ *  the integrator are distributed over \ref n_threads threads.
+ *
+ *  The pair loop works on the local cells in the order of the cell
+ *  coloring of \ref DomainDecomposition::color_cells. Two cells of
+ *  the same color never write to the same particles, so the cells of
+ *  one color are processed concurrently without locks or force
+ *  buffers. Every particle receives its force contributions in the
+ *  same order independent of the number of threads and of the
+ *  scheduling, i.e. the forces are bitwise reproducible. The bonded
+ *  and single particle forces are done in a serial pass before, since
+ *  they may act on arbitrary particles.
+ *
+ *  Interactions that use random numbers or accumulate into global
+ *  variables inside the pair loop cannot be run concurrently, see
+ *  \ref threads_pair_loop_active.
+ */
+#include "config.hpp"
+
+#ifdef _OPENMP
+/** Emit an OpenMP pragma if the code is compiled with OpenMP. */
+#define ES_OMP_PRAGMA(x) _Pragma(#x)
+#else
+#define ES_OMP_PRAGMA(x)
+#endif
+
+#ifdef _OPENMP
+/** The pair loop may be run in the colored order of the cells. */
+#define THREADED_PAIR_LOOP
+#endif
+
+/** Number of threads per MPI process (setmd n_threads). Defaults to
+    OMP_NUM_THREADS if this is set, otherwise to 1. */
+extern int n_threads;
+
+/** Set the initial number of threads. Called from \ref on_program_start. */
+void threads_init();
+
+/** Apply a changed \ref n_threads on this node. */
+void threads_set_num();
+
+/** Check whether the pair forces are calculated in the colored
+    order of the cells, possibly by several threads. This is the case
+    if the code is compiled with OpenMP, the cell structure is a
+    domain decomposition with a coloring, and no interaction that is
+    not thread safe (DPD, collision detection, NpT, ScaFaCoS, LJ-angle
+    and affinity interactions) is active. The decision does not depend on \ref n_threads, so that
+    the results do not either. */
+int threads_pair_loop_active();
+
+#endif
@@ -0,0 +1,658 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file trajectory.cpp
+ *
+ *  Implementation of \ref trajectory.hpp "trajectory.hpp".
+ *
+ *  Layout of a trajectory file:
+ *  - a \ref TrajectoryFileHeader,
+ *  - the frames, each consisting of a \ref TrajectoryFrameHeader,
+ *    n_chunks \ref TrajectoryChunk and the chunks.
+ *
+ *  A chunk holds the particles of a node in the order of their
+ *  identities. For each particle, the difference of the identity and
+ *  of the quantized coordinates to the previous particle of the chunk
+ *  (or 0 for the first one) are stored as zigzag encoded variable
+ *  length integers, first the identity, then the position and then the
+ *  velocity, if present.
+ *
+ *  The index file starts with a \ref TrajectoryFileHeader with its own
+ *  magic, followed by a \ref TrajectoryIndexEntry per frame. The index
+ *  entry of a frame is written when the next frame or the close
+ *  confirms that all nodes have written their chunks.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "config.hpp"
+#include "trajectory.hpp"
+#include "communication.hpp"
+#include "cells.hpp"
+#include "grid.hpp"
+#include "integrate.hpp"
+#include "particle_data.hpp"
+#include "errorhandling.hpp"
+#include "utils.hpp"
+
+#define TRAJECTORY_MAGIC "ESTRAJ"
+#define TRAJECTORY_INDEX_MAGIC "ESTRIDX"
+#define TRAJECTORY_VERSION 1
+
+/** Header of the trajectory and of the index file. */
+typedef struct {
+  char magic[8];
+  int version;
+  /** 1 if the frames contain velocities */
+  int velocities;
+  double precision;
+  double v_precision;
+} TrajectoryFileHeader;
+
+/** Header of a frame. */
+typedef struct {
+  double time;
+  double box_l[3];
+  int n_part;
+  int n_chunks;
+} TrajectoryFrameHeader;
+
+/** Entry of the chunk table of a frame. */
+typedef struct {
+  /** size in bytes */
+  int64_t size;
+  /** number of particles */
+  int64_t n_part;
+} TrajectoryChunk;
+
+/** Entry of the index file. */
+typedef struct {
+  /** offset of the frame header */
+  int64_t offset;
+  /** size of the frame including the header */
+  int64_t size;
+  double time;
+} TrajectoryIndexEntry;
+
+/************************************************************
+ * background writer
+ ************************************************************/
+
+/** Write a buffer completely at an offset of a file.
+    \return empty string or the error. */
+static std::string write_at(int fd, int64_t offset, const char *data,
+                            size_t size) {
+  while (size > 0) {
+    ssize_t n = pwrite(fd, data, size, offset);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return strerror(errno);
+    }
+    data += n;
+    size -= n;
+    offset += n;
+  }
+  return "";
+}
+
+/** Data to be written at an offset of a file. */
+struct WriteJob {
+  int fd;
+  int64_t offset;
+  std::vector<char> data;
+};
+
+/** Thread that writes the data of one frame in the background. */
+class AsyncWriter {
+public:
+  AsyncWriter() : m_busy(false), m_quit(false) {}
+  ~AsyncWriter() { stop(); }
+
+  /** Hand over the data of the next frame, after the previous one is
+      written. */
+  void submit(std::vector<WriteJob> &jobs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_thread.joinable())
+      m_thread = std::thread(&AsyncWriter::run, this);
+    m_done.wait(lock, [this] { return !m_busy; });
+    m_jobs.swap(jobs);
+    m_busy = true;
+    m_work.notify_one();
+  }
+
+  /** Wait for the last frame to be written.
+      \return the first error since the last call, or an empty string. */
+  std::string wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return !m_busy; });
+    std::string error;
+    error.swap(m_error);
+    return error;
+  }
+
+  /** Write the last frame and stop the thread. */
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_quit = true;
+    }
+    m_work.notify_one();
+    if (m_thread.joinable())
+      m_thread.join();
+    m_quit = false;
+  }
+
+private:
+  void run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      m_work.wait(lock, [this] { return m_busy || m_quit; });
+      if (!m_busy)
+        break;
+      std::vector<WriteJob> jobs;
+      jobs.swap(m_jobs);
+      lock.unlock();
+      std::string error;
+      for (auto const &job : jobs) {
+        error = write_at(job.fd, job.offset, job.data.data(), job.data.size());
+        if (!error.empty())
+          break;
+      }
+      lock.lock();
+      if (m_error.empty())
+        m_error = error;
+      m_busy = false;
+      m_done.notify_all();
+    }
+  }
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_work, m_done;
+  std::vector<WriteJob> m_jobs;
+  std::string m_error;
+  bool m_busy, m_quit;
+};
+
+/************************************************************
+ * state
+ ************************************************************/
+
+/** Header of the open trajectory, the same on all nodes. */
+static TrajectoryFileHeader traj_head;
+/** Name of the trajectory, set on the master node for the open. */
+static std::string traj_filename;
+/** Whether a trajectory is open, the same on all nodes. */
+static bool traj_is_open = false;
+/** File descriptors of the trajectory and, on the master node, of the
+    index. */
+static int traj_fd = -1, index_fd = -1;
+/** Master node: end of the trajectory and of the index. */
+static int64_t traj_end = 0, index_end = 0;
+/** Master node: index entry of the last frame, which is written once
+    the frame is complete. */
+static TrajectoryIndexEntry pending_entry;
+static bool entry_pending = false;
+
+static AsyncWriter writer;
+
+/************************************************************
+ * encoding
+ ************************************************************/
+
+static void put_varint(std::vector<char> &buf, int64_t v) {
+  uint64_t u = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+  while (u >= 0x80) {
+    buf.push_back((char)(u | 0x80));
+    u >>= 7;
+  }
+  buf.push_back((char)u);
+}
+
+static bool get_varint(const char *&p, const char *end, int64_t *v) {
+  uint64_t u = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    const uint8_t b = *p++;
+    u |= (uint64_t)(b & 0x7f) << shift;
+    if (!(b & 0x80)) {
+      *v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Encode the local particles into a chunk. */
+static void encode_chunk(std::vector<char> &buf, int64_t *n_part) {
+  std::vector<const Particle *> parts;
+  for (int c = 0; c < local_cells.n; c++) {
+    const Cell *cell = local_cells.cell[c];
+    for (int i = 0; i < cell->n; i++)
+      parts.push_back(&cell->part[i]);
+  }
+  std::sort(parts.begin(), parts.end(),
+            [](const Particle *a, const Particle *b) {
+              return a->p.identity < b->p.identity;
+            });
+
+  buf.reserve(parts.size() * (traj_head.velocities ? 10 : 5));
+  int64_t prev_id = 0, prev_q[3] = {0, 0, 0}, prev_qv[3] = {0, 0, 0};
+  for (auto p : parts) {
+    put_varint(buf, p->p.identity - prev_id);
+    prev_id = p->p.identity;
+
+    double pos[3] = {p->r.p[0], p->r.p[1], p->r.p[2]};
+    int img[3] = {p->l.i[0], p->l.i[1], p->l.i[2]};
+    unfold_position(pos, img);
+    for (int d = 0; d < 3; d++) {
+      const int64_t q = llround(pos[d] / traj_head.precision);
+      put_varint(buf, q - prev_q[d]);
+      prev_q[d] = q;
+    }
+    if (traj_head.velocities)
+      for (int d = 0; d < 3; d++) {
+        const int64_t q = llround(p->m.v[d] / time_step / traj_head.v_precision);
+        put_varint(buf, q - prev_qv[d]);
+        prev_qv[d] = q;
+      }
+  }
+  *n_part = parts.size();
+}
+
+/** Decode a chunk and append it to a frame. */
+static bool decode_chunk(const char *p, const char *end, int64_t n_part,
+                         const TrajectoryFileHeader &head,
+                         TrajectoryFrame *frame) {
+  int64_t id = 0, q[3] = {0, 0, 0}, qv[3] = {0, 0, 0};
+  for (int64_t i = 0; i < n_part; i++) {
+    int64_t delta;
+    if (!get_varint(p, end, &delta))
+      return false;
+    id += delta;
+    frame->id.push_back(id);
+    for (int d = 0; d < 3; d++) {
+      if (!get_varint(p, end, &delta))
+        return false;
+      q[d] += delta;
+      frame->pos.push_back(q[d] * head.precision);
+    }
+    if (head.velocities)
+      for (int d = 0; d < 3; d++) {
+        if (!get_varint(p, end, &delta))
+          return false;
+        qv[d] += delta;
+        frame->v.push_back(qv[d] * head.v_precision);
+      }
+  }
+  return p == end;
+}
+
+/************************************************************
+ * collective operations
+ ************************************************************/
+
+static void close_files() {
+  if (traj_fd >= 0)
+    close(traj_fd);
+  if (index_fd >= 0)
+    close(index_fd);
+  traj_fd = index_fd = -1;
+}
+
+static void common_open() {
+  int len = traj_filename.size();
+  MPI_Bcast(&len, 1, MPI_INT, 0, comm_cart);
+  traj_filename.resize(len);
+  MPI_Bcast(&traj_filename[0], len, MPI_CHAR, 0, comm_cart);
+  MPI_Bcast(&traj_head, sizeof(traj_head), MPI_BYTE, 0, comm_cart);
+
+  /* the master creates the files, then the others open them */
+  int failed = 0;
+  if (this_node == 0) {
+    const std::string index_filename = traj_filename + ".idx";
+    traj_fd = open(traj_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    index_fd = open(index_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (traj_fd < 0 || index_fd < 0) {
+      runtimeErrorMsg() << "could not create trajectory \"" << traj_filename
+                        << "\": " << strerror(errno);
+      failed = 1;
+    } else {
+      TrajectoryFileHeader index_head = traj_head;
+      strncpy(index_head.magic, TRAJECTORY_INDEX_MAGIC,
+              sizeof(index_head.magic));
+      std::string error =
+          write_at(traj_fd, 0, (char *)&traj_head, sizeof(traj_head));
+      if (error.empty())
+        error = write_at(index_fd, 0, (char *)&index_head, sizeof(index_head));
+      if (!error.empty()) {
+        runtimeErrorMsg() << "could not write trajectory \"" << traj_filename
+                          << "\": " << error;
+        failed = 1;
+      }
+    }
+    traj_end = index_end = sizeof(TrajectoryFileHeader);
+    entry_pending = false;
+  }
+  MPI_Bcast(&failed, 1, MPI_INT, 0, comm_cart);
+  if (this_node != 0 && !failed) {
+    traj_fd = open(traj_filename.c_str(), O_WRONLY);
+    if (traj_fd < 0) {
+      runtimeErrorMsg() << "could not open trajectory \"" << traj_filename
+                        << "\": " << strerror(errno);
+      failed = 1;
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, comm_cart);
+
+  traj_is_open = !failed;
+  if (failed)
+    close_files();
+}
+
+/** Wait for the last frame of this node.
+    \return 1 if it failed, 0 otherwise. */
+static int64_t wait_for_frame() {
+  const std::string error = writer.wait();
+  if (error.empty())
+    return 0;
+  runtimeErrorMsg() << "could not write trajectory \"" << traj_filename
+                    << "\": " << error;
+  return 1;
+}
+
+static void common_write() {
+  /* encoding overlaps with the writing of the previous frame */
+  std::vector<char> chunk;
+  int64_t n_local;
+  encode_chunk(chunk, &n_local);
+
+  /* size, number of particles, and whether the previous frame failed */
+  int64_t info[3] = {(int64_t)chunk.size(), n_local, wait_for_frame()};
+  std::vector<int64_t> infos(this_node == 0 ? 3 * n_nodes : 0);
+  MPI_Gather(info, 3, MPI_INT64_T, infos.data(), 3, MPI_INT64_T, 0, comm_cart);
+
+  std::vector<WriteJob> jobs;
+  std::vector<int64_t> offsets(n_nodes);
+  if (this_node == 0) {
+    bool previous_ok = true;
+    for (int i = 0; i < n_nodes; i++)
+      previous_ok = previous_ok && !infos[3 * i + 2];
+
+    /* all nodes have written the previous frame, so it can be indexed */
+    if (entry_pending && previous_ok) {
+      WriteJob entry = {index_fd, index_end, std::vector<char>()};
+      entry.data.assign((char *)&pending_entry,
+                        (char *)&pending_entry + sizeof(pending_entry));
+      jobs.push_back(std::move(entry));
+      index_end += sizeof(TrajectoryIndexEntry);
+    }
+
+    TrajectoryFrameHeader head;
+    head.time = sim_time;
+    for (int d = 0; d < 3; d++)
+      head.box_l[d] = box_l[d];
+    head.n_part = n_part;
+    head.n_chunks = n_nodes;
+
+    WriteJob header = {traj_fd, traj_end, std::vector<char>()};
+    header.data.assign((char *)&head, (char *)&head + sizeof(head));
+    int64_t offset =
+        traj_end + sizeof(head) + n_nodes * sizeof(TrajectoryChunk);
+    for (int i = 0; i < n_nodes; i++) {
+      TrajectoryChunk entry = {infos[3 * i], infos[3 * i + 1]};
+      header.data.insert(header.data.end(), (char *)&entry,
+                         (char *)&entry + sizeof(entry));
+      offsets[i] = offset;
+      offset += infos[3 * i];
+    }
+    jobs.push_back(std::move(header));
+
+    pending_entry.offset = traj_end;
+    pending_entry.size = offset - traj_end;
+    pending_entry.time = sim_time;
+    entry_pending = true;
+    traj_end = offset;
+  }
+  int64_t my_offset;
+  MPI_Scatter(offsets.data(), 1, MPI_INT64_T, &my_offset, 1, MPI_INT64_T, 0,
+              comm_cart);
+
+  WriteJob job = {traj_fd, my_offset, std::vector<char>()};
+  job.data.swap(chunk);
+  jobs.push_back(std::move(job));
+  writer.submit(jobs);
+}
+
+static void common_close() {
+  int64_t failed = wait_for_frame();
+  MPI_Reduce(this_node == 0 ? MPI_IN_PLACE : &failed, &failed, 1, MPI_INT64_T,
+             MPI_MAX, 0, comm_cart);
+  if (this_node == 0 && entry_pending && !failed) {
+    const std::string error = write_at(index_fd, index_end,
+                                       (char *)&pending_entry,
+                                       sizeof(pending_entry));
+    if (!error.empty())
+      runtimeErrorMsg() << "could not write the index of trajectory \""
+                        << traj_filename << "\": " << error;
+  }
+  entry_pending = false;
+  writer.stop();
+  close_files();
+  traj_is_open = false;
+}
+
+void trajectory_common(int action) {
+  switch (action) {
+  case TRAJECTORY_OPEN:
+    common_open();
+    break;
+  case TRAJECTORY_WRITE:
+    common_write();
+    break;
+  case TRAJECTORY_CLOSE:
+    common_close();
+    break;
+  }
+}
+
+/************************************************************
+ * master functions
+ ************************************************************/
+
+int trajectory_open(const char *filename, double precision,
+                    double v_precision) {
+  if (traj_is_open) {
+    runtimeErrorMsg() << "trajectory \"" << traj_filename
+                      << "\" is still open";
+    return ES_ERROR;
+  }
+  if (precision <= 0 || v_precision < 0) {
+    runtimeErrorMsg() << "trajectory precision has to be positive";
+    return ES_ERROR;
+  }
+  memset(&traj_head, 0, sizeof(traj_head));
+  strncpy(traj_head.magic, TRAJECTORY_MAGIC, sizeof(traj_head.magic));
+  traj_head.version = TRAJECTORY_VERSION;
+  traj_head.velocities = v_precision > 0;
+  traj_head.precision = precision;
+  traj_head.v_precision = v_precision;
+  traj_filename = filename;
+
+  mpi_trajectory(TRAJECTORY_OPEN);
+  return traj_is_open ? ES_OK : ES_ERROR;
+}
+
+int trajectory_write() {
+  if (!traj_is_open) {
+    runtimeErrorMsg() << "no trajectory is open";
+    return ES_ERROR;
+  }
+  mpi_trajectory(TRAJECTORY_WRITE);
+  return ES_OK;
+}
+
+int trajectory_close() {
+  if (!traj_is_open) {
+    runtimeErrorMsg() << "no trajectory is open";
+    return ES_ERROR;
+  }
+  mpi_trajectory(TRAJECTORY_CLOSE);
+  return ES_OK;
+}
+
+/************************************************************
+ * reading
+ ************************************************************/
+
+/** Read a buffer completely from an offset of a file. */
+static bool read_at(int fd, int64_t offset, void *data, size_t size) {
+  char *c = static_cast<char *>(data);
+  while (size > 0) {
+    ssize_t n = pread(fd, c, size, offset);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    c += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+/** Open the index of a trajectory and read its header. */
+static int open_index(const char *filename, TrajectoryFileHeader *head) {
+  const std::string index_filename = std::string(filename) + ".idx";
+  int fd = open(index_filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if (!read_at(fd, 0, head, sizeof(TrajectoryFileHeader)) ||
+      strncmp(head->magic, TRAJECTORY_INDEX_MAGIC, sizeof(head->magic)) != 0 ||
+      head->version != TRAJECTORY_VERSION) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int trajectory_n_frames(const char *filename) {
+  TrajectoryFileHeader head;
+  int fd = open_index(filename, &head);
+  if (fd < 0)
+    return -1;
+  off_t size = lseek(fd, 0, SEEK_END);
+  close(fd);
+  if (size < (off_t)sizeof(head))
+    return -1;
+  return (size - sizeof(head)) / sizeof(TrajectoryIndexEntry);
+}
+
+int trajectory_read_frame(const char *filename, int n,
+                          TrajectoryFrame *frame) {
+  TrajectoryFileHeader head;
+  TrajectoryIndexEntry entry;
+
+  int fd = open_index(filename, &head);
+  if (fd < 0) {
+    runtimeErrorMsg() << "could not read the index of trajectory \""
+                      << filename << "\"";
+    return ES_ERROR;
+  }
+  bool ok = n >= 0 &&
+            read_at(fd, sizeof(head) + (int64_t)n * sizeof(entry), &entry,
+                    sizeof(entry));
+  close(fd);
+  if (!ok) {
+    runtimeErrorMsg() << "trajectory \"" << filename << "\" has no frame "
+                      << n;
+    return ES_ERROR;
+  }
+
+  std::vector<char> data(entry.size);
+  fd = open(filename, O_RDONLY);
+  ok = fd >= 0 && read_at(fd, entry.offset, data.data(), data.size());
+  if (fd >= 0)
+    close(fd);
+
+  TrajectoryFrameHeader fh;
+  ok = ok && data.size() >= sizeof(fh);
+  if (ok) {
+    memcpy(&fh, data.data(), sizeof(fh));
+    ok = fh.n_chunks >= 0 &&
+         data.size() >= sizeof(fh) + fh.n_chunks * sizeof(TrajectoryChunk);
+  }
+  if (ok) {
+    frame->time = fh.time;
+    for (int d = 0; d < 3; d++)
+      frame->box_l[d] = fh.box_l[d];
+    frame->id.clear();
+    frame->pos.clear();
+    frame->v.clear();
+
+    const char *p = data.data() + sizeof(fh) +
+                    fh.n_chunks * sizeof(TrajectoryChunk);
+    const char *end = data.data() + data.size();
+    for (int c = 0; c < fh.n_chunks && ok; c++) {
+      TrajectoryChunk chunk;
+      memcpy(&chunk, data.data() + sizeof(fh) + c * sizeof(chunk),
+             sizeof(chunk));
+      ok = chunk.size >= 0 && chunk.size <= end - p &&
+           decode_chunk(p, p + chunk.size, chunk.n_part, head, frame);
+      p += chunk.size;
+    }
+    ok = ok && (int)frame->id.size() == fh.n_part;
+  }
+  if (!ok) {
+    runtimeErrorMsg() << "could not read frame " << n << " of trajectory \""
+                      << filename << "\"";
+    return ES_ERROR;
+  }
+
+  /* the chunks are sorted, but not the frame */
+  const size_t n_part = frame->id.size();
+  std::vector<size_t> order(n_part);
+  for (size_t i = 0; i < n_part; i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), [frame](size_t a, size_t b) {
+    return frame->id[a] < frame->id[b];
+  });
+  TrajectoryFrame sorted;
+  sorted.time = frame->time;
+  for (int d = 0; d < 3; d++)
+    sorted.box_l[d] = frame->box_l[d];
+  for (auto i : order) {
+    sorted.id.push_back(frame->id[i]);
+    sorted.pos.insert(sorted.pos.end(), &frame->pos[3 * i],
+                      &frame->pos[3 * i] + 3);
+    if (head.velocities)
+      sorted.v.insert(sorted.v.end(), &frame->v[3 * i], &frame->v[3 * i] + 3);
+  }
+  *frame = std::move(sorted);
+  return ES_OK;
+}
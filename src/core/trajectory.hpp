@@ -0,0 +1,115 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+/** \file trajectory.hpp
+ *
+ *  Compressed trajectories, written in parallel and in the background.
+ *
+ *  The positions are unfolded and quantized to a fixed precision like
+ *  in the xtc format, the velocities optionally to a second
+ *  precision. Each node encodes its particles in the order of their
+ *  identities as differences to the previous particle, which are
+ *  small for neighbouring particles of a chain, and stores them as
+ *  variable length integers. The resulting chunks of all nodes form a
+ *  frame; the master node writes a table of the chunks in front of
+ *  them.
+ *
+ *  Writing a frame only encodes the local particles and determines the
+ *  offsets of the chunks with two small collectives. The chunks are
+ *  then written by a background thread on each node, while the
+ *  integration continues. The next frame waits for the previous one to
+ *  complete, so at most one frame per node is in flight. All nodes
+ *  write into the same file, which therefore has to be on a file
+ *  system that is shared by the nodes.
+ *
+ *  The master node also writes an index file "filename.idx" with the
+ *  offset, size and time of each frame, which allows random access to
+ *  the frames. A frame is added to the index only after it has been
+ *  written.
+ */
+
+#include <vector>
+
+/** A frame of a trajectory, see \ref trajectory_read_frame. */
+typedef struct {
+  double time;
+  double box_l[3];
+  /** particle identities, sorted */
+  std::vector<int> id;
+  /** unfolded positions, 3 per particle */
+  std::vector<double> pos;
+  /** velocities, 3 per particle, or empty */
+  std::vector<double> v;
+} TrajectoryFrame;
+
+/** \name Actions of \ref trajectory_common */
+/*@{*/
+#define TRAJECTORY_OPEN  0
+#define TRAJECTORY_WRITE 1
+#define TRAJECTORY_CLOSE 2
+/*@}*/
+
+/** Open a trajectory for writing. An existing file is replaced. Must
+ *  be called on the master node only.
+ *
+ *  \param filename    name of the trajectory file.
+ *  \param precision   precision of the positions.
+ *  \param v_precision precision of the velocities, or 0 to not write
+ *                     velocities.
+ *  \return ES_OK or ES_ERROR, in which case a runtime error was issued.
+ */
+int trajectory_open(const char *filename, double precision,
+                    double v_precision);
+
+/** Add the current configuration to the open trajectory. Returns
+ *  after the frame has been handed to the background threads. Must be
+ *  called on the master node only.
+ *
+ *  \return ES_OK or ES_ERROR, if no trajectory is open or writing a
+ *  previous frame failed.
+ */
+int trajectory_write();
+
+/** Wait for the last frame and close the trajectory. Must be called on
+ *  the master node only.
+ *
+ *  \return ES_OK or ES_ERROR.
+ */
+int trajectory_close();
+
+/** Collective part of the functions above, called on all nodes. */
+void trajectory_common(int action);
+
+/** Number of complete frames of a trajectory, or -1 if the index
+ *  cannot be read.
+ */
+int trajectory_n_frames(const char *filename);
+
+/** Read a frame of a trajectory. Only needs the file and the index, so
+ *  it can be called on any node.
+ *
+ *  \param filename name of the trajectory file.
+ *  \param n        number of the frame, starting at 0.
+ *  \param frame    where to store the frame.
+ *  \return ES_OK or ES_ERROR, in which case a runtime error was issued.
+ */
+int trajectory_read_frame(const char *filename, int n, TrajectoryFrame *frame);
+
+#endif
@@ -38,6 +38,9 @@
 #include "domain_decomposition.hpp"
 #include "constraint.hpp"
 #include "external_potential.hpp"
+#include "nonbonded_batch.hpp"
+#include "threads.hpp"
+#include "ghosts.hpp"
 
 /** Granularity of the verlet list */
 #define LIST_INCREMENT 20
@@ -50,30 +53,26 @@
 /************************************************************/
 /*@{*/
 
-/** Add a particle pair to a verlet pair list.
-    Checks verlet pair list size and reallocates memory if necessary.
- *  \param p1 Pointer to particle one.
- *  \param p2 Pointer to particle two.
- *  \param pl Pointer to the verlet pair list.
- */
-inline void add_pair(PairList *pl, Particle *p1, Particle *p2)
+/** Add the non bonded force of a pair, either directly or through
+    the batched kernel. */
+inline void calc_verlet_pair_force(Particle *p1, Particle *p2,
+#ifdef NONBONDED_BATCH_KERNEL
+                                   NonbondedBatch *batch, int use_batch,
+#endif
+                                   double vec21[3], double dist2)
 {
-  /* check size of verlet List */
-  if(pl->n+1 >= pl->max) {
-    pl->max += LIST_INCREMENT;
-    pl->pair = (Particle **)Utils::realloc(pl->pair, 2*pl->max*sizeof(Particle *));
+#ifdef NONBONDED_BATCH_KERNEL
+  if (use_batch) {
+    IA_parameters *ia = get_ia_param(p1->p.type, p2->p.type);
+    if (nonbonded_batch_accepts(p1, p2, ia, dist2)) {
+      nonbonded_batch_add(batch, p1, p2, ia, vec21, dist2);
+      return;
+    }
   }
-  /* add pair */
-  pl->pair[(2*pl->n)  ] = p1;
-  pl->pair[(2*pl->n)+1] = p2;
-  /* increase number of pairs */
-  pl->n++;
+#endif
+  add_non_bonded_pair_force(p1, p2, vec21, sqrt(dist2), dist2);
 }
 
-/** Resizes a verlet pair list according to the actual content (*vl).n. 
-    \param pl Pointer to the verlet pair list. */
-void resize_verlet_list(PairList *pl);
-
 /*@}*/
 
 /*******************  exported functions  *******************/
@@ -82,14 +81,65 @@ void init_pairList(PairList *list)
 {
   list->n       = 0;
   list->max     = 0;
-  list->pair = NULL;
+  list->np      = 0;
+  list->max_np  = 0;
+  list->start   = NULL;
+  list->partner = NULL;
 }
 
 void free_pairList(PairList *list)
 {
   list->n       = 0;
   list->max     = 0;
-  list->pair = (Particle **)Utils::realloc(list->pair, 0);
+  list->np      = 0;
+  list->max_np  = 0;
+  list->start   = (int *)Utils::realloc(list->start, 0);
+  list->partner = (unsigned int *)Utils::realloc(list->partner, 0);
+}
+
+int estimate_verlet_pairs(int c)
+{
+  IA_Neighbor_List *il = &dd.cell_inter[c];
+  const int np1 = local_cells.cell[c]->n;
+  const double range = max_cut + skin;
+  double n_shell = 0, vol_shell, estimate;
+  int n;
+
+  if (max_cut_nonbonded == 0.0 || il->n_neighbors == 0)
+    return 0;
+
+  for (n = 0; n < il->n_neighbors; n++)
+    n_shell += il->nList[n].pList->n;
+  vol_shell = il->n_neighbors*dd.cell_size[0]*dd.cell_size[1]*dd.cell_size[2];
+
+  /* each particle finds half of its interaction sphere in the half shell */
+  estimate = np1*(n_shell/vol_shell)*(2.0/3.0*PI*range*range*range);
+  /* there cannot be more pairs than particles in the half shell */
+  estimate = std::min(1.2*estimate + LIST_INCREMENT, np1*n_shell);
+
+  return std::max((int)estimate, il->vList.n);
+}
+
+void verlet_list_begin(PairList *pl, int np, int n_pairs)
+{
+  pl->n  = 0;
+  pl->np = np;
+  if (np + 1 > pl->max_np) {
+    pl->max_np = np + 1;
+    pl->start = (int *)Utils::realloc(pl->start, pl->max_np*sizeof(int));
+  }
+  /* only shrink if the list is much larger than needed */
+  if (n_pairs > pl->max || pl->max > 2*n_pairs + LIST_INCREMENT) {
+    pl->max = n_pairs;
+    pl->partner = (unsigned int *)Utils::realloc(pl->partner, pl->max*sizeof(unsigned int));
+  }
+}
+
+void verlet_list_grow(PairList *pl)
+{
+  VERLET_TRACE(fprintf(stderr,"%d: verlet list with %d pairs exceeds the estimate\n",this_node,pl->n));
+  pl->max += pl->max/2 + LIST_INCREMENT;
+  pl->partner = (unsigned int *)Utils::realloc(pl->partner, pl->max*sizeof(unsigned int));
 }
 
 
@@ -101,7 +151,7 @@ void build_verlet_lists()
 {
   int c, np1, n, np2, i ,j, j_start;
   Cell *cell;
-  IA_Neighbor *neighbor;
+  IA_Neighbor_List *il;
   Particle *p1, *p2;
   PairList *pl;
   double dist2;
@@ -123,27 +173,28 @@ void build_verlet_lists()
     cell = local_cells.cell[c];
     p1   = cell->part;
     np1  = cell->n;
-    /* Loop cell neighbors */
-    for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-      neighbor = &dd.cell_inter[c].nList[n];
-      p2  = neighbor->pList->part;
-      np2 = neighbor->pList->n;
-      /* init pair list */
-      pl  = &neighbor->vList;
-      pl->n = 0;
+    il   = &dd.cell_inter[c];
+    pl   = &il->vList;
+    /* init pair list */
+    verlet_list_begin(pl, np1, estimate_verlet_pairs(c));
+
+    /* Loop cell particles */
+    for(i=0; i < np1; i++) {
+      verlet_list_open(pl, i);
+      /* store old position */
+      memcpy(p1[i].l.p_old, p1[i].r.p, 3*sizeof(double));
 
       /* no interaction set, Verlet list stays empty */
       if (max_cut_nonbonded == 0.0)
         continue;
 
-      /* Loop cell particles */
-      for(i=0; i < np1; i++) {
-        j_start = 0;
-        /* Tasks within cell: store old position, avoid double counting */
-        if(n == 0) {
-           memcpy(p1[i].l.p_old, p1[i].r.p, 3*sizeof(double));
-           j_start = i+1;
-        }
+      /* Loop cell neighbors */
+      for (n = 0; n < il->n_neighbors; n++) {
+        p2  = il->nList[n].pList->part;
+        np2 = il->nList[n].pList->n;
+        /* avoid double counting within the cell */
+        j_start = (n == 0) ? i+1 : 0;
+
         /* Loop neighbor cell particles */
         for(j = j_start; j < np2; j++) {
 #ifdef EXCLUSIONS
@@ -152,14 +203,14 @@ void build_verlet_lists()
           {
             dist2 = distance2(p1[i].r.p, p2[j].r.p);
             if(verlet_list_criterion(p1+i, p2+j,dist2))
-              add_pair(pl, &p1[i], &p2[j]);
+              add_pair(pl, n, j);
           }
         }
       }
-      resize_verlet_list(pl);
-      VERLET_TRACE(fprintf(stderr,"%d: neighbor %d has %d particles\n",this_node,n,pl->n));
-      VERLET_TRACE(sum += pl->n);
     }
+    verlet_list_close(pl);
+    VERLET_TRACE(fprintf(stderr,"%d: cell %d has %d pairs\n",this_node,c,pl->n));
+    VERLET_TRACE(sum += pl->n);
   }
 
   rebuild_verletlist = 0;
@@ -167,58 +218,309 @@ void build_verlet_lists()
   VERLET_TRACE(fprintf(stderr,"%d: total number of interaction pairs: %d (should be around %d)\n",this_node,sum,estimate));
 }
 
-void calculate_verlet_ia()
+/** Calculate the non bonded forces of the Verlet list of local cell \a c. */
+static void calc_verlet_ia_cell(int c
+#ifdef NONBONDED_BATCH_KERNEL
+                                , NonbondedBatch *batch, int use_batch
+#endif
+                                )
 {
-  int c, np, n, i;
+  int i, k;
+  Particle *p1   = local_cells.cell[c]->part, *p2;
+  IA_Neighbor_List *il = &dd.cell_inter[c];
+  PairList *pl = &il->vList;
+  double dist2, vec21[3];
+
+  for(i = 0; i < pl->np; i++) {
+    for(k = pl->start[i]; k < pl->start[i+1]; k++) {
+      p2 = dd_pair_partner(il, pl->partner[k]);
+#ifdef MULTI_TIMESTEP
+      if (smaller_time_step < 0. 
+          || (p1[i].p.smaller_timestep==0 && p2->p.smaller_timestep==0 && current_time_step_is_small==0)
+          || (!(p1[i].p.smaller_timestep==0 && p2->p.smaller_timestep==0) && current_time_step_is_small==1))
+#endif 
+      {
+        dist2 = distance2vec(p1[i].r.p, p2->r.p, vec21);
+        calc_verlet_pair_force(&p1[i], p2,
+#ifdef NONBONDED_BATCH_KERNEL
+                               batch, use_batch,
+#endif
+                               vec21, dist2);
+      }
+    }
+  }
+}
+
+/** Rebuild the Verlet list of local cell \a c and calculate the non
+    bonded forces of the new pairs.
+    @param c      index of the cell in \ref local_cells.
+    @param single whether to also calculate the bonded and single
+                  particle forces of the cell particles and store
+                  their old positions. */
+static void build_verlet_list_and_calc_cell(int c, int single
+#ifdef NONBONDED_BATCH_KERNEL
+                                            , NonbondedBatch *batch, int use_batch
+#endif
+                                            )
+{
+  int np1, n, np2, i ,j, j_start;
   Cell *cell;
-  Particle *p1, *p2, **pairs;
+  IA_Neighbor_List *il;
+  Particle *p1, *p2;
+  PairList *pl;
   double dist2, vec21[3];
 
-  /* Loop local cells */
-  for (c = 0; c < local_cells.n; c++) {
-    cell = local_cells.cell[c];
-    p1   = cell->part;
-    np  = cell->n;
-    /* calculate bonded interactions (loop local particles) */
-    for(i = 0; i < np; i++)  {
+  VERLET_TRACE(fprintf(stderr,"%d: cell %d with %d neighbors\n",this_node,c, dd.cell_inter[c].n_neighbors));
+
+  cell = local_cells.cell[c];
+  p1   = cell->part;
+  np1  = cell->n;
+  il   = &dd.cell_inter[c];
+  pl   = &il->vList;
+  /* init pair list */
+  verlet_list_begin(pl, np1, estimate_verlet_pairs(c));
+
+  /* Loop cell particles */
+  for(i=0; i < np1; i++) {
+    verlet_list_open(pl, i);
+    /* Tasks within cell: bonded forces, store old position */
+    if (single) {
 #ifdef MULTI_TIMESTEP
       if (p1[i].p.smaller_timestep==current_time_step_is_small || smaller_time_step < 0.)
 #endif
       {
         add_single_particle_force(&p1[i]);
+        memcpy(p1[i].l.p_old, p1[i].r.p, 3*sizeof(double));
       }
     }
 
+    /* no interaction set, no need for particle pairs */
+    if (max_cut_nonbonded == 0.0)
+      continue;
+
     /* Loop cell neighbors */
-    for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-      pairs = dd.cell_inter[c].nList[n].vList.pair;
-      np    = dd.cell_inter[c].nList[n].vList.n;
-      /* verlet list loop */
-      for(i=0; i<2*np; i+=2) {
-        p1 = pairs[i];                    /* pointer to particle 1 */
-        p2 = pairs[i+1];                  /* pointer to particle 2 */
-#ifdef MULTI_TIMESTEP
-        if (smaller_time_step < 0. 
-            || (p1->p.smaller_timestep==0 && p2->p.smaller_timestep==0 && current_time_step_is_small==0)
-            || (!(p1->p.smaller_timestep==0 && p2->p.smaller_timestep==0) && current_time_step_is_small==1))
-#endif 
+    for (n = 0; n < il->n_neighbors; n++) {
+      p2  = il->nList[n].pList->part;
+      np2 = il->nList[n].pList->n;
+      /* avoid double counting within the cell */
+      j_start = (n == 0) ? i+1 : 0;
+
+      /* Loop neighbor cell particles */
+      for(j = j_start; j < np2; j++) {
+#ifdef EXCLUSIONS
+        if(do_nonbonded(&p1[i], &p2[j]))
+#endif
         {
-          dist2 = distance2vec(p1->r.p, p2->r.p, vec21);
-          add_non_bonded_pair_force(p1, p2, vec21, sqrt(dist2), dist2);
+        dist2 = distance2vec(p1[i].r.p, p2[j].r.p, vec21);
+
+        VERLET_TRACE(fprintf(stderr,"%d: pair %d %d has distance %f\n",this_node,p1[i].p.identity,p2[j].p.identity,sqrt(dist2)));
+
+        if(verlet_list_criterion(p1+i, p2+j,dist2)) {
+          ONEPART_TRACE(if(p1[i].p.identity==check_id) fprintf(stderr,"%d: OPT: Verlet Pair %d %d (Cells %d,%d %d,%d dist %f)\n",this_node,p1[i].p.identity,p2[j].p.identity,c,i,n,j,sqrt(dist2)));
+          ONEPART_TRACE(if(p2[j].p.identity==check_id) fprintf(stderr,"%d: OPT: Verlet Pair %d %d (Cells %d %d dist %f)\n",this_node,p1[i].p.identity,p2[j].p.identity,c,n,sqrt(dist2)));
+          add_pair(pl, n, j);
+#ifdef MULTI_TIMESTEP
+    if (smaller_time_step < 0.
+      || (p1[i].p.smaller_timestep==0 && p2[j].p.smaller_timestep==0 && current_time_step_is_small==0)
+      || (!(p1[i].p.smaller_timestep==0 && p2[j].p.smaller_timestep==0) && current_time_step_is_small==1))
+#endif      
+    {
+            /* calc non bonded interactions */
+            calc_verlet_pair_force(&p1[i], &p2[j],
+#ifdef NONBONDED_BATCH_KERNEL
+                                   batch, use_batch,
+#endif
+                                   vec21, dist2);
+    }
         }
+       }
+      }
+    }
+  }
+  verlet_list_close(pl);
+  VERLET_TRACE(fprintf(stderr,"%d: cell %d has %d pairs\n",this_node,c,pl->n));
+}
+
+#ifdef THREADED_PAIR_LOOP
+/** Force calculation over the Verlet lists in the colored order of
+    the cells, see \ref threads.hpp. The bonded and single particle
+    forces are calculated first in a serial pass.
+    @param rebuild whether to rebuild the Verlet lists. */
+static void calc_verlet_ia_colored(int rebuild)
+{
+  int c, col, k, i, np;
+  Particle *p;
+#ifdef NONBONDED_BATCH_KERNEL
+  const int use_batch = nonbonded_batch_active();
+#endif
+
+  for (c = 0; c < local_cells.n; c++) {
+    p  = local_cells.cell[c]->part;
+    np = local_cells.cell[c]->n;
+    for(i = 0; i < np; i++) {
+#ifdef MULTI_TIMESTEP
+      if (p[i].p.smaller_timestep==current_time_step_is_small || smaller_time_step < 0.)
+#endif
+      {
+        add_single_particle_force(&p[i]);
+        if (rebuild)
+          memcpy(p[i].l.p_old, p[i].r.p, 3*sizeof(double));
       }
     }
   }
+
+  ES_OMP_PRAGMA(omp parallel private(col, k))
+  for (col = 0; col < dd.n_colors; col++) {
+    /* the implicit barrier separates the colors */
+    ES_OMP_PRAGMA(omp for schedule(dynamic))
+    for (k = dd.color_start[col]; k < dd.color_start[col+1]; k++) {
+#ifdef NONBONDED_BATCH_KERNEL
+      /* flushed per cell, so that the order of the force contributions
+         does not depend on the other cells of the thread */
+      NonbondedBatch batch;
+      batch.n = 0;
+#endif
+      if (rebuild)
+        build_verlet_list_and_calc_cell(dd.color_cells[k], 0
+#ifdef NONBONDED_BATCH_KERNEL
+                                        , &batch, use_batch
+#endif
+                                        );
+      else
+        calc_verlet_ia_cell(dd.color_cells[k]
+#ifdef NONBONDED_BATCH_KERNEL
+                            , &batch, use_batch
+#endif
+                            );
+#ifdef NONBONDED_BATCH_KERNEL
+      nonbonded_batch_flush(&batch);
+#endif
+    }
+  }
+}
+#endif
+
+/** Calculate the non bonded forces of the cells of each color in the
+    range [first[col], last[col]) of \ref DomainDecomposition::color_cells.
+    Between the colors, the ghost communication in flight is advanced. */
+static void calc_verlet_ia_color_range(const int *first, const int *last)
+{
+  int col, k;
+#ifdef NONBONDED_BATCH_KERNEL
+  const int use_batch = nonbonded_batch_active();
+#endif
+
+  ES_OMP_PRAGMA(omp parallel private(col, k) if(threads_pair_loop_active()))
+  for (col = 0; col < dd.n_colors; col++) {
+    ES_OMP_PRAGMA(omp for schedule(dynamic))
+    for (k = first[col]; k < last[col]; k++) {
+#ifdef NONBONDED_BATCH_KERNEL
+      NonbondedBatch batch;
+      batch.n = 0;
+#endif
+      calc_verlet_ia_cell(dd.color_cells[k]
+#ifdef NONBONDED_BATCH_KERNEL
+                          , &batch, use_batch
+#endif
+                          );
+#ifdef NONBONDED_BATCH_KERNEL
+      nonbonded_batch_flush(&batch);
+#endif
+    }
+    ES_OMP_PRAGMA(omp master)
+    ghost_communicator_test();
+  }
+}
+
+/** Force calculation over the Verlet lists while the ghost positions
+    are still in flight (\ref cells_start_update_ghosts). First the
+    pairs of the inner cells, which do not involve ghosts, then, after
+    the ghost update has arrived, the bonded and single particle
+    forces and the pairs of the boundary cells. */
+static void calc_verlet_ia_overlapped()
+{
+  int c, i, np;
+  Particle *p;
+
+  calc_verlet_ia_color_range(dd.color_start, dd.color_boundary);
+
+  ghost_communicator_finish();
+
+  for (c = 0; c < local_cells.n; c++) {
+    p  = local_cells.cell[c]->part;
+    np = local_cells.cell[c]->n;
+    for(i = 0; i < np; i++) {
+#ifdef MULTI_TIMESTEP
+      if (p[i].p.smaller_timestep==current_time_step_is_small || smaller_time_step < 0.)
+#endif
+      {
+        add_single_particle_force(&p[i]);
+      }
+    }
+  }
+
+  calc_verlet_ia_color_range(dd.color_boundary, dd.color_start + 1);
+}
+
+void calculate_verlet_ia()
+{
+  int c, np, i;
+  Particle *p1;
+#ifdef NONBONDED_BATCH_KERNEL
+  NonbondedBatch batch;
+  const int use_batch = nonbonded_batch_active();
+
+  batch.n = 0;
+#endif
+
+  if (ghost_communicator_pending()) {
+    calc_verlet_ia_overlapped();
+    return;
+  }
+
+#ifdef THREADED_PAIR_LOOP
+  if (threads_pair_loop_active()) {
+    calc_verlet_ia_colored(0);
+    return;
+  }
+#endif
+
+  /* Loop local cells */
+  for (c = 0; c < local_cells.n; c++) {
+    p1   = local_cells.cell[c]->part;
+    np  = local_cells.cell[c]->n;
+    /* calculate bonded interactions (loop local particles) */
+    for(i = 0; i < np; i++)  {
+#ifdef MULTI_TIMESTEP
+      if (p1[i].p.smaller_timestep==current_time_step_is_small || smaller_time_step < 0.)
+#endif
+      {
+        add_single_particle_force(&p1[i]);
+      }
+    }
+
+    /* verlet list loop */
+    calc_verlet_ia_cell(c
+#ifdef NONBONDED_BATCH_KERNEL
+                        , &batch, use_batch
+#endif
+                        );
+  }
+
+#ifdef NONBONDED_BATCH_KERNEL
+  nonbonded_batch_flush(&batch);
+#endif
 }
 
 void build_verlet_lists_and_calc_verlet_ia()
 {
-  int c, np1, n, np2, i ,j, j_start;
-  Cell *cell;
-  IA_Neighbor *neighbor;
-  Particle *p1, *p2;
-  PairList *pl;
-  double dist2, vec21[3];
+  int c;
+#ifdef NONBONDED_BATCH_KERNEL
+  NonbondedBatch batch;
+  const int use_batch = nonbonded_batch_active();
+
+  batch.n = 0;
+#endif
  
 #ifdef VERLET_DEBUG 
   int estimate, sum=0;
@@ -231,75 +533,29 @@ void build_verlet_lists_and_calc_verlet_ia()
   if (!dd.use_vList) { fprintf(stderr, "%d: build_verlet_lists, but use_vList == 0\n", this_node); errexit(); }
 #endif
  
-  /* Loop local cells */
-  for (c = 0; c < local_cells.n; c++) {
-    VERLET_TRACE(fprintf(stderr,"%d: cell %d with %d neighbors\n",this_node,c, dd.cell_inter[c].n_neighbors));
+  /* the new lists need all ghost positions */
+  ghost_communicator_finish();
 
-    cell = local_cells.cell[c];
-    p1   = cell->part;
-    np1  = cell->n;
-    
-    /* Loop cell neighbors */
-    for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-      neighbor = &dd.cell_inter[c].nList[n];
-      p2  = neighbor->pList->part;
-      np2 = neighbor->pList->n;
-      VERLET_TRACE(fprintf(stderr,"%d: neighbor %d contains %d parts\n",this_node,n,np2));
-      /* init pair list */
-      pl  = &neighbor->vList;
-      pl->n = 0;
-      /* Loop cell particles */
-      for(i=0; i < np1; i++) {
-        j_start = 0;
-        /* Tasks within cell: bonded forces, store old position, avoid double counting */
-        if(n == 0) {
-#ifdef MULTI_TIMESTEP
-          if (p1[i].p.smaller_timestep==current_time_step_is_small || smaller_time_step < 0.)
+#ifdef THREADED_PAIR_LOOP
+  if (threads_pair_loop_active())
+    calc_verlet_ia_colored(1);
+  else
 #endif
-          {
-            add_single_particle_force(&p1[i]);
-            memcpy(p1[i].l.p_old, p1[i].r.p, 3*sizeof(double));
-            j_start = i+1;
-          }
-        }
-        
-        /* no interaction set, no need for particle pairs */
-        if (max_cut_nonbonded == 0.0)
-          continue;
-
-        /* Loop neighbor cell particles */
-        for(j = j_start; j < np2; j++) {
-#ifdef EXCLUSIONS
-          if(do_nonbonded(&p1[i], &p2[j]))
+  {
+    /* Loop local cells */
+    for (c = 0; c < local_cells.n; c++)
+      build_verlet_list_and_calc_cell(c, 1
+#ifdef NONBONDED_BATCH_KERNEL
+                                      , &batch, use_batch
 #endif
-          {
-          dist2 = distance2vec(p1[i].r.p, p2[j].r.p, vec21);
-
-          VERLET_TRACE(fprintf(stderr,"%d: pair %d %d has distance %f\n",this_node,p1[i].p.identity,p2[j].p.identity,sqrt(dist2)));
+                                      );
 
-          if(verlet_list_criterion(p1+i, p2+j,dist2)) {
-            ONEPART_TRACE(if(p1[i].p.identity==check_id) fprintf(stderr,"%d: OPT: Verlet Pair %d %d (Cells %d,%d %d,%d dist %f)\n",this_node,p1[i].p.identity,p2[j].p.identity,c,i,n,j,sqrt(dist2)));
-            ONEPART_TRACE(if(p2[j].p.identity==check_id) fprintf(stderr,"%d: OPT: Verlet Pair %d %d (Cells %d %d dist %f)\n",this_node,p1[i].p.identity,p2[j].p.identity,c,n,sqrt(dist2)));
-            add_pair(pl, &p1[i], &p2[j]);
-#ifdef MULTI_TIMESTEP
-      if (smaller_time_step < 0.
-        || (p1[i].p.smaller_timestep==0 && p2[j].p.smaller_timestep==0 && current_time_step_is_small==0)
-        || (!(p1[i].p.smaller_timestep==0 && p2[j].p.smaller_timestep==0) && current_time_step_is_small==1))
-#endif      
-      {
-              /* calc non bonded interactions */
-              add_non_bonded_pair_force(&(p1[i]), &(p2[j]), vec21, sqrt(dist2), dist2);
-      }
-          }
-         }
-        }
-      }
-      resize_verlet_list(pl);
-      VERLET_TRACE(fprintf(stderr,"%d: neighbor %d has %d pairs\n",this_node,n,pl->n));
-      VERLET_TRACE(sum += pl->n);
-    }
+#ifdef NONBONDED_BATCH_KERNEL
+    nonbonded_batch_flush(&batch);
+#endif
   }
 
+  VERLET_TRACE(for (c = 0; c < local_cells.n; c++) sum += dd.cell_inter[c].vList.n);
   VERLET_TRACE(fprintf(stderr,"%d: total number of interaction pairs: %d (should be around %d)\n",this_node,sum,estimate));
  
   rebuild_verletlist = 0;
@@ -309,9 +565,11 @@ void build_verlet_lists_and_calc_verlet_ia()
 
 void calculate_verlet_energies()
 {
-  int c, np, n, i;
+  int c, np, i, k;
   Cell *cell;
-  Particle *p1, *p2, **pairs;
+  IA_Neighbor_List *il;
+  PairList *pl;
+  Particle *p1, *p2;
   double dist2, vec21[3];
 
   VERLET_TRACE(fprintf(stderr,"%d: calculate verlet energies\n",this_node));
@@ -330,20 +588,17 @@ void calculate_verlet_energies()
     if (max_cut_nonbonded == 0.0)
       continue;
 
-    VERLET_TRACE(fprintf(stderr,"%d: cell %d with %d neighbors\n",this_node,c, dd.cell_inter[c].n_neighbors));
-    /* Loop cell neighbors */
-    for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-      pairs = dd.cell_inter[c].nList[n].vList.pair;
-      np    = dd.cell_inter[c].nList[n].vList.n;
-      VERLET_TRACE(fprintf(stderr,"%d: neighbor %d has %d particles\n",this_node,n,np));
-
-      /* verlet list loop */
-      for(i=0; i<2*np; i+=2) {
-        p1 = pairs[i];                    /* pointer to particle 1 */
-        p2 = pairs[i+1];                  /* pointer to particle 2 */
-        dist2 = distance2vec(p1->r.p, p2->r.p, vec21);
-        VERLET_TRACE(fprintf(stderr, "%d: %d <-> %d: dist2 dist2\n",this_node,p1->p.identity,p2->p.identity));
-        add_non_bonded_pair_energy(p1, p2, vec21, sqrt(dist2), dist2);
+    il = &dd.cell_inter[c];
+    pl = &il->vList;
+    VERLET_TRACE(fprintf(stderr,"%d: cell %d has %d pairs\n",this_node,c,pl->n));
+
+    /* verlet list loop */
+    for(i = 0; i < pl->np; i++) {
+      for(k = pl->start[i]; k < pl->start[i+1]; k++) {
+        p2 = dd_pair_partner(il, pl->partner[k]);
+        dist2 = distance2vec(p1[i].r.p, p2->r.p, vec21);
+        VERLET_TRACE(fprintf(stderr, "%d: %d <-> %d: dist2 dist2\n",this_node,p1[i].p.identity,p2->p.identity));
+        add_non_bonded_pair_energy(&p1[i], p2, vec21, sqrt(dist2), dist2);
       }
     }
   }
@@ -353,9 +608,11 @@ void calculate_verlet_energies()
 
 void calculate_verlet_virials(int v_comp)
 {
-  int c, np, n, i;
+  int c, np, i, k;
   Cell *cell;
-  Particle *p1, *p2, **pairs;
+  IA_Neighbor_List *il;
+  PairList *pl;
+  Particle *p1, *p2;
   double dist2, vec21[3];
 
   VERLET_TRACE(fprintf(stderr,"%d: calculate verlet pressure\n",this_node));
@@ -381,34 +638,17 @@ void calculate_verlet_virials(int v_comp)
     if (max_cut_nonbonded == 0.0)
       continue;
 
-    VERLET_TRACE(fprintf(stderr,"%d: cell %d with %d neighbors\n",this_node,c, dd.cell_inter[c].n_neighbors));
-    /* Loop cell neighbors */
-    for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-      pairs = dd.cell_inter[c].nList[n].vList.pair;
-      np    = dd.cell_inter[c].nList[n].vList.n;
-      VERLET_TRACE(fprintf(stderr,"%d: neighbor %d has %d particles\n",this_node,n,np));
-
-      /* verlet list loop */
-      for(i=0; i<2*np; i+=2) {
-        p1 = pairs[i];                    /* pointer to particle 1 */
-        p2 = pairs[i+1];                  /* pointer to particle 2 */
-        dist2 = distance2vec(p1->r.p, p2->r.p, vec21);
-        add_non_bonded_pair_virials(p1, p2, vec21, sqrt(dist2), dist2);
+    il = &dd.cell_inter[c];
+    pl = &il->vList;
+    VERLET_TRACE(fprintf(stderr,"%d: cell %d has %d pairs\n",this_node,c,pl->n));
+
+    /* verlet list loop */
+    for(i = 0; i < pl->np; i++) {
+      for(k = pl->start[i]; k < pl->start[i+1]; k++) {
+        p2 = dd_pair_partner(il, pl->partner[k]);
+        dist2 = distance2vec(p1[i].r.p, p2->r.p, vec21);
+        add_non_bonded_pair_virials(&p1[i], p2, vec21, sqrt(dist2), dist2);
       }
     }
   }
 }
-
-/************************************************************/
-
-void resize_verlet_list(PairList *pl)
-{
-  int diff;
-  diff = pl->max - pl->n;
-  if( diff > 2*LIST_INCREMENT ) {
-    diff = (diff/LIST_INCREMENT)-1;
-    pl->max -= diff*LIST_INCREMENT;
-    pl->pair = (Particle **)Utils::realloc(pl->pair, 2*pl->max*sizeof(Particle *));
-  }
-}
-
@@ -58,17 +58,35 @@
  * data types
  ************************************************/
 
-/** Verlet pair list. The verlet pair list array is resized using a
-    sophisticated (we hope) algorithm to avoid unnecessary resizes.
-    Access using \ref resize_verlet_list.
+/** Number of bits of a packed pair partner used for the particle
+    index within the neighbor cell. The remaining upper bits hold the
+    index of the neighbor cell in \ref IA_Neighbor_List::nList. */
+#define VERLET_PART_BITS 26
+/** Mask for the particle index of a packed pair partner. */
+#define VERLET_PART_MASK ((1u << VERLET_PART_BITS) - 1)
+
+/** Verlet pair list of one local cell in compressed row form. The
+    partners of particle i of the cell are stored in
+    partner[start[i]] ... partner[start[i+1]-1], each as a 32-bit
+    index packed from the neighbor cell and the position of the
+    partner in that cell (see \ref verlet_pack_partner). The pair
+    count is estimated before a rebuild, see \ref
+    estimate_verlet_pairs, so that the array is normally allocated
+    once per rebuild.
 */
 typedef struct {
-  /** The pair payload (two pointers per pair) */
-  Particle **pair;
+  /** Offsets of the partners of each particle into \ref partner (np+1 entries) */
+  int *start;
+  /** The packed partner indices */
+  unsigned int *partner;
   /** Number of pairs contained */
   int n;
   /** Number of pairs that fit in until a resize is needed */
   int max;
+  /** Number of particles of the cell the list was built for */
+  int np;
+  /** Number of particles that fit into \ref start */
+  int max_np;
 } PairList;
 
 /** \name Exported Functions */
@@ -82,6 +100,21 @@ void init_pairList(PairList *list);
 /** Free a Pair List . */
 void free_pairList(PairList *list);
 
+/** Estimate the number of Verlet pairs of a local cell from the
+    particle density in its neighbor cells. The estimate is padded,
+    and is never below the size of the last list of the cell.
+    @param c index of the cell in \ref local_cells. */
+int estimate_verlet_pairs(int c);
+
+/** Prepare a pair list for refilling.
+    @param pl      the pair list.
+    @param np      number of particles in the cell.
+    @param n_pairs expected number of pairs, see \ref estimate_verlet_pairs. */
+void verlet_list_begin(PairList *pl, int np, int n_pairs);
+
+/** Enlarge the partner array of a pair list that ran full. */
+void verlet_list_grow(PairList *pl);
+
 /** Fill verlet tables. */
 void build_verlet_lists();
 
@@ -103,6 +136,38 @@ void calculate_verlet_energies();
 		  naturally it doesn't make sense to use it without NpT. */
 void calculate_verlet_virials(int v_comp);
 
+/** Pack a pair partner.
+    @param n index of the neighbor cell.
+    @param j index of the particle in the neighbor cell. */
+inline unsigned int verlet_pack_partner(int n, int j)
+{
+  return ((unsigned int)n << VERLET_PART_BITS) | (unsigned int)j;
+}
+
+/** Open the partner range of particle i (particles have to be
+    added in order). */
+inline void verlet_list_open(PairList *pl, int i)
+{
+  pl->start[i] = pl->n;
+}
+
+/** Add a partner to the particle opened last.
+    @param pl the pair list.
+    @param n  index of the neighbor cell of the partner.
+    @param j  index of the partner in the neighbor cell. */
+inline void add_pair(PairList *pl, int n, int j)
+{
+  if(pl->n >= pl->max)
+    verlet_list_grow(pl);
+  pl->partner[pl->n++] = verlet_pack_partner(n, j);
+}
+
+/** Close a pair list after all particles were added. */
+inline void verlet_list_close(PairList *pl)
+{
+  pl->start[pl->np] = pl->n;
+}
+
 /*@}*/
 
 
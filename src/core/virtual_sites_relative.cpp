@@ -191,23 +191,14 @@ void distribute_mol_force()
 
 
 
-// Setup the virtual_sites_relative properties of a particle so that the given virtaul particle will follow the given real particle
-int vs_relate_to(int part_num, int relate_to)
+// Calculate the distance and relative orientation with which the virtual
+// particle p_current follows the real particle p_relate_to
+static int vs_relative_params(Particle *p_current, Particle *p_relate_to,
+                              double *l_out, double quat[4])
 {
-    // Get the data for the particle we act on and the one we wnat to relate
-    // it to.
-    Particle  p_current,p_relate_to;
-    if ((get_particle_data(relate_to,&p_relate_to)!=ES_OK) || 
-        (get_particle_data(part_num,&p_current)!=ES_OK)) {
-        ostringstream msg;
-        msg <<"Could not retrieve particle data for the given id";
-        runtimeError(msg);
-      return ES_ERROR;
-    }
-    
     // get teh distance between the particles
     double d[3];
-    get_mi_vector(d, p_current.r.p,p_relate_to.r.p);
+    get_mi_vector(d, p_current->r.p,p_relate_to->r.p);
     
     
     
@@ -224,7 +215,6 @@ int vs_relate_to(int part_num, int relate_to)
     // Now, calculate the quaternions which specify the angle between 
     // the director of the particel we relate to and the vector
     // (paritlce_we_relate_to - this_particle)
-    double quat[4];
     // The vs_relative implemnation later obtains the direcotr by multiplying
     // the quaternions representing the orientation of the real particle
     // with those in the virtual particle. The re quulting quaternion is then
@@ -251,31 +241,31 @@ int vs_relate_to(int part_num, int relate_to)
       // Define quat as described above:
       double x=0;
       for (i=0;i<4;i++)
-       x+=p_relate_to.r.quat[i]*p_relate_to.r.quat[i];
+       x+=p_relate_to->r.quat[i]*p_relate_to->r.quat[i];
   
       quat[0]=0;
       for (i=0;i<4;i++)
-       quat[0] +=p_relate_to.r.quat[i]*quat_director[i];
+       quat[0] +=p_relate_to->r.quat[i]*quat_director[i];
       
-      quat[1] =-quat_director[0] *p_relate_to.r.quat[1] 
-         +quat_director[1] *p_relate_to.r.quat[0]
-         +quat_director[2] *p_relate_to.r.quat[3]
-         -quat_director[3] *p_relate_to.r.quat[2];
-      quat[2] =p_relate_to.r.quat[1] *quat_director[3] 
-        + p_relate_to.r.quat[0] *quat_director[2] 
-        - p_relate_to.r.quat[3] *quat_director[1] 
-        - p_relate_to.r.quat[2] * quat_director[0];
-      quat[3] =quat_director[3] *p_relate_to.r.quat[0]
-        - p_relate_to.r.quat[3] *quat_director[0] 
-        + p_relate_to.r.quat[2] * quat_director[1] 
-        - p_relate_to.r.quat[1] *quat_director[2];
+      quat[1] =-quat_director[0] *p_relate_to->r.quat[1] 
+         +quat_director[1] *p_relate_to->r.quat[0]
+         +quat_director[2] *p_relate_to->r.quat[3]
+         -quat_director[3] *p_relate_to->r.quat[2];
+      quat[2] =p_relate_to->r.quat[1] *quat_director[3] 
+        + p_relate_to->r.quat[0] *quat_director[2] 
+        - p_relate_to->r.quat[3] *quat_director[1] 
+        - p_relate_to->r.quat[2] * quat_director[0];
+      quat[3] =quat_director[3] *p_relate_to->r.quat[0]
+        - p_relate_to->r.quat[3] *quat_director[0] 
+        + p_relate_to->r.quat[2] * quat_director[1] 
+        - p_relate_to->r.quat[1] *quat_director[2];
       for (i=0;i<4;i++)
        quat[i]/=x;
      
      
      // Verify result
      double qtemp[4];
-     multiply_quaternions(p_relate_to.r.quat,quat,qtemp);
+     multiply_quaternions(p_relate_to->r.quat,quat,qtemp);
      for (i=0;i<4;i++)
        if (fabs(qtemp[i]-quat_director[i])>1E-9)
          fprintf(stderr, "vs_relate_to: component %d: %f instead of %f\n",
@@ -286,8 +276,30 @@ int vs_relate_to(int part_num, int relate_to)
      quat[0]=1;
      quat[1]=quat[2]=quat[3]=0;
     }
+    *l_out = l;
+    return ES_OK;
+}
+
+// Setup the virtual_sites_relative properties of a particle so that the given virtaul particle will follow the given real particle
+int vs_relate_to(int part_num, int relate_to)
+{
+    // Get the data for the particle we act on and the one we wnat to relate
+    // it to.
+    Particle  p_current,p_relate_to;
+    if ((get_particle_data(relate_to,&p_relate_to)!=ES_OK) || 
+        (get_particle_data(part_num,&p_current)!=ES_OK)) {
+        ostringstream msg;
+        msg <<"Could not retrieve particle data for the given id";
+        runtimeError(msg);
+      return ES_ERROR;
+    }
+
+    double l, quat[4];
+    int res = vs_relative_params(&p_current, &p_relate_to, &l, quat);
     free_particle(&p_relate_to);
     free_particle(&p_current);
+    if (res != ES_OK)
+      return ES_ERROR;
 
     // Set the particle id of the particle we want to relate to, the distnace
     // and the relative orientation
@@ -301,6 +313,20 @@ int vs_relate_to(int part_num, int relate_to)
    return ES_OK;
 }
 
+// Same as vs_relate_to, for two particles on this node
+int local_vs_relate_to(Particle *p_current, Particle *p_relate_to)
+{
+    double l, quat[4];
+    if (vs_relative_params(p_current, p_relate_to, &l, quat) != ES_OK)
+      return ES_ERROR;
+
+    p_current->p.vs_relative_to_particle_id = p_relate_to->p.identity;
+    p_current->p.vs_relative_distance = l;
+    for (int i=0;i<4;i++)
+      p_current->p.vs_relative_rel_orientation[i] = quat[i];
+    return ES_OK;
+}
+
 
 // Rigid body conribution to scalar pressure and stress tensor
 void vs_relative_pressure_and_stress_tensor(double* pressure, double* stress_tensor)
@@ -39,6 +39,10 @@ void distribute_mol_force();
 // Setup the virtual_sites_relative properties of a particle so that the given virtaul particle will follow the given real particle
 int vs_relate_to(int part_num, int relate_to);
 
+// Same as vs_relate_to, but for two particles that are both on this node,
+// without communication. Can be called on all nodes.
+int local_vs_relate_to(Particle *p_current, Particle *p_relate_to);
+
 
 // Rigid body conribution to scalar pressure and stress tensor
 void vs_relative_pressure_and_stress_tensor(double* pressure, double* stress_tensor);
@@ -26,12 +26,20 @@ cdef extern from "global.hpp":
     int FIELD_NPTISO_PDIFF
     int FIELD_PERIODIC
     int FIELD_SIMTIME
+    int FIELD_NONBONDED_BATCH
+    int FIELD_N_THREADS
+    int FIELD_BALANCE_INTERVAL
+    int FIELD_PHASE_TIMERS
+    int FIELD_SKIN_TUNE_INTERVAL
+    int FIELD_RESPA_STEPS
+    int FIELD_SORT_INTERVAL
 
 cdef extern from "communication.hpp":
     extern int n_nodes
     void mpi_set_smaller_time_step(double smaller_time_step)
     void mpi_set_time_step(double time_step)
     void mpi_bcast_parameter(int p)
+    void mpi_gather_phase_timers(double * stats)
 
 cdef extern from "integrate.hpp":
     double time_step
@@ -39,6 +47,7 @@ cdef extern from "integrate.hpp":
     extern double sim_time
     extern double smaller_time_step
     extern double verlet_reuse
+    extern int respa_steps
 
 cdef extern from "verlet.hpp":
     double skin
@@ -67,6 +76,26 @@ cdef extern from "particle_data.hpp":
     extern int n_part
 
 
+cdef extern from "nonbonded_batch.hpp":
+    extern int nonbonded_batch
+
+cdef extern from "threads.hpp":
+    extern int n_threads
+
+cdef extern from "load_balance.hpp":
+    extern int balance_interval
+    extern double load_imbalance
+
+cdef extern from "skin_tune.hpp":
+    extern int skin_tune_interval
+
+cdef extern from "phase_timers.hpp":
+    enum: PHASE_N
+    extern int phase_timers
+    extern const char ** phase_timer_names
+    extern const int * phase_timer_parent
+
+
 cdef extern from "interaction_data.hpp":
     double dpd_gamma
     double dpd_r_cut
@@ -106,6 +135,7 @@ IF LB_GPU:
 
 cdef extern from "cells.hpp":
     extern double max_range
+    extern int sort_interval
     ctypedef struct CellStructure:
         int type
     CellStructure cell_structure
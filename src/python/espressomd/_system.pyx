@@ -36,9 +36,9 @@ from analyze import Analysis
 
 import sys
 
-setable_properties = ["box_l", "max_num_cells", "min_num_cells",
-                      "node_grid", "npt_piston", "npt_p_diff",
-                      "periodicity", "skin", "time",
+setable_properties = ["balance_interval", "box_l", "max_num_cells", "min_num_cells",
+                      "n_threads", "node_grid", "nonbonded_batch", "npt_piston", "npt_p_diff",
+                      "periodicity", "phase_timers", "respa_steps", "skin", "skin_tune_interval", "sort_interval", "time",
                       "time_step", "timings"]
 
 cdef class System:
@@ -76,6 +76,17 @@ cdef class System:
         for property_ in params.keys():
             System.__setattr__(self, property_, params[property_])
 
+    property balance_interval:
+        def __set__(self, int _balance_interval):
+            global balance_interval
+            if _balance_interval < 0:
+                raise ValueError("balance_interval must be non-negative")
+            balance_interval = _balance_interval
+            mpi_bcast_parameter(FIELD_BALANCE_INTERVAL)
+
+        def __get__(self):
+            return balance_interval
+
     property box_l:
         def __set__(self, _box_l):
             if len(_box_l) != 3:
@@ -115,6 +126,10 @@ cdef class System:
         def __get__(self):
             return integ_switch
 
+    property load_imbalance:
+        def __get__(self):
+            return load_imbalance
+
     property local_box_l:
         def __get__(self):
             return np.array([local_box_l[0], local_box_l[1], local_box_l[2]])
@@ -202,6 +217,28 @@ cdef class System:
         def __get__(self):
             return np.array([node_grid[0], node_grid[1], node_grid[2]])
 
+    property n_threads:
+        def __set__(self, int _n_threads):
+            global n_threads
+            if _n_threads < 1:
+                raise ValueError("n_threads must be positive")
+            n_threads = _n_threads
+            mpi_bcast_parameter(FIELD_N_THREADS)
+
+        def __get__(self):
+            return n_threads
+
+    property nonbonded_batch:
+        def __set__(self, _nonbonded_batch):
+            global nonbonded_batch
+            if _nonbonded_batch not in (0, 1, False, True):
+                raise ValueError("nonbonded_batch must be 0 or 1")
+            nonbonded_batch = int(_nonbonded_batch)
+            mpi_bcast_parameter(FIELD_NONBONDED_BATCH)
+
+        def __get__(self):
+            return nonbonded_batch
+
     property nptiso_gamma0:
         def __get__(self):
             return nptiso_gamma0
@@ -268,6 +305,17 @@ cdef class System:
             periodicity[2] = int(periodic / 4) % 2
             return periodicity
 
+    property phase_timers:
+        def __set__(self, _phase_timers):
+            global phase_timers
+            if _phase_timers not in (0, 1, False, True):
+                raise ValueError("phase_timers must be 0 or 1")
+            phase_timers = int(_phase_timers)
+            mpi_bcast_parameter(FIELD_PHASE_TIMERS)
+
+        def __get__(self):
+            return phase_timers
+
     property skin:
         def __set__(self, double _skin):
             if _skin <= 0:
@@ -280,6 +328,39 @@ cdef class System:
         def __get__(self):
             return skin
 
+    property respa_steps:
+        def __set__(self, int _respa_steps):
+            global respa_steps
+            if _respa_steps < 1:
+                raise ValueError("respa_steps must be at least 1")
+            respa_steps = _respa_steps
+            mpi_bcast_parameter(FIELD_RESPA_STEPS)
+
+        def __get__(self):
+            return respa_steps
+
+    property skin_tune_interval:
+        def __set__(self, int _skin_tune_interval):
+            global skin_tune_interval
+            if _skin_tune_interval < 0:
+                raise ValueError("skin_tune_interval must be non-negative")
+            skin_tune_interval = _skin_tune_interval
+            mpi_bcast_parameter(FIELD_SKIN_TUNE_INTERVAL)
+
+        def __get__(self):
+            return skin_tune_interval
+
+    property sort_interval:
+        def __set__(self, int _sort_interval):
+            global sort_interval
+            if _sort_interval < 0:
+                raise ValueError("sort_interval must be non-negative")
+            sort_interval = _sort_interval
+            mpi_bcast_parameter(FIELD_SORT_INTERVAL)
+
+        def __get__(self):
+            return sort_interval
+
     property temperature:
         def __get__(self):
             return temperature
@@ -424,6 +505,25 @@ cdef class System:
             raise ValueError(
                 'Usage: changeVolume { <V_new> | <L_new> { "x" | "y" | "z" | "xyz" } }')
 
+    def time_phases(self):
+        """Average wall time per integration step of the phases of the
+           step, see phase_timers. Returns a dictionary which maps the
+           path of a phase, e.g. "integrate/force_calc/short_range", to
+           the minimum, mean and maximum over the nodes.
+        """
+        cdef double stats[3 * PHASE_N]
+        cdef int i, p
+        mpi_gather_phase_timers(stats)
+        result = {}
+        for i in range(PHASE_N):
+            path = phase_timer_names[i].decode()
+            p = phase_timer_parent[i]
+            while p >= 0:
+                path = phase_timer_names[p].decode() + "/" + path
+                p = phase_timer_parent[p]
+            result[path] = (stats[3 * i], stats[3 * i + 1], stats[3 * i + 2])
+        return result
+
 
 # lbfluid=lb.DeviceList()
 IF CUDA == 1:
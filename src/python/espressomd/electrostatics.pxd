@@ -84,7 +84,7 @@ IF ELECTROSTATICS:
 
         cdef extern from "p3m.hpp":
             int p3m_set_params(double r_cut, int * mesh, int cao, double alpha, double accuracy)
-            void p3m_set_tune_params(double r_cut, int mesh[3], int cao, double alpha, double accuracy, int n_interpol)
+            void p3m_set_tune_params(double r_cut, int mesh[3], int cao, double alpha, double accuracy, int n_interpol, int diff)
             int p3m_set_mesh_offset(double x, double y, double z)
             int p3m_set_eps(double eps)
             int p3m_set_ninterpol(int n)
@@ -165,7 +165,7 @@ IF ELECTROSTATICS:
             else:
                 mesh = p_mesh
 
-            p3m_set_tune_params(r_cut, mesh, cao, alpha, accuracy, n_interpol)
+            p3m_set_tune_params(r_cut, mesh, cao, alpha, accuracy, n_interpol, -1)
 
     cdef extern from "debye_hueckel.hpp":
         IF COULOMB_DEBYE_HUECKEL:
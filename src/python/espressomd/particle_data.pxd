@@ -83,6 +83,10 @@ cdef extern from "particle_data.hpp":
 
     int place_particle(int part, double p[3])
 
+    int set_particles_data(int n, int * ids, double * pos, double * v, int * type, double * q)
+
+    int get_particles_data(int n, int * ids, double * pos, double * v, int * type, double * q)
+
     int set_particle_v(int part, double v[3])
 
     int set_particle_f(int part, double F[3])
@@ -1162,19 +1162,104 @@ cdef class ParticleList:
             ids = P["id"]
             del P["id"]
 
-        # Place particles
-        cdef double mypos[3]
-        for j in range(len(P["pos"])):
-            for i in range(3):
-                mypos[i] = P["pos"][j][i]
-            if place_particle(ids[j], mypos) == -1:
-                raise Exception("particle could not be set")
-
-        del P["pos"]
+        # Place particles, and set the properties that the bulk setter
+        # supports in the same step
+        n = len(ids)
+        bulk = {"pos": P.pop("pos")}
+        if "v" in P and np.shape(P["v"]) == (n, 3):
+            bulk["v"] = P.pop("v")
+        for key in ["type", "q"]:
+            if key in P and np.shape(P[key]) == (n,):
+                bulk[key] = P.pop(key)
+        self.set_arrays(ids, **bulk)
 
         if P != {}:
             self[ids].update(P)
 
+    def set_arrays(self, id, pos=None, v=None, type=None, q=None):
+        """Create or change many particles at once.
+
+        The properties are given as arrays in the order of the
+        identities in id, and sent to the nodes with one collective
+        operation instead of one message per particle and property.
+        Particles that do not exist yet are created and require pos.
+
+        """
+
+        cdef np.ndarray[int, ndim = 1, mode = "c"] c_id
+        cdef np.ndarray[double, ndim = 2, mode = "c"] c_pos
+        cdef np.ndarray[double, ndim = 2, mode = "c"] c_v
+        cdef np.ndarray[int, ndim = 1, mode = "c"] c_type
+        cdef np.ndarray[double, ndim = 1, mode = "c"] c_q
+        cdef double * pos_ptr = NULL
+        cdef double * v_ptr = NULL
+        cdef int * type_ptr = NULL
+        cdef double * q_ptr = NULL
+
+        c_id = np.ascontiguousarray(id, dtype=np.intc).reshape(-1)
+        n = c_id.shape[0]
+        if n == 0:
+            return
+        if np.any(c_id < 0):
+            raise ValueError("particle ids must be non-negative")
+
+        if pos is not None:
+            c_pos = np.ascontiguousarray(pos, dtype=np.float64).reshape(n, 3)
+            pos_ptr = &c_pos[0, 0]
+        if v is not None:
+            c_v = np.ascontiguousarray(np.asarray(
+                v, dtype=np.float64).reshape(n, 3) * time_step)
+            v_ptr = &c_v[0, 0]
+        if type is not None:
+            c_type = np.ascontiguousarray(type, dtype=np.intc).reshape(n)
+            if np.any(c_type < 0):
+                raise ValueError("type must be an integer >= 0")
+            type_ptr = &c_type[0]
+        if q is not None:
+            IF ELECTROSTATICS:
+                c_q = np.ascontiguousarray(q, dtype=np.float64).reshape(n)
+                q_ptr = &c_q[0]
+            ELSE:
+                raise Exception("ELECTROSTATICS not compiled in")
+
+        if set_particles_data(n, & c_id[0], pos_ptr, v_ptr, type_ptr, q_ptr):
+            raise Exception(
+                "particles could not be set, check for duplicate ids and that new particles have a position")
+
+    def get_arrays(self, id=None):
+        """Get the properties of many particles at once.
+
+        Returns a dictionary of NumPy arrays in the order of id, which
+        defaults to all particles: "id", "pos" (unfolded), "v", "type"
+        and with ELECTROSTATICS "q". The arrays are filled by one
+        collective operation.
+
+        """
+
+        cdef np.ndarray[int, ndim = 1, mode = "c"] c_id
+        cdef np.ndarray[double, ndim = 2, mode = "c"] c_pos
+        cdef np.ndarray[double, ndim = 2, mode = "c"] c_v
+        cdef np.ndarray[int, ndim = 1, mode = "c"] c_type
+        cdef np.ndarray[double, ndim = 1, mode = "c"] c_q
+
+        if id is None:
+            id = [i for i in range(max_seen_particle + 1)
+                  if particle_exists(i)]
+        c_id = np.ascontiguousarray(id, dtype=np.intc).reshape(-1)
+        n = c_id.shape[0]
+        c_pos = np.zeros((n, 3))
+        c_v = np.zeros((n, 3))
+        c_type = np.zeros(n, dtype=np.intc)
+        c_q = np.zeros(n)
+
+        if n > 0 and get_particles_data(n, & c_id[0], & c_pos[0, 0], & c_v[0, 0], & c_type[0], & c_q[0]):
+            raise Exception("Particle(s) of %s do not exist." % id)
+
+        res = {"id": c_id, "pos": c_pos, "v": c_v / time_step, "type": c_type}
+        IF ELECTROSTATICS:
+            res["q"] = c_q
+        return res
+
     # Iteration over all existing particles
     def __iter__(self):
         for i in range(max_seen_particle + 1):
@@ -99,3 +99,17 @@ int tclcommand_cellsystem(ClientData data, Tcl_Interp *interp,
   return gather_runtime_errors(interp, TCL_OK);
 }
 
+int tclcallback_sort_interval(Tcl_Interp *interp, void *_data)
+{
+  int data = *(int *)_data;
+
+  if (data < 0) {
+    Tcl_AppendResult(interp, "sort_interval must be non-negative", (char *) NULL);
+    return (TCL_ERROR);
+  }
+
+  sort_interval = data;
+  mpi_bcast_parameter(FIELD_SORT_INTERVAL);
+
+  return (TCL_OK);
+}
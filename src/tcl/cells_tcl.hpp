@@ -34,6 +34,10 @@ int tclcommand_cellsystem(ClientData data, Tcl_Interp *interp,
 int tclcommand_sort_particles(ClientData data, Tcl_Interp *interp,
                               int argc, char **argv);
 
+/** Callback for setmd sort_interval (sort_interval >= 0).
+    see also \ref sort_interval */
+int tclcallback_sort_interval(Tcl_Interp *interp, void *_data);
+
 /*@}*/
 
 #endif
@@ -227,9 +227,6 @@ int tclcommand_on_collision(ClientData data, Tcl_Interp *interp, int argc, char
     case 1:
       Tcl_AppendResult(interp, "This mode requires the VIRTUAL_SITES_RELATIVE feature to be compiled in.", (char*) NULL);
       return TCL_ERROR;
-    case 2:
-      Tcl_AppendResult(interp, "Collision detection only works on a single cpu.", (char*) NULL);
-      return TCL_ERROR;
     case 3:
       Tcl_AppendResult(interp, "Bond type does not exist.", (char*) NULL);
       return TCL_ERROR;
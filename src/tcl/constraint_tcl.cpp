@@ -271,6 +271,58 @@ static int tclprint_to_result_Constraint(Tcl_Interp *interp, int i)
     return (TCL_OK);
   }
 
+  if (con->sdf_spacing > 0.0) {
+    Tcl_PrintDouble(interp, con->sdf_spacing, buffer);
+    Tcl_AppendResult(interp, " sdf ", buffer, (char *) NULL);
+    Tcl_PrintDouble(interp, con->sdf_tolerance, buffer);
+    Tcl_AppendResult(interp, " ", buffer, (char *) NULL);
+  }
+
+  return (TCL_OK);
+}
+
+/** Parse "constraint sdf <n> <spacing> [<tolerance>]" or
+    "constraint sdf <n> off". */
+static int tclcommand_constraint_parse_sdf(Tcl_Interp *interp, int argc, char **argv)
+{
+  int c_num;
+  double spacing = 0.0, tolerance = 1e-3;
+
+  if (argc < 2) {
+    Tcl_AppendResult(interp, "usage: constraint sdf <n> {<spacing> [<tolerance>] | off}", (char *) NULL);
+    return (TCL_ERROR);
+  }
+  if (Tcl_GetInt(interp, argv[0], &c_num) == TCL_ERROR)
+    return (TCL_ERROR);
+  if (c_num < 0 || c_num >= n_constraints) {
+    Tcl_AppendResult(interp, "constraint does not exist", (char *) NULL);
+    return (TCL_ERROR);
+  }
+  if (!ARG_IS_S(1, "off")) {
+    if (!ARG_IS_D(1, spacing))
+      return (TCL_ERROR);
+    if (argc > 2 && !ARG_IS_D(2, tolerance))
+      return (TCL_ERROR);
+    if (spacing <= 0.0 || tolerance < 0.0) {
+      Tcl_AppendResult(interp, "the spacing must be positive and the tolerance non-negative", (char *) NULL);
+      return (TCL_ERROR);
+    }
+    switch (constraints[c_num].type) {
+    case CONSTRAINT_ROD:
+    case CONSTRAINT_PLATE:
+    case CONSTRAINT_EXT_MAGN_FIELD:
+    case CONSTRAINT_NONE:
+      Tcl_AppendResult(interp, "only the distance to a shaped constraint can be cached", (char *) NULL);
+      return (TCL_ERROR);
+    default:
+      break;
+    }
+  }
+
+  constraints[c_num].sdf_spacing = spacing;
+  constraints[c_num].sdf_tolerance = tolerance;
+  mpi_bcast_constraint_sdf(c_num);
+
   return (TCL_OK);
 }
 
@@ -2024,6 +2076,9 @@ int tclcommand_constraint(ClientData _data, Tcl_Interp *interp,
     tclprint_to_result_ConstraintForce(interp, c_num);
     status  = TCL_OK;
   }
+  else if(!strncmp(argv[1], "sdf", strlen(argv[1]))) {
+    status = tclcommand_constraint_parse_sdf(interp, argc - 2, argv + 2);
+  }
   else if(!strncmp(argv[1], "n_constraints", strlen(argv[1]))) {
     tclprint_to_result_n_constraints(interp);
     status=TCL_OK;
@@ -28,6 +28,7 @@
 #include "communication.hpp"
 #include "grid.hpp"
 #include "global.hpp"
+#include "load_balance.hpp"
 
 int tclcallback_node_grid(Tcl_Interp *interp, void *_data)
 {
@@ -97,6 +98,21 @@ int tclcallback_box_l(Tcl_Interp *interp, void *_data)
   return (TCL_OK);
 }
 
+int tclcallback_balance_interval(Tcl_Interp *interp, void *_data)
+{
+  int data = *(int *)_data;
+
+  if (data < 0) {
+    Tcl_AppendResult(interp, "balance_interval must be non-negative", (char *) NULL);
+    return (TCL_ERROR);
+  }
+
+  balance_interval = data;
+  mpi_bcast_parameter(FIELD_BALANCE_INTERVAL);
+
+  return (TCL_OK);
+}
+
 int tclcommand_change_volume(ClientData data, Tcl_Interp *interp, int argc, char **argv) {
   char buffer[50 + TCL_DOUBLE_SPACE + TCL_INTEGER_SPACE];
   char *mode;
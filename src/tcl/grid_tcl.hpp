@@ -38,6 +38,9 @@ int tclcallback_periodicity(Tcl_Interp *interp, void *_data);
 /** datafield callback for \ref box_l. Sets the box dimensions. */
 int tclcallback_box_l(Tcl_Interp *interp, void *_data);
 
+/** datafield callback for \ref balance_interval. */
+int tclcallback_balance_interval(Tcl_Interp *interp, void *_data);
+
 /** changes the volume by resizing the box and isotropically adjusting the particles coordinates as well */
 int tclcommand_change_volume(ClientData data, Tcl_Interp *interp, int argc, char **argv);
 
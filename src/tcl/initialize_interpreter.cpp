@@ -65,6 +65,7 @@
 #include "minimize_energy_tcl.hpp"
 #include "h5mdfile_tcl.hpp"
 #include "mpiio_tcl.hpp"
+#include "trajectory_tcl.hpp"
 
 #ifdef TK
 #include <tk.h>
@@ -126,6 +127,18 @@ int tclcommand_time_integration(ClientData data, Tcl_Interp *interp, int argc, c
 /** Tunes the skin */
 int tclcommand_tune_skin(ClientData data, Tcl_Interp *interp, int argc, char *argv[]);
 
+/** Times the scalar and the batched non-bonded pair loop. From tuning_tcl.cpp **/
+int tclcommand_time_nonbonded_kernel(ClientData data, Tcl_Interp *interp, int argc, char *argv[]);
+/** callback for \ref nonbonded_batch. See \ref tuning_tcl.cpp */
+int tclcallback_nonbonded_batch(Tcl_Interp *interp, void *data);
+int tclcallback_n_threads(Tcl_Interp *interp, void *data);
+/** callback for \ref phase_timers. See \ref tuning_tcl.cpp */
+int tclcallback_phase_timers(Tcl_Interp *interp, void *data);
+/** callback for \ref skin_tune_interval. See \ref tuning_tcl.cpp */
+int tclcallback_skin_tune_interval(Tcl_Interp *interp, void *data);
+/** Average times per step of the integration phases. From tuning_tcl.cpp **/
+int tclcommand_time_phases(ClientData data, Tcl_Interp *interp, int argc, char *argv[]);
+
 /** Reads particles from pdb file, see \ref readpdb.cpp */
 int tclcommand_readpdb(ClientData data, Tcl_Interp *interp, int argc, char *argv[]);
 
@@ -179,6 +192,8 @@ static void tcl_register_commands(Tcl_Interp* interp) {
   #endif
   /* in mpiio_tcl.cpp */
   REGISTER_COMMAND("mpiio", tclcommand_mpiio);
+  /* in trajectory_tcl.cpp */
+  REGISTER_COMMAND("trajectory", tclcommand_trajectory);
   /* in constraint.cpp */
   REGISTER_COMMAND("constraint", tclcommand_constraint);
   /* in external_potential.hpp */
@@ -241,6 +256,8 @@ static void tcl_register_commands(Tcl_Interp* interp) {
   REGISTER_COMMAND("system_CMS_velocity", tclcommand_system_CMS_velocity);
   REGISTER_COMMAND("galilei_transform", tclcommand_galilei_transform);
   REGISTER_COMMAND("time_integration", tclcommand_time_integration);
+  REGISTER_COMMAND("time_nonbonded_kernel", tclcommand_time_nonbonded_kernel);
+  REGISTER_COMMAND("time_phases", tclcommand_time_phases);
   REGISTER_COMMAND("tune_skin", tclcommand_tune_skin);
   REGISTER_COMMAND("electrokinetics", tclcommand_electrokinetics);
 #if defined(SD) || defined(BD)
@@ -269,10 +286,13 @@ static void tcl_register_global_variables(Tcl_Interp *interp)
   register_global_callback(FIELD_MAXNUMCELLS, tclcallback_max_num_cells);
   register_global_callback(FIELD_MINNUMCELLS, tclcallback_min_num_cells);
   register_global_callback(FIELD_NODEGRID, tclcallback_node_grid);
+  register_global_callback(FIELD_BALANCE_INTERVAL, tclcallback_balance_interval);
   register_global_callback(FIELD_NPTISO_PDIFF, tclcallback_npt_p_diff);
   register_global_callback(FIELD_NPTISO_PISTON, tclcallback_npt_piston);
   register_global_callback(FIELD_PERIODIC, tclcallback_periodicity);
   register_global_callback(FIELD_SKIN, tclcallback_skin);
+  register_global_callback(FIELD_SORT_INTERVAL, tclcallback_sort_interval);
+  register_global_callback(FIELD_RESPA_STEPS, tclcallback_respa_steps);
   register_global_callback(FIELD_SIMTIME, tclcallback_time);
   register_global_callback(FIELD_TIMESTEP, tclcallback_time_step);
   register_global_callback(FIELD_TIMINGSAMP, tclcallback_timings);
@@ -283,6 +303,10 @@ static void tcl_register_global_variables(Tcl_Interp *interp)
   register_global_callback(FIELD_SD_RANDOM_STATE, tclcallback_sd_random_state);
   register_global_callback(FIELD_SD_RANDOM_PRECISION, tclcallback_sd_random_precision);
   register_global_callback(FIELD_DPD_IGNORE_FIXED_PARTICLES, tclcallback_dpd_ignore_fixed_particles);
+  register_global_callback(FIELD_NONBONDED_BATCH, tclcallback_nonbonded_batch);
+  register_global_callback(FIELD_N_THREADS, tclcallback_n_threads);
+  register_global_callback(FIELD_PHASE_TIMERS, tclcallback_phase_timers);
+  register_global_callback(FIELD_SKIN_TUNE_INTERVAL, tclcallback_skin_tune_interval);
 
 #ifdef MULTI_TIMESTEP
   register_global_callback(FIELD_SMALLERTIMESTEP, tclcallback_smaller_time_step);
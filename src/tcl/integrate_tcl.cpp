@@ -309,6 +309,18 @@ int tclcallback_time_step(Tcl_Interp *interp, void *_data)
   return (TCL_OK);
 }
 
+int tclcallback_respa_steps(Tcl_Interp *interp, void *_data)
+{
+  int data = *(int *)_data;
+  if (data < 1) {
+    Tcl_AppendResult(interp, "respa_steps must be at least 1.", (char *) NULL);
+    return (TCL_ERROR);
+  }
+  respa_steps = data;
+  mpi_bcast_parameter(FIELD_RESPA_STEPS);
+  return (TCL_OK);
+}
+
 #ifdef MULTI_TIMESTEP
 int tclcallback_smaller_time_step(Tcl_Interp *interp, void *_data)
 {
@@ -40,6 +40,10 @@ int tclcallback_skin(Tcl_Interp *interp, void *_data);
  */
 int tclcallback_time_step(Tcl_Interp *interp, void *_data);
 
+/** Callback for the number of r-RESPA inner steps (1 <= respa_steps).
+ */
+int tclcallback_respa_steps(Tcl_Interp *interp, void *_data);
+
 #ifdef MULTI_TIMESTEP
 /** Callback for integration time_step (0.0 <= time_step).
     \return TCL status.
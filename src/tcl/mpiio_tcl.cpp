@@ -21,6 +21,7 @@
 
 #include "mpiio.hpp"
 #include "mpiio_tcl.hpp"
+#include "checkpoint.hpp"
 #include "communication.hpp"
 
 #define LEN(x) (sizeof(x) / sizeof(*(x)))
@@ -56,11 +57,29 @@ int tclcommand_mpiio(ClientData data, Tcl_Interp *interp,
   
   if (argc < 3) {
     Tcl_AppendResult(interp, "wrong # args:  should be \"",
-                     argv[0], " <filename> read|write ?pos|v|types|bonds?* ...\"",
+                     argv[0], " <filename> read|write ?pos|v|types|bonds?* ...\" or \"",
+                     argv[0], " <filename> checkpoint|restore\"",
                      (char *) NULL);
     return (TCL_ERROR);
   }
   filename = argv[1];
+
+  // Complete checkpoints
+  if (!strcmp(argv[2], "checkpoint") || !strcmp(argv[2], "restore")) {
+    if (argc != 3) {
+      Tcl_AppendResult(interp, "wrong # args:  should be \"",
+                       argv[0], " <filename> checkpoint|restore\"",
+                       (char *) NULL);
+      return (TCL_ERROR);
+    }
+    int err;
+    if (argv[2][0] == 'c')
+      err = checkpoint_write(filename);
+    else
+      err = checkpoint_read(filename);
+    return gather_runtime_errors(interp, err == ES_OK ? TCL_OK : TCL_ERROR);
+  }
+
   // Operation mode
   if (!strncmp(argv[2], "write", strlen(argv[2]))) {
     write = 1;
@@ -26,7 +26,7 @@
 
 int tclcommand_inter_coulomb_parse_p3m_tune(Tcl_Interp * interp, int argc, char ** argv, int adaptive)
 {
-  int cao = -1, n_interpol = -1;
+  int cao = -1, n_interpol = -1, diff = P3M_DIFF_TUNE;
   double r_cut = -1, accuracy = -1;
   int mesh[3];
   IntList il;
@@ -77,6 +77,15 @@ int tclcommand_inter_coulomb_parse_p3m_tune(Tcl_Interp * interp, int argc, char
         Tcl_AppendResult(interp, "n_interpol expects an nonnegative integer", (char *) NULL);
         return TCL_ERROR;
       }
+    } else if (ARG0_IS_S("diff")) {
+      if (argc > 1 && ARG1_IS_S("ik"))
+        diff = P3M_DIFF_IK;
+      else if (argc > 1 && ARG1_IS_S("ad"))
+        diff = P3M_DIFF_AD;
+      else {
+        Tcl_AppendResult(interp, "diff expects ik or ad", (char *) NULL);
+        return TCL_ERROR;
+      }
     }
     /* unknown parameter. Probably one of the optionals */
     else break;
@@ -92,7 +101,7 @@ int tclcommand_inter_coulomb_parse_p3m_tune(Tcl_Interp * interp, int argc, char
     Tcl_AppendResult(interp, "P3M requires an even number of mesh points in all directions", (char *) NULL);
     return TCL_ERROR;
   }
-  p3m_set_tune_params(r_cut, mesh, cao, -1.0, accuracy, n_interpol);
+  p3m_set_tune_params(r_cut, mesh, cao, -1.0, accuracy, n_interpol, diff);
 
   /* check for optional parameters */
   if (argc > 0) {
@@ -283,6 +292,31 @@ int tclcommand_inter_coulomb_parse_p3m_opt_params(Tcl_Interp * interp, int argc,
       argv += 4;
     }
     
+    /* p3m parameter: diff */
+    else if (ARG0_IS_S("diff")) {
+
+      if(argc < 2) {
+	Tcl_AppendResult(interp, argv[0], " needs 1 parameter",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      if (ARG1_IS_S("ik"))
+	i = P3M_DIFF_IK;
+      else if (ARG1_IS_S("ad"))
+	i = P3M_DIFF_AD;
+      else {
+	Tcl_AppendResult(interp, argv[0], " needs \"ik\" or \"ad\"",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      p3m_set_diff(i);
+
+      argc -= 2;
+      argv += 2;
+    }
+
     /* p3m parameter: epsilon */
     else if(ARG0_IS_S( "epsilon")) {
 
@@ -358,6 +392,8 @@ int tclprint_to_result_p3m(Tcl_Interp *interp)
   Tcl_AppendResult(interp, buffer, " ", (char *) NULL);
   Tcl_PrintDouble(interp, p3m.params.mesh_off[2], buffer);
   Tcl_AppendResult(interp, buffer, (char *) NULL);
+  if (p3m.params.diff == P3M_DIFF_AD)
+    Tcl_AppendResult(interp, " diff ad", (char *) NULL);
 
   return TCL_OK;
 }
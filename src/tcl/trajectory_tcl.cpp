@@ -0,0 +1,127 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file trajectory_tcl.cpp
+ *  Implementation of \ref trajectory_tcl.hpp "trajectory_tcl.hpp".
+ */
+#include "trajectory_tcl.hpp"
+#include "trajectory.hpp"
+#include "integrate.hpp"
+#include "particle_data.hpp"
+
+static int tclcommand_trajectory_usage(Tcl_Interp *interp)
+{
+  Tcl_AppendResult(interp, "usage: trajectory open <file> ?precision <p>? "
+                   "?velocities <p>? | write | close | frames <file> | "
+                   "read <file> <frame>", (char *) NULL);
+  return TCL_ERROR;
+}
+
+/** Read a frame and set the positions and velocities of the particles. */
+static int tclcommand_trajectory_read(Tcl_Interp *interp, char *filename,
+                                      int n)
+{
+  TrajectoryFrame frame;
+  if (trajectory_read_frame(filename, n, &frame) == ES_ERROR)
+    return gather_runtime_errors(interp, TCL_ERROR);
+
+  for (size_t i = 0; i < frame.id.size(); i++) {
+    if (place_particle(frame.id[i], &frame.pos[3*i]) == ES_PART_ERROR) {
+      Tcl_AppendResult(interp, "particle could not be set", (char *) NULL);
+      return TCL_ERROR;
+    }
+    if (!frame.v.empty()) {
+      double v[3];
+      for (int d = 0; d < 3; d++)
+        v[d] = frame.v[3*i + d]*time_step;
+      set_particle_v(frame.id[i], v);
+    }
+  }
+
+  char buffer[TCL_DOUBLE_SPACE];
+  Tcl_PrintDouble(interp, frame.time, buffer);
+  Tcl_AppendResult(interp, buffer, (char *) NULL);
+  return gather_runtime_errors(interp, TCL_OK);
+}
+
+int tclcommand_trajectory(ClientData data, Tcl_Interp *interp,
+                          int argc, char *argv[])
+{
+  argc--; argv++;
+  if (argc < 1)
+    return tclcommand_trajectory_usage(interp);
+
+  if (ARG0_IS_S_EXACT("open")) {
+    if (argc < 2)
+      return tclcommand_trajectory_usage(interp);
+    char *filename = argv[1];
+    double precision = 1e-3, v_precision = 0;
+    argc -= 2; argv += 2;
+    while (argc > 0) {
+      if (argc >= 2 && ARG0_IS_S("precision")) {
+        if (!ARG1_IS_D(precision) || precision <= 0) {
+          Tcl_ResetResult(interp);
+          Tcl_AppendResult(interp, "precision must be a positive number",
+                           (char *) NULL);
+          return TCL_ERROR;
+        }
+      } else if (argc >= 2 && ARG0_IS_S("velocities")) {
+        if (!ARG1_IS_D(v_precision) || v_precision <= 0) {
+          Tcl_ResetResult(interp);
+          Tcl_AppendResult(interp, "velocity precision must be a positive number",
+                           (char *) NULL);
+          return TCL_ERROR;
+        }
+      } else
+        return tclcommand_trajectory_usage(interp);
+      argc -= 2; argv += 2;
+    }
+    trajectory_open(filename, precision, v_precision);
+    return gather_runtime_errors(interp, TCL_OK);
+  }
+  else if (ARG0_IS_S_EXACT("write")) {
+    trajectory_write();
+    return gather_runtime_errors(interp, TCL_OK);
+  }
+  else if (ARG0_IS_S_EXACT("close")) {
+    trajectory_close();
+    return gather_runtime_errors(interp, TCL_OK);
+  }
+  else if (ARG0_IS_S_EXACT("frames")) {
+    if (argc != 2)
+      return tclcommand_trajectory_usage(interp);
+    int n = trajectory_n_frames(argv[1]);
+    if (n < 0) {
+      Tcl_AppendResult(interp, "could not read the index of \"", argv[1],
+                       "\"", (char *) NULL);
+      return TCL_ERROR;
+    }
+    char buffer[TCL_INTEGER_SPACE];
+    sprintf(buffer, "%d", n);
+    Tcl_AppendResult(interp, buffer, (char *) NULL);
+    return TCL_OK;
+  }
+  else if (ARG0_IS_S_EXACT("read")) {
+    int n;
+    if (argc != 3 || !ARG_IS_I(2, n))
+      return tclcommand_trajectory_usage(interp);
+    return tclcommand_trajectory_read(interp, argv[1], n);
+  }
+
+  return tclcommand_trajectory_usage(interp);
+}
@@ -0,0 +1,34 @@
+/*
+  Copyright (C) 2016 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file trajectory_tcl.hpp
+ *  Tcl interface for compressed trajectories, see \ref trajectory.hpp.
+ */
+#ifndef _TRAJECTORY_TCL_H
+#define _TRAJECTORY_TCL_H
+
+#include "parser.hpp"
+
+/** Implementation of the Tcl command trajectory, with the subcommands
+ *  "open <file> ?precision <p>? ?velocities <p>?", "write", "close",
+ *  "frames <file>" and "read <file> <frame>".
+ */
+int tclcommand_trajectory(ClientData data, Tcl_Interp *interp,
+                          int argc, char *argv[]);
+
+#endif
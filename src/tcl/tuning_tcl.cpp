@@ -25,6 +25,13 @@
  */
 #include "parser.hpp"
 #include "tuning.hpp"
+#include "communication.hpp"
+#include "global.hpp"
+#include "nonbonded_batch.hpp"
+#include "threads.hpp"
+#include "phase_timers.hpp"
+#include "skin_tune.hpp"
+#include <string>
 
 int tclcallback_timings(Tcl_Interp *interp, void *data)
 {
@@ -35,6 +42,91 @@ int tclcallback_timings(Tcl_Interp *interp, void *data)
   return TCL_OK;
 }
 
+int tclcallback_nonbonded_batch(Tcl_Interp *interp, void *data)
+{
+  int value = *(int *)data;
+
+  if ((value != 0) && (value != 1)) {
+    Tcl_AppendResult(interp, "nonbonded_batch must be 0 or 1", (char *) NULL);
+    return TCL_ERROR;
+  }
+  nonbonded_batch = value;
+  mpi_bcast_parameter(FIELD_NONBONDED_BATCH);
+  return TCL_OK;
+}
+
+int tclcallback_n_threads(Tcl_Interp *interp, void *data)
+{
+  int value = *(int *)data;
+
+  if (value < 1) {
+    Tcl_AppendResult(interp, "n_threads must be positive", (char *) NULL);
+    return TCL_ERROR;
+  }
+#ifndef _OPENMP
+  if (value != 1) {
+    Tcl_AppendResult(interp, "n_threads > 1 requires OpenMP, which was not enabled at compile time", (char *) NULL);
+    return TCL_ERROR;
+  }
+#endif
+  n_threads = value;
+  mpi_bcast_parameter(FIELD_N_THREADS);
+  return TCL_OK;
+}
+
+int tclcallback_phase_timers(Tcl_Interp *interp, void *data)
+{
+  int value = *(int *)data;
+
+  if ((value != 0) && (value != 1)) {
+    Tcl_AppendResult(interp, "phase_timers must be 0 or 1", (char *) NULL);
+    return TCL_ERROR;
+  }
+  phase_timers = value;
+  mpi_bcast_parameter(FIELD_PHASE_TIMERS);
+  return TCL_OK;
+}
+
+int tclcallback_skin_tune_interval(Tcl_Interp *interp, void *data)
+{
+  int value = *(int *)data;
+
+  if (value < 0) {
+    Tcl_AppendResult(interp, "skin_tune_interval must be non-negative", (char *) NULL);
+    return TCL_ERROR;
+  }
+  skin_tune_interval = value;
+  mpi_bcast_parameter(FIELD_SKIN_TUNE_INTERVAL);
+  return TCL_OK;
+}
+
+int tclcommand_time_phases(ClientData data, Tcl_Interp *interp, int argc, char *argv[]) {
+  char buffer[3*TCL_DOUBLE_SPACE];
+  double stats[3*PHASE_N];
+
+  if(argc > 1) {
+    Tcl_AppendResult(interp, "time_phases expects no arguments.", (char *)NULL);
+    return TCL_ERROR;
+  }
+
+  mpi_gather_phase_timers(stats);
+
+  for (int i = 0; i < PHASE_N; i++) {
+    /* full path of the phase, e.g. integrate/force_calc/short_range */
+    std::string path = phase_timer_names[i];
+    for (int p = phase_timer_parent[i]; p >= 0; p = phase_timer_parent[p])
+      path = std::string(phase_timer_names[p]) + "/" + path;
+
+    Tcl_AppendResult(interp, "{", path.c_str(), (char *)NULL);
+    for (int j = 0; j < 3; j++) {
+      Tcl_PrintDouble(interp, stats[3*i + j], buffer);
+      Tcl_AppendResult(interp, " ", buffer, (char *)NULL);
+    }
+    Tcl_AppendResult(interp, "} ", (char *)NULL);
+  }
+  return TCL_OK;
+}
+
 int tclcommand_time_integration(ClientData data, Tcl_Interp *interp, int argc, char *argv[]) {
   char buffer[10+TCL_DOUBLE_SPACE];
   double t;
@@ -73,6 +165,36 @@ int tclcommand_tune_skin(ClientData data, Tcl_Interp *interp, int argc, char *ar
   return TCL_OK;
 }
 
+int tclcommand_time_nonbonded_kernel(ClientData data, Tcl_Interp *interp, int argc, char *argv[]) {
+  char buffer[3*TCL_DOUBLE_SPACE + TCL_INTEGER_SPACE + 4];
+  int rounds = 10, n_pairs;
+  double t_scalar, t_batch;
+
+  if(argc > 2) {
+    Tcl_AppendResult(interp, "time_nonbonded_kernel expects zero or one argument.", (char *)NULL);
+    return TCL_ERROR;
+  }
+  if(argc == 2) {
+    if(!(ARG1_IS_I(rounds) && (rounds > 0))) {
+      return TCL_ERROR;
+    }
+  }
+
+  /* bring the Verlet lists up to date */
+  if (mpi_integrate(0, 0))
+    return gather_runtime_errors(interp, TCL_OK);
+
+  if (nonbonded_batch_benchmark(rounds, &n_pairs, &t_scalar, &t_batch) != ES_OK) {
+    Tcl_AppendResult(interp, "time_nonbonded_kernel needs the domain decomposition with Verlet lists.", (char *)NULL);
+    return TCL_ERROR;
+  }
+
+  /* number of pairs and pairs per second of the scalar and the batched loop */
+  sprintf(buffer, "%d %g %g", n_pairs, n_pairs/t_scalar, n_pairs/t_batch);
+  Tcl_AppendResult(interp, buffer, (char *)NULL);
+  return TCL_OK;
+}
+
 
 
 
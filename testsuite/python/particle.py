@@ -143,6 +143,36 @@ class ParticleProperties(ut.TestCase):
             self.assertTrue(res[0] == 0 and res[1] == 5.0 and
                             self.arraysNearlyEqual(res[2], np.array((0.5, -0.5, -0.5, -0.5))), "vs_relative: " + res.__str__())
 
+    def test_arrays(self):
+        ids = np.arange(100, 200)
+        pos = np.random.random((100, 3)) * self.es.box_l
+        v = np.random.random((100, 3))
+        types = np.arange(100) % 3
+        self.es.part.set_arrays(ids, pos=pos, v=v, type=types)
+        for i in [0, 57, 99]:
+            self.assertTrue(self.arraysNearlyEqual(
+                self.es.part[ids[i]].v, v[i]), "v differs after set_arrays")
+            self.assertEqual(self.es.part[ids[i]].type, types[i])
+
+        # update a subset, in a different order
+        self.es.part.set_arrays(ids[::-2], v=-v[::-2])
+        res = self.es.part.get_arrays(ids)
+        self.assertTrue(np.all(res["id"] == ids))
+        self.assertTrue(np.allclose(res["pos"], pos, atol=self.tol))
+        self.assertTrue(np.allclose(res["v"][1::2], -v[1::2], atol=self.tol))
+        self.assertTrue(np.allclose(res["v"][::2], v[::2], atol=self.tol))
+        self.assertTrue(np.all(res["type"] == types))
+
+        # new particles need a position, and ids must be unique
+        self.assertRaises(Exception, self.es.part.set_arrays, [300], v=[[0, 0, 0]])
+        self.assertRaises(Exception, self.es.part.set_arrays,
+                          [301, 301], pos=[[0, 0, 0], [1, 1, 1]])
+        self.assertFalse(self.es.part.exists(300))
+        self.assertFalse(self.es.part.exists(301))
+
+        for i in ids:
+            self.es.part[i].delete()
+
 
 if __name__ == "__main__":
     #print("Features: ", espressomd.features())
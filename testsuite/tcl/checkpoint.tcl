@@ -0,0 +1,123 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#############################################################
+#                                                           #
+#  Test: parallel checkpoint and restart                    #
+#                                                           #
+#############################################################
+source "tests_common.tcl"
+
+require_feature "LENNARD_JONES"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase checkpoint.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set filename "checkpoint.chk"
+set epsilon 1e-6
+
+setmd box_l 8. 8. 8.
+setmd time_step 0.01
+setmd skin 0.4
+thermostat langevin 1.0 1.0
+
+inter 0 0 lennard-jones 1.0 1.0 1.12246 0.25 0.0
+inter 0 harmonic 10.0 1.0
+
+# chains of 10 particles on a cubic lattice
+set pid 0
+for {set x 0} {$x < 4} {incr x} {
+    for {set y 0} {$y < 4} {incr y} {
+        for {set z 0} {$z < 10} {incr z} {
+            part $pid pos [expr 2.*$x] [expr 2.*$y] [expr 0.8*$z] type 0
+            if { $z > 0 } { part $pid bond 0 [expr $pid - 1] }
+            incr pid
+        }
+    }
+}
+
+integrate 200
+
+if { [catch {
+    mpiio $filename checkpoint
+
+    integrate 100
+    set reference ""
+    for {set i 0} {$i < [setmd n_part]} {incr i} {
+        lappend reference [concat [part $i print pos] [part $i print v]]
+    }
+    set reference_time [setmd time]
+
+    # change the state, which the checkpoint has to reset
+    setmd skin 0.3
+    thermostat langevin 2.0 0.5
+    part 0 delete
+    part 1000 pos 1 1 1
+
+    mpiio $filename restore
+
+    if { [setmd skin] != 0.4 } {
+        error "skin was not restored"
+    }
+    if { [setmd n_part] != 160 || [part 1000] != "na" } {
+        error "particles were not restored"
+    }
+    if { [lindex [part 1 print bonds] 0 0] != "0 0" } {
+        error "bonds were not restored: [part 1 print bonds]"
+    }
+
+    integrate 100
+    if { abs([setmd time] - $reference_time) > $epsilon } {
+        error "time [setmd time] differs from $reference_time"
+    }
+    for {set i 0} {$i < [setmd n_part]} {incr i} {
+        set res [concat [part $i print pos] [part $i print v]]
+        foreach a $res b [lindex $reference $i] {
+            if { abs($a - $b) > $epsilon } {
+                error "particle $i differs after restart: $res vs. [lindex $reference $i]"
+            }
+        }
+    }
+
+    # a corrupt global section must leave the system untouched. The
+    # offset of the global section is the int64 at byte 112 of the
+    # header; its first field index is overwritten with garbage.
+    mpiio $filename checkpoint
+    set f [open $filename r+]
+    fconfigure $f -translation binary
+    seek $f 112
+    binary scan [read $f 8] w global_offset
+    seek $f [expr $global_offset + 4]
+    puts -nonewline $f [binary format i 0x7fffffff]
+    close $f
+
+    setmd skin 0.3
+    if { ![catch {mpiio $filename restore}] } {
+        error "corrupt checkpoint was accepted"
+    }
+    if { [setmd skin] != 0.3 || [setmd n_part] != 160 } {
+        error "corrupt checkpoint changed the system"
+    }
+} res ] } {
+    file delete $filename
+    error_exit $res
+}
+
+file delete $filename
+
+ok_exit
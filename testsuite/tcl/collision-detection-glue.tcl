@@ -26,10 +26,10 @@ source "tests_common.tcl"
 require_feature "VIRTUAL_SITES_RELATIVE"
 require_feature "COLLISION_DETECTION"
 require_feature "ADRESS" off
-require_max_nodes_per_side {1 1 1}
+require_max_nodes_per_side 2
 
 puts "---------------------------------------------------------------"
-puts "- Testcase collision-detection-glue.tcl running on 1 nodes"
+puts "- Testcase collision-detection-glue.tcl running on [setmd n_nodes] nodes"
 puts "---------------------------------------------------------------"
 
 # Setup
@@ -0,0 +1,106 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#############################################################
+#                                                           #
+#  Test: constraints in range of the cells                  #
+#                                                           #
+#############################################################
+source "tests_common.tcl"
+
+require_feature "CONSTRAINTS"
+require_feature "LENNARD_JONES"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase constraint_culling.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set epsilon 1e-8
+
+setmd box_l 12. 12. 12.
+setmd time_step 0.01
+setmd skin 0.3
+thermostat off
+
+# a porous medium of small obstacles
+expr srand(42)
+for {set i 0} {$i < 100} {incr i} {
+    constraint sphere center [expr 12.*rand()] [expr 12.*rand()] [expr 12.*rand()] radius 0.5 direction 1 type 1
+}
+inter 0 1 lennard-jones 1.0 1.0 1.5 auto 0.0
+inter 0 0 lennard-jones 1.0 1.0 1.12246 0.25 0.0
+
+set n_part 0
+while { $n_part < 400 } {
+    set pos [list [expr 12.*rand()] [expr 12.*rand()] [expr 12.*rand()]]
+    if { [eval constraint mindist_position $pos] > 0.8 } {
+        eval part $n_part pos $pos type 0
+        incr n_part
+    }
+}
+
+proc forces {} {
+    global n_part
+    integrate 0
+    set res ""
+    for {set i 0} {$i < $n_part} {incr i} {
+        lappend res [part $i print f]
+    }
+    return [list $res [analyze energy nonbonded 0 1]]
+}
+
+proc compare {a b what} {
+    global epsilon
+    foreach fa [lindex $a 0] fb [lindex $b 0] {
+        if { [veclen [vecsub $fa $fb]] > $epsilon*(1. + [veclen $fa]) } {
+            error "$what: force differs: $fa vs. $fb"
+        }
+    }
+    if { abs([lindex $a 1] - [lindex $b 1]) > $epsilon*(1. + abs([lindex $a 1])) } {
+        error "$what: energy differs: [lindex $a 1] vs. [lindex $b 1]"
+    }
+}
+
+if { [catch {
+    # without a domain decomposition, all constraints are visited
+    cellsystem nsquare
+    set all [forces]
+    cellsystem domain_decomposition -no_verlet_list
+    compare $all [forces] "domain decomposition"
+
+    # the lists follow changes of the cutoff, the constraints and the cells
+    inter 0 1 lennard-jones 1.0 1.0 2.0 auto 0.0
+    set dd [forces]
+    cellsystem nsquare
+    compare $dd [forces] "larger cutoff"
+
+    cellsystem domain_decomposition -no_verlet_list
+    constraint delete 0
+    set dd [forces]
+    cellsystem nsquare
+    compare $dd [forces] "deleted constraint"
+
+    cellsystem domain_decomposition -no_verlet_list
+    setmd skin 0.5
+    set dd [forces]
+    cellsystem nsquare
+    compare $dd [forces] "changed cells"
+} res ] } {
+    error_exit $res
+}
+
+ok_exit
@@ -0,0 +1,107 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#############################################################
+#                                                           #
+#  Test: cached distance fields of constraints              #
+#                                                           #
+#############################################################
+source "tests_common.tcl"
+
+require_feature "CONSTRAINTS"
+require_feature "LENNARD_JONES"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase constraint_sdf.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set epsilon 1e-2
+
+setmd box_l 10. 10. 10.
+setmd time_step 0.01
+setmd skin 0.3
+thermostat off
+
+constraint pore center 5 5 5 axis 0 0 1 radii 3 3 length 2 smoothing_radius 0.5 type 1
+inter 0 1 lennard-jones 1.0 1.0 2.5 auto 0.0
+
+# particles at some distance to the pore, only interacting with it
+expr srand(42)
+set n_part 0
+while { $n_part < 300 } {
+    set pos [list [expr 10.*rand()] [expr 10.*rand()] [expr 10.*rand()]]
+    if { [eval constraint mindist_position $pos] > 1.0 } {
+        eval part $n_part pos $pos type 0
+        incr n_part
+    }
+}
+
+proc forces {} {
+    global n_part
+    integrate 0
+    set res ""
+    for {set i 0} {$i < $n_part} {incr i} {
+        lappend res [part $i print f]
+    }
+    return $res
+}
+
+if { [catch {
+    set exact_f [forces]
+    set exact_e [analyze energy nonbonded 0 1]
+
+    if { ![catch {constraint sdf 0 -0.1}] } {
+        error "negative spacing was accepted"
+    }
+    # coarse grid: where the interpolation of the curved pore wall is
+    # off by more than the tolerance, the exact distance is used
+    constraint sdf 0 0.2 1e-4
+    if { [lrange [constraint 0] end-2 end] != "sdf 0.2 0.0001" } {
+        error "sdf parameters not printed: [constraint 0]"
+    }
+
+    set cached_f [forces]
+    set cached_e [analyze energy nonbonded 0 1]
+
+    set n_interacting 0
+    for {set i 0} {$i < $n_part} {incr i} {
+        set a [lindex $exact_f $i]
+        set b [lindex $cached_f $i]
+        if { [veclen $a] > 0 } { incr n_interacting }
+        if { [veclen [vecsub $a $b]] > $epsilon*([veclen $a] + 1e-3) } {
+            error "force on particle $i differs: exact $a, cached $b"
+        }
+    }
+    if { $n_interacting == 0 } {
+        error "no particle interacts with the constraint"
+    }
+    if { abs($exact_e - $cached_e) > $epsilon*abs($exact_e) } {
+        error "energy differs: exact $exact_e, cached $cached_e"
+    }
+
+    # switching the cache off restores the exact forces
+    constraint sdf 0 off
+    foreach a $exact_f b [forces] {
+        if { [veclen [vecsub $a $b]] > 1e-10 } {
+            error "force differs after switching the cache off: $a vs. $b"
+        }
+    }
+} res ] } {
+    error_exit $res
+}
+
+ok_exit
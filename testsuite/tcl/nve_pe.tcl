@@ -191,6 +191,19 @@ puts "Energy deviation in NVE simulation: $error %"
 
 if { $error > $ener_tolerance } {
     error_exit "energy deviation greater than $ener_tolerance % "
+}
+
+# the same with r-RESPA, the k-space forces only every second step
+setmd respa_steps 2
+set ini_energy [lindex [lindex [analyze energy] 0] 1 ]
+integrate $int_steps
+set fin_energy [lindex [lindex [analyze energy] 0] 1 ]
+setmd respa_steps 1
+set error [expr abs( $fin_energy - $ini_energy) / $ini_energy * 100.]
+puts "Energy deviation in NVE simulation with r-RESPA: $error %"
+
+if { $error > $ener_tolerance } {
+    error_exit "energy deviation with r-RESPA greater than $ener_tolerance % "
 } else {
     puts "Alles in Ordnung :) "
 }
@@ -52,6 +52,8 @@ proc write_data {file} {
 if { [catch {
     puts "Tests for P3M charge-charge interaction"
     read_data "p3m_system.data"
+    # rms force error of the reference forces
+    set ref_accuracy [lindex [lindex [inter coulomb] 0] 7]
 
     for { set i 0 } { $i <= [setmd max_part] } { incr i } {
 	set F($i) [part $i pr f]
@@ -118,6 +120,65 @@ if { [catch {
     if { $rmsf > $epsilon } {
 	error "p3m-charges: force error too large"
    }
+
+    ############## same system with ad differentiation
+
+    inter coulomb diff ad
+    integrate 0
+
+    set rmsf 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	set resF [part $i pr f]
+	set tgtF $F($i)
+	set dx [expr abs(([lindex $resF 0] - [lindex $tgtF 0]))]
+	set dy [expr abs(([lindex $resF 1] - [lindex $tgtF 1]))]
+	set dz [expr abs(([lindex $resF 2] - [lindex $tgtF 2]))]
+	set rmsf [expr $rmsf + $dx*$dx + $dy*$dy + $dz*$dz]
+    }
+    set rmsf [expr sqrt($rmsf/[setmd n_part])]
+    puts "p3m-charges (ad): rms force deviation $rmsf"
+    if { $rmsf > $epsilon } {
+	error "p3m-charges: force error with ad differentiation too large"
+    }
+    inter coulomb diff ik
+
+    ############## ad differentiation tuned for the reference accuracy
+
+    inter coulomb 1.0 p3m tune accuracy $ref_accuracy diff ad
+    integrate 0
+    set accuracy [lindex [lindex [inter coulomb] 0] 7]
+    puts "p3m-charges (ad): [inter coulomb]"
+
+    set rmsf 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	set resF [part $i pr f]
+	set tgtF $F($i)
+	set dx [expr abs(([lindex $resF 0] - [lindex $tgtF 0]))]
+	set dy [expr abs(([lindex $resF 1] - [lindex $tgtF 1]))]
+	set dz [expr abs(([lindex $resF 2] - [lindex $tgtF 2]))]
+	set rmsf [expr $rmsf + $dx*$dx + $dy*$dy + $dz*$dz]
+    }
+    set rmsf [expr sqrt($rmsf/[setmd n_part])]
+    # both the reference and the tuned forces are off by their accuracy
+    puts "p3m-charges (ad, tuned): rms force deviation $rmsf, accuracy $accuracy"
+    if { $rmsf > $accuracy + $ref_accuracy } {
+	error "p3m-charges: force error with tuned ad differentiation too large"
+    }
+
+    ############## ad self force of a single particle
+
+    # the mesh force on a lone particle is only its force on its own
+    # mesh charge, which ad subtracts exactly
+    part deleteall
+    set box [setmd box_l]
+    part 0 pos [expr 0.31*[lindex $box 0]] [expr 0.57*[lindex $box 1]] [expr 0.83*[lindex $box 2]] q 1.0
+    integrate 0
+    set f [part 0 pr f]
+    set fabs [expr sqrt([lindex $f 0]*[lindex $f 0] + [lindex $f 1]*[lindex $f 1] + [lindex $f 2]*[lindex $f 2])]
+    puts "p3m-charges (ad): force on a single particle $fabs"
+    if { $fabs > 1e-10 } {
+	error "p3m-charges: ad self force of a single particle not subtracted"
+    }
    
    
      #end this part of the p3m-checks by cleaning the system .... 
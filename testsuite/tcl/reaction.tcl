@@ -0,0 +1,199 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#############################################################
+#                                                           #
+#  Test: catalytic reactions across cells and nodes         #
+#                                                           #
+#############################################################
+source "tests_common.tcl"
+
+require_feature "CATALYTIC_REACTIONS"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase reaction.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set box 10.
+set range 1.5
+
+setmd box_l $box $box $box
+setmd time_step 0.01
+setmd skin 0.3
+thermostat off
+
+# resting catalyzers (type 0) and reactants (type 1), no forces
+expr srand(42)
+for {set i 0} {$i < 20} {incr i} {
+    part $i pos [expr $box*rand()] [expr $box*rand()] [expr $box*rand()] type 0
+}
+for {set i 20} {$i < 400} {incr i} {
+    part $i pos [expr $box*rand()] [expr $box*rand()] [expr $box*rand()] type 1
+}
+
+# the rate is so large that every reactant in range is converted
+reaction reactant_type 1 catalyzer_type 0 product_type 2 range $range ct_rate 1e6
+
+if { [catch {
+    integrate 1
+
+    set converted 0
+    for {set i 20} {$i < 400} {incr i} {
+        set p [part $i print pos]
+        set in_range 0
+        for {set c 0} {$c < 20} {incr c} {
+            set d2 0
+            foreach a $p b [part $c print pos] {
+                set d [expr $a - $b]
+                set d [expr $d - $box*round($d/$box)]
+                set d2 [expr $d2 + $d*$d]
+            }
+            if { $d2 < $range*$range } { set in_range 1 }
+        }
+        set type [part $i print type]
+        if { $type != 1 + $in_range } {
+            error "particle $i has type $type, but is [expr $in_range ? {} : {not }]in range of a catalyzer"
+        }
+        incr converted $in_range
+    }
+    if { $converted == 0 } {
+        error "no reactant was in range of a catalyzer"
+    }
+} res ] } {
+    error_exit $res
+}
+
+if { ! [has_feature "ROTATION"] } {
+    ok_exit
+}
+
+# In the swap mode, each conversion of a reactant in the lower half
+# space of a catalyzer is paired with the conversion of a product in
+# its upper half space, so the numbers of reactants and products in
+# range of a catalyzer stay the same. A particle in range of several
+# catalyzers is only converted by one of them. The catalyzers point in
+# z direction.
+require_max_nodes_per_side 3
+reaction off
+part deleteall
+
+# count the reactants and products within the range of each catalyzer
+proc count_around {catalyzers n_part} {
+    global box range
+    set res ""
+    foreach c $catalyzers {
+        set n(1) 0
+        set n(2) 0
+        for {set i 0} {$i < $n_part} {incr i} {
+            set type [part $i print type]
+            if { $type == 0 } { continue }
+            set d2 0
+            foreach a [part $i print pos] b [part $c print pos] {
+                set d [expr $a - $b]
+                set d [expr $d - $box*round($d/$box)]
+                set d2 [expr $d2 + $d*$d]
+            }
+            if { $d2 < $range*$range } { incr n($type) }
+        }
+        lappend res [list $n(1) $n(2)]
+    }
+    return $res
+}
+
+proc count_types {n_part} {
+    set n(0) 0
+    set n(1) 0
+    set n(2) 0
+    for {set i 0} {$i < $n_part} {incr i} {
+        incr n([part $i print type])
+    }
+    return [list $n(1) $n(2)]
+}
+
+if { [catch {
+    # isolated catalyzers at the node and periodic boundaries, each
+    # surrounded by reactants and products
+    set catalyzers ""
+    set n_part 0
+    foreach cx {4.9 9.9} {
+        foreach cy {0.1 5.1} {
+            foreach cz {4.9 9.9} {
+                part $n_part pos $cx $cy $cz type 0
+                lappend catalyzers $n_part
+                incr n_part
+                for {set k 0} {$k < 20} {incr k} {
+                    while { 1 } {
+                        set d [list [expr 2.8*rand() - 1.4] [expr 2.8*rand() - 1.4] [expr 2.8*rand() - 1.4]]
+                        if { [veclen $d] < 1.4 } { break }
+                    }
+                    part $n_part pos [expr $cx + [lindex $d 0]] [expr $cy + [lindex $d 1]] \
+                        [expr $cz + [lindex $d 2]] type [expr 1 + $k % 2]
+                    incr n_part
+                }
+            }
+        }
+    }
+
+    reaction reactant_type 1 catalyzer_type 0 product_type 2 range $range ct_rate 1e6 swap on
+
+    set before [count_around $catalyzers $n_part]
+    set types_before ""
+    for {set i 0} {$i < $n_part} {incr i} { lappend types_before [part $i print type] }
+    integrate 1
+    set after [count_around $catalyzers $n_part]
+    if { $before != $after } {
+        error "swap: the reactants and products at the catalyzers changed from $before to $after"
+    }
+    set n_changed 0
+    for {set i 0} {$i < $n_part} {incr i} {
+        if { [part $i print type] != [lindex $types_before $i] } { incr n_changed }
+    }
+    if { $n_changed == 0 } {
+        error "swap: no particle was converted"
+    }
+
+    # many catalyzers with overlapping ranges; a particle converted by
+    # two catalyzers would unbalance the numbers of reactants and
+    # products
+    reaction off
+    part deleteall
+    set n_part 0
+    for {set i 0} {$i < 60} {incr i} {
+        part $n_part pos [expr $box*rand()] [expr $box*rand()] [expr $box*rand()] type 0
+        incr n_part
+    }
+    for {set i 0} {$i < 600} {incr i} {
+        part $n_part pos [expr $box*rand()] [expr $box*rand()] [expr $box*rand()] \
+            type [expr 1 + $i % 2]
+        incr n_part
+    }
+
+    reaction reactant_type 1 catalyzer_type 0 product_type 2 range $range ct_rate 1e6 swap on
+
+    set before [count_types $n_part]
+    for {set step 0} {$step < 5} {incr step} {
+        integrate 1
+        set after [count_types $n_part]
+        if { $before != $after } {
+            error "swap: the numbers of reactants and products changed from $before to $after"
+        }
+    }
+} res ] } {
+    error_exit $res
+}
+
+ok_exit
@@ -0,0 +1,94 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#############################################################
+#                                                           #
+#  Test: skin tuning together with load balancing           #
+#                                                           #
+#############################################################
+source "tests_common.tcl"
+
+require_feature "LENNARD_JONES"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase skin_tune.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set epsilon 1e-8
+
+setmd box_l 10. 10. 10.
+setmd time_step 0.005
+setmd skin 0.4
+thermostat off
+
+inter 0 0 lennard-jones 1.0 1.0 2.5 auto 0.0
+
+# a cubic lattice with random velocities that is denser in the upper
+# half of the box, so that the balancing moves the node boundaries
+expr srand(42)
+set n_part 0
+for {set x 0} {$x < 8} {incr x} {
+    for {set y 0} {$y < 8} {incr y} {
+        for {set z 0} {$z < 8} {incr z} {
+            set px [expr 1.25*$x]
+            if { $x >= 4 } { set px [expr 5. + ($x - 4)] }
+            part $n_part pos $px [expr 1.25*$y] [expr 1.25*$z] type 0 \
+                v [expr rand() - 0.5] [expr rand() - 0.5] [expr rand() - 0.5]
+            incr n_part
+        }
+    }
+}
+
+proc forces {} {
+    global n_part
+    set res ""
+    for {set i 0} {$i < $n_part} {incr i} {
+        lappend res [part $i print f]
+    }
+    return $res
+}
+
+if { [catch {
+    integrate 0
+    set energy [analyze energy total]
+
+    # the nodes have to agree on the skin, otherwise pairs are missed
+    # and the energy is not conserved
+    setmd balance_interval 10
+    setmd skin_tune_interval 5
+    integrate 1000
+    set tuned [forces]
+
+    set drift [expr abs([analyze energy total] - $energy)/abs($energy)]
+    if { $drift > 1e-2 } {
+        error "energy drift $drift with skin tuning and balancing"
+    }
+
+    # recalculate the forces with equal domains and fresh lists
+    setmd balance_interval 0
+    setmd skin_tune_interval 0
+    integrate 0
+    foreach fa $tuned fb [forces] {
+        if { [veclen [vecsub $fa $fb]] > $epsilon*(1. + [veclen $fa]) } {
+            error "force differs after tuning: $fa vs. $fb"
+        }
+    }
+} res ] } {
+    error_exit $res
+}
+
+ok_exit
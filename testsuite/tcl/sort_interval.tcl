@@ -0,0 +1,119 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#############################################################
+#                                                           #
+#  Test: spatial sorting of the particles in the cells      #
+#                                                           #
+#############################################################
+source "tests_common.tcl"
+
+require_feature "LENNARD_JONES"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase sort_interval.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set epsilon 1e-6
+
+setmd box_l 10. 10. 10.
+setmd time_step 0.005
+setmd skin 0.3
+thermostat off
+
+inter 0 0 lennard-jones 1.0 1.0 1.12246 0.25 0.0
+inter 0 harmonic 10.0 1.0
+
+# chains of 10 particles on a lattice, with random displacements
+expr srand(42)
+set pid 0
+for {set x 0} {$x < 5} {incr x} {
+    for {set y 0} {$y < 5} {incr y} {
+        for {set z 0} {$z < 10} {incr z} {
+            part $pid pos [expr 2.*$x + 0.2*rand()] [expr 2.*$y + 0.2*rand()] [expr 0.95*$z] \
+                v [expr rand() - 0.5] [expr rand() - 0.5] [expr rand() - 0.5] type 0
+            if { $z > 0 } { part $pid bond 0 [expr $pid - 1] }
+            incr pid
+        }
+    }
+}
+set n_part [setmd n_part]
+
+proc state {} {
+    global n_part
+    set res ""
+    for {set i 0} {$i < $n_part} {incr i} {
+        lappend res [concat [part $i print pos] [part $i print v]]
+    }
+    return $res
+}
+
+proc set_state {state} {
+    set i 0
+    foreach p $state {
+        part $i pos [lindex $p 0] [lindex $p 1] [lindex $p 2] v [lindex $p 3] [lindex $p 4] [lindex $p 5]
+        incr i
+    }
+}
+
+proc run {cellsystem interval} {
+    global start
+    cellsystem $cellsystem
+    setmd sort_interval $interval
+    set_state $start
+    invalidate_system
+    integrate 200
+    return [list [state] [analyze energy total]]
+}
+
+if { [catch {
+    if { [setmd sort_interval] != 0 } {
+        error "sort_interval should be off by default"
+    }
+    if { ![catch {setmd sort_interval -1}] } {
+        error "negative sort_interval was accepted"
+    }
+
+    set start [state]
+
+    foreach cellsystem {domain_decomposition nsquare} {
+        set reference [run $cellsystem 0]
+        foreach interval {1 3} {
+            set res [run $cellsystem $interval]
+            # the order of the force summation differs, but not more
+            # than the rounding errors over a short run
+            foreach a [lindex $res 0] b [lindex $reference 0] {
+                foreach x $a y $b {
+                    if { abs($x - $y) > $epsilon } {
+                        error "$cellsystem, sort_interval $interval: particle differs, $a vs. $b"
+                    }
+                }
+            }
+            if { abs([lindex $res 1] - [lindex $reference 1]) > $epsilon } {
+                error "$cellsystem, sort_interval $interval: energy [lindex $res 1] differs from [lindex $reference 1]"
+            }
+        }
+    }
+    # bonds are found after sorting, i.e. the local particle table is correct
+    if { [lindex [part 1 print bonds] 0 0] != "0 0" } {
+        error "bonds are broken: [part 1 print bonds]"
+    }
+} res ] } {
+    error_exit $res
+}
+
+ok_exit
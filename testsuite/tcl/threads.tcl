@@ -0,0 +1,101 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#############################################################
+#                                                           #
+#  Test: threaded pair forces                               #
+#                                                           #
+#############################################################
+source "tests_common.tcl"
+
+require_feature "LENNARD_JONES"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase threads.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+if { [catch {setmd n_threads 4}] } {
+    ignore_exit "Threads require OpenMP."
+}
+setmd n_threads 1
+
+setmd box_l 12. 12. 12.
+setmd time_step 0.005
+setmd skin 0.4
+thermostat off
+
+# two species; the interactions only change the pair, so that the
+# threaded pair loop is used also when features like AFFINITY are
+# compiled in
+inter 0 0 lennard-jones 1.0 1.0 2.5 auto 0.0
+inter 0 1 lennard-jones 1.0 1.2 2.0 auto 0.0
+inter 1 1 lennard-jones 1.5 1.0 1.12246 0.25 0.0
+
+expr srand(42)
+set n_part 0
+for {set x 0} {$x < 10} {incr x} {
+    for {set y 0} {$y < 10} {incr y} {
+        for {set z 0} {$z < 10} {incr z} {
+            part $n_part pos [expr 1.2*$x + 0.1*rand()] [expr 1.2*$y + 0.1*rand()] \
+                [expr 1.2*$z + 0.1*rand()] type [expr $n_part % 2] \
+                v [expr rand() - 0.5] [expr rand() - 0.5] [expr rand() - 0.5]
+            incr n_part
+        }
+    }
+}
+
+proc state {} {
+    global n_part
+    set res ""
+    for {set i 0} {$i < $n_part} {incr i} {
+        lappend res [concat [part $i print pos] [part $i print v] [part $i print f]]
+    }
+    return $res
+}
+
+# the forces and trajectories do not depend on the number of threads
+proc compare {a b what} {
+    foreach pa $a pb $b {
+        if { $pa != $pb } {
+            error "$what: $pa vs. $pb"
+        }
+    }
+}
+
+if { [catch {
+    foreach cs {"domain_decomposition" "domain_decomposition -no_verlet_list"} {
+        eval cellsystem $cs
+        set start [state]
+
+        setmd n_threads 1
+        integrate 100
+        set serial [state]
+
+        # back to the start
+        for {set i 0} {$i < $n_part} {incr i} {
+            eval part $i pos [lrange [lindex $start $i] 0 2] v [lrange [lindex $start $i] 3 5]
+        }
+        setmd time 0
+        setmd n_threads 4
+        integrate 100
+        compare $serial [state] "$cs with 4 threads"
+    }
+} res ] } {
+    error_exit $res
+}
+
+ok_exit
@@ -0,0 +1,91 @@
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#############################################################
+#                                                           #
+#  Test: compressed trajectories                            #
+#                                                           #
+#############################################################
+source "tests_common.tcl"
+
+require_feature "LENNARD_JONES"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase trajectory.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+set filename "trajectory.trj"
+set precision 1e-4
+set v_precision 1e-3
+
+setmd box_l 6. 6. 6.
+setmd time_step 0.01
+setmd skin 0.4
+thermostat langevin 1.0 1.0
+inter 0 0 lennard-jones 1.0 1.0 1.12246 0.25 0.0
+
+for {set i 0} {$i < 100} {incr i} {
+    part $i pos [expr 6.*[t_random]] [expr 6.*[t_random]] [expr 6.*[t_random]]
+}
+inter forcecap 20
+integrate 200
+inter forcecap 0
+
+if { [catch {
+    trajectory open $filename precision $precision velocities $v_precision
+    set frames ""
+    for {set f 0} {$f < 5} {incr f} {
+        integrate 50
+        trajectory write
+        set frame [setmd time]
+        for {set i 0} {$i < 100} {incr i} {
+            lappend frame [concat [part $i print pos] [part $i print v]]
+        }
+        lappend frames $frame
+    }
+    trajectory close
+
+    if { [trajectory frames $filename] != 5 } {
+        error "trajectory has [trajectory frames $filename] instead of 5 frames"
+    }
+
+    # random access, backwards
+    for {set f 4} {$f >= 0} {incr f -1} {
+        set time [trajectory read $filename $f]
+        set frame [lindex $frames $f]
+        if { abs($time - [lindex $frame 0]) > 1e-10 } {
+            error "frame $f has time $time instead of [lindex $frame 0]"
+        }
+        for {set i 0} {$i < 100} {incr i} {
+            set res [concat [part $i print pos] [part $i print v]]
+            set ref [lindex $frame [expr $i + 1]]
+            for {set d 0} {$d < 6} {incr d} {
+                set eps [expr $d < 3 ? $precision : $v_precision]
+                if { abs([lindex $res $d] - [lindex $ref $d]) > $eps } {
+                    error "particle $i of frame $f is $res instead of $ref"
+                }
+            }
+        }
+    }
+} res ] } {
+    file delete $filename $filename.idx
+    error_exit $res
+}
+
+file delete $filename $filename.idx
+
+ok_exit
@@ -0,0 +1,110 @@
+#############################################################
+#                                                           #
+#  Non-bonded kernel benchmark: WCA polymer melt            #
+#                                                           #
+#############################################################
+#
+# Copyright (C) 2016 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Reports the pairs per second of the per-pair force routine and of
+# the batched kernel (setmd nonbonded_batch) for a coarse-grained
+# polymer melt, and the time per force calculation with the batch
+# switched off and on. Run on a single node, and for the vectorized
+# path compile with e.g. -march=native.
+
+# System parameters
+#############################################################
+
+set n_poly      200
+set n_mono      50
+set density     0.85
+
+set box_l [expr pow($n_poly*$n_mono/$density, 1.0/3.0)]
+
+# Interaction parameters (WCA + FENE)
+#############################################################
+
+set lj1_eps     1.0
+set lj1_sig     1.0
+set lj1_cut     1.12246
+set lj1_shift   [calc_lj_shift $lj1_sig $lj1_cut]
+
+set fene_k      30.0
+set fene_r      1.5
+
+# Integration parameters
+#############################################################
+
+setmd time_step 0.01
+setmd skin      0.4
+thermostat langevin 1.0 1.0
+
+set warm_steps   100
+set warm_n_times 30
+set min_dist     0.9
+
+# number of sweeps for the kernel timing
+set rounds       20
+
+set tcl_precision 6
+
+#############################################################
+#  Setup System                                             #
+#############################################################
+
+setmd box_l $box_l $box_l $box_l
+
+inter 0 fene $fene_k $fene_r
+inter 0 0 lennard-jones $lj1_eps $lj1_sig $lj1_cut $lj1_shift 0
+
+polymer $n_poly $n_mono 0.97 mode RW bond 0
+
+#############################################################
+#  Warmup Integration                                       #
+#############################################################
+
+set act_min_dist [analyze mindist]
+set cap 20
+inter forcecap $cap
+
+set i 0
+while { $i < $warm_n_times && $act_min_dist < $min_dist } {
+    integrate $warm_steps
+    set act_min_dist [analyze mindist]
+    set cap [expr $cap+10]
+    inter forcecap $cap
+    incr i
+}
+inter forcecap 0
+integrate $warm_steps
+
+#############################################################
+#  Timing                                                   #
+#############################################################
+
+set res [time_nonbonded_kernel $rounds]
+puts "pairs in Verlet lists:     [lindex $res 0]"
+puts "scalar loop  (pairs/s):    [lindex $res 1]"
+puts "batched loop (pairs/s):    [lindex $res 2]"
+puts "speedup:                   [expr [lindex $res 2]/[lindex $res 1]]"
+
+setmd timings $rounds
+foreach batch {0 1} {
+    setmd nonbonded_batch $batch
+    puts "nonbonded_batch $batch: [time_integration] ms per force calculation"
+}